@@ -0,0 +1,104 @@
+#include "GlfwStub.hpp"
+#include <unordered_set>
+
+struct GLFWwindow {
+  void *userPointer = nullptr;
+  int cursorMode = GLFW_CURSOR_NORMAL;
+  std::unordered_set<int> pressedKeys;
+  GLFWcursorposfun cursorCallback = nullptr;
+  GLFWscrollfun scrollCallback = nullptr;
+  GLFWkeyfun keyCallback = nullptr;
+};
+
+auto glfw_stub::createWindow() -> GLFWwindow * { return new GLFWwindow(); }
+
+void glfw_stub::destroyWindow(GLFWwindow *window) { delete window; }
+
+void glfw_stub::setKey(GLFWwindow *window, int key, bool pressed) {
+  if (pressed)
+    window->pressedKeys.insert(key);
+  else
+    window->pressedKeys.erase(key);
+}
+
+void glfw_stub::sendKey(GLFWwindow *window, int key, int action) {
+  setKey(window, key, action != GLFW_RELEASE);
+  if (window->keyCallback)
+    window->keyCallback(window, key, 0, action, 0);
+}
+
+void glfw_stub::sendCursor(GLFWwindow *window, double x, double y) {
+  if (window->cursorCallback)
+    window->cursorCallback(window, x, y);
+}
+
+void glfw_stub::sendScroll(GLFWwindow *window, double x, double y) {
+  if (window->scrollCallback)
+    window->scrollCallback(window, x, y);
+}
+
+// ---- GLFW entry points used by InputSystem --------------------------------
+
+extern "C" {
+
+void glfwSetWindowUserPointer(GLFWwindow *window, void *pointer) {
+  window->userPointer = pointer;
+}
+
+void *glfwGetWindowUserPointer(GLFWwindow *window) {
+  return window->userPointer;
+}
+
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow *window,
+                                          GLFWcursorposfun callback) {
+  auto previous = window->cursorCallback;
+  window->cursorCallback = callback;
+  return previous;
+}
+
+GLFWscrollfun glfwSetScrollCallback(GLFWwindow *window,
+                                    GLFWscrollfun callback) {
+  auto previous = window->scrollCallback;
+  window->scrollCallback = callback;
+  return previous;
+}
+
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow *window, GLFWkeyfun callback) {
+  auto previous = window->keyCallback;
+  window->keyCallback = callback;
+  return previous;
+}
+
+// The stub window never resizes, minimizes or needs repainting
+GLFWframebuffersizefun
+glfwSetFramebufferSizeCallback(GLFWwindow *window,
+                               GLFWframebuffersizefun callback) {
+  return nullptr;
+}
+
+GLFWwindowiconifyfun
+glfwSetWindowIconifyCallback(GLFWwindow *window,
+                             GLFWwindowiconifyfun callback) {
+  return nullptr;
+}
+
+GLFWwindowfocusfun glfwSetWindowFocusCallback(GLFWwindow *window,
+                                              GLFWwindowfocusfun callback) {
+  return nullptr;
+}
+
+GLFWwindowrefreshfun glfwSetWindowRefreshCallback(
+    GLFWwindow *window, GLFWwindowrefreshfun callback) {
+  return nullptr;
+}
+
+int glfwGetKey(GLFWwindow *window, int key) {
+  return window->pressedKeys.count(key) ? GLFW_PRESS : GLFW_RELEASE;
+}
+
+void glfwSetInputMode(GLFWwindow *window, int mode, int value) {
+  if (mode == GLFW_CURSOR)
+    window->cursorMode = value;
+}
+
+} // extern "C"
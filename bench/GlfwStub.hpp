@@ -0,0 +1,21 @@
+#pragma once
+#include <GLFW/glfw3.h>
+
+/*
+@brief In-process stand-in for the few GLFW window calls the input and camera
+code makes, so CPU benchmarks run without a display.
+
+Link GlfwStub.cpp instead of the GLFW library. Key state is set directly and
+events are delivered through the callbacks the code under test registered.
+*/
+namespace glfw_stub {
+
+auto createWindow() -> GLFWwindow *;
+void destroyWindow(GLFWwindow *window);
+
+void setKey(GLFWwindow *window, int key, bool pressed);
+void sendKey(GLFWwindow *window, int key, int action);
+void sendCursor(GLFWwindow *window, double x, double y);
+void sendScroll(GLFWwindow *window, double x, double y);
+
+} // namespace glfw_stub
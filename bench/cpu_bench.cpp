@@ -0,0 +1,640 @@
+// CPU microbenchmarks for the per-frame paths that do not touch the GPU:
+// camera matrices, camera controllers, input polling and the frame prep done
+// in VkApp::run before drawFrame, RenderScene batching, SceneStore transform
+// propagation, galaxy generation, the Barnes-Hut N-body step and JobSystem
+// scaling. GLFW is replaced by GlfwStub.cpp.
+//
+// The Record* benchmarks are the exception: they record command buffers on
+// the first Vulkan device to compare the loader's exports with
+// vulkan::dispatch, or time the grid's scene pass recording against a stubbed
+// dispatch table, and skip without a driver (a software ICD will do).
+
+#include "Camera.hpp"
+#include "CameraController.hpp"
+#include "GalaxyGenerator.hpp"
+#include "GlfwStub.hpp"
+#include "GridRenderer.hpp"
+#include "InputSystem.hpp"
+#include "JobSystem.hpp"
+#include "NBodySimulation.hpp"
+#include "RenderScene.hpp"
+#include "SceneStore.hpp"
+#include "SimdMath.hpp"
+#include "VulkanDispatch.hpp"
+
+#include <benchmark/benchmark.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+/* @brief Stub window, input system, camera and controllers for one run. */
+class FrameFixture : public benchmark::Fixture {
+public:
+  void SetUp(const benchmark::State &) override {
+    window = glfw_stub::createWindow();
+    input = std::make_unique<InputSystem>(window);
+    camera = std::make_unique<Camera>(16.0f / 9.0f);
+  }
+
+  void TearDown(const benchmark::State &) override {
+    input.reset();
+    camera.reset();
+    glfw_stub::destroyWindow(window);
+  }
+
+  // Hold movement and sprint keys so the controllers take the moving paths
+  void pressMovementKeys() {
+    glfw_stub::setKey(window, GLFW_KEY_W, true);
+    glfw_stub::setKey(window, GLFW_KEY_D, true);
+    glfw_stub::setKey(window, GLFW_KEY_E, true);
+    glfw_stub::setKey(window, GLFW_KEY_LEFT_SHIFT, true);
+  }
+
+  GLFWwindow *window = nullptr;
+  std::unique_ptr<InputSystem> input;
+  std::unique_ptr<Camera> camera;
+};
+
+constexpr float FRAME_DT = 1.0f / 60.0f;
+
+} // namespace
+
+// ---- Camera ----------------------------------------------------------------
+
+BENCHMARK_F(FrameFixture, CameraViewMatrix)(benchmark::State &state) {
+  for (auto _ : state) {
+    camera->moveRight(0.001f);
+    benchmark::DoNotOptimize(camera->getViewMatrix());
+  }
+}
+
+BENCHMARK_F(FrameFixture, CameraProjectionMatrix)(benchmark::State &state) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(camera->getProjectionMatrix());
+}
+
+BENCHMARK_F(FrameFixture, CameraViewProjection)(benchmark::State &state) {
+  for (auto _ : state) {
+    camera->moveRight(0.001f);
+    benchmark::DoNotOptimize(camera->getViewProjectionMatrix());
+  }
+}
+
+// ---- Controllers -----------------------------------------------------------
+
+BENCHMARK_F(FrameFixture, FreeControllerUpdate)(benchmark::State &state) {
+  FreeCameraController controller;
+  pressMovementKeys();
+  input->update();
+  for (auto _ : state) {
+    controller.update(*camera, *input, FRAME_DT);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_F(FrameFixture, OrbitControllerUpdate)(benchmark::State &state) {
+  OrbitCameraController controller;
+  pressMovementKeys();
+  input->update();
+  for (auto _ : state) {
+    controller.update(*camera, *input, FRAME_DT);
+    benchmark::ClobberMemory();
+  }
+}
+
+// ---- Input -----------------------------------------------------------------
+
+// Binding table size is the argument; roughly a quarter of keys are held
+BENCHMARK_DEFINE_F(FrameFixture, InputUpdate)(benchmark::State &state) {
+  const int bindings = static_cast<int>(state.range(0));
+  const InputAction actions[] = {InputAction::MoveForward,
+                                 InputAction::MoveRight, InputAction::MoveUp,
+                                 InputAction::SpeedBoost};
+  for (int i = 0; i < bindings; i++) {
+    int key = GLFW_KEY_LAST + 1 + i;
+    input->bindKey(key, actions[i % 4], (i & 1) ? 1.0f : -1.0f);
+    glfw_stub::setKey(window, key, i % 4 == 0);
+  }
+  for (auto _ : state) {
+    input->update();
+    benchmark::DoNotOptimize(input->getAxis(InputAction::MoveForward));
+  }
+  state.SetItemsProcessed(state.iterations() * bindings);
+}
+BENCHMARK_REGISTER_F(FrameFixture, InputUpdate)->RangeMultiplier(4)->Range(16, 4096);
+
+// ---- Frame prep --------------------------------------------------------------
+
+// Everything VkApp::run does on the CPU before drawFrame records commands:
+// poll input, run the controller and build the grid push constants. Command
+// recording is RecordGridPass below; submission is covered by vkapp_bench.
+BENCHMARK_F(FrameFixture, FramePrep)(benchmark::State &state) {
+  FreeCameraController controller;
+  pressMovementKeys();
+  for (auto _ : state) {
+    input->update();
+    controller.update(*camera, *input, FRAME_DT);
+    GridPushConstants constants = GridRenderer::makeConstants(*camera);
+    benchmark::DoNotOptimize(constants);
+  }
+}
+
+BENCHMARK_F(FrameFixture, GridConstants)(benchmark::State &state) {
+  for (auto _ : state) {
+    camera->moveUp(0.01f);
+    benchmark::DoNotOptimize(GridRenderer::makeConstants(*camera));
+  }
+}
+
+// ---- Job system --------------------------------------------------------------
+
+// Thread counts from 1 (the caller alone) to one per core, doubling
+static void threadCounts(benchmark::internal::Benchmark *b) {
+  uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  for (uint32_t t = 1; t < cores; t *= 2)
+    b->Arg(t);
+  b->Arg(cores);
+}
+
+// Scheduling overhead: 1024 empty jobs submitted and waited for
+static void JobSpawnWait(benchmark::State &state) {
+  JobSystem jobs(static_cast<uint32_t>(state.range(0)) - 1);
+  for (auto _ : state) {
+    JobCounter counter;
+    for (uint32_t i = 0; i < 1024; i++)
+      jobs.run([] {}, &counter);
+    jobs.wait(counter);
+  }
+  state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(JobSpawnWait)->Apply(threadCounts)->UseRealTime();
+
+// parallelFor over 1M independent elements with automatic grain
+static void ParallelForScaling(benchmark::State &state) {
+  JobSystem jobs(static_cast<uint32_t>(state.range(0)) - 1);
+  std::vector<float> data(1 << 20, 1.0f);
+  for (auto _ : state) {
+    jobs.parallelFor(static_cast<uint32_t>(data.size()),
+                     [&](uint32_t begin, uint32_t end) {
+                       for (uint32_t i = begin; i < end; i++)
+                         data[i] = std::sqrt(data[i] * 1.0001f + 0.5f);
+                     });
+    benchmark::DoNotOptimize(data.data());
+  }
+  state.SetItemsProcessed(state.iterations() * data.size());
+}
+BENCHMARK(ParallelForScaling)
+    ->Apply(threadCounts)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// ---- Scene batching ----------------------------------------------------------
+
+// Cull and batch a mesh field from a camera that sees roughly half of it;
+// the second argument is the number of distinct meshes and the third the
+// number of threads culling
+static void SceneBuildBatches(benchmark::State &state) {
+  auto count = static_cast<uint32_t>(state.range(0));
+  auto meshes = static_cast<uint32_t>(state.range(1));
+  auto threads = static_cast<uint32_t>(state.range(2));
+  JobSystem jobs(threads - 1);
+
+  vulkan::RenderScene scene;
+  float half = 0.0f;
+  for (uint32_t m = 0; m < meshes; m++) {
+    vulkan::MeshAllocation mesh{};
+    mesh.firstIndex = m * 3000;
+    mesh.indexCount = 3000;
+    mesh.boundsMax[0] = mesh.boundsMax[1] = mesh.boundsMax[2] = 1.0f;
+    mesh.sphere[0] = mesh.sphere[1] = mesh.sphere[2] = 0.5f;
+    mesh.sphere[3] = 0.87f;
+    half = vulkan::addObjectGrid(scene, scene.addMesh(mesh),
+                                 m % 2, // opaque / double-sided
+                                 count / meshes);
+  }
+
+  Camera camera(16.0f / 9.0f, glm::vec3(0.0f, 0.3f * half, 1.5f * half));
+  glm::mat4 viewProj = camera.getViewProjectionMatrix();
+
+  vulkan::DrawBatches batches;
+  for (auto _ : state) {
+    scene.buildBatches(batches, &viewProj, &jobs);
+    benchmark::DoNotOptimize(batches.commands.data());
+  }
+  state.SetItemsProcessed(state.iterations() * scene.size());
+  state.counters["visible"] = static_cast<double>(batches.instances.size());
+  state.counters["commands"] = static_cast<double>(batches.commands.size());
+}
+BENCHMARK(SceneBuildBatches)
+    ->ArgsProduct({{1024, 8192, 65536}, {1, 16}, {1}})
+    ->Args({262144, 16, std::max<int>(std::thread::hardware_concurrency(), 1)})
+    ->UseRealTime();
+
+// ---- Transform propagation -------------------------------------------------
+
+static void Mat4MultiplyGlm(benchmark::State &state) {
+  glm::mat4 a = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f));
+  glm::mat4 b = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0, 1, 0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    glm::mat4 out = a * b;
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(Mat4MultiplyGlm);
+
+static void Mat4MultiplySimd(benchmark::State &state) {
+  glm::mat4 a = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f));
+  glm::mat4 b = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0, 1, 0));
+  glm::mat4 out;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(a);
+    simd::mul(a, b, out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(Mat4MultiplySimd);
+
+// 1024 roots x 31 children x 31 grandchildren (~1M nodes). Every frame turns
+// the roots, so all world matrices are recomputed; the argument is the
+// number of threads including the caller.
+static void TransformPropagation(benchmark::State &state) {
+  auto threads = static_cast<uint32_t>(state.range(0));
+  JobSystem jobs(threads - 1);
+
+  vulkan::SceneStore store;
+  std::vector<vulkan::SceneNode> roots;
+  glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0, 0));
+  for (uint32_t r = 0; r < 1024; r++) {
+    roots.push_back(store.create(glm::mat4(1.0f)));
+    for (uint32_t c = 0; c < 31; c++) {
+      vulkan::SceneNode child = store.create(offset, roots.back());
+      for (uint32_t g = 0; g < 31; g++)
+        store.create(offset, child);
+    }
+  }
+  store.propagate(&jobs);
+
+  float angle = 0.0f;
+  for (auto _ : state) {
+    angle += 0.01f;
+    glm::mat4 spin = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0, 1, 0));
+    for (auto root : roots)
+      store.setLocal(root, spin);
+    store.propagate(&jobs);
+  }
+  state.SetItemsProcessed(state.iterations() * store.size());
+}
+BENCHMARK(TransformPropagation)
+    ->Apply(threadCounts)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Normal variates, four per iteration: the standard library against the
+// four-lane Box-Muller the galaxy generator uses
+static void RandomNormalStd(benchmark::State &state) {
+  std::mt19937 rng(1);
+  std::normal_distribution<float> normal;
+  for (auto _ : state) {
+    float v[4] = {normal(rng), normal(rng), normal(rng), normal(rng)};
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(RandomNormalStd);
+
+static void RandomNormalSimd(benchmark::State &state) {
+  simd::Random4 rng(1);
+  for (auto _ : state) {
+    simd::float4 a, b;
+    rng.normal(a, b);
+    benchmark::DoNotOptimize(a);
+  }
+  state.SetItemsProcessed(state.iterations() * 4);
+}
+BENCHMARK(RandomNormalSimd);
+
+// Four million stars of the default galaxy into memory, as when filling
+// upload staging; the argument is the number of threads including the caller
+static void GalaxyGenerate(benchmark::State &state) {
+  auto threads = static_cast<uint32_t>(state.range(0));
+  JobSystem jobs(threads - 1);
+  GalaxyDesc desc;
+  desc.stars = 1u << 22;
+  GalaxyGenerator galaxy(desc);
+  std::vector<Star> stars(galaxy.count());
+  for (auto _ : state) {
+    galaxy.generate(stars.data(), 0, galaxy.count(), &jobs);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * galaxy.count());
+  state.SetBytesProcessed(state.iterations() * galaxy.count() * sizeof(Star));
+}
+BENCHMARK(GalaxyGenerate)
+    ->Apply(threadCounts)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// N bodies of a default galaxy, by thread count
+static void nbodySizes(benchmark::internal::Benchmark *b) {
+  uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  for (int64_t n : {1 << 14, 1 << 17, 1 << 20}) {
+    for (uint32_t t = 1; t < cores; t *= 2)
+      b->Args({n, t});
+    b->Args({n, cores});
+  }
+}
+
+static auto nbodyGalaxy(uint32_t count) -> NBodySnapshot {
+  GalaxyDesc desc;
+  desc.stars = count;
+  GalaxyGenerator galaxy(desc);
+  std::vector<Star> stars(count);
+  galaxy.generate(stars.data(), 0, count);
+  return makeRotatingSnapshot(std::move(stars), 1e11f,
+                              NBodySettings().softening);
+}
+
+// One Barnes-Hut step (tree build, force pass and leapfrog). interactions
+// counts body-body and body-cell terms, so it compares with DirectSum
+static void NBodyStep(benchmark::State &state) {
+  auto count = static_cast<uint32_t>(state.range(0));
+  JobSystem jobs(static_cast<uint32_t>(state.range(1)) - 1);
+  NBodySimulation sim(nbodyGalaxy(count));
+  uint64_t interactions = 0;
+  for (auto _ : state) {
+    sim.step(&jobs);
+    interactions += sim.interactions();
+  }
+  state.counters["interactions"] = benchmark::Counter(
+      static_cast<double>(interactions), benchmark::Counter::kIsRate);
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(NBodyStep)
+    ->Apply(nbodySizes)
+    ->ArgNames({"n", "threads"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// The O(N^2) reference the tree is checked against, on every thread
+static void DirectSum(benchmark::State &state) {
+  auto count = static_cast<uint32_t>(state.range(0));
+  uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+  JobSystem jobs(cores - 1);
+  NBodySnapshot snapshot = nbodyGalaxy(count);
+  std::vector<glm::vec3> accelerations;
+  for (auto _ : state) {
+    NBodySimulation::directAccelerations(snapshot, NBodySettings().softening,
+                                         accelerations, &jobs);
+    benchmark::ClobberMemory();
+  }
+  state.counters["interactions"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) * count * count,
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK(DirectSum)
+    ->Arg(1 << 12)
+    ->Arg(1 << 14)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// ---- Vulkan dispatch --------------------------------------------------------
+
+namespace {
+
+/*
+@brief A bare device on the first physical device with one resettable command
+buffer, a pipeline layout to push constants through and a one-attachment
+render pass to build pipelines against.
+
+No queue work is ever submitted: the benchmarks only measure recording.
+*/
+struct RecordingDevice {
+  VkInstance instance = VK_NULL_HANDLE;
+  VkDevice device = VK_NULL_HANDLE;
+  VkCommandPool pool = VK_NULL_HANDLE;
+  VkCommandBuffer cmd = VK_NULL_HANDLE;
+  VkPipelineLayout layout = VK_NULL_HANDLE;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+  // The loader's exports in a table, called exactly like vulkan::dispatch
+  vulkan::DeviceDispatch loader;
+
+  RecordingDevice() {
+    VkApplicationInfo app{};
+    app.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app.apiVersion = VK_API_VERSION_1_2;
+    VkInstanceCreateInfo ici{};
+    ici.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    ici.pApplicationInfo = &app;
+    if (vkCreateInstance(&ici, nullptr, &instance) != VK_SUCCESS)
+      return;
+    uint32_t count = 1;
+    VkPhysicalDevice physical = VK_NULL_HANDLE;
+    vkEnumeratePhysicalDevices(instance, &count, &physical);
+    if (count == 0)
+      return;
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue{};
+    queue.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue.queueCount = 1;
+    queue.pQueuePriorities = &priority;
+    VkDeviceCreateInfo dci{};
+    dci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    dci.queueCreateInfoCount = 1;
+    dci.pQueueCreateInfos = &queue;
+    if (vkCreateDevice(physical, &dci, nullptr, &device) != VK_SUCCESS ||
+        !vulkan::dispatch.load(device)) {
+      device = VK_NULL_HANDLE;
+      return;
+    }
+#define VKAPP_LOADER_EXPORT(name) loader.name = name;
+    VKAPP_DEVICE_FUNCTIONS(VKAPP_LOADER_EXPORT)
+#undef VKAPP_LOADER_EXPORT
+
+    VkCommandPoolCreateInfo pci{};
+    pci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    vkCreateCommandPool(device, &pci, nullptr, &pool);
+    VkCommandBufferAllocateInfo ai{};
+    ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    ai.commandPool = pool;
+    ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    ai.commandBufferCount = 1;
+    vkAllocateCommandBuffers(device, &ai, &cmd);
+    VkPushConstantRange range{VK_SHADER_STAGE_ALL, 0, 128};
+    VkPipelineLayoutCreateInfo lci{};
+    lci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    lci.pushConstantRangeCount = 1;
+    lci.pPushConstantRanges = &range;
+    vkCreatePipelineLayout(device, &lci, nullptr, &layout);
+
+    VkAttachmentDescription color{};
+    color.format = COLOR_FORMAT;
+    color.samples = VK_SAMPLE_COUNT_1_BIT;
+    color.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    color.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    color.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    color.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+    VkRenderPassCreateInfo rpci{};
+    rpci.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    rpci.attachmentCount = 1;
+    rpci.pAttachments = &color;
+    rpci.subpassCount = 1;
+    rpci.pSubpasses = &subpass;
+    vkCreateRenderPass(device, &rpci, nullptr, &renderPass);
+  }
+
+  ~RecordingDevice() {
+    if (device) {
+      vkDestroyRenderPass(device, renderPass, nullptr);
+      vkDestroyPipelineLayout(device, layout, nullptr);
+      vkDestroyCommandPool(device, pool, nullptr);
+      vkDestroyDevice(device, nullptr);
+    }
+    if (instance)
+      vkDestroyInstance(instance, nullptr);
+  }
+};
+
+auto recordingDevice() -> RecordingDevice & {
+  static RecordingDevice device;
+  return device;
+}
+
+// What a draw-heavy frame records per object: viewport, scissor, push
+// constants and the draw's own state, outside a render pass so no pipeline
+// or attachments are needed
+void recordObjects(const vulkan::DeviceDispatch &vk, VkCommandBuffer cmd,
+                   VkPipelineLayout layout, uint32_t objects) {
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vk.vkBeginCommandBuffer(cmd, &begin);
+  VkViewport viewport{0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f};
+  VkRect2D scissor{{0, 0}, {1920, 1080}};
+  glm::mat4 transform(1.0f);
+  for (uint32_t i = 0; i < objects; i++) {
+    transform[3].x = static_cast<float>(i);
+    vk.vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vk.vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vk.vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_ALL, 0,
+                          sizeof(transform), &transform);
+  }
+  vk.vkEndCommandBuffer(cmd);
+  vk.vkResetCommandBuffer(cmd, 0);
+}
+
+constexpr uint32_t CALLS_PER_OBJECT = 3;
+
+void recordBenchmark(benchmark::State &state, bool direct) {
+  RecordingDevice &device = recordingDevice();
+  if (!device.device) {
+    state.SkipWithError("No Vulkan device");
+    return;
+  }
+  const vulkan::DeviceDispatch &vk = direct ? vulkan::dispatch : device.loader;
+  auto objects = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state)
+    recordObjects(vk, device.cmd, device.layout, objects);
+  // items/s is commands recorded per second; its inverse is the cost per
+  // call, including the driver's own work
+  state.SetItemsProcessed(state.iterations() * objects * CALLS_PER_OBJECT);
+}
+
+// A device entry point that does nothing and reports success
+template <typename PFN> struct NoOp;
+template <typename R, typename... Args> struct NoOp<R(VKAPI_PTR *)(Args...)> {
+  static VKAPI_ATTR R VKAPI_CALL call(Args...) {
+    if constexpr (!std::is_void_v<R>)
+      return R{};
+  }
+};
+
+// Every entry, optional ones included, pointing at a no-op
+auto stubDispatch() -> vulkan::DeviceDispatch {
+  vulkan::DeviceDispatch stub;
+#define VKAPP_STUB_ENTRY(name) stub.name = NoOp<PFN_##name>::call;
+  VKAPP_DEVICE_FUNCTIONS(VKAPP_STUB_ENTRY)
+  VKAPP_DEVICE_OPTIONAL_FUNCTIONS(VKAPP_STUB_ENTRY)
+#undef VKAPP_STUB_ENTRY
+  return stub;
+}
+
+} // namespace
+
+// The grid's scene pass as drawFrame records it (begin, pass, grid draw, end)
+// with vulkan::dispatch pointing at no-ops: the driver's share is gone, so
+// what is timed is the engine's own recording work. The device is only
+// needed to build the grid pipeline; run from the source tree so
+// build/shaders/ resolves.
+static void RecordGridPass(benchmark::State &state) {
+  RecordingDevice &device = recordingDevice();
+  if (!device.device || !device.renderPass) {
+    state.SkipWithError("No Vulkan device");
+    return;
+  }
+  RenderTargetLayout target;
+  target.renderPass = device.renderPass;
+  target.colorFormat = RecordingDevice::COLOR_FORMAT;
+  const VkExtent2D extent{1920, 1080};
+  std::unique_ptr<GridRenderer> grid;
+  try {
+    grid = std::make_unique<GridRenderer>(device.device, target, extent);
+  } catch (const std::runtime_error &e) {
+    state.SkipWithError(e.what());
+    return;
+  }
+  Camera camera(extent.width / static_cast<float>(extent.height));
+  GridPushConstants constants = GridRenderer::makeConstants(camera);
+
+  const vulkan::DeviceDispatch driver = vulkan::dispatch;
+  vulkan::dispatch = stubDispatch();
+  const vulkan::DeviceDispatch &vk = vulkan::dispatch;
+  VkRenderPassBeginInfo rpbi{};
+  rpbi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  rpbi.renderPass = device.renderPass;
+  rpbi.renderArea.extent = extent;
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  for (auto _ : state) {
+    vk.vkResetCommandBuffer(device.cmd, 0);
+    vk.vkBeginCommandBuffer(device.cmd, &begin);
+    vk.vkCmdBeginRenderPass(device.cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
+    grid->recordCommands(device.cmd, constants);
+    vk.vkCmdEndRenderPass(device.cmd);
+    vk.vkEndCommandBuffer(device.cmd);
+  }
+  vulkan::dispatch = driver;
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(RecordGridPass);
+
+// Every command through the loader's exported trampolines
+static void RecordLoader(benchmark::State &state) {
+  recordBenchmark(state, false);
+}
+BENCHMARK(RecordLoader)->RangeMultiplier(8)->Range(64, 32768);
+
+// The same commands through vulkan::dispatch, straight into the driver
+static void RecordDispatch(benchmark::State &state) {
+  recordBenchmark(state, true);
+}
+BENCHMARK(RecordDispatch)->RangeMultiplier(8)->Range(64, 32768);
+
+BENCHMARK_MAIN();
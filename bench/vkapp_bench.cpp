@@ -0,0 +1,775 @@
+// Headless benchmark: renders the grid offscreen along scripted camera paths
+// and prints frame-time percentiles, the CPU/GPU split and heap allocation
+// counts as JSON.
+//
+//   vkapp_bench [--scenario all|grid_sweep|low_altitude_skim|
+//                high_altitude_overview|mesh_indirect|mesh_per_object|
+//                mesh_occlusion|stars_compute|stars_raster|nbody_compute]
+//               [--frames N] [--warmup N] [--width W] [--height H]
+//               [--output file.json] [--trace trace.json] [--gpu index|name]
+//               [--mesh file.vmesh] [--objects N] [--stars N] [--nbody N]
+//               [--capture dir] [--capture-format png|pam]
+//               [--grid-levels 1|2] [--views N] [--static-passes]
+//
+// With --mesh, the mesh_* scenarios fly over a field of N copies of the mesh
+// drawn with multi-draw-indirect and with one draw per object.
+// mesh_occlusion adds GPU occlusion culling to the indirect path and reports
+// how many objects it skipped (occluded_objects) and how many the late phase
+// drew (late_drawn); devices without dynamic rendering skip it. Selecting it
+// keeps scene depth stored for the whole run, which the other scenarios
+// then pay for too.
+//
+// With --stars, stars_compute and stars_raster fly into a generated spiral
+// galaxy of N stars (GalaxyGenerator, fixed seed) drawn by StarRenderer's
+// compute rasterizer and as hardware points, and report throughput as
+// points_per_s (stars over mean GPU frame time, grid included). Try N from
+// 1000000 to 100000000; the stars take 16 bytes each of device memory and
+// are generated chunk by chunk into the upload staging buffer.
+//
+// With --nbody, nbody_compute flies the same path through a galaxy of N
+// bodies that NBodyCompute advances one step per frame, drawn straight from
+// its buffer by the compute star rasterizer, and reports interactions_per_s
+// (N^2 over mean GPU frame time, drawing included). Try N from 16384 to
+// 262144; each step costs N^2.
+//
+// With --capture, every measured frame is also recorded to
+// dir/<scenario>/; compare frame times with a run without it to see what
+// capture costs, and check dropped_frames for encoder backlog.
+//
+// --grid-levels picks the grid pipeline variant (see GridVariant) to compare
+// the single-level grid with the default two-level fade.
+//
+// --static-passes records the grid once per frame in flight and replays it
+// (GridRenderer::enableStatic); compare cpu_ms with a run without it.
+// static_grid in the report says whether the device could; it needs dynamic
+// rendering with nested command buffers and is skipped for separate passes
+// per view.
+//
+// --views N (2-4) renders a side-by-side camera rig and runs every grid
+// scenario twice, each on its own device: as one multiview pass
+// (<scenario>/multiview) and as one pass per view (<scenario>/passes). The
+// mesh scenarios are single-view and skipped.
+//
+// Run from the source directory so build/shaders/ resolves. On machines
+// without a GPU point the loader at a software ICD, e.g.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json
+
+#include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "GalaxyGenerator.hpp"
+#include "GeometryPool.hpp"
+#include "GridRenderer.hpp"
+#include "JobSystem.hpp"
+#include "MeshAsset.hpp"
+#include "MeshRenderer.hpp"
+#include "NBodyCompute.hpp"
+#include "NBodySimulation.hpp"
+#include "RenderScene.hpp"
+#include "StarRenderer.hpp"
+#include "Trace.hpp"
+#include "VulkanCore.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rig spacing for --views, in world units along the camera's right axis
+static constexpr float VIEW_SEPARATION = 0.3f;
+// Display value of a magnitude 0 star at 10 pc in the star scenarios
+static constexpr float STAR_EXPOSURE = 2e4f;
+
+// ---- allocation counting -------------------------------------------------
+
+static std::atomic<uint64_t> g_allocCount{0};
+static std::atomic<uint64_t> g_allocBytes{0};
+
+void *operator new(std::size_t size) {
+  g_allocCount.fetch_add(1, std::memory_order_relaxed);
+  g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+// ---- scenarios -------------------------------------------------------------
+
+struct Scenario {
+  const char *name;
+  std::vector<glm::vec3> points;
+  // Draw the mesh field over the grid, and how
+  bool meshes = false;
+  MeshRenderer::DrawMode drawMode = MeshRenderer::DrawMode::Indirect;
+  bool occlusion = false;
+  // Draw the star galaxy over the grid instead, and how
+  bool stars = false;
+  StarRenderer::Mode starMode = StarRenderer::Mode::Compute;
+  // Draw the n-body galaxy, stepping it every frame
+  bool nbody = false;
+};
+
+// Radius of the --stars galaxy, in parsecs
+static constexpr float STAR_GALAXY_RADIUS = 500.0f;
+// The --nbody galaxy has the same radius; about 25 frames per megayear and
+// a few hundred per orbit at mid radius
+static constexpr float NBODY_GALAXY_MASS = 1e9f;
+static const NBodySettings NBODY_SETTINGS{0.04f, 2.0f};
+
+// fieldHalfWidth > 0 adds the mesh scenarios, scaled to the field; stars the
+// star scenarios and nbody the n-body one
+static auto scenarios(float fieldHalfWidth, bool stars, bool nbody)
+    -> std::vector<Scenario> {
+  std::vector<Scenario> list = {
+      // Medium height pass across the grid, crossing both axes
+      {"grid_sweep",
+       {{-40.0f, 6.0f, 40.0f},
+        {-10.0f, 4.0f, 15.0f},
+        {10.0f, 5.0f, -5.0f},
+        {35.0f, 8.0f, -30.0f},
+        {5.0f, 6.0f, -45.0f}}},
+      // Close to the ground: finest LOD levels, horizon near screen centre
+      {"low_altitude_skim",
+       {{-30.0f, 0.3f, 20.0f},
+        {-10.0f, 0.15f, 8.0f},
+        {5.0f, 0.5f, 12.0f},
+        {20.0f, 0.2f, -6.0f},
+        {30.0f, 0.4f, 10.0f}}},
+      // Climbs through several LOD decades and looks down on the grid
+      {"high_altitude_overview",
+       {{0.0f, 20.0f, 30.0f},
+        {40.0f, 120.0f, 40.0f},
+        {-60.0f, 400.0f, 80.0f},
+        {-20.0f, 900.0f, -50.0f}}},
+  };
+  // From outside the disk to skimming through it; both star modes see
+  // identical frames
+  float r = STAR_GALAXY_RADIUS;
+  std::vector<glm::vec3> intoDisk = {{0.0f, 0.6f * r, 3.0f * r},
+                                     {0.8f * r, 0.3f * r, 1.2f * r},
+                                     {-0.4f * r, 0.08f * r, 0.2f * r},
+                                     {-1.2f * r, 0.4f * r, -0.8f * r}};
+  if (stars) {
+    Scenario compute{"stars_compute", intoDisk};
+    compute.stars = true;
+    Scenario raster = compute;
+    raster.name = "stars_raster";
+    raster.starMode = StarRenderer::Mode::Raster;
+    list.push_back(compute);
+    list.push_back(raster);
+  }
+  if (nbody) {
+    Scenario evolving{"nbody_compute", intoDisk};
+    evolving.nbody = true;
+    list.push_back(evolving);
+  }
+  if (fieldHalfWidth <= 0.0f)
+    return list;
+
+  // Low pass across the field (most objects culled) then up to where all of
+  // it is in view; both draw modes see identical frames
+  float h = fieldHalfWidth;
+  std::vector<glm::vec3> overField = {{-1.2f * h, 0.15f * h, 1.2f * h},
+                                      {-0.3f * h, 0.1f * h, 0.4f * h},
+                                      {0.6f * h, 0.4f * h, -0.2f * h},
+                                      {1.0f * h, 1.2f * h, 1.6f * h}};
+  list.push_back({"mesh_indirect", overField, true,
+                  MeshRenderer::DrawMode::Indirect});
+  list.push_back({"mesh_per_object", overField, true,
+                  MeshRenderer::DrawMode::PerObject});
+  list.push_back({"mesh_occlusion", overField, true,
+                  MeshRenderer::DrawMode::Indirect, true});
+  return list;
+}
+
+// ---- statistics ------------------------------------------------------------
+
+struct Stats {
+  double mean = 0.0, p50 = 0.0, p90 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+static auto summarize(std::vector<float> samples) -> Stats {
+  Stats s;
+  if (samples.empty())
+    return s;
+  std::sort(samples.begin(), samples.end());
+  auto rank = [&](double q) {
+    size_t i = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+    return static_cast<double>(samples[std::min(i, samples.size() - 1)]);
+  };
+  double sum = 0.0;
+  for (float v : samples)
+    sum += v;
+  s.mean = sum / samples.size();
+  s.p50 = rank(0.50);
+  s.p90 = rank(0.90);
+  s.p95 = rank(0.95);
+  s.p99 = rank(0.99);
+  s.max = samples.back();
+  return s;
+}
+
+static void writeStats(std::ostream &os, const char *name, const Stats &s) {
+  os << "\"" << name << "\": {\"mean\": " << s.mean << ", \"p50\": " << s.p50
+     << ", \"p90\": " << s.p90 << ", \"p95\": " << s.p95
+     << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << "}";
+}
+
+struct ScenarioResult {
+  std::string name;
+  std::string viewMode; // --views only
+  uint32_t frames = 0;
+  Stats frame, cpu, gpu;
+  bool gpuValid = false;
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  bool meshes = false;
+  double drawCalls = 0.0; // per frame, mesh scenarios only
+  double visibleObjects = 0.0;
+  bool occlusion = false;
+  double occludedObjects = 0.0; // per frame, mesh_occlusion only
+  double lateDrawn = 0.0;
+  bool stars = false;
+  bool nbody = false;
+  uint64_t capturedFrames = 0; // --capture only
+  uint64_t droppedFrames = 0;
+};
+
+// ---- runner ----------------------------------------------------------------
+
+struct Options {
+  uint32_t frames = 600;
+  uint32_t warmup = 60;
+  VkExtent2D extent{1280, 720};
+  std::string scenario = "all";
+  std::string output;
+  std::string trace;
+  std::string gpu;
+  std::string mesh;
+  uint32_t objects = 4096;
+  uint32_t stars = 0;
+  uint32_t nbody = 0;
+  std::string capture;
+  vulkan::CaptureFormat captureFormat = vulkan::CaptureFormat::Png;
+  GridVariant grid;
+  uint32_t views = 1;
+  bool staticPasses = false;
+};
+
+static auto parseArgs(int argc, char **argv, Options &opts) -> bool {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto next = [&]() -> const char * {
+      return i + 1 < argc ? argv[++i] : nullptr;
+    };
+    const char *value = nullptr;
+    if (arg == "--frames" && (value = next()))
+      opts.frames = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--warmup" && (value = next()))
+      opts.warmup = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--width" && (value = next()))
+      opts.extent.width =
+          static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--height" && (value = next()))
+      opts.extent.height =
+          static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--scenario" && (value = next()))
+      opts.scenario = value;
+    else if (arg == "--output" && (value = next()))
+      opts.output = value;
+    else if (arg == "--trace" && (value = next()))
+      opts.trace = value;
+    else if (arg == "--gpu" && (value = next()))
+      opts.gpu = value;
+    else if (arg == "--mesh" && (value = next()))
+      opts.mesh = value;
+    else if (arg == "--objects" && (value = next()))
+      opts.objects = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--stars" && (value = next()))
+      opts.stars = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--nbody" && (value = next()))
+      opts.nbody = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--capture" && (value = next()))
+      opts.capture = value;
+    else if (arg == "--capture-format" && (value = next()) &&
+             (std::strcmp(value, "png") == 0 || std::strcmp(value, "pam") == 0))
+      opts.captureFormat = std::strcmp(value, "png") == 0
+                               ? vulkan::CaptureFormat::Png
+                               : vulkan::CaptureFormat::Pam;
+    else if (arg == "--grid-levels" && (value = next()) &&
+             (std::strcmp(value, "1") == 0 || std::strcmp(value, "2") == 0))
+      opts.grid.levels = value[0] == '1' ? 1 : 2;
+    else if (arg == "--views" && (value = next()))
+      opts.views = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--static-passes")
+      opts.staticPasses = true;
+    else {
+      std::cerr << "Unknown or incomplete argument: " << arg << "\n";
+      return false;
+    }
+  }
+  return opts.frames > 0 && opts.extent.width > 0 && opts.extent.height > 0 &&
+         opts.views >= 1 && opts.views <= MAX_VIEWS;
+}
+
+// Mesh field shared by the mesh scenarios
+struct MeshField {
+  vulkan::GeometryPool geometry;
+  vulkan::RenderScene scene;
+  std::unique_ptr<MeshRenderer> renderer;
+  // Same field with occlusion culling; null when the device cannot
+  std::unique_ptr<MeshRenderer> occlusionRenderer;
+  // Culling, instance gather and capture encoding, as in VkApp
+  std::unique_ptr<JobSystem> jobs;
+  float halfWidth = 0.0f;
+  // --stars
+  std::unique_ptr<StarRenderer> stars;
+  // --nbody, and the renderer drawing its buffer
+  std::unique_ptr<NBodyCompute> nbody;
+  std::unique_ptr<StarRenderer> nbodyStars;
+};
+
+// The grid as VkApp draws it: every view at once under multiview or the one
+// this pass renders. A static grid is replayed through staticGrid instead.
+static void recordGrid(vulkan::VulkanCore &core, GridRenderer &grid,
+                       VkCommandBuffer cmd,
+                       const GridPushConstants *constants) {
+  if (grid.isStatic())
+    return;
+  if (core.usesMultiview())
+    grid.recordViews(cmd, core.frameIndex(), constants, core.viewCount());
+  else
+    grid.recordCommands(cmd, constants[core.viewIndex()]);
+}
+
+// drawFrame's staticFunc opening the pass with the grid; null unless static
+static auto staticGrid(vulkan::VulkanCore &core, GridRenderer &grid,
+                       const GridPushConstants *constants)
+    -> std::function<VkCommandBuffer()> {
+  if (!grid.isStatic())
+    return nullptr;
+  return [&core, &grid, constants] {
+    return grid.staticCommands(core.frameIndex(), constants, core.viewCount());
+  };
+}
+
+static auto runScenario(vulkan::VulkanCore &core, GridRenderer &grid,
+                        MeshField &field, const Scenario &scenario,
+                        const Options &opts) -> ScenarioResult {
+  CameraPath path(scenario.points);
+  VkExtent2D viewExtent = core.renderExtent();
+  Camera camera(viewExtent.width / static_cast<float>(viewExtent.height),
+                path.sample(0.0f));
+  uint32_t views = core.viewCount();
+  bool multiview = core.usesMultiview();
+
+  std::vector<float> frameMs, cpuMs, gpuMs;
+  frameMs.reserve(opts.frames);
+  cpuMs.reserve(opts.frames);
+  gpuMs.reserve(opts.frames);
+
+  ScenarioResult result;
+  result.name = scenario.name;
+  if (opts.views > 1) {
+    result.viewMode = multiview ? "multiview" : "passes";
+    result.name += "/" + result.viewMode;
+  }
+  result.frames = opts.frames;
+  result.meshes = scenario.meshes;
+  result.occlusion = scenario.occlusion;
+  result.stars = scenario.stars;
+  result.nbody = scenario.nbody;
+  StarRenderer *stars = scenario.stars   ? field.stars.get()
+                        : scenario.nbody ? field.nbodyStars.get()
+                                         : nullptr;
+  if (stars)
+    stars->setMode(scenario.starMode);
+  NBodyCompute *nbody = scenario.nbody ? field.nbody.get() : nullptr;
+  MeshRenderer *meshes = nullptr;
+  if (scenario.meshes)
+    meshes = scenario.occlusion ? field.occlusionRenderer.get()
+                                : field.renderer.get();
+  if (meshes)
+    meshes->setDrawMode(scenario.drawMode);
+  uint64_t drawCalls = 0, visibleObjects = 0, occluded = 0, late = 0;
+
+  uint32_t total = opts.warmup + opts.frames;
+  uint64_t allocStart = 0, bytesStart = 0;
+  vulkan::FrameCapture &capture = core.capture();
+  uint64_t capturedStart = capture.capturedFrames();
+  uint64_t droppedStart = capture.droppedFrames();
+  auto last = std::chrono::steady_clock::now();
+
+  for (uint32_t i = 0; i < total; i++) {
+    TRACE_ZONE("BenchFrame");
+    if (i == opts.warmup) {
+      allocStart = g_allocCount.load();
+      bytesStart = g_allocBytes.load();
+      if (!opts.capture.empty())
+        capture.startSequence(opts.capture + "/" + result.name);
+    }
+
+    // The path is timed by frame index so every run renders the same views
+    path.apply(camera, static_cast<float>(i) / std::max(total - 1, 1u));
+    camera.update(0.0f);
+    GridPushConstants constants[MAX_VIEWS];
+    for (uint32_t v = 0; v < views; v++)
+      constants[v] = GridRenderer::makeConstants(
+          camera.getViewProjectionMatrix(v, views, VIEW_SEPARATION),
+          camera.getViewPosition(v, views, VIEW_SEPARATION));
+    MeshPushConstants meshConstants{camera.getViewProjectionMatrix(),
+                                    glm::vec4(0.4f, 0.8f, 0.3f, 0.0f)};
+    StarPushConstants starConstants = StarRenderer::makeConstants(
+        camera.getViewProjectionMatrix(), camera.getPosition(), STAR_EXPOSURE);
+
+    auto prepare = [&](VkCommandBuffer cmd) {
+      if (nbody) {
+        nbody->step(cmd, NBODY_SETTINGS);
+        stars->attach(nbody->stars(), nbody->count());
+      }
+      if (stars)
+        stars->rasterize(cmd, starConstants);
+      else
+        meshes->cullEarly(cmd, core.frameIndex(), field.scene, meshConstants,
+                          field.jobs.get());
+    };
+    core.drawFrame(
+        [&](VkCommandBuffer cmd, uint32_t) {
+          recordGrid(core, grid, cmd, constants);
+          if (meshes)
+            meshes->recordCommands(cmd, core.frameIndex(), field.scene,
+                                   field.geometry, meshConstants,
+                                   field.jobs.get());
+          if (stars)
+            stars->recordCommands(cmd, starConstants);
+          if (scenario.occlusion &&
+              core.splitPass(cmd,
+                             [&](VkCommandBuffer cmd,
+                                 const vulkan::VulkanCore::SceneDepth &depth) {
+                               meshes->cullLate(cmd, core.frameIndex(),
+                                                depth.texture, depth.extent);
+                             }))
+            meshes->recordLate(cmd, core.frameIndex(), field.geometry,
+                               meshConstants);
+        },
+        scenario.occlusion || stars
+            ? std::function<void(VkCommandBuffer)>(prepare)
+            : nullptr,
+        staticGrid(core, grid, constants));
+
+    auto now = std::chrono::steady_clock::now();
+    float ms = std::chrono::duration<float, std::milli>(now - last).count();
+    last = now;
+
+    if (i < opts.warmup)
+      continue;
+    frameMs.push_back(ms);
+    cpuMs.push_back(core.lastCpuRecordMs());
+    if (core.hasGpuTimestamps())
+      gpuMs.push_back(core.lastGpuFrameMs());
+    if (meshes) {
+      drawCalls += meshes->drawCalls();
+      visibleObjects += meshes->visibleObjects();
+      // Lags by the frames in flight, which the averages absorb
+      occluded += meshes->cullStats().occluded;
+      late += meshes->cullStats().lateDrawn;
+    }
+  }
+  capture.stopSequence();
+  core.waitIdle();
+  result.capturedFrames = capture.capturedFrames() - capturedStart;
+  result.droppedFrames = capture.droppedFrames() - droppedStart;
+  result.drawCalls = static_cast<double>(drawCalls) / opts.frames;
+  result.visibleObjects = static_cast<double>(visibleObjects) / opts.frames;
+  result.occludedObjects = static_cast<double>(occluded) / opts.frames;
+  result.lateDrawn = static_cast<double>(late) / opts.frames;
+
+  result.allocations = g_allocCount.load() - allocStart;
+  result.allocatedBytes = g_allocBytes.load() - bytesStart;
+  result.frame = summarize(frameMs);
+  result.cpu = summarize(cpuMs);
+  result.gpuValid = !gpuMs.empty();
+  result.gpu = summarize(gpuMs);
+  return result;
+}
+
+// Device-wide facts for the report, from the first configuration run
+struct BenchInfo {
+  std::string device;
+  bool dynamicRendering = false;
+  bool staticGrid = false;
+  double startupMs = 0.0, firstFrameMs = 0.0;
+};
+
+// Every selected scenario on a fresh headless device. False on a setup
+// failure; a view mode the device cannot do is reported and skipped.
+static auto runConfiguration(const Options &opts,
+                             vulkan::VulkanCore::ViewMode viewMode,
+                             std::vector<ScenarioResult> &results,
+                             BenchInfo &info) -> bool {
+  auto startupBegin = std::chrono::steady_clock::now();
+  auto msSinceStartup = [&] {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - startupBegin)
+        .count();
+  };
+
+  vulkan::VulkanCore core;
+  vulkan::DynamicResolutionSettings drs;
+  drs.enabled = false; // measure at a fixed resolution
+  core.setDynamicResolution(drs);
+  core.setDevicePreference(opts.gpu);
+  core.setViews(opts.views, viewMode);
+  bool occlusion = !opts.mesh.empty() && opts.views == 1 &&
+                   (opts.scenario == "all" || opts.scenario == "mesh_occlusion");
+  core.setDepthSampling(occlusion);
+  core.setStaticPasses(opts.staticPasses);
+  if (!core.initializeHeadless(opts.extent)) {
+    std::cerr << "Failed to initialize headless VulkanCore\n";
+    return false;
+  }
+  if (opts.views > 1 &&
+      (core.viewCount() != opts.views ||
+       (viewMode == vulkan::VulkanCore::ViewMode::Multiview) !=
+           core.usesMultiview())) {
+    std::cerr << "View mode unavailable on this device; skipping it\n";
+    return true;
+  }
+  bool first = info.device.empty();
+  info.device = core.profile().name;
+  info.dynamicRendering = core.usesDynamicRendering();
+
+  VkExtent2D viewExtent = core.renderExtent();
+  GridRenderer grid(core.device(), core.renderTargetLayout(), viewExtent,
+                    VK_NULL_HANDLE, nullptr, core.bindless().pipelineLayout(),
+                    opts.grid);
+  if (core.usesMultiview())
+    grid.enableMultiview(core.physicalDevice(), core.bindless(),
+                         core.framesInFlight());
+  if (opts.staticPasses && core.canExecuteStatic() &&
+      (core.viewCount() == 1 || core.usesMultiview()))
+    grid.enableStatic(core.physicalDevice(), core.bindless(),
+                      core.framesInFlight(), core.profile().graphicsFamily);
+  info.staticGrid = info.staticGrid || grid.isStatic();
+  if (first)
+    info.startupMs = msSinceStartup();
+
+  MeshField field;
+  if (!opts.mesh.empty() && opts.views == 1) {
+    MeshAsset asset;
+    if (!asset.load(opts.mesh) ||
+        !field.geometry.create(core.device(), core.physicalDevice(),
+                               core.graphicsQueue(),
+                               core.profile().graphicsFamily,
+                               asset.header().vertexCount,
+                               asset.header().indexCount, &core.bindless())) {
+      std::cerr << "Failed to load " << opts.mesh << "\n";
+      return false;
+    }
+    uint32_t meshId = field.scene.addMesh(field.geometry.upload(asset));
+    field.halfWidth = vulkan::addObjectGrid(
+        field.scene, meshId, MeshRenderer::Opaque, opts.objects);
+    field.renderer = std::make_unique<MeshRenderer>(
+        core.device(), core.physicalDevice(), core.profile(),
+        core.renderTargetLayout(), opts.extent,
+        core.bindless().pipelineLayout(), core.framesInFlight(),
+        opts.objects);
+    if (occlusion && core.canSplitPass() &&
+        core.profile().drawIndirectFirstInstance) {
+      field.occlusionRenderer = std::make_unique<MeshRenderer>(
+          core.device(), core.physicalDevice(), core.profile(),
+          core.renderTargetLayout(), opts.extent,
+          core.bindless().pipelineLayout(), core.framesInFlight(),
+          opts.objects);
+      field.occlusionRenderer->enableOcclusionCulling(core.physicalDevice(),
+                                                      core.bindless());
+    }
+  }
+  bool stars = opts.stars > 0 && opts.views == 1;
+  bool nbody = opts.nbody > 0 && opts.views == 1;
+  if (!opts.mesh.empty() || !opts.capture.empty() || stars || nbody)
+    field.jobs = std::make_unique<JobSystem>(
+        std::max(std::thread::hardware_concurrency(), 2u) - 1);
+  if (stars) {
+    GalaxyDesc desc;
+    desc.seed = 7;
+    desc.stars = opts.stars;
+    desc.radius = STAR_GALAXY_RADIUS;
+    GalaxyGenerator galaxy(desc);
+    field.stars = std::make_unique<StarRenderer>(
+        core.device(), core.physicalDevice(), core.bindless(),
+        core.renderTargetLayout(), viewExtent);
+    field.stars->upload(core.graphicsQueue(), core.profile().graphicsFamily,
+                        galaxy.count(), galaxy.fill(field.jobs.get()));
+  }
+  if (nbody) {
+    GalaxyDesc desc;
+    desc.seed = 7;
+    desc.stars = std::min(opts.nbody, NBodyCompute::MAX_BODIES);
+    desc.radius = STAR_GALAXY_RADIUS;
+    GalaxyGenerator galaxy(desc);
+    std::vector<Star> bodies(galaxy.count());
+    galaxy.generate(bodies.data(), 0, galaxy.count(), field.jobs.get());
+    field.nbody = std::make_unique<NBodyCompute>(
+        core.device(), core.physicalDevice(), core.bindless());
+    field.nbody->upload(core.graphicsQueue(), core.profile().graphicsFamily,
+                        makeRotatingSnapshot(std::move(bodies),
+                                             NBODY_GALAXY_MASS,
+                                             NBODY_SETTINGS.softening));
+    field.nbodyStars = std::make_unique<StarRenderer>(
+        core.device(), core.physicalDevice(), core.bindless(),
+        core.renderTargetLayout(), viewExtent);
+  }
+  core.capture().setJobSystem(field.jobs.get());
+  core.capture().setSequenceFormat(opts.captureFormat);
+
+  // Time to first frame: one frame rendered and completed on the GPU
+  Camera camera(viewExtent.width / static_cast<float>(viewExtent.height));
+  GridPushConstants constants[MAX_VIEWS];
+  std::fill(constants, constants + MAX_VIEWS,
+            GridRenderer::makeConstants(camera));
+  core.drawFrame(
+      [&](VkCommandBuffer cmd, uint32_t) {
+        recordGrid(core, grid, cmd, constants);
+      },
+      nullptr, staticGrid(core, grid, constants));
+  core.waitIdle();
+  if (first)
+    info.firstFrameMs = msSinceStartup();
+  for (const auto &scenario : scenarios(field.halfWidth, field.stars != nullptr,
+                                        field.nbody != nullptr)) {
+    if (opts.scenario != "all" && opts.scenario != scenario.name)
+      continue;
+    if (scenario.occlusion && !field.occlusionRenderer) {
+      std::cerr << "Occlusion culling unavailable on this device; skipping "
+                << scenario.name << "\n";
+      continue;
+    }
+    std::cerr << "Running " << scenario.name << "...\n";
+    results.push_back(runScenario(core, grid, field, scenario, opts));
+  }
+  core.waitIdle();
+  core.capture().setJobSystem(nullptr); // before field.jobs goes away
+  return true;
+}
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseArgs(argc, argv, opts))
+    return EXIT_FAILURE;
+  if (opts.views > 1 && !opts.mesh.empty())
+    std::cerr << "--mesh is ignored with --views; the mesh scenarios are "
+                 "single-view\n";
+  if (opts.views > 1 && (opts.stars > 0 || opts.nbody > 0))
+    std::cerr << "--stars and --nbody are ignored with --views; the star "
+                 "scenarios are single-view\n";
+
+  if (!opts.trace.empty())
+    trace::start(opts.trace);
+
+  // With several views the same scenarios run once per view mode
+  std::vector<vulkan::VulkanCore::ViewMode> modes = {
+      vulkan::VulkanCore::ViewMode::Multiview};
+  if (opts.views > 1)
+    modes.push_back(vulkan::VulkanCore::ViewMode::PerViewPasses);
+  std::vector<ScenarioResult> results;
+  BenchInfo info;
+  for (auto mode : modes) {
+    if (!runConfiguration(opts, mode, results, info))
+      return EXIT_FAILURE;
+  }
+  trace::stop();
+
+  if (results.empty()) {
+    std::cerr << "Unknown scenario: " << opts.scenario << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3);
+  json << "{\n  \"device\": \"" << info.device << "\",\n"
+       << "  \"render_path\": \""
+       << (info.dynamicRendering ? "dynamic_rendering" : "render_pass")
+       << "\",\n  \"width\": " << opts.extent.width
+       << ",\n  \"height\": " << opts.extent.height
+       << ",\n  \"warmup_frames\": " << opts.warmup
+       << ",\n  \"grid_levels\": " << opts.grid.levels
+       << ",\n  \"views\": " << opts.views
+       << ",\n  \"static_grid\": " << (info.staticGrid ? "true" : "false")
+       << ",\n  \"startup_ms\": " << info.startupMs
+       << ",\n  \"first_frame_ms\": " << info.firstFrameMs;
+  if (!opts.mesh.empty() && opts.views == 1)
+    json << ",\n  \"mesh\": \"" << opts.mesh
+         << "\",\n  \"objects\": " << opts.objects;
+  if (opts.stars > 0 && opts.views == 1)
+    json << ",\n  \"stars\": " << opts.stars;
+  if (opts.nbody > 0 && opts.views == 1)
+    json << ",\n  \"nbody\": "
+         << std::min(opts.nbody, NBodyCompute::MAX_BODIES);
+  json << ",\n  \"scenarios\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    json << "    {\"name\": \"" << r.name << "\", \"frames\": " << r.frames;
+    if (!r.viewMode.empty())
+      json << ", \"view_mode\": \"" << r.viewMode << "\"";
+    json << ",\n     ";
+    writeStats(json, "frame_ms", r.frame);
+    json << ",\n     ";
+    writeStats(json, "cpu_ms", r.cpu);
+    json << ",\n     ";
+    if (r.gpuValid)
+      writeStats(json, "gpu_ms", r.gpu);
+    else
+      json << "\"gpu_ms\": null";
+    json << ",\n     \"allocations\": " << r.allocations
+         << ", \"allocations_per_frame\": "
+         << static_cast<double>(r.allocations) / r.frames
+         << ", \"allocated_bytes\": " << r.allocatedBytes;
+    if (r.meshes)
+      json << ",\n     \"draw_calls\": " << r.drawCalls
+           << ", \"visible_objects\": " << r.visibleObjects;
+    if (r.occlusion)
+      json << ", \"occluded_objects\": " << r.occludedObjects
+           << ", \"late_drawn\": " << r.lateDrawn;
+    if (r.stars && r.gpuValid && r.gpu.mean > 0.0)
+      json << ",\n     \"points_per_s\": "
+           << opts.stars / (r.gpu.mean / 1000.0);
+    if (r.nbody && r.gpuValid && r.gpu.mean > 0.0) {
+      double n = std::min(opts.nbody, NBodyCompute::MAX_BODIES);
+      json << ",\n     \"interactions_per_s\": "
+           << n * n / (r.gpu.mean / 1000.0);
+    }
+    if (!opts.capture.empty())
+      json << ",\n     \"captured_frames\": " << r.capturedFrames
+           << ", \"dropped_frames\": " << r.droppedFrames;
+    json << "}"
+         << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  json << "  ]\n}\n";
+
+  if (opts.output.empty()) {
+    std::cout << json.str();
+  } else {
+    std::ofstream out(opts.output);
+    if (!out) {
+      std::cerr << "Failed to open " << opts.output << "\n";
+      return EXIT_FAILURE;
+    }
+    out << json.str();
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "DynamicResolution.hpp"
+#include "FrameCapture.hpp"
+#include "GridRenderer.hpp"
+#include "Log.hpp"
+#include <string>
+
+/*
+@brief Runtime settings read from a `key = value` file.
+
+Every key can be overridden from the environment as VKAPP_<KEY>, e.g.
+VKAPP_FRAME_BUDGET_MS=8.3. Unknown keys are reported and ignored; a missing
+file leaves the defaults in place.
+*/
+struct AppConfig {
+  bool dynamicRendering = true;
+  std::string gpu; // device index or name substring; empty = best score
+  vulkan::DynamicResolutionSettings dynamicResolution;
+  // Draw only when input, the camera, a resize or a recording changes the
+  // frame, and otherwise sleep on window events
+  bool renderOnDemand = false;
+  // Record the grid once per frame slot and replay it while only the camera
+  // moves (VulkanCore::drawFrame's staticFunc); needs dynamic rendering
+  bool staticPasses = false;
+  GridVariant grid;
+  uint32_t views = 1;          // side-by-side views of a camera rig, 1-4
+  bool multiview = true;       // one multiview pass; false = a pass per view
+  float viewSeparation = 0.3f; // rig spacing along the camera's right axis
+  std::string meshFile;       // .vmesh drawn as a field of objects; empty = none
+  uint32_t meshObjects = 1024; // copies of the mesh in that field
+  bool occlusionCulling = false; // two-phase Hi-Z culling of that field
+  uint32_t stars = 0;           // generated galaxy behind the scene; 0 = none
+  uint32_t galaxySeed = 1;      // same seed, same galaxy
+  float galaxyRadius = 15000.0f; // parsecs
+  std::string starCatalog; // .vstars drawn instead of a generated galaxy
+  float starExposure = 2e6f;
+  bool starCompute = true; // compute rasterizer; false = hardware points
+  std::string traceFile; // Chrome trace JSON output; empty disables tracing
+  std::string captureDir = "captures"; // screenshots and recorded sequences
+  vulkan::CaptureFormat captureFormat = vulkan::CaptureFormat::Png;
+  std::string pipelineCacheFile = "pipeline_cache.bin"; // empty disables
+  logging::Level logLevel = logging::Level::Info;
+  logging::Level validationLogLevel = logging::Level::Warning;
+
+  static auto load(const std::string &path) -> AppConfig;
+
+  // Apply one setting; returns false for unknown keys or bad values
+  auto set(const std::string &key, const std::string &value) -> bool;
+};
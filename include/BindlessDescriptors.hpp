@@ -0,0 +1,115 @@
+#pragma once
+#include "DeviceProfile.hpp"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+// Shader-visible index of a bindless resource
+using BindlessIndex = uint32_t;
+constexpr BindlessIndex BINDLESS_INVALID = UINT32_MAX;
+
+/*
+@brief Free-list allocator for slots in one descriptor array.
+
+Released slots are reused before the high-water mark grows, so indices stay
+dense and small.
+*/
+class DescriptorIndexAllocator {
+public:
+  void reset(uint32_t capacity);
+
+  // BINDLESS_INVALID when the array is full
+  auto allocate() -> BindlessIndex;
+  void release(BindlessIndex index);
+
+  auto capacity() const -> uint32_t { return _capacity; }
+  auto used() const -> uint32_t {
+    return _next - static_cast<uint32_t>(_free.size());
+  }
+
+private:
+  uint32_t _capacity = 0;
+  uint32_t _next = 0;
+  std::vector<BindlessIndex> _free;
+};
+
+/*
+@brief One global descriptor set holding every buffer, image and sampler.
+
+Set 0 has three large PARTIALLY_BOUND, UPDATE_AFTER_BIND arrays: storage
+buffers (binding 0), sampled images (binding 1) and samplers (binding 2),
+declared in shaders/Bindless.slang. Resources are registered once and
+addressed by the returned index, which shaders receive through push
+constants. Every pipeline uses the shared pipelineLayout(), so the set is
+bound once per command buffer and survives pipeline switches.
+
+Released indices are recycled only after every frame that could still read
+them has completed. Registration is thread-safe.
+
+Without descriptor indexing only the pipeline layout (push constants) is
+created and valid() is false.
+*/
+class BindlessDescriptors {
+public:
+  enum Kind { StorageBuffer, SampledImage, Sampler, KindCount };
+
+  // Push constant bytes available to every pipeline (the guaranteed minimum)
+  static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;
+
+  BindlessDescriptors() = default;
+  ~BindlessDescriptors();
+  BindlessDescriptors(const BindlessDescriptors &) = delete;
+  BindlessDescriptors &operator=(const BindlessDescriptors &) = delete;
+
+  auto create(VkDevice device, const DeviceProfile &profile,
+              uint32_t framesInFlight) -> bool;
+  void destroy();
+
+  auto registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0,
+                             VkDeviceSize range = VK_WHOLE_SIZE)
+      -> BindlessIndex;
+  auto registerSampledImage(
+      VkImageView view,
+      VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+      -> BindlessIndex;
+  auto registerSampler(VkSampler sampler) -> BindlessIndex;
+  void release(Kind kind, BindlessIndex index);
+
+  // Call once the frame slot's fence has signaled: recycles the indices
+  // released the last time this slot was recorded
+  void beginFrame(uint32_t frame);
+  // Binds set 0 for graphics and compute
+  void bind(VkCommandBuffer cmd) const;
+
+  auto valid() const -> bool { return _set != VK_NULL_HANDLE; }
+  auto pipelineLayout() const -> VkPipelineLayout { return _pipelineLayout; }
+  auto setLayout() const -> VkDescriptorSetLayout { return _setLayout; }
+  auto capacity(Kind kind) const -> uint32_t {
+    return _slots[kind].capacity();
+  }
+  auto used(Kind kind) const -> uint32_t;
+
+private:
+  auto allocate(Kind kind) -> BindlessIndex;
+
+  VkDevice _device = VK_NULL_HANDLE;
+  VkDescriptorPool _pool = VK_NULL_HANDLE;
+  VkDescriptorSetLayout _setLayout = VK_NULL_HANDLE;
+  VkDescriptorSet _set = VK_NULL_HANDLE;
+  VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+
+  mutable std::mutex _mutex;
+  std::array<DescriptorIndexAllocator, KindCount> _slots;
+  struct Retired {
+    Kind kind;
+    BindlessIndex index;
+  };
+  std::vector<std::vector<Retired>> _retired; // per frame slot
+  uint32_t _frame = 0;
+};
+
+} // namespace vulkan
@@ -1,5 +1,6 @@
 #pragma once
 #include "CameraConstants.hpp"
+#include <cstdint>
 #include <glm/glm.hpp>
 
 /*
@@ -24,13 +25,25 @@ public:
   auto getViewMatrix() const -> glm::mat4;
   auto getProjectionMatrix() const -> glm::mat4;
   auto getViewProjectionMatrix() const -> glm::mat4;
+  // View of a rig of count parallel cameras spaced separation apart along
+  // this camera's right axis and centered on it (stereo pairs, side-by-side
+  // views); view 0 is leftmost. Projection is shared.
+  auto getViewMatrix(uint32_t view, uint32_t count, float separation) const
+      -> glm::mat4;
+  auto getViewProjectionMatrix(uint32_t view, uint32_t count,
+                               float separation) const -> glm::mat4;
+  auto getViewPosition(uint32_t view, uint32_t count, float separation) const
+      -> glm::vec3;
   auto getPosition() const -> const glm::vec3 & { return _position; }
   auto getFront() const -> const glm::vec3 & { return _front; }
   auto getUp() const -> const glm::vec3 & { return _up; }
   auto getRight() const -> const glm::vec3 & { return _right; }
   auto getFov() const -> float { return _fov; }
+  // Bumped whenever the view or projection actually changes; a frame drawn
+  // at the same version shows the same thing
+  auto version() const -> uint64_t { return _version; }
 
-  void setPosition(const glm::vec3 &position) { _position = position; }
+  void setPosition(const glm::vec3 &position);
   void setSpeed(float speed) { _moveSpeed = speed; }
   void setSensitivity(float sensitivity) { _mouseSensitivity = sensitivity; }
   void setFov(float fov);
@@ -60,4 +73,6 @@ private:
   float _moveSpeed;
   float _mouseSensitivity;
   float _zoomSpeed;
+
+  uint64_t _version = 0;
 };
\ No newline at end of file
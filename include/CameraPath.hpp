@@ -0,0 +1,27 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+
+class Camera;
+
+/*
+@brief Catmull-Rom spline through camera positions for scripted fly-throughs.
+
+The curve passes through every control point; the first and last points are
+duplicated so the path starts and ends exactly on them. Parameter t runs from
+0 to 1 uniformly over segments.
+*/
+class CameraPath {
+public:
+  explicit CameraPath(std::vector<glm::vec3> points);
+
+  auto sample(float t) const -> glm::vec3;
+
+  // Move the camera to the sampled position
+  void apply(Camera &camera, float t) const;
+
+  auto points() const -> const std::vector<glm::vec3> & { return _points; }
+
+private:
+  std::vector<glm::vec3> _points;
+};
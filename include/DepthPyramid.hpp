@@ -0,0 +1,60 @@
+#pragma once
+#include "BindlessDescriptors.hpp"
+#include "VulkanResources.hpp"
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/*
+@brief Hierarchical-Z pyramid of a depth buffer, built with compute.
+
+Every level lives in one device-local storage buffer registered with
+bindless (shaders/HiZ.slang reads it): level 0 is the depth extent rounded
+down to a power of two and capped at MAX_SIZE, each texel of every level
+holding the farthest depth of the area it covers. A storage buffer instead
+of a mipped storage image keeps it inside the bindless set, which has no
+storage image array.
+
+build() records one dispatch per level with a barrier between levels; the
+bindless set must be bound and the shared layout's push constants are
+overwritten.
+*/
+class DepthPyramid {
+public:
+  static constexpr uint32_t MAX_SIZE = 1024;
+
+  DepthPyramid(VkDevice device, VkPhysicalDevice physicalDevice,
+               vulkan::BindlessDescriptors &bindless,
+               VkPipelineCache pipelineCache,
+               const std::vector<char> &initCode,
+               const std::vector<char> &reduceCode);
+  ~DepthPyramid();
+  DepthPyramid(const DepthPyramid &) = delete;
+  DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+  // depth is a bindless sampled image of the given extent, in a layout
+  // compute can read. Ends with the pyramid's writes visible to compute.
+  void build(VkCommandBuffer cmd, vulkan::BindlessIndex depth,
+             VkExtent2D extent);
+
+  // Last build; levels() == 0 until the first one
+  auto buffer() const -> vulkan::BindlessIndex { return _index; }
+  auto width() const -> uint32_t { return _width; }
+  auto height() const -> uint32_t { return _height; }
+  auto levels() const -> uint32_t { return _levels; }
+
+private:
+  auto createPipeline(const std::vector<char> &code) -> VkPipeline;
+
+  VkDevice _device;
+  vulkan::BindlessDescriptors &_bindless;
+  VkPipelineCache _pipelineCache;
+  VkPipeline _init = VK_NULL_HANDLE;
+  VkPipeline _reduce = VK_NULL_HANDLE;
+
+  // Sized for the largest pyramid, so extent changes never reallocate
+  vulkan::BufferResource _buffer;
+  vulkan::BindlessIndex _index = vulkan::BINDLESS_INVALID;
+  uint32_t _width = 0;
+  uint32_t _height = 0;
+  uint32_t _levels = 0;
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+/*
+@brief Capabilities and limits of one physical device, queried once.
+
+VulkanCore scores every device with it at startup and keeps the profile of
+the one it picked; subsystems read VulkanCore::profile() to choose their
+fastest supported path instead of querying Vulkan themselves.
+*/
+struct DeviceProfile {
+  VkPhysicalDevice device = VK_NULL_HANDLE;
+  std::string name;
+  VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+  uint32_t apiVersion = 0;
+  uint32_t vendorID = 0;
+  uint32_t deviceID = 0;
+  VkDeviceSize deviceLocalBytes = 0; // largest DEVICE_LOCAL heap
+
+  // Queue families (UINT32_MAX = none)
+  uint32_t graphicsFamily = UINT32_MAX;
+  uint32_t presentFamily = UINT32_MAX;
+  uint32_t asyncComputeFamily = UINT32_MAX; // compute without graphics
+  uint32_t transferFamily = UINT32_MAX;     // transfer-only
+  uint32_t timestampValidBits = 0;          // on the graphics family
+
+  // Optional features (supported, and enabled on the logical device)
+  bool dynamicRendering = false;
+  bool timelineSemaphore = false;
+  bool descriptorIndexing = false; // runtime arrays, partially bound,
+                                   // update-after-bind buffers and images
+  bool drawIndirectCount = false;
+  bool multiDrawIndirect = false;
+  bool drawIndirectFirstInstance = false;
+  bool multiview = false;
+  // Secondaries and inline commands in one dynamic rendering pass
+  // (VK_EXT_nested_command_buffer); false with headers that predate it
+  bool nestedCommandBuffer = false;
+  bool shaderInt64 = false;
+  bool samplerAnisotropy = false;
+
+  // Limits
+  uint32_t maxImageDimension2D = 0;
+  uint32_t maxPushConstantsSize = 0;
+  uint32_t maxDrawIndirectCount = 0;
+  uint32_t maxComputeWorkGroupInvocations = 0;
+  uint32_t maxComputeSharedMemorySize = 0;
+  uint32_t maxBoundDescriptorSets = 0;
+  // Per stage and per set, whichever is lower
+  uint32_t maxUpdateAfterBindStorageBuffers = 0;
+  uint32_t maxUpdateAfterBindSampledImages = 0;
+  uint32_t maxUpdateAfterBindSamplers = 0;
+  uint32_t maxMultiviewViewCount = 0;
+  uint32_t subgroupSize = 0;
+  float timestampPeriod = 0.0f;
+  VkDeviceSize minUniformBufferOffsetAlignment = 0;
+  VkDeviceSize minStorageBufferOffsetAlignment = 0;
+
+  // Selection
+  bool suitable = false;
+  std::string rejectReason;
+  int score = 0;
+
+  // surface may be VK_NULL_HANDLE (headless); requiredExtensions must all be
+  // present for the device to be suitable
+  static auto query(VkPhysicalDevice device, VkSurfaceKHR surface,
+                    const std::vector<const char *> &requiredExtensions)
+      -> DeviceProfile;
+
+  auto typeName() const -> const char *;
+};
+
+// Higher is better; unsuitable devices score below every suitable one
+auto scoreDevice(const DeviceProfile &profile) -> int;
+
+// Index into candidates chosen by a selector: a device index ("1") or a
+// case-insensitive substring of the device name ("nvidia"). -1 if no match.
+auto matchDeviceSelector(const std::vector<DeviceProfile> &candidates,
+                         const std::string &selector) -> int;
+
+} // namespace vulkan
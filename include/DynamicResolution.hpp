@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+struct DynamicResolutionSettings {
+  bool enabled = true;
+  float frameBudgetMs = 16.6f; // GPU time the governor aims to stay under
+  float minScale = 0.5f;       // Per-axis render scale limits
+  float maxScale = 1.0f;
+  uint32_t logInterval = 120; // Frames between scale/frame-time log lines
+};
+
+/*
+@brief Picks a per-axis render scale that keeps GPU frame time inside the
+budget.
+
+Shading cost is proportional to pixel count, i.e. scale squared, so the
+correction uses the square root of the time ratio. Overload is corrected
+quickly, headroom is reclaimed slowly, and a small deadband keeps the scale
+from oscillating around the target.
+*/
+class FrameTimeGovernor {
+public:
+  explicit FrameTimeGovernor(const DynamicResolutionSettings &settings);
+
+  // Feed the latest GPU frame time; returns the scale for the next frame
+  auto update(float gpuMs) -> float;
+
+  auto scale() const -> float { return _scale; }
+  auto smoothedMs() const -> float { return _smoothedMs; }
+
+private:
+  DynamicResolutionSettings _settings;
+  float _scale;
+  float _smoothedMs = 0.0f;
+  bool _hasSample = false;
+};
+
+/*
+@brief Two timestamps per frame in flight bracketing the frame's scene work.
+
+The end timestamp goes right after the scene pass: the compose blit and the
+capture copies that follow wait on the swapchain acquire, and counting that
+wait (a whole vsync interval under FIFO) would read as GPU load. A scene
+drawn straight into the acquired image still includes it; the governor only
+runs on composed frames, so it never sees that.
+
+Results are read back after the frame's fence has signaled, so no query ever
+stalls the CPU.
+*/
+class GpuFrameTimer {
+public:
+  GpuFrameTimer() = default;
+  ~GpuFrameTimer();
+
+  // Returns false (and stays disabled) when the queue has no timestamps
+  auto create(VkDevice device, VkPhysicalDevice physicalDevice,
+              uint32_t queueFamily, uint32_t framesInFlight) -> bool;
+  void destroy();
+
+  void begin(VkCommandBuffer cmd, uint32_t frame);
+  void end(VkCommandBuffer cmd, uint32_t frame);
+
+  // Call after the frame's fence wait; returns false if no result yet
+  auto collect(uint32_t frame, float &gpuMs) -> bool;
+
+  auto valid() const -> bool { return _queryPool != VK_NULL_HANDLE; }
+
+private:
+  VkDevice _device = VK_NULL_HANDLE;
+  VkQueryPool _queryPool = VK_NULL_HANDLE;
+  float _timestampPeriodNs = 1.0f;
+  uint64_t _timestampMask = ~0ull;
+  std::vector<bool> _written;
+};
+
+} // namespace vulkan
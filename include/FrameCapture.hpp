@@ -0,0 +1,117 @@
+#pragma once
+#include "JobSystem.hpp"
+#include "VulkanResources.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+enum class CaptureFormat { Png, Pam };
+
+// Layout of an image and the stage and access of its last write; what the
+// next barrier on it has to wait for
+struct ImageSyncState {
+  VkImageLayout layout;
+  VkPipelineStageFlags stage;
+  VkAccessFlags access;
+};
+
+/*
+@brief Screenshots and image sequences without stalling the frame loop.
+
+record() copies the finished image into a persistently mapped host buffer
+inside the frame's own command buffer. collect() picks the copy up when that
+frame slot comes around again and its fence has signaled, and hands it to a
+Background job that converts and writes the file. There are a few more
+readback slots than frames in flight to cover encoder backlog; when all of
+them are busy a sequence frame is dropped rather than waited for.
+*/
+class FrameCapture {
+public:
+  FrameCapture() = default;
+  ~FrameCapture() { destroy(); }
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+
+  void create(VkDevice device, VkPhysicalDevice physicalDevice,
+              uint32_t framesInFlight);
+  // Writes every outstanding capture first; the device must be idle
+  void destroy();
+
+  // Encoders run on its workers; without one they run inside collect().
+  // Replacing it waits for the encodes already queued on the old one.
+  void setJobSystem(JobSystem *jobs);
+  // Format of sequence frames; screenshots are always PNG
+  void setSequenceFormat(CaptureFormat format) { _sequenceFormat = format; }
+
+  // Capture the next frame to path (parent directories are created)
+  void requestScreenshot(const std::string &path);
+  // Capture every frame to directory/frame_NNNNNN.{png,pam} until stopped
+  auto startSequence(const std::string &directory) -> bool;
+  void stopSequence();
+  auto recording() const -> bool { return _recording; }
+  // Whether record() has anything to do this frame
+  auto wanted() const -> bool {
+    return _recording || !_screenshotPath.empty();
+  }
+
+  // Copies image into a free readback slot tied to frameSlot. When it does,
+  // image is left in TRANSFER_SRC_OPTIMAL and state says so. Never waits.
+  auto record(VkCommandBuffer cmd, uint32_t frameSlot, VkImage image,
+              VkFormat format, VkExtent2D extent, ImageSyncState &state)
+      -> bool;
+  // Hands frameSlot's copies to the encoder; call once its fence signaled
+  void collect(uint32_t frameSlot);
+  // Whether a copy is still waiting for its frame slot to come around: only
+  // drawing more frames gets it collected and written
+  auto pending() const -> bool;
+
+  static auto supportsFormat(VkFormat format) -> bool;
+  // Converts pixels of a supported format to RGBA8 with opaque alpha
+  static void toRgba(VkFormat format, const void *src, size_t pixels,
+                     uint8_t *rgba);
+
+  auto capturedFrames() const -> uint64_t { return _captured; }
+  auto droppedFrames() const -> uint64_t { return _dropped; }
+
+private:
+  enum SlotState : uint8_t { Free, Copying, Encoding };
+  struct Slot {
+    BufferResource buffer;
+    bool coherent = true;
+    std::atomic<uint8_t> state{Free}; // Encoding -> Free on a worker
+    uint32_t frameSlot = 0;
+    VkExtent2D extent{};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::string screenshot;   // empty when not requested
+    std::string sequenceFile; // empty outside a sequence
+    CaptureFormat sequenceFormat = CaptureFormat::Png;
+  };
+
+  auto acquireSlot(VkDeviceSize size) -> Slot *;
+  void encode(Slot &slot);
+  void waitForEncoders();
+
+  VkDevice _device = VK_NULL_HANDLE;
+  VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+  std::vector<std::unique_ptr<Slot>> _slots;
+  JobSystem *_jobs = nullptr;
+  JobCounter _encoding;
+
+  std::string _screenshotPath;
+  bool _recording = false;
+  std::string _sequenceDir;
+  CaptureFormat _sequenceFormat = CaptureFormat::Png;
+  uint32_t _sequenceFrame = 0;
+  bool _warnedFormat = false;
+  bool _warnedDrop = false;
+
+  uint64_t _captured = 0;
+  uint64_t _dropped = 0;
+};
+
+} // namespace vulkan
@@ -0,0 +1,88 @@
+#pragma once
+#include "CameraConstants.hpp"
+#include "StarFormat.hpp"
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Shape of a generated star field. Lengths are parsecs
+// (CameraConstants::Galaxy); the disk, bulge, halo and cluster system scale
+// with radius. Shares are fractions of stars, the disk taking the rest.
+struct GalaxyDesc {
+  uint64_t seed = 1;
+  uint32_t stars = 1000000;
+  float radius = 15000.0f; // most disk stars lie inside it
+
+  // Density-wave arms: logarithmic spirals holding armShare of the disk,
+  // pitched armPitch degrees, armWidth across
+  uint32_t arms = 2;
+  float armPitch = 18.0f;
+  float armShare = 0.6f;
+  float armWidth = 1500.0f;
+
+  float bulgeShare = 0.15f;
+  float haloShare = 0.02f;
+  // Globular clusters orbiting in the halo, a few parsecs across each
+  float clusterShare = 0.03f;
+  uint32_t clusters = 150;
+  // Cosmic-web filaments around the galaxy: webNodes random nodes in a cube
+  // webSize across, each joined to its nearest neighbours. Their points are
+  // galaxies, packed at the brightest magnitude
+  float filamentShare = 0.0f;
+  uint32_t webNodes = 64;
+  float webSize = 2.0f * CameraConstants::Galaxy::COSMIC_WEB_DISTANCE;
+};
+
+/*
+@brief Procedural spiral galaxies, globular clusters and cosmic-web filaments.
+
+Stars are numbered: the disk first, then the bulge, halo, clusters and
+filaments. Each component is cut into blocks of BLOCK stars with their own
+random streams seeded from (seed, component, block), so a star depends only
+on the seed and its number: generate() gives the same stars for any range
+split and thread count. Positions, magnitudes and colors come from
+four-lane SIMD kernels (simd::Random4, simd::log/exp/sincos) and are stored
+four stars at a time, which suits write-combined staging memory.
+
+The disk has an exponential surface density and sech^2 vertical profile,
+young blue stars concentrated in the arms; the bulge, halo and clusters
+are old, redder Plummer spheres. Results match across runs of one build;
+other targets and compilers may round differently.
+*/
+class GalaxyGenerator {
+public:
+  static constexpr uint32_t BLOCK = 4096;
+
+  explicit GalaxyGenerator(const GalaxyDesc &desc);
+
+  auto desc() const -> const GalaxyDesc & { return _desc; }
+  auto count() const -> uint32_t { return _desc.stars; }
+
+  // Writes stars [first, first + count) to out, across jobs when given
+  void generate(Star *out, uint32_t first, uint32_t count,
+                JobSystem *jobs = nullptr) const;
+
+  // generate() as a StarFill, for StarRenderer::upload and
+  // StarCatalog::write; jobs must outlive the returned function
+  auto fill(JobSystem *jobs = nullptr) const -> StarFill;
+
+private:
+  enum Component { Disk, Bulge, Halo, Cluster, Filament, COMPONENTS };
+  struct Range {
+    uint32_t first = 0;
+    uint32_t count = 0;
+  };
+  struct Segment {
+    glm::vec3 a, b;
+  };
+
+  // Stars [skip, skip + count) of one block, written to out
+  void generateBlock(Component component, uint32_t block, uint32_t skip,
+                     uint32_t count, Star *out) const;
+
+  GalaxyDesc _desc;
+  Range _ranges[COMPONENTS];
+  std::vector<glm::vec4> _clusters; // center, Plummer radius
+  std::vector<Segment> _filaments;
+};
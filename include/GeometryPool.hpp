@@ -0,0 +1,105 @@
+#pragma once
+#include "BindlessDescriptors.hpp"
+#include "MeshAsset.hpp"
+#include "VulkanResources.hpp"
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+/*
+@brief First-fit allocator of element ranges inside a fixed-size buffer.
+
+Free ranges are kept sorted by offset and coalesced on release.
+*/
+class RangeAllocator {
+public:
+  static constexpr uint32_t INVALID = UINT32_MAX;
+
+  void reset(uint32_t capacity);
+  // Offset of `count` consecutive elements, or INVALID
+  auto allocate(uint32_t count) -> uint32_t;
+  void release(uint32_t offset, uint32_t count);
+
+  auto capacity() const -> uint32_t { return _capacity; }
+  auto used() const -> uint32_t { return _used; }
+
+private:
+  struct Range {
+    uint32_t offset;
+    uint32_t count;
+  };
+  std::vector<Range> _free;
+  uint32_t _capacity = 0;
+  uint32_t _used = 0;
+};
+
+// Where a mesh lives in the pool: the arguments of vkCmdDrawIndexed
+struct MeshAllocation {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  int32_t vertexOffset = 0;
+  uint32_t vertexCount = 0;
+  // Dequantization and culling data from the file header
+  float boundsMin[3] = {};
+  float boundsMax[3] = {};
+  float sphere[4] = {};
+
+  auto valid() const -> bool { return indexCount != 0; }
+};
+
+/*
+@brief Every mesh sub-allocated from one vertex buffer and one index buffer.
+
+Vertices stay in the packed 12-byte .vmesh format; indices are widened to 32
+bits and stay relative to the mesh (vertexOffset is the draw's base vertex).
+bind() once per command buffer covers every mesh, and the vertex buffer is
+also registered as a bindless storage buffer for vertex pulling.
+
+Uploads go through a staging buffer and wait for completion, so call them
+from the thread that submits to the queue, outside frame recording.
+*/
+class GeometryPool {
+public:
+  GeometryPool() = default;
+  ~GeometryPool();
+  GeometryPool(const GeometryPool &) = delete;
+  GeometryPool &operator=(const GeometryPool &) = delete;
+
+  auto create(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue,
+              uint32_t queueFamily, uint32_t maxVertices, uint32_t maxIndices,
+              BindlessDescriptors *bindless = nullptr) -> bool;
+  void destroy();
+
+  // One staging copy and one submit for the whole batch. Meshes that don't
+  // fit come back invalid.
+  auto upload(const std::vector<const MeshAsset *> &meshes)
+      -> std::vector<MeshAllocation>;
+  auto upload(const MeshAsset &mesh) -> MeshAllocation;
+  // The caller guarantees no pending frame still draws the mesh
+  void release(const MeshAllocation &allocation);
+
+  void bind(VkCommandBuffer cmd) const;
+
+  auto vertexBuffer() const -> VkBuffer { return _vertices.buffer; }
+  auto indexBuffer() const -> VkBuffer { return _indices.buffer; }
+  auto vertexBufferIndex() const -> BindlessIndex { return _vertexIndex; }
+  auto usedVertices() const -> uint32_t { return _vertexRanges.used(); }
+  auto usedIndices() const -> uint32_t { return _indexRanges.used(); }
+
+private:
+  VkDevice _device = VK_NULL_HANDLE;
+  VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+  VkQueue _queue = VK_NULL_HANDLE;
+  VkCommandPool _commandPool = VK_NULL_HANDLE;
+  BindlessDescriptors *_bindless = nullptr;
+
+  BufferResource _vertices;
+  BufferResource _indices;
+  RangeAllocator _vertexRanges;
+  RangeAllocator _indexRanges;
+  BindlessIndex _vertexIndex = BINDLESS_INVALID;
+};
+
+} // namespace vulkan
@@ -1,30 +1,162 @@
 #pragma once
+#include "BindlessDescriptors.hpp"
+#include "Camera.hpp"
+#include "RenderTarget.hpp"
+#include "StaticPass.hpp"
+#include "VulkanResources.hpp"
+#include <cstddef>
 #include <glm/glm.hpp>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 struct GridPushConstants {
-  glm::mat4 viewProj;
   glm::mat4 invViewProj;
   glm::vec3 cameraPos;
-  float gridScale;
+  float gridScale; // Cells per unit of the finer of the two active levels
+  glm::vec4 horizon; // NDC half-plane: ground where dot(xyz, (x, y, 1)) <= 0
+  float lodBlend;    // 0 = finer level fully shown, 1 = faded into coarser
+  float fadeScale;   // Continuous scale (no level steps) for fade/axis width
+  float _pad[2];
+  uint32_t viewBuffer; // Multiview, static: bindless index of the view array
+};
+
+static_assert(sizeof(GridPushConstants) <= 128,
+              "must fit BindlessDescriptors::PUSH_CONSTANT_SIZE");
+// Per-view part of GridPushConstants; the stride of the multiview array
+constexpr size_t GRID_VIEW_SIZE = offsetof(GridPushConstants, viewBuffer);
+static_assert(GRID_VIEW_SIZE == 112, "GridView in Grid.slang");
+
+// Compile-time grid appearance, baked into the pipeline as specialization
+// constants (ids in Grid.slang follow field order). Each distinct variant is
+// one pipeline, compiled on first use.
+struct GridVariant {
+  uint32_t levels = 2; // 1 draws only the finer level, with no LOD fade
+  float fadeStart = 50.0f; // Distance fade range; scales with the camera
+  float fadeEnd = 100.0f;  // height like the grid levels do
+  bool axes = true;
+  float axisWidth = 0.05f;
+  glm::vec3 color{0.2f};
+  float opacity = 0.7f;
+
+  auto operator==(const GridVariant &other) const -> bool;
+  auto operator!=(const GridVariant &other) const -> bool {
+    return !(*this == other);
+  }
+};
+
+// SPIR-V for the grid pipeline; load() only touches the filesystem, so it can
+// run before the device exists. The multiview pair is loaded on request, or
+// by the renderer when a multiview target needs it.
+struct GridShaders {
+  std::vector<char> vertex;
+  std::vector<char> fragment;
+  std::vector<char> multiviewVertex;
+  std::vector<char> multiviewFragment;
+
+  static auto load(bool multiview = false) -> GridShaders;
 };
 
 class GridRenderer {
 public:
-  GridRenderer(VkDevice device, VkRenderPass renderPass, VkExtent2D extent);
+  // Shaders are read from disk when none are passed in. With a shared
+  // layout (BindlessDescriptors::pipelineLayout()) the pipeline keeps the
+  // global set bound; otherwise the renderer creates a push-constant-only one.
+  GridRenderer(VkDevice device, const RenderTargetLayout &target,
+               VkExtent2D extent, VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+               const GridShaders *shaders = nullptr,
+               VkPipelineLayout sharedLayout = VK_NULL_HANDLE,
+               const GridVariant &variant = {});
   ~GridRenderer();
+  GridRenderer(const GridRenderer &) = delete;
+  GridRenderer &operator=(const GridRenderer &) = delete;
+
+  // Per-frame constants: picks the two grid levels around the camera height
+  // and the screen-space horizon the vertex shader clips the quad against
+  static auto makeConstants(const Camera &camera) -> GridPushConstants;
+  // Same for one view of a camera rig (Camera::getViewProjectionMatrix)
+  static auto makeConstants(const glm::mat4 &viewProj,
+                            const glm::vec3 &cameraPos) -> GridPushConstants;
+  // False when the whole screen is above the horizon
+  static auto isGroundVisible(const GridPushConstants &constants) -> bool;
 
   void recordCommands(VkCommandBuffer cmd, const GridPushConstants &constants);
   void resize(VkExtent2D newExtent);
 
+  // Multiview targets (target.viewMask set) read each view's constants by
+  // view index from a mapped buffer per frame slot, registered with
+  // bindless. Call once before recordViews; throws without bindless.
+  void enableMultiview(VkPhysicalDevice physicalDevice,
+                       vulkan::BindlessDescriptors &bindless,
+                       uint32_t framesInFlight);
+  // All views in one draw, broadcast by the multiview pass; frame is the
+  // frame-in-flight slot
+  void recordViews(VkCommandBuffer cmd, uint32_t frame,
+                   const GridPushConstants *views, uint32_t count);
+
+  // Static pass: the draw is recorded once per frame slot into a secondary
+  // command buffer (vulkan::StaticPass) and replayed until the variant or
+  // extent changes. The views' constants go through the same buffers as
+  // multiview, so recordCommands no longer applies. Needs the bindless
+  // layout and a dynamic rendering target; call once before the first
+  // frame. queueFamily is the graphics family.
+  void enableStatic(VkPhysicalDevice physicalDevice,
+                    vulkan::BindlessDescriptors &bindless,
+                    uint32_t framesInFlight, uint32_t queueFamily);
+  auto isStatic() const -> bool { return _static.valid(); }
+  // Stores the views (count as for recordViews; 1 without multiview) for
+  // frame and returns the buffer for VulkanCore::drawFrame's staticFunc,
+  // re-recorded first if stale. VK_NULL_HANDLE when no view sees the ground.
+  auto staticCommands(uint32_t frame, const GridPushConstants *views,
+                      uint32_t count) -> VkCommandBuffer;
+  // The draw staticCommands records, binding its own descriptor sets
+  void recordStatic(VkCommandBuffer cmd, uint32_t frame);
+  // Secondaries recorded so far; flat while only the camera moves
+  auto staticRecordCount() const -> uint64_t { return _static.recordCount(); }
+
+  // Switches the pipeline used by recordCommands; a variant seen before
+  // reuses its pipeline, a new one is compiled here
+  void setVariant(const GridVariant &variant);
+  auto variant() const -> const GridVariant & {
+    return _variants[_active].first;
+  }
+  auto variantCount() const -> size_t { return _variants.size(); }
+
 private:
   VkDevice _device;
-  VkRenderPass _renderPass;
+  RenderTargetLayout _target;
   VkExtent2D _extent;
+  VkPipelineCache _pipelineCache;
 
   VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
-  VkPipeline _graphicsPipeline = VK_NULL_HANDLE;
+  bool _ownsLayout = true;
+  VkShaderStageFlags _pushStages =
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  // Kept for compiling variants after construction
+  VkShaderModule _vertModule = VK_NULL_HANDLE;
+  VkShaderModule _fragModule = VK_NULL_HANDLE;
+  std::vector<std::pair<GridVariant, VkPipeline>> _variants;
+  size_t _active = 0;
+  // Pipelines read the single view from _viewBuffers (static passes)
+  bool _viewFromBuffer = false;
+
+  // Multiview and static: MAX_VIEWS views per frame slot, persistently
+  // mapped
+  vulkan::BindlessDescriptors *_bindless = nullptr;
+  std::vector<vulkan::BufferResource> _viewBuffers;
+  std::vector<vulkan::BindlessIndex> _viewIndices;
+
+  // Static pass buffers, keyed by a count bumped whenever what they bake in
+  // (pipeline, viewport) changes
+  vulkan::StaticPass _static;
+  uint64_t _drawStateVersion = 0;
 
-  void createPipeline();
-  VkShaderModule loadShaderModule(const char *path);
+  void createViewBuffers(VkPhysicalDevice physicalDevice,
+                         vulkan::BindlessDescriptors &bindless,
+                         uint32_t framesInFlight);
+  auto writeViews(uint32_t frame, const GridPushConstants *views,
+                  uint32_t count) -> bool;
+  void setDrawState(VkCommandBuffer cmd);
+  auto createPipeline(const GridVariant &variant) -> VkPipeline;
+  VkShaderModule loadShaderModule(const std::vector<char> &code);
 };
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/*
+@brief Writers for tightly packed RGBA8 images.
+
+PNGs use stored (uncompressed) deflate blocks: files are about as large as
+the raw pixels, but writing one costs little more than a memcpy and needs no
+zlib. PAM is the raw alternative for image sequences (a short Netpbm text
+header followed by the pixels), readable by ffmpeg and ImageMagick.
+*/
+namespace image {
+
+auto writePng(const std::string &path, uint32_t width, uint32_t height,
+              const uint8_t *rgba) -> bool;
+auto writePam(const std::string &path, uint32_t width, uint32_t height,
+              const uint8_t *rgba) -> bool;
+
+// CRC-32 as used by PNG chunks (and zlib's crc32)
+auto crc32(const uint8_t *data, size_t size, uint32_t crc = 0) -> uint32_t;
+
+} // namespace image
@@ -13,6 +13,8 @@ enum class InputAction {
   Zoom,
   SpeedBoost,
   ToggleMouseCapture,
+  Screenshot,
+  ToggleRecording,
   Exit
 };
 
@@ -40,6 +42,13 @@ public:
   void enableMouseCapture(bool capture);
   bool isMouseCaptured() const { return _mouseCaptured; }
 
+  // Since the last update(): any key, mouse, scroll or window event (resize,
+  // restore, expose), or a bound key held down. False means the last frame
+  // still shows the right thing as far as input goes
+  bool hasActivity() const { return _activity; }
+  // Framebuffer resized since the last update()
+  bool wasResized() const { return _resized; }
+
   // Update (call once per frame BEFORE processing)
   void update();
 
@@ -50,6 +59,10 @@ private:
                              double yoffset);
   static void keyCallback(GLFWwindow *window, int key, int scancode, int action,
                           int mods);
+  static void framebufferSizeCallback(GLFWwindow *window, int width,
+                                      int height);
+  static void windowEventCallback(GLFWwindow *window, int state);
+  static void refreshCallback(GLFWwindow *window);
 
   void handleMouseMove(double xpos, double ypos);
   void handleScroll(double xoffset, double yoffset);
@@ -70,4 +83,10 @@ private:
   double _lastMouseX, _lastMouseY;
   glm::vec2 _mouseDelta;
   float _scrollDelta;
+
+  // Set by callbacks during event polling, latched by update()
+  bool _eventPending = false;
+  bool _resizePending = false;
+  bool _activity = true; // the first frame is always drawn
+  bool _resized = false;
 };
\ No newline at end of file
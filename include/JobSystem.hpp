@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+/*
+@brief Number of unfinished jobs submitted against it.
+
+Jobs added with JobSystem::runAfter() wait for it to drain. A counter may be
+reused once drained. Destroy it only after JobSystem::wait() on it returned:
+done() alone does not mean the last job has let go of it.
+*/
+class JobCounter {
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  auto done() const -> bool {
+    return _pending.load(std::memory_order_acquire) == 0;
+  }
+
+private:
+  friend class JobSystem;
+  struct Join;
+
+  std::atomic<uint32_t> _pending{0};
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<Join>> _continuations;
+};
+
+/*
+@brief Work-stealing scheduler shared by the engine's subsystems.
+
+Every thread owns a deque: it pushes and pops its own jobs at the back, and
+idle threads steal from the front of the others. The thread that constructs
+the JobSystem is the main thread (index 0). It only runs jobs while inside
+wait(), parallelFor() or runMainThreadJobs(), and it is the only thread that
+runs Affinity::MainThread jobs (GLFW calls). Affinity::Background jobs
+(long file writes) only run on workers, so they never stall a frame on the
+main thread; without workers they behave like Affinity::Any.
+
+Deques are mutex-guarded rather than lock-free: jobs here are coarse
+(a culling chunk, a pipeline, a file), so the lock is never the bottleneck.
+Jobs must not throw; exceptions are logged and swallowed so counters still
+drain. Jobs still queued when the JobSystem is destroyed are dropped.
+*/
+class JobSystem {
+public:
+  using Job = std::function<void()>;
+  using RangeFn = std::function<void(uint32_t begin, uint32_t end)>;
+  enum class Affinity { Any, MainThread, Background };
+
+  // workerCount threads besides the main thread
+  explicit JobSystem(uint32_t workerCount);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // counter (optional) is incremented now and decremented when job returns
+  void run(Job job, JobCounter *counter = nullptr,
+           Affinity affinity = Affinity::Any);
+  // Queues job once every dependency has drained
+  void runAfter(std::initializer_list<JobCounter *> dependencies, Job job,
+                JobCounter *counter = nullptr,
+                Affinity affinity = Affinity::Any);
+
+  // Runs other jobs until counter drains
+  void wait(JobCounter &counter);
+
+  // Splits [0, count) into about four chunks per thread, but no smaller than
+  // minGrain, runs them in parallel and returns when all are done
+  void parallelFor(uint32_t count, const RangeFn &fn, uint32_t minGrain = 1);
+
+  // Runs queued MainThread jobs; call from the main loop
+  void runMainThreadJobs();
+
+  auto threadCount() const -> uint32_t {
+    return static_cast<uint32_t>(_queues.size());
+  }
+  // 0 on the main thread and on threads not owned by this JobSystem
+  auto threadIndex() const -> uint32_t;
+
+private:
+  struct Task {
+    Job fn;
+    JobCounter *counter;
+  };
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void push(Task task, Affinity affinity);
+  auto tryRunOne(uint32_t self, bool mainThread) -> bool;
+  void execute(Task &task);
+  void release(JobCounter::Join &join);
+  void notify(bool all);
+  void workerLoop(uint32_t index);
+
+  std::vector<std::unique_ptr<Queue>> _queues; // per thread, 0 = main
+  Queue _mainOnly;
+  Queue _background; // workers only, after every deque is empty
+  std::vector<std::thread> _workers;
+  std::thread::id _mainThread;
+
+  std::atomic<uint32_t> _queued{0};   // in _queues
+  std::atomic<uint32_t> _mainQueued{0}; // in _mainOnly
+  std::atomic<uint32_t> _backgroundQueued{0};
+  std::atomic<uint32_t> _sleeping{0};
+  std::atomic<bool> _stop{false};
+  std::mutex _sleepMutex;
+  std::condition_variable _wake;
+};
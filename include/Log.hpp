@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+
+/*
+@brief Asynchronous, filtered logging.
+
+Messages are formatted (printf-style) into a fixed-size lock-free ring buffer
+and written to stdout/stderr by a background thread, so logging never blocks
+on console I/O. A message longer than a slot is formatted again into a heap
+copy the slot points to. A full ring drops the message and counts it.
+Filtering is per category at runtime and happens before any formatting.
+*/
+namespace logging {
+
+enum class Level : uint8_t { Debug, Info, Warning, Error, Off };
+
+enum class Category : uint8_t {
+  Core,
+  Validation,
+  Swapchain,
+  Input,
+  Render,
+  App,
+  Count
+};
+
+struct Stats {
+  uint64_t written = 0;
+  uint64_t droppedFull = 0;      // ring buffer was full
+  uint64_t spilled = 0;          // longer than a slot, copied to the heap
+  uint64_t truncated = 0;        // cut to a slot: the heap copy failed
+  uint64_t suppressedRepeats = 0; // validation messages over the rate limit
+};
+
+void setLevel(Category category, Level level);
+void setLevel(Level level); // all categories
+auto enabled(Category category, Level level) -> bool;
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 3, 4)))
+#endif
+void write(Category category, Level level, const char *format, ...);
+
+// Validation messages are rate limited per message ID: a burst is let
+// through, further repeats in the same window are only counted and reported
+// once the window ends.
+void validation(Level level, int32_t messageId, const char *messageName,
+                const char *message);
+
+// Block until everything queued so far has been written
+void flush();
+auto stats() -> Stats;
+
+// Parse "debug", "info", "warning", "error" or "off"
+auto parseLevel(const char *text, Level &out) -> bool;
+
+} // namespace logging
+
+#define LOG_DEBUG(category, ...)                                               \
+  do {                                                                         \
+    if (::logging::enabled(::logging::Category::category,                      \
+                           ::logging::Level::Debug))                           \
+      ::logging::write(::logging::Category::category,                          \
+                       ::logging::Level::Debug, __VA_ARGS__);                  \
+  } while (0)
+#define LOG_INFO(category, ...)                                                \
+  do {                                                                         \
+    if (::logging::enabled(::logging::Category::category,                      \
+                           ::logging::Level::Info))                            \
+      ::logging::write(::logging::Category::category, ::logging::Level::Info,  \
+                       __VA_ARGS__);                                           \
+  } while (0)
+#define LOG_WARN(category, ...)                                                \
+  do {                                                                         \
+    if (::logging::enabled(::logging::Category::category,                      \
+                           ::logging::Level::Warning))                         \
+      ::logging::write(::logging::Category::category,                          \
+                       ::logging::Level::Warning, __VA_ARGS__);                \
+  } while (0)
+#define LOG_ERROR(category, ...)                                               \
+  do {                                                                         \
+    if (::logging::enabled(::logging::Category::category,                      \
+                           ::logging::Level::Error))                           \
+      ::logging::write(::logging::Category::category,                          \
+                       ::logging::Level::Error, __VA_ARGS__);                  \
+  } while (0)
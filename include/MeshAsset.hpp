@@ -0,0 +1,30 @@
+#pragma once
+#include "MeshFormat.hpp"
+#include <string>
+#include <vector>
+
+/*
+@brief A .vmesh file held in memory exactly as stored on disk.
+
+load() reads the whole file with a single read and only validates the
+header; vertices() and indices point into that one allocation, ready to be
+copied to the GPU (GeometryPool::upload).
+*/
+class MeshAsset {
+public:
+  // Returns false (and logs) on I/O errors or a malformed header
+  auto load(const std::string &path) -> bool;
+
+  auto header() const -> const vmesh::FileHeader & { return _header; }
+  auto vertices() const -> const vmesh::PackedVertex *;
+  auto vertexBytes() const -> size_t;
+  // indexSize() bytes per index
+  auto indices() const -> const void *;
+  auto indexBytes() const -> size_t;
+  auto indexSize() const -> uint32_t { return _header.indexSize; }
+  auto empty() const -> bool { return _data.empty(); }
+
+private:
+  vmesh::FileHeader _header;
+  std::vector<char> _data;
+};
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+/*
+@brief On-disk layout of .vmesh files written by vkapp_meshimport.
+
+A file is a FileHeader followed by vertexCount PackedVertex records and
+indexCount indices of indexSize bytes, so it loads with one read and uploads
+with two copies. Indices are already ordered for the post-transform vertex
+cache and overdraw, and vertices for fetch locality.
+*/
+namespace vmesh {
+
+constexpr uint32_t MAGIC = 0x48534D56; // "VMSH"
+constexpr uint32_t VERSION = 1;
+
+// 12 bytes instead of 32 for float position/normal/uv
+struct PackedVertex {
+  uint16_t position[3]; // unorm16 across the header's bounds
+  int8_t normal[2];     // octahedral, snorm8
+  uint16_t uv[2];       // half float
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must stay 12 bytes");
+
+struct FileHeader {
+  uint32_t magic = MAGIC;
+  uint32_t version = VERSION;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  uint32_t indexSize = 4; // 2 when every index fits in 16 bits
+  uint32_t reserved = 0;
+  float boundsMin[3] = {};
+  float boundsMax[3] = {};
+  float sphere[4] = {}; // center xyz, radius
+};
+static_assert(sizeof(FileHeader) == 64, "FileHeader must stay 64 bytes");
+
+// ---- attribute codecs (shaders decode the same way) -----------------------
+
+inline auto quantizeUnorm16(float v) -> uint16_t {
+  v = std::min(std::max(v, 0.0f), 1.0f);
+  return static_cast<uint16_t>(std::lround(v * 65535.0f));
+}
+
+inline auto quantizeSnorm8(float v) -> int8_t {
+  v = std::min(std::max(v, -1.0f), 1.0f);
+  return static_cast<int8_t>(std::lround(v * 127.0f));
+}
+
+// Octahedral map of a unit vector onto [-1, 1]^2
+inline void octEncode(const float n[3], int8_t out[2]) {
+  float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+  float x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+  float y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+  if (n[2] < 0.0f) {
+    float ox = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float oy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = ox;
+    y = oy;
+  }
+  out[0] = quantizeSnorm8(x);
+  out[1] = quantizeSnorm8(y);
+}
+
+inline void octDecode(const int8_t in[2], float n[3]) {
+  float x = std::max(in[0] / 127.0f, -1.0f);
+  float y = std::max(in[1] / 127.0f, -1.0f);
+  float z = 1.0f - std::abs(x) - std::abs(y);
+  float t = std::max(-z, 0.0f);
+  x += x >= 0.0f ? -t : t;
+  y += y >= 0.0f ? -t : t;
+  float len = std::sqrt(x * x + y * y + z * z);
+  n[0] = x / len;
+  n[1] = y / len;
+  n[2] = z / len;
+}
+
+// IEEE half, round to nearest even; overflow saturates to infinity
+inline auto floatToHalf(float f) -> uint16_t {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000u;
+  uint32_t exp = (x >> 23) & 0xFFu;
+  uint32_t mant = x & 0x7FFFFFu;
+
+  if (exp == 0xFFu) // inf / nan
+    return static_cast<uint16_t>(sign | 0x7C00u | (mant ? 0x200u : 0u));
+  int e = static_cast<int>(exp) - 127 + 15;
+  if (e >= 31)
+    return static_cast<uint16_t>(sign | 0x7C00u);
+  if (e <= 0) { // subnormal or zero
+    if (e < -10)
+      return static_cast<uint16_t>(sign);
+    mant |= 0x800000u;
+    uint32_t shift = static_cast<uint32_t>(14 - e);
+    uint32_t half = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t mid = 1u << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1u)))
+      half++;
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1FFFu;
+  if (rem > 0x1000u || (rem == 0x1000u && (half & 1u)))
+    half++; // may carry into the exponent, which is still correct
+  return static_cast<uint16_t>(sign | half);
+}
+
+inline auto halfToFloat(uint16_t h) -> float {
+  uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+  uint32_t exp = (h >> 10) & 0x1Fu;
+  uint32_t mant = h & 0x3FFu;
+  uint32_t x;
+  if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else { // renormalise the subnormal
+      int e = -1;
+      do {
+        e++;
+        mant <<= 1;
+      } while ((mant & 0x400u) == 0);
+      x = sign | (static_cast<uint32_t>(127 - 15 - e) << 23) |
+          ((mant & 0x3FFu) << 13);
+    }
+  } else if (exp == 31) {
+    x = sign | 0x7F800000u | (mant << 13);
+  } else {
+    x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+} // namespace vmesh
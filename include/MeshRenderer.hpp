@@ -0,0 +1,176 @@
+#pragma once
+#include "BindlessDescriptors.hpp"
+#include "DepthPyramid.hpp"
+#include "DeviceProfile.hpp"
+#include "GeometryPool.hpp"
+#include "RenderScene.hpp"
+#include "RenderTarget.hpp"
+#include "VulkanResources.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct MeshPushConstants {
+  glm::mat4 viewProj;
+  glm::vec4 lightDir; // world space, towards the light; w unused
+};
+
+static_assert(sizeof(MeshPushConstants) <= 128,
+              "must fit BindlessDescriptors::PUSH_CONSTANT_SIZE");
+
+// SPIR-V for the mesh pipelines; load() only touches the filesystem. The
+// compute shaders are loaded for occlusion culling only.
+struct MeshShaders {
+  std::vector<char> vertex;
+  std::vector<char> fragment;
+  std::vector<char> cull;
+  std::vector<char> pyramidInit;
+  std::vector<char> pyramidReduce;
+
+  static auto load(bool occlusion = false) -> MeshShaders;
+};
+
+/*
+@brief Draws a RenderScene out of a GeometryPool.
+
+Each frame the scene is culled and batched, the visible objects' instance
+data is written to this frame slot's buffer in batch order, and each
+pipeline's commands go out in one vkCmdDrawIndexedIndirect. Recording cost
+depends on the number of pipelines and meshes, not objects.
+
+Devices without multiDrawIndirect issue one indirect draw per command;
+without drawIndirectFirstInstance the commands are recorded as direct
+draws. DrawMode::PerObject records one vkCmdDrawIndexed per visible object
+instead, as a baseline for benchmarks.
+
+With occlusion culling enabled the frame is drawn in two phases. Before the
+pass, cullEarly() tests the frustum-visible objects against the depth
+pyramid of the previous frame on the GPU, which appends what passes to the
+indirect commands recordCommands() draws. Between the halves of the pass
+(VulkanCore::splitPass) cullLate() builds the pyramid from that depth and
+re-tests the rejected objects; recordLate() draws the ones that turned out
+visible. Objects stay correct when the camera moves: anything wrongly
+rejected early is drawn late in the same frame.
+*/
+class MeshRenderer {
+public:
+  // Pipeline ids for RenderScene::add
+  enum Pipeline : uint32_t { Opaque, DoubleSided, PipelineCount };
+  enum class DrawMode { Indirect, PerObject };
+
+  // Up to maxObjects visible objects are drawn per frame
+  MeshRenderer(VkDevice device, VkPhysicalDevice physicalDevice,
+               const vulkan::DeviceProfile &profile,
+               const RenderTargetLayout &target, VkExtent2D extent,
+               VkPipelineLayout sharedLayout, uint32_t framesInFlight,
+               uint32_t maxObjects, VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+               const MeshShaders *shaders = nullptr);
+  ~MeshRenderer();
+  MeshRenderer(const MeshRenderer &) = delete;
+  MeshRenderer &operator=(const MeshRenderer &) = delete;
+
+  // With jobs, culling and the instance gather run in parallel. Under
+  // occlusion culling this draws what cullEarly() kept; scene is unused.
+  void recordCommands(VkCommandBuffer cmd, uint32_t frame,
+                      const vulkan::RenderScene &scene,
+                      const vulkan::GeometryPool &geometry,
+                      const MeshPushConstants &constants,
+                      JobSystem *jobs = nullptr);
+  void resize(VkExtent2D newExtent) { _extent = newExtent; }
+
+  void setDrawMode(DrawMode mode) { _drawMode = mode; }
+  auto drawMode() const -> DrawMode { return _drawMode; }
+
+  // Last recorded frame
+  auto drawCalls() const -> uint32_t { return _drawCalls; }
+  auto visibleObjects() const -> uint32_t { return _visibleObjects; }
+
+  // Call once before cullEarly. Throws without bindless descriptors or
+  // drawIndirectFirstInstance; shaders are read from disk when none are
+  // passed in. DrawMode is ignored from then on: draws are always indirect.
+  void enableOcclusionCulling(VkPhysicalDevice physicalDevice,
+                              vulkan::BindlessDescriptors &bindless,
+                              const MeshShaders *shaders = nullptr);
+  auto occlusionCulling() const -> bool { return _pyramid != nullptr; }
+
+  // Outside any pass, with the bindless set bound (drawFrame's prepareFunc)
+  void cullEarly(VkCommandBuffer cmd, uint32_t frame,
+                 const vulkan::RenderScene &scene,
+                 const MeshPushConstants &constants, JobSystem *jobs = nullptr);
+  // Inside splitPass: depth is what the pass has drawn so far
+  void cullLate(VkCommandBuffer cmd, uint32_t frame,
+                vulkan::BindlessIndex depth, VkExtent2D extent);
+  // After splitPass resumed the pass
+  void recordLate(VkCommandBuffer cmd, uint32_t frame,
+                  const vulkan::GeometryPool &geometry,
+                  const MeshPushConstants &constants);
+
+  struct CullStats {
+    uint32_t objects = 0;       // in the scene
+    uint32_t frustumCulled = 0; // on the CPU
+    uint32_t earlyDrawn = 0;    // visible in the previous frame's pyramid
+    uint32_t lateDrawn = 0;     // disoccluded this frame
+    uint32_t occluded = 0;      // in the frustum but drawn by neither phase
+  };
+  // Latest frame whose GPU counts have been read back; lags the recorded
+  // frame by the frames in flight
+  auto cullStats() const -> const CullStats & { return _cullStats; }
+
+private:
+  void createPipelines(const MeshShaders &shaders);
+  auto loadShaderModule(const std::vector<char> &code) -> VkShaderModule;
+  void clampToCapacity();
+  void setDrawState(VkCommandBuffer cmd, const vulkan::GeometryPool &geometry,
+                    const MeshPushConstants &constants, VkBuffer instances);
+  void recordIndirect(VkCommandBuffer cmd, uint32_t frame,
+                      uint32_t commandBase = 0);
+  void recordPerObject(VkCommandBuffer cmd);
+  void dispatchCull(VkCommandBuffer cmd, uint32_t frame, uint32_t phase,
+                    const glm::mat4 &viewProj);
+
+  VkDevice _device;
+  RenderTargetLayout _target;
+  VkExtent2D _extent;
+  VkPipelineLayout _pipelineLayout;
+  VkPipelineCache _pipelineCache;
+  bool _multiDraw;
+  bool _indirectFirstInstance;
+  uint32_t _maxObjects;
+  DrawMode _drawMode = DrawMode::Indirect;
+
+  VkPipeline _pipelines[PipelineCount] = {};
+
+  // Per frame slot, persistently mapped
+  std::vector<vulkan::BufferResource> _instanceBuffers;
+  std::vector<vulkan::BufferResource> _indirectBuffers;
+
+  vulkan::DrawBatches _batches;
+  uint32_t _drawCalls = 0;
+  uint32_t _visibleObjects = 0;
+  bool _warnedOverflow = false;
+
+  // Occlusion culling. Per frame slot; the drawn instances and commands hold
+  // an early and a late region each, the late one starting at _maxObjects.
+  struct CullFrame {
+    vulkan::BufferResource inputs;     // CullInput per tested object, mapped
+    vulkan::BufferResource drawn;      // MeshInstance per drawn object
+    vulkan::BufferResource visibility; // kept by the early phase
+    vulkan::BufferResource stats;      // drawn per phase, mapped
+    vulkan::BindlessIndex inputsIndex = vulkan::BINDLESS_INVALID;
+    vulkan::BindlessIndex sourceIndex = vulkan::BINDLESS_INVALID;
+    vulkan::BindlessIndex drawnIndex = vulkan::BINDLESS_INVALID;
+    vulkan::BindlessIndex commandsIndex = vulkan::BINDLESS_INVALID;
+    vulkan::BindlessIndex visibilityIndex = vulkan::BINDLESS_INVALID;
+    vulkan::BindlessIndex statsIndex = vulkan::BINDLESS_INVALID;
+    CullStats pending; // CPU counts, completed once the GPU's are back
+    bool recorded = false;
+  };
+  vulkan::BindlessDescriptors *_bindless = nullptr;
+  VkPipeline _cullPipeline = VK_NULL_HANDLE;
+  std::unique_ptr<DepthPyramid> _pyramid;
+  std::vector<CullFrame> _cullFrames;
+  glm::mat4 _viewProj{1.0f};        // of the frame being recorded
+  glm::mat4 _pyramidViewProj{1.0f}; // the pyramid's depth was drawn with
+  CullStats _cullStats;
+};
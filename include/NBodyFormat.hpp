@@ -0,0 +1,40 @@
+#pragma once
+#include "StarFormat.hpp"
+#include <cstdint>
+#include <vector>
+
+// Gravitational constant in parsecs, solar masses and megayears
+constexpr float NBODY_G = 4.4985022e-3f;
+
+// Velocity and mass of one body; its position and color are its Star
+struct BodyMotion {
+  glm::vec3 velocity; // parsecs per megayear
+  float mass;         // solar masses
+};
+static_assert(sizeof(BodyMotion) == 16, "BodyMotion in NBody.slang");
+
+/*
+@brief State of an N-body system, the same for both backends.
+
+Body i is stars[i] and motion[i]. stars is exactly what StarRenderer draws
+and .vstars catalogs store, so a snapshot is uploaded, drawn or saved with
+no conversion; NBodyCompute keeps the same two arrays in storage buffers.
+Both integrate with kick-drift leapfrog, so velocities trail the positions
+by half a step.
+*/
+struct NBodySnapshot {
+  std::vector<Star> stars;
+  std::vector<BodyMotion> motion;
+  double time = 0.0; // megayears
+
+  auto count() const -> uint32_t {
+    return static_cast<uint32_t>(stars.size());
+  }
+};
+
+// Defaults suit a galaxy of GalaxyDesc's default radius
+struct NBodySettings {
+  float dt = 0.2f;         // megayears per step
+  float softening = 50.0f; // Plummer softening length, parsecs
+  float theta = 0.5f;      // Barnes-Hut opening angle (NBodySimulation)
+};
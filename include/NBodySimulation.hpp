@@ -0,0 +1,97 @@
+#pragma once
+#include "NBodyFormat.hpp"
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// One octree cell in depth-first order: an internal node's first child
+// follows it, and next skips its whole subtree, so the force pass walks the
+// tree without a stack
+struct OctreeNode {
+  glm::vec3 center; // center of mass
+  float mass;
+  float size;     // cell edge, parsecs
+  uint32_t next;  // node after this subtree
+  uint32_t first; // leaves: first body in key order
+  uint32_t count; // leaves: bodies; 0 for internal nodes
+};
+static_assert(sizeof(OctreeNode) == 32, "OctreeNode must stay 32 bytes");
+
+/*
+@brief Barnes-Hut N-body integrator on the CPU.
+
+Each step sorts the bodies along a Morton curve, builds an octree with up to
+LEAF_SIZE bodies per leaf, walks it once per body for the acceleration and
+applies a kick-drift leapfrog step. A cell is taken as a point mass when its
+edge is below theta times its distance; leaves that are too close sum their
+bodies four at a time with simd::float4.
+
+With a JobSystem, the bounds, keys, sort, the 64 subtrees under the second
+tree level, the force pass and the integration all run across its threads.
+Work is cut into fixed parts independent of the thread count, so a step
+gives the same bits on any number of threads.
+*/
+class NBodySimulation {
+public:
+  static constexpr uint32_t LEAF_SIZE = 16;
+
+  explicit NBodySimulation(NBodySnapshot snapshot,
+                           const NBodySettings &settings = {});
+
+  // Advances the snapshot by settings().dt
+  void step(JobSystem *jobs = nullptr);
+
+  // Octree accelerations at the current positions, in parsecs per megayear
+  // squared, indexed like the snapshot
+  void accelerations(std::vector<glm::vec3> &out, JobSystem *jobs = nullptr);
+
+  // O(N^2) sum in double precision: the reference both backends are tested
+  // against
+  static void directAccelerations(const NBodySnapshot &snapshot,
+                                  float softening,
+                                  std::vector<glm::vec3> &out,
+                                  JobSystem *jobs = nullptr);
+
+  auto snapshot() const -> const NBodySnapshot & { return _snapshot; }
+  auto settings() const -> const NBodySettings & { return _settings; }
+  void setSettings(const NBodySettings &settings) { _settings = settings; }
+
+  // Of the last force pass: body-body plus body-cell terms
+  auto interactions() const -> uint64_t { return _interactions; }
+  auto nodes() const -> const std::vector<OctreeNode> & { return _nodes; }
+
+private:
+  void buildTree(JobSystem *jobs);
+  void computeForces(JobSystem *jobs);
+  // Node for keys [begin, end) of a cell at level, appended with its
+  // subtree to nodes; next is relative to nodes
+  auto buildSubtree(uint32_t begin, uint32_t end, uint32_t level,
+                    std::vector<OctreeNode> &nodes) const -> uint32_t;
+  // The levels above the top cells, their subtrees spliced in
+  auto assemble(uint32_t level, uint32_t cell) -> uint32_t;
+  auto walk(uint32_t k, glm::vec3 &acceleration) const -> uint32_t;
+
+  NBodySnapshot _snapshot;
+  NBodySettings _settings;
+  uint64_t _interactions = 0;
+
+  // Bounding cube of the last build
+  glm::vec3 _origin{0.0f};
+  float _size = 0.0f;
+
+  std::vector<uint64_t> _unsorted; // Morton key << 32 | body
+  std::vector<uint64_t> _keys;     // the same, sorted
+  std::vector<uint32_t> _cells;    // first key of each top cell, plus the end
+  std::vector<std::vector<OctreeNode>> _subtrees; // per top cell
+  std::vector<OctreeNode> _nodes;
+  // Bodies in key order, padded to whole float4s with massless bodies
+  std::vector<float> _x, _y, _z, _m;
+  std::vector<glm::vec3> _accelerations; // key order
+};
+
+// The stars with totalMass shared equally, each moving on a circular orbit
+// about the Y axis through the origin in the field of the mass inside its
+// radius: a cold, rotating start for generated galaxies
+auto makeRotatingSnapshot(std::vector<Star> stars, float totalMass,
+                          float softening) -> NBodySnapshot;
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+/*
+@brief VkPipelineCache persisted to disk between runs.
+
+load() only reads the file, so it can run before the device exists; create()
+seeds the cache with that data when its header matches the device and
+starts empty otherwise.
+*/
+class PipelineCache {
+public:
+  PipelineCache() = default;
+  ~PipelineCache();
+  PipelineCache(const PipelineCache &) = delete;
+  PipelineCache &operator=(const PipelineCache &) = delete;
+
+  // Returns false if the file is missing or unreadable (not an error)
+  auto load(const std::string &path) -> bool;
+  auto create(VkDevice device, VkPhysicalDevice physicalDevice) -> bool;
+  auto save(const std::string &path) const -> bool;
+  void destroy();
+
+  auto handle() const -> VkPipelineCache { return _cache; }
+
+private:
+  VkDevice _device = VK_NULL_HANDLE;
+  VkPipelineCache _cache = VK_NULL_HANDLE;
+  std::vector<char> _initialData;
+};
+
+} // namespace vulkan
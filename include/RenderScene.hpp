@@ -0,0 +1,127 @@
+#pragma once
+#include "GeometryPool.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class JobSystem;
+
+namespace vulkan {
+
+using SceneObject = uint32_t;
+constexpr SceneObject INVALID_OBJECT = UINT32_MAX;
+
+// Per-instance vertex data (binding 1 of MeshRenderer's pipelines)
+struct MeshInstance {
+  // Rows of the 3x4 object-to-world matrix with the mesh's unorm16
+  // dequantization folded in
+  glm::vec4 model[3];
+  // Undoes the dequantization scale before normals go through `model`
+  // (1 / extent, w unused); exact for uniformly scaled objects
+  glm::vec4 normalScale;
+};
+static_assert(sizeof(MeshInstance) == 64, "MeshInstance is a vertex stride");
+
+// Output of RenderScene::buildBatches, reused across frames so steady-state
+// building does not allocate
+struct DrawBatches {
+  struct Range {
+    uint32_t firstCommand = 0;
+    uint32_t commandCount = 0;
+  };
+
+  // Dense object indices, grouped by command; a command's instances start
+  // at its firstInstance
+  std::vector<uint32_t> instances;
+  // One command per (pipeline, mesh) with at least one visible object
+  std::vector<VkDrawIndexedIndirectCommand> commands;
+  // Commands of each pipeline id, contiguous in `commands`
+  std::vector<Range> pipelines;
+  uint32_t culled = 0;
+
+  // scratch
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> offsets;
+};
+
+/*
+@brief Renderable objects in structure-of-arrays form.
+
+Transforms, world bounding spheres, mesh and pipeline ids live in parallel
+dense arrays, so per-frame passes stream through only the fields they read.
+Handles stay stable: removal swaps the last object into the hole and
+patches the handle table.
+
+buildBatches() groups the objects by (pipeline, mesh) with a counting sort
+and emits one VkDrawIndexedIndirectCommand per group, so the number of
+draws depends on the number of distinct meshes, not objects.
+*/
+class RenderScene {
+public:
+  // Meshes must outlive the scene's use of them in the pool
+  auto addMesh(const MeshAllocation &mesh) -> uint32_t;
+  auto meshCount() const -> uint32_t {
+    return static_cast<uint32_t>(_meshes.size());
+  }
+  auto mesh(uint32_t id) const -> const MeshAllocation & {
+    return _meshes[id];
+  }
+
+  auto add(uint32_t mesh, uint32_t pipeline, const glm::mat4 &transform)
+      -> SceneObject;
+  void remove(SceneObject object);
+  void setTransform(SceneObject object, const glm::mat4 &transform);
+  void clear();
+
+  auto contains(SceneObject object) const -> bool;
+  auto size() const -> uint32_t {
+    return static_cast<uint32_t>(_transforms.size());
+  }
+  auto pipelineCount() const -> uint32_t { return _pipelineCount; }
+
+  // Dense arrays, indexed 0..size()-1
+  auto transforms() const -> const std::vector<glm::mat4> & {
+    return _transforms;
+  }
+  auto spheres() const -> const std::vector<glm::vec4> & { return _spheres; }
+  auto meshIds() const -> const std::vector<uint32_t> & { return _meshIds; }
+  auto pipelineIds() const -> const std::vector<uint32_t> & {
+    return _pipelineIds;
+  }
+  auto instances() const -> const std::vector<MeshInstance> & {
+    return _instances;
+  }
+  auto handles() const -> const std::vector<SceneObject> & { return _handles; }
+
+  // Objects whose world sphere lies outside the frustum of viewProj (GL
+  // clip space, as Camera produces) are skipped; pass nullptr to keep all.
+  // With jobs, culling is split across threads; the sort stays serial.
+  void buildBatches(DrawBatches &out, const glm::mat4 *viewProj = nullptr,
+                    JobSystem *jobs = nullptr) const;
+
+private:
+  void updateDerived(uint32_t dense);
+
+  std::vector<MeshAllocation> _meshes;
+  uint32_t _pipelineCount = 0;
+
+  // SoA, dense
+  std::vector<glm::mat4> _transforms;
+  std::vector<glm::vec4> _spheres; // world center xyz, radius
+  std::vector<uint32_t> _meshIds;
+  std::vector<uint32_t> _pipelineIds;
+  std::vector<MeshInstance> _instances;
+  std::vector<SceneObject> _handles; // dense -> handle
+
+  std::vector<uint32_t> _dense; // handle -> dense, UINT32_MAX when free
+  std::vector<SceneObject> _freeHandles;
+};
+
+// Lays `count` copies of a mesh on a square lattice resting on the y = 0
+// plane, centered on the origin, each turned by a different yaw. Returns the
+// lattice's half-width.
+auto addObjectGrid(RenderScene &scene, uint32_t mesh, uint32_t pipeline,
+                   uint32_t count) -> float;
+
+} // namespace vulkan
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+// Most views a frame can render side by side (VulkanCore::setViews)
+constexpr uint32_t MAX_VIEWS = 4;
+
+/*
+@brief Describes what a renderer's pipelines draw into.
+
+With VK_KHR_dynamic_rendering the render pass stays null and pipelines are
+built from the attachment formats alone. On devices without the extension
+the legacy render pass is filled in instead. A non-zero viewMask means every
+draw is broadcast to those layers (VK_KHR_multiview); shaders pick their
+view by SV_ViewID.
+*/
+struct RenderTargetLayout {
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  uint32_t viewMask = 0;
+
+  auto usesDynamicRendering() const -> bool {
+    return renderPass == VK_NULL_HANDLE;
+  }
+};
+
+// Point a pipeline create info at the target. `rendering` must outlive the
+// vkCreateGraphicsPipelines call because it is chained through pNext.
+inline void applyRenderTarget(VkGraphicsPipelineCreateInfo &pipelineInfo,
+                              VkPipelineRenderingCreateInfoKHR &rendering,
+                              const RenderTargetLayout &target) {
+  if (!target.usesDynamicRendering()) {
+    pipelineInfo.renderPass = target.renderPass;
+    pipelineInfo.subpass = 0;
+    return;
+  }
+
+  rendering = {};
+  rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+  rendering.colorAttachmentCount = 1;
+  rendering.pColorAttachmentFormats = &target.colorFormat;
+  rendering.depthAttachmentFormat = target.depthFormat;
+  rendering.viewMask = target.viewMask;
+
+  rendering.pNext = pipelineInfo.pNext;
+  pipelineInfo.pNext = &rendering;
+  pipelineInfo.renderPass = VK_NULL_HANDLE;
+}
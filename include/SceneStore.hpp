@@ -0,0 +1,77 @@
+#pragma once
+#include "RenderScene.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+namespace vulkan {
+
+using SceneNode = uint32_t;
+constexpr SceneNode INVALID_NODE = UINT32_MAX;
+
+/*
+@brief Transform hierarchy stored as parallel arrays sorted by depth.
+
+Every parent precedes its children, and the nodes of one depth are
+contiguous, so propagate() walks the levels in order and each level is a
+flat loop whose iterations are independent: a node only reads its parent's
+world matrix, finished on the level above. Levels are split across the
+JobSystem and the products use simd::mul.
+
+Only subtrees under a changed local transform are recomputed. Nodes can
+carry a RenderScene object, which syncTo() keeps at the node's world
+transform.
+*/
+class SceneStore {
+public:
+  // parent must already exist (or be INVALID_NODE for a root)
+  auto create(const glm::mat4 &local, SceneNode parent = INVALID_NODE)
+      -> SceneNode;
+  // Destroys the node and its whole subtree; attached render objects stay
+  // in the RenderScene
+  void destroy(SceneNode node);
+  void clear();
+
+  void setLocal(SceneNode node, const glm::mat4 &local);
+  auto local(SceneNode node) const -> const glm::mat4 &;
+  // As of the last propagate()
+  auto world(SceneNode node) const -> const glm::mat4 &;
+  auto parent(SceneNode node) const -> SceneNode;
+  void setRenderObject(SceneNode node, SceneObject object);
+
+  auto contains(SceneNode node) const -> bool;
+  auto size() const -> uint32_t {
+    return static_cast<uint32_t>(_locals.size());
+  }
+  auto levelCount() const -> uint32_t {
+    return _levels.empty() ? 0 : static_cast<uint32_t>(_levels.size() - 1);
+  }
+
+  // Recomputes world matrices of changed subtrees; serial without jobs
+  void propagate(JobSystem *jobs = nullptr);
+  // Pushes world matrices changed by the last propagate() into the scene
+  void syncTo(RenderScene &scene) const;
+
+private:
+  void sortByDepth();
+
+  // SoA in depth order; parents are dense indices
+  std::vector<glm::mat4> _locals;
+  std::vector<glm::mat4> _worlds;
+  std::vector<uint32_t> _parents;
+  std::vector<uint32_t> _depths;
+  std::vector<SceneObject> _renderObjects;
+  std::vector<uint8_t> _localDirty;
+  std::vector<uint8_t> _changed; // world recomputed by the last propagate
+  std::vector<SceneNode> _handles; // dense -> handle
+
+  std::vector<uint32_t> _dense; // handle -> dense, UINT32_MAX when free
+  std::vector<SceneNode> _freeHandles;
+
+  std::vector<uint32_t> _levels; // first dense index of each depth, + end
+  bool _structureDirty = false;  // order and _levels need rebuilding
+};
+
+} // namespace vulkan
@@ -0,0 +1,461 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKAPP_SIMD_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define VKAPP_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+@brief Hand-vectorized kernels for hot loops over many transforms or points.
+
+glm only vectorizes when built with GLM_FORCE_INTRINSICS, which is not set
+for the engine. Each column of a matrix product is a linear combination of
+a's columns, so a 4x4 product is 16 broadcast multiply-adds on SSE or NEON;
+other targets fall back to glm. Results may alias either operand.
+
+float4 and uint4 are four-lane registers on SSE2 and NEON and plain arrays
+elsewhere. log, exp and sincos are built from their operators only, so every
+target runs the same polynomials.
+*/
+namespace simd {
+
+inline void mul(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out) {
+#if defined(VKAPP_SIMD_SSE)
+  const float *pa = &a[0][0];
+  const float *pb = &b[0][0];
+  float *po = &out[0][0];
+  __m128 a0 = _mm_loadu_ps(pa);
+  __m128 a1 = _mm_loadu_ps(pa + 4);
+  __m128 a2 = _mm_loadu_ps(pa + 8);
+  __m128 a3 = _mm_loadu_ps(pa + 12);
+  for (int c = 0; c < 4; c++) {
+    __m128 col = _mm_loadu_ps(pb + 4 * c);
+    __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(col, col, 0x00));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(col, col, 0x55)));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(col, col, 0xAA)));
+    r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(col, col, 0xFF)));
+    _mm_storeu_ps(po + 4 * c, r);
+  }
+#elif defined(VKAPP_SIMD_NEON)
+  const float *pa = &a[0][0];
+  const float *pb = &b[0][0];
+  float *po = &out[0][0];
+  float32x4_t a0 = vld1q_f32(pa);
+  float32x4_t a1 = vld1q_f32(pa + 4);
+  float32x4_t a2 = vld1q_f32(pa + 8);
+  float32x4_t a3 = vld1q_f32(pa + 12);
+  for (int c = 0; c < 4; c++) {
+    float32x4_t col = vld1q_f32(pb + 4 * c);
+    float32x4_t r = vmulq_laneq_f32(a0, col, 0);
+    r = vfmaq_laneq_f32(r, a1, col, 1);
+    r = vfmaq_laneq_f32(r, a2, col, 2);
+    r = vfmaq_laneq_f32(r, a3, col, 3);
+    vst1q_f32(po + 4 * c, r);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+// ---- four-lane registers ---------------------------------------------------
+
+#if defined(VKAPP_SIMD_SSE)
+struct float4 {
+  __m128 v;
+};
+struct uint4 {
+  __m128i v;
+};
+
+inline auto splat(float x) -> float4 { return {_mm_set1_ps(x)}; }
+inline auto splat(uint32_t x) -> uint4 {
+  return {_mm_set1_epi32(static_cast<int>(x))};
+}
+inline auto load(const float *p) -> float4 { return {_mm_loadu_ps(p)}; }
+inline auto load(const uint32_t *p) -> uint4 {
+  return {_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))};
+}
+inline void store(float *p, float4 a) { _mm_storeu_ps(p, a.v); }
+inline void store(uint32_t *p, uint4 a) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), a.v);
+}
+
+inline auto operator+(float4 a, float4 b) -> float4 {
+  return {_mm_add_ps(a.v, b.v)};
+}
+inline auto operator-(float4 a, float4 b) -> float4 {
+  return {_mm_sub_ps(a.v, b.v)};
+}
+inline auto operator*(float4 a, float4 b) -> float4 {
+  return {_mm_mul_ps(a.v, b.v)};
+}
+inline auto operator/(float4 a, float4 b) -> float4 {
+  return {_mm_div_ps(a.v, b.v)};
+}
+inline auto min(float4 a, float4 b) -> float4 { return {_mm_min_ps(a.v, b.v)}; }
+inline auto max(float4 a, float4 b) -> float4 { return {_mm_max_ps(a.v, b.v)}; }
+inline auto sqrt(float4 a) -> float4 { return {_mm_sqrt_ps(a.v)}; }
+// All ones in lanes where a < b
+inline auto less(float4 a, float4 b) -> uint4 {
+  return {_mm_castps_si128(_mm_cmplt_ps(a.v, b.v))};
+}
+
+inline auto operator+(uint4 a, uint4 b) -> uint4 {
+  return {_mm_add_epi32(a.v, b.v)};
+}
+inline auto operator&(uint4 a, uint4 b) -> uint4 {
+  return {_mm_and_si128(a.v, b.v)};
+}
+inline auto operator|(uint4 a, uint4 b) -> uint4 {
+  return {_mm_or_si128(a.v, b.v)};
+}
+inline auto operator^(uint4 a, uint4 b) -> uint4 {
+  return {_mm_xor_si128(a.v, b.v)};
+}
+template <int N> inline auto shiftLeft(uint4 a) -> uint4 {
+  return {_mm_slli_epi32(a.v, N)};
+}
+template <int N> inline auto shiftRight(uint4 a) -> uint4 {
+  return {_mm_srli_epi32(a.v, N)};
+}
+
+inline auto asFloat(uint4 a) -> float4 { return {_mm_castsi128_ps(a.v)}; }
+inline auto asUint(float4 a) -> uint4 { return {_mm_castps_si128(a.v)}; }
+// Lanes read as int32
+inline auto toFloat(uint4 a) -> float4 { return {_mm_cvtepi32_ps(a.v)}; }
+// Nearest int32, ties to even
+inline auto roundToInt(float4 a) -> uint4 { return {_mm_cvtps_epi32(a.v)}; }
+// mask ? a : b per bit
+inline auto select(uint4 mask, float4 a, float4 b) -> float4 {
+  __m128 m = _mm_castsi128_ps(mask.v);
+  return {_mm_or_ps(_mm_and_ps(m, a.v), _mm_andnot_ps(m, b.v))};
+}
+
+// Rows a..d become columns, so four xyzw records store with four writes
+inline void transpose(float4 &a, float4 &b, float4 &c, float4 &d) {
+  _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+}
+#elif defined(VKAPP_SIMD_NEON)
+struct float4 {
+  float32x4_t v;
+};
+struct uint4 {
+  uint32x4_t v;
+};
+
+inline auto splat(float x) -> float4 { return {vdupq_n_f32(x)}; }
+inline auto splat(uint32_t x) -> uint4 { return {vdupq_n_u32(x)}; }
+inline auto load(const float *p) -> float4 { return {vld1q_f32(p)}; }
+inline auto load(const uint32_t *p) -> uint4 { return {vld1q_u32(p)}; }
+inline void store(float *p, float4 a) { vst1q_f32(p, a.v); }
+inline void store(uint32_t *p, uint4 a) { vst1q_u32(p, a.v); }
+
+inline auto operator+(float4 a, float4 b) -> float4 {
+  return {vaddq_f32(a.v, b.v)};
+}
+inline auto operator-(float4 a, float4 b) -> float4 {
+  return {vsubq_f32(a.v, b.v)};
+}
+inline auto operator*(float4 a, float4 b) -> float4 {
+  return {vmulq_f32(a.v, b.v)};
+}
+inline auto operator/(float4 a, float4 b) -> float4 {
+  return {vdivq_f32(a.v, b.v)};
+}
+inline auto min(float4 a, float4 b) -> float4 { return {vminq_f32(a.v, b.v)}; }
+inline auto max(float4 a, float4 b) -> float4 { return {vmaxq_f32(a.v, b.v)}; }
+inline auto sqrt(float4 a) -> float4 { return {vsqrtq_f32(a.v)}; }
+inline auto less(float4 a, float4 b) -> uint4 { return {vcltq_f32(a.v, b.v)}; }
+
+inline auto operator+(uint4 a, uint4 b) -> uint4 {
+  return {vaddq_u32(a.v, b.v)};
+}
+inline auto operator&(uint4 a, uint4 b) -> uint4 {
+  return {vandq_u32(a.v, b.v)};
+}
+inline auto operator|(uint4 a, uint4 b) -> uint4 {
+  return {vorrq_u32(a.v, b.v)};
+}
+inline auto operator^(uint4 a, uint4 b) -> uint4 {
+  return {veorq_u32(a.v, b.v)};
+}
+template <int N> inline auto shiftLeft(uint4 a) -> uint4 {
+  return {vshlq_n_u32(a.v, N)};
+}
+template <int N> inline auto shiftRight(uint4 a) -> uint4 {
+  return {vshrq_n_u32(a.v, N)};
+}
+
+inline auto asFloat(uint4 a) -> float4 { return {vreinterpretq_f32_u32(a.v)}; }
+inline auto asUint(float4 a) -> uint4 { return {vreinterpretq_u32_f32(a.v)}; }
+inline auto toFloat(uint4 a) -> float4 {
+  return {vcvtq_f32_s32(vreinterpretq_s32_u32(a.v))};
+}
+inline auto roundToInt(float4 a) -> uint4 {
+  return {vreinterpretq_u32_s32(vcvtnq_s32_f32(a.v))};
+}
+inline auto select(uint4 mask, float4 a, float4 b) -> float4 {
+  return {vbslq_f32(mask.v, a.v, b.v)};
+}
+
+inline void transpose(float4 &a, float4 &b, float4 &c, float4 &d) {
+  float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+  float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+  a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+  b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+  c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+  d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+#else
+struct float4 {
+  float v[4];
+};
+struct uint4 {
+  uint32_t v[4];
+};
+
+#define VKAPP_SIMD_LANES(type, expr)                                           \
+  type r;                                                                      \
+  for (int i = 0; i < 4; i++)                                                  \
+    r.v[i] = expr;                                                             \
+  return r
+
+inline auto splat(float x) -> float4 { VKAPP_SIMD_LANES(float4, x); }
+inline auto splat(uint32_t x) -> uint4 { VKAPP_SIMD_LANES(uint4, x); }
+inline auto load(const float *p) -> float4 { VKAPP_SIMD_LANES(float4, p[i]); }
+inline auto load(const uint32_t *p) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, p[i]);
+}
+inline void store(float *p, float4 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+inline void store(uint32_t *p, uint4 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+
+inline auto operator+(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, a.v[i] + b.v[i]);
+}
+inline auto operator-(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, a.v[i] - b.v[i]);
+}
+inline auto operator*(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, a.v[i] * b.v[i]);
+}
+inline auto operator/(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, a.v[i] / b.v[i]);
+}
+inline auto min(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, b.v[i] < a.v[i] ? b.v[i] : a.v[i]);
+}
+inline auto max(float4 a, float4 b) -> float4 {
+  VKAPP_SIMD_LANES(float4, a.v[i] < b.v[i] ? b.v[i] : a.v[i]);
+}
+inline auto sqrt(float4 a) -> float4 {
+  VKAPP_SIMD_LANES(float4, std::sqrt(a.v[i]));
+}
+inline auto less(float4 a, float4 b) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] < b.v[i] ? ~0u : 0u);
+}
+
+inline auto operator+(uint4 a, uint4 b) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] + b.v[i]);
+}
+inline auto operator&(uint4 a, uint4 b) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] & b.v[i]);
+}
+inline auto operator|(uint4 a, uint4 b) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] | b.v[i]);
+}
+inline auto operator^(uint4 a, uint4 b) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] ^ b.v[i]);
+}
+template <int N> inline auto shiftLeft(uint4 a) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] << N);
+}
+template <int N> inline auto shiftRight(uint4 a) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, a.v[i] >> N);
+}
+
+inline auto asFloat(uint4 a) -> float4 {
+  float4 r;
+  std::memcpy(r.v, a.v, sizeof(r.v));
+  return r;
+}
+inline auto asUint(float4 a) -> uint4 {
+  uint4 r;
+  std::memcpy(r.v, a.v, sizeof(r.v));
+  return r;
+}
+inline auto toFloat(uint4 a) -> float4 {
+  VKAPP_SIMD_LANES(float4, static_cast<float>(static_cast<int32_t>(a.v[i])));
+}
+inline auto roundToInt(float4 a) -> uint4 {
+  VKAPP_SIMD_LANES(uint4, static_cast<uint32_t>(
+                              static_cast<int32_t>(std::nearbyint(a.v[i]))));
+}
+inline auto select(uint4 mask, float4 a, float4 b) -> float4 {
+  return asFloat((mask & asUint(a)) | (asUint(b) & (mask ^ splat(~0u))));
+}
+
+inline void transpose(float4 &a, float4 &b, float4 &c, float4 &d) {
+  float m[4][4];
+  store(m[0], a);
+  store(m[1], b);
+  store(m[2], c);
+  store(m[3], d);
+  for (int i = 0; i < 4; i++) {
+    a.v[i] = m[i][0];
+    b.v[i] = m[i][1];
+    c.v[i] = m[i][2];
+    d.v[i] = m[i][3];
+  }
+}
+
+#undef VKAPP_SIMD_LANES
+#endif
+
+inline auto operator-(uint4 a, uint4 b) -> uint4 {
+  return a + (b ^ splat(~0u)) + splat(1u);
+}
+inline auto clamp(float4 x, float lo, float hi) -> float4 {
+  return min(max(x, splat(lo)), splat(hi));
+}
+
+// ---- math ------------------------------------------------------------------
+
+// Natural log of positive normal x, to a few ulp
+inline auto log(float4 x) -> float4 {
+  uint4 bits = asUint(x);
+  float4 exponent =
+      toFloat(shiftRight<23>(bits) & splat(0xFFu)) - splat(127.0f);
+  // Mantissa in [1, 2), then folded into [sqrt(1/2), sqrt(2))
+  float4 m = asFloat((bits & splat(0x007FFFFFu)) | splat(0x3F800000u));
+  uint4 high = less(splat(1.41421356f), m);
+  m = select(high, m * splat(0.5f), m);
+  exponent = exponent + select(high, splat(1.0f), splat(0.0f));
+  // ln m = 2 atanh(s), |s| <= 0.172
+  float4 s = (m - splat(1.0f)) / (m + splat(1.0f));
+  float4 s2 = s * s;
+  float4 p = splat(1.0f / 9.0f);
+  p = p * s2 + splat(1.0f / 7.0f);
+  p = p * s2 + splat(1.0f / 5.0f);
+  p = p * s2 + splat(1.0f / 3.0f);
+  p = p * s2 + splat(1.0f);
+  return exponent * splat(0.693147181f) + splat(2.0f) * s * p;
+}
+
+// e^x, clamped to the normal float range
+inline auto exp(float4 x) -> float4 {
+  x = clamp(x, -87.0f, 88.0f);
+  uint4 n = roundToInt(x * splat(1.44269504f));
+  float4 nf = toFloat(n);
+  // Cody-Waite reduction: r = x - n ln 2, |r| <= 0.347
+  float4 r = x - nf * splat(0.693359375f) - nf * splat(-2.12194440e-4f);
+  float4 p = splat(1.0f / 720.0f);
+  p = p * r + splat(1.0f / 120.0f);
+  p = p * r + splat(1.0f / 24.0f);
+  p = p * r + splat(1.0f / 6.0f);
+  p = p * r + splat(0.5f);
+  p = p * r + splat(1.0f);
+  p = p * r + splat(1.0f);
+  return p * asFloat(shiftLeft<23>(n + splat(127u)));
+}
+
+// Sine and cosine of x; accurate to a few ulp for |x| < 1000
+inline void sincos(float4 x, float4 &s, float4 &c) {
+  // Quadrant j and r = x - j pi/2 in [-pi/4, pi/4]
+  uint4 j = roundToInt(x * splat(0.636619772f));
+  float4 jf = toFloat(j);
+  float4 r = x - jf * splat(1.5703125f) - jf * splat(4.83751297e-4f) -
+             jf * splat(7.54978995e-8f);
+  float4 r2 = r * r;
+  float4 sr = splat(2.75573192e-6f);
+  sr = sr * r2 - splat(1.98412698e-4f);
+  sr = sr * r2 + splat(8.33333333e-3f);
+  sr = sr * r2 - splat(1.66666667e-1f);
+  sr = sr * r2 * r + r;
+  float4 cr = splat(2.48015873e-5f);
+  cr = cr * r2 - splat(1.38888889e-3f);
+  cr = cr * r2 + splat(4.16666667e-2f);
+  cr = cr * r2 - splat(0.5f);
+  cr = cr * r2 + splat(1.0f);
+  // Odd quadrants swap sin and cos; signs follow the quadrant
+  uint4 odd = splat(0u) - (j & splat(1u));
+  float4 sv = select(odd, cr, sr);
+  float4 cv = select(odd, sr, cr);
+  s = asFloat(asUint(sv) ^ shiftLeft<30>(j & splat(2u)));
+  c = asFloat(asUint(cv) ^ shiftLeft<30>((j + splat(1u)) & splat(2u)));
+}
+
+// ---- random numbers --------------------------------------------------------
+
+/*
+@brief Four independent xoshiro128+ streams, one per lane.
+
+Shifts, xors and adds only, so each draw is a handful of instructions on
+SSE2 or NEON. The low bits of xoshiro128+ are weak; uniform() keeps the top
+24, which is all a float mantissa holds anyway.
+*/
+class Random4 {
+public:
+  // Seeds the lanes from one 64-bit value with splitmix64, so nearby seeds
+  // give unrelated streams
+  explicit Random4(uint64_t seed) {
+    uint32_t state[16];
+    for (int i = 0; i < 16; i += 2) {
+      uint64_t z = splitmix64(seed);
+      state[i] = static_cast<uint32_t>(z);
+      state[i + 1] = static_cast<uint32_t>(z >> 32);
+    }
+    for (int k = 0; k < 4; k++) {
+      uint32_t lanes[4];
+      for (int lane = 0; lane < 4; lane++)
+        lanes[lane] = state[lane * 4 + k] | (k == 0 ? 1u : 0u); // never all 0
+      _s[k] = load(lanes);
+    }
+  }
+
+  auto next() -> uint4 {
+    uint4 result = _s[0] + _s[3];
+    uint4 t = shiftLeft<9>(_s[1]);
+    _s[2] = _s[2] ^ _s[0];
+    _s[3] = _s[3] ^ _s[1];
+    _s[1] = _s[1] ^ _s[2];
+    _s[0] = _s[0] ^ _s[3];
+    _s[2] = _s[2] ^ t;
+    _s[3] = shiftLeft<11>(_s[3]) | shiftRight<21>(_s[3]);
+    return result;
+  }
+
+  // Uniform in the open interval (0, 1), safe to take the log of
+  auto uniform() -> float4 {
+    return (toFloat(shiftRight<8>(next())) + splat(0.5f)) *
+           splat(1.0f / 16777216.0f);
+  }
+
+  // Two independent standard normal variates (Box-Muller)
+  void normal(float4 &a, float4 &b) {
+    float4 radius = sqrt(splat(-2.0f) * log(uniform()));
+    float4 s, c;
+    sincos(splat(6.28318531f) * uniform(), s, c);
+    a = radius * c;
+    b = radius * s;
+  }
+
+  static auto splitmix64(uint64_t &state) -> uint64_t {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+private:
+  uint4 _s[4];
+};
+
+} // namespace simd
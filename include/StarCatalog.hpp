@@ -0,0 +1,37 @@
+#pragma once
+#include "StarFormat.hpp"
+#include <fstream>
+#include <string>
+
+/*
+@brief A .vstars star catalog, read in ranges straight into caller memory.
+
+open() only reads and validates the header. read() copies any range of
+stars from the file, so catalogs larger than memory upload chunk by chunk
+through fill() (StarRenderer::upload). write() streams stars from any
+StarFill to disk, such as GalaxyGenerator::fill().
+*/
+class StarCatalog {
+public:
+  // Returns false (and logs) on I/O errors, a malformed header or a file
+  // shorter than its header says
+  auto open(const std::string &path) -> bool;
+
+  auto header() const -> const vstars::FileHeader & { return _header; }
+  auto count() const -> uint32_t { return _header.count; }
+
+  // Stars [first, first + count); false (and logs) past the end or on I/O
+  // errors
+  auto read(Star *out, uint32_t first, uint32_t count) -> bool;
+  // read() as a StarFill; the catalog must outlive it
+  auto fill() -> StarFill;
+
+  // Writes count stars from fill in blocks, with their bounds in the header
+  static auto write(const std::string &path, uint32_t count, uint64_t seed,
+                    const StarFill &fill) -> bool;
+
+private:
+  std::string _path;
+  std::ifstream _file;
+  vstars::FileHeader _header;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+// One point star as shaders/Stars.slang reads it and .vstars files store it
+struct Star {
+  glm::vec3 position; // parsecs (CameraConstants::Galaxy)
+  uint32_t color;     // packStarColor
+};
+static_assert(sizeof(Star) == 16, "Star in Stars.slang");
+
+// RGB8 color (linear, 0-1) and A8 absolute magnitude, clamped to [-10, 20]
+inline auto packStarColor(const glm::vec3 &rgb, float absoluteMagnitude)
+    -> uint32_t {
+  auto unorm8 = [](float v) {
+    return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+  };
+  float magnitude = std::clamp(absoluteMagnitude, -10.0f, 20.0f);
+  uint32_t m = static_cast<uint32_t>((magnitude + 10.0f) * (255.0f / 30.0f) +
+                                     0.5f);
+  return unorm8(rgb.r) | unorm8(rgb.g) << 8 | unorm8(rgb.b) << 16 | m << 24;
+}
+
+// Writes stars [first, first + count) of some source to out; false on error
+using StarFill =
+    std::function<bool(Star *out, uint32_t first, uint32_t count)>;
+
+/*
+@brief On-disk layout of .vstars star catalogs.
+
+A file is a FileHeader followed by count Star records, so a catalog streams
+from disk into upload staging memory without any conversion.
+*/
+namespace vstars {
+
+constexpr uint32_t MAGIC = 0x52545356; // "VSTR"
+constexpr uint32_t VERSION = 1;
+
+struct FileHeader {
+  uint32_t magic = MAGIC;
+  uint32_t version = VERSION;
+  uint32_t count = 0;
+  uint32_t reserved = 0;
+  uint64_t seed = 0; // generator seed, 0 when not generated
+  float boundsMin[3] = {};
+  float boundsMax[3] = {};
+};
+static_assert(sizeof(FileHeader) == 48, "FileHeader must stay 48 bytes");
+
+} // namespace vstars
@@ -0,0 +1,136 @@
+#pragma once
+#include "BindlessDescriptors.hpp"
+#include "RenderTarget.hpp"
+#include "StarFormat.hpp"
+#include "VulkanResources.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct StarPushConstants {
+  glm::mat4 viewProj;
+  glm::vec3 eye;
+  float exposure; // display value of a magnitude 0 star seen from 10 pc
+  uint32_t stars;
+  uint32_t count;
+  uint32_t accumulation;
+  uint32_t width;
+  uint32_t height;
+};
+
+static_assert(sizeof(StarPushConstants) <= 128,
+              "must fit BindlessDescriptors::PUSH_CONSTANT_SIZE");
+
+// SPIR-V for the star pipelines; load() only touches the filesystem
+struct StarShaders {
+  std::vector<char> splat;
+  std::vector<char> resolveVertex;
+  std::vector<char> resolveFragment;
+  std::vector<char> pointVertex;
+  std::vector<char> pointFragment;
+
+  static auto load() -> StarShaders;
+};
+
+/*
+@brief Draws large sets of sub-pixel stars.
+
+Most stars cover less than a pixel, where hardware points pay for triangle
+setup and 2x2 quad shading on a single sample. Mode::Compute rasterizes in
+a compute shader instead: rasterize() projects every star to its pixel and
+adds its flux to an RGB accumulation buffer with 32-bit fixed-point atomics
+(FIXED_ONE per display unit), and recordCommands() tone maps the sums over
+the scene in one fullscreen pass. Sums saturate past the tone map's white
+point instead of wrapping when many bright stars share a pixel. Mode::Raster
+draws one hardware point per star with additive blending, as the baseline.
+
+Stars live in device-local chunks of up to CHUNK_STARS, so any count fits
+the guaranteed storage buffer range and dispatch size; each chunk is one
+dispatch or draw. Stars are additive light and are not depth tested.
+*/
+class StarRenderer {
+public:
+  enum class Mode { Compute, Raster };
+
+  static constexpr uint32_t CHUNK_STARS = 1u << 22; // 64 MiB of stars
+  static constexpr uint32_t FIXED_ONE = 65536;
+
+  // The accumulation buffer is sized for extent; needs bindless descriptors
+  StarRenderer(VkDevice device, VkPhysicalDevice physicalDevice,
+               vulkan::BindlessDescriptors &bindless,
+               const RenderTargetLayout &target, VkExtent2D extent,
+               VkPipelineCache pipelineCache = VK_NULL_HANDLE,
+               const StarShaders *shaders = nullptr);
+  ~StarRenderer();
+  StarRenderer(const StarRenderer &) = delete;
+  StarRenderer &operator=(const StarRenderer &) = delete;
+
+  // Replaces every star, copying through a staging buffer on queue and
+  // waiting for it; nothing may be drawing the old ones
+  void upload(VkQueue queue, uint32_t queueFamily, const Star *stars,
+              uint32_t count);
+  // Same, but fill writes each chunk straight into the mapped staging
+  // buffer (a generator or a catalog read). False, with no stars left, when
+  // fill fails
+  auto upload(VkQueue queue, uint32_t queueFamily, uint32_t count,
+              const StarFill &fill) -> bool;
+  // Draws count stars from a storage buffer owned elsewhere (an
+  // NBodyCompute's stars()) instead, until the next upload or attach; count
+  // is at most CHUNK_STARS
+  void attach(vulkan::BindlessIndex stars, uint32_t count);
+  auto count() const -> uint32_t { return _count; }
+
+  // Per-frame constants; exposure scales every star's flux
+  static auto makeConstants(const glm::mat4 &viewProj, const glm::vec3 &eye,
+                            float exposure) -> StarPushConstants;
+
+  // Mode::Compute, outside any pass with the bindless set bound (drawFrame's
+  // prepareFunc): clears the accumulation buffer and splats every star
+  void rasterize(VkCommandBuffer cmd, const StarPushConstants &constants);
+  // Inside the pass: the resolve, or the points in Mode::Raster
+  void recordCommands(VkCommandBuffer cmd, const StarPushConstants &constants);
+  // Growing past the accumulation buffer reallocates it, which needs the
+  // device idle (as after swapchain recreation)
+  void resize(VkExtent2D newExtent);
+
+  void setMode(Mode mode) { _mode = mode; }
+  auto mode() const -> Mode { return _mode; }
+
+private:
+  struct Chunk {
+    vulkan::BufferResource buffer;
+    vulkan::BindlessIndex index = vulkan::BINDLESS_INVALID;
+    uint32_t count = 0;
+    bool owned = true; // false for attached buffers
+  };
+
+  void createPipelines(const StarShaders &shaders);
+  auto createGraphicsPipeline(const std::vector<char> &vertex,
+                              const std::vector<char> &fragment,
+                              VkPrimitiveTopology topology) -> VkPipeline;
+  auto loadShaderModule(const std::vector<char> &code) -> VkShaderModule;
+  void createAccumulation(VkExtent2D extent);
+  void destroyAccumulation();
+  void releaseChunks();
+  void setViewport(VkCommandBuffer cmd);
+
+  VkDevice _device;
+  VkPhysicalDevice _physicalDevice;
+  vulkan::BindlessDescriptors &_bindless;
+  RenderTargetLayout _target;
+  VkExtent2D _extent;
+  VkPipelineCache _pipelineCache;
+  Mode _mode = Mode::Compute;
+
+  VkPipeline _splat = VK_NULL_HANDLE;
+  VkPipeline _resolve = VK_NULL_HANDLE;
+  VkPipeline _points = VK_NULL_HANDLE;
+
+  std::vector<Chunk> _chunks;
+  uint32_t _count = 0;
+
+  // uint3 per pixel, rows of _extent.width; holds _capacity pixels
+  vulkan::BufferResource _accumulation;
+  vulkan::BindlessIndex _accumulationIndex = vulkan::BINDLESS_INVALID;
+  VkDeviceSize _capacity = 0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include "RenderTarget.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+/*
+@brief Draw commands recorded once into secondary command buffers and
+replayed every frame (drawFrame's staticFunc).
+
+There is one buffer per frame-in-flight slot, so re-recording one never
+touches a buffer the GPU may still be executing: a slot's buffer was last
+submitted with that slot's fence, which drawFrame has waited on. Each buffer
+remembers the key it was recorded with and get() re-records it only when
+the caller passes a different one. Anything the commands bake in (pipeline,
+viewport, bindless indices) must change the key; everything that changes
+per frame has to come through memory the shaders read.
+
+Buffers are recorded for a dynamic rendering pass of the given layout.
+Replaying one only pays off when it costs the pass nothing: without nested
+command buffers a pass holds inline commands or secondaries, never both, so
+the replay would need a pass of its own, a barrier and depth stored across
+the break, more than the handful of commands a buffer saves. VulkanCore
+therefore only runs them where canExecuteStatic() says the device can mix
+both in one pass; elsewhere callers record the same commands inline.
+*/
+class StaticPass {
+public:
+  StaticPass() = default;
+  ~StaticPass() { destroy(); }
+  StaticPass(const StaticPass &) = delete;
+  StaticPass &operator=(const StaticPass &) = delete;
+
+  // queueFamily is the family of the queue the executing primaries go to
+  auto create(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight,
+              const RenderTargetLayout &target) -> bool;
+  // The device must be idle
+  void destroy();
+  auto valid() const -> bool { return _pool != VK_NULL_HANDLE; }
+
+  // frameSlot's buffer, first re-recorded through record if it was recorded
+  // with another key. record gets a secondary that inherits nothing but the
+  // attachments: it binds its own descriptor sets and pipeline.
+  auto get(uint32_t frameSlot, uint64_t key,
+           const std::function<void(VkCommandBuffer)> &record)
+      -> VkCommandBuffer;
+  // Every slot is re-recorded on its next get()
+  void invalidate();
+
+  // Recordings so far; flat while the key stays the same
+  auto recordCount() const -> uint64_t { return _recorded; }
+
+private:
+  VkDevice _device = VK_NULL_HANDLE;
+  VkCommandPool _pool = VK_NULL_HANDLE;
+  RenderTargetLayout _target;
+  std::vector<VkCommandBuffer> _buffers;
+  std::vector<uint64_t> _keys;
+  std::vector<bool> _current;
+  uint64_t _recorded = 0;
+};
+
+} // namespace vulkan
@@ -0,0 +1,55 @@
+#pragma once
+#include "JobSystem.hpp"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+/*
+@brief One-shot dependency graph of tasks run on a JobSystem.
+
+A task runs once all its dependencies succeeded. A task that returns false
+(or throws) fails its dependents without running them. MainThread tasks run
+on the JobSystem's main thread, for APIs such as GLFW that require it.
+Every task is timed and emitted as a trace zone.
+*/
+class TaskGraph {
+public:
+  using TaskId = size_t;
+  enum class Affinity { Any, MainThread };
+
+  struct Timing {
+    const char *name;
+    double startMs; // relative to run() start
+    double endMs;
+    uint32_t thread; // JobSystem::threadIndex(), 0 = main thread
+    bool ran;
+    bool ok;
+  };
+
+  auto add(const char *name, std::function<bool()> fn,
+           std::initializer_list<TaskId> dependencies = {},
+           Affinity affinity = Affinity::Any) -> TaskId;
+
+  // Blocks until every task finished or was skipped; false if any failed.
+  // Call from the JobSystem's main thread, which helps run the tasks.
+  auto run(JobSystem &jobs) -> bool;
+
+  auto timings() const -> const std::vector<Timing> & { return _timings; }
+  auto totalMs() const -> double { return _totalMs; }
+  // Log one line per task plus the critical-path total
+  void report(const char *title) const;
+
+private:
+  struct Task {
+    const char *name;
+    std::function<bool()> fn;
+    std::vector<TaskId> dependents;
+    uint32_t dependencyCount = 0;
+    Affinity affinity;
+  };
+
+  std::vector<Task> _tasks;
+  std::vector<Timing> _timings;
+  double _totalMs = 0.0;
+};
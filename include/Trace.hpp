@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan.h>
+
+/*
+@brief Scoped CPU zones exported as Chrome trace JSON (chrome://tracing,
+ui.perfetto.dev).
+
+Zones are recorded into a per-thread buffer; full buffers are handed to a
+writer thread, so the hot path never touches the file. Nothing is recorded
+unless a session is running. Build with VKAPP_TRACING=0 and the macros
+compile to nothing.
+
+TRACE_GPU_ZONE additionally wraps the commands recorded inside it in a
+vkCmdBeginDebugUtilsLabelEXT region with the same name, so captures in
+RenderDoc/Nsight line up with the CPU trace.
+*/
+
+#ifndef VKAPP_TRACING
+#define VKAPP_TRACING 1
+#endif
+
+namespace trace {
+
+// Start writing a session to path; returns false if the file cannot be opened
+auto start(const std::string &path) -> bool;
+// Flush every thread's buffer and close the file. Other threads must not be
+// inside a zone while stopping.
+void stop();
+auto active() -> bool;
+
+// Name shown for the calling thread in the trace viewer
+void setThreadName(const char *name);
+
+// Resolve the debug-utils label entry points (no-op if the extension is off)
+void loadDebugLabels(VkInstance instance);
+void beginLabel(VkCommandBuffer cmd, const char *name);
+void endLabel(VkCommandBuffer cmd);
+
+auto nowNs() -> uint64_t;
+void record(const char *name, uint64_t beginNs, uint64_t endNs);
+
+class Zone {
+public:
+  explicit Zone(const char *name)
+      : _name(active() ? name : nullptr), _begin(_name ? nowNs() : 0) {}
+  ~Zone() {
+    if (_name)
+      record(_name, _begin, nowNs());
+  }
+  Zone(const Zone &) = delete;
+  Zone &operator=(const Zone &) = delete;
+
+private:
+  const char *_name;
+  uint64_t _begin;
+};
+
+class GpuZone {
+public:
+  GpuZone(VkCommandBuffer cmd, const char *name) : _zone(name), _cmd(cmd) {
+    beginLabel(_cmd, name);
+  }
+  ~GpuZone() { endLabel(_cmd); }
+  GpuZone(const GpuZone &) = delete;
+  GpuZone &operator=(const GpuZone &) = delete;
+
+private:
+  Zone _zone;
+  VkCommandBuffer _cmd;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if VKAPP_TRACING
+#define TRACE_ZONE(name) ::trace::Zone TRACE_CONCAT(_traceZone, __LINE__)(name)
+#define TRACE_GPU_ZONE(cmd, name)                                              \
+  ::trace::GpuZone TRACE_CONCAT(_traceGpuZone, __LINE__)(cmd, name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_GPU_ZONE(cmd, name) ((void)0)
+#endif
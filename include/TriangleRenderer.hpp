@@ -1,10 +1,12 @@
 #pragma once
+#include "RenderTarget.hpp"
 #include <vector>
 #include <vulkan/vulkan.h>
 
 class TriangleRenderer {
 public:
-  TriangleRenderer(VkDevice device, VkRenderPass renderPass, VkExtent2D extent);
+  TriangleRenderer(VkDevice device, const RenderTargetLayout &target,
+                   VkExtent2D extent);
   ~TriangleRenderer();
 
   void recordCommands(VkCommandBuffer cmd);
@@ -12,7 +14,7 @@ public:
 
 private:
   VkDevice device_;
-  VkRenderPass renderPass_;
+  RenderTargetLayout target_;
   VkExtent2D extent_;
 
   VkPipelineLayout pipelineLayout_ = VK_NULL_HANDLE;
@@ -1,15 +1,26 @@
 #pragma once
+#include "AppConfig.hpp"
 #include "Camera.hpp"
 #include "CameraController.hpp"
+#include "GeometryPool.hpp"
 #include "GridRenderer.hpp"
 #include "InputSystem.hpp"
+#include "JobSystem.hpp"
+#include "MeshAsset.hpp"
+#include "MeshRenderer.hpp"
+#include "PipelineCache.hpp"
+#include "RenderScene.hpp"
+#include "SceneStore.hpp"
+#include "StarRenderer.hpp"
+#include "TaskGraph.hpp"
 #include "TriangleRenderer.hpp"
 #include "VulkanCore.hpp"
+#include <chrono>
 #include <vulkan/vulkan.h>
 
 class VkApp {
 public:
-  VkApp();
+  explicit VkApp(const AppConfig &config = AppConfig{});
   ~VkApp();
 
   bool initialize();
@@ -19,11 +30,28 @@ public:
   auto getWindow() const -> GLFWwindow * { return _window; }
   auto getVulkanInstance() -> vulkan::VulkanCore & { return _vulkanCore; }
 
+  // Milliseconds from initialize() to the end of startup / to the first
+  // queued present (negative until the first frame)
+  auto startupMs() const -> double { return _startupMs; }
+  auto timeToFirstFrameMs() const -> double { return _timeToFirstFrameMs; }
+
 private:
+  AppConfig _config;
+  // Startup tasks and per-frame parallel work; the main thread joins in
+  std::unique_ptr<JobSystem> _jobs;
   GLFWwindow *_window = nullptr;
   vulkan::VulkanCore _vulkanCore;
+  vulkan::PipelineCache _pipelineCache;
   std::unique_ptr<TriangleRenderer> _triangleRenderer;
   std::unique_ptr<GridRenderer> _gridRenderer;
+  std::unique_ptr<MeshRenderer> _meshRenderer;
+  std::unique_ptr<StarRenderer> _starRenderer;
+  // Where the galaxy's origin sits in the world
+  glm::vec3 _galaxyCenter{0.0f};
+  vulkan::GeometryPool _geometry;
+  vulkan::RenderScene _scene;
+  // Transform hierarchy; world matrices are pushed into _scene every frame
+  vulkan::SceneStore _sceneStore;
 
   std::unique_ptr<Camera> _camera;
   std::unique_ptr<InputSystem> _inputSystem;
@@ -31,12 +59,20 @@ private:
 
   float _lastFrameTime = 0.0f;
   float _deltaTime = 0.0f;
+  float _lastCullLogTime = 0.0f;
 
   bool _framebufferResized = false;
+  // Camera::version() of the last frame drawn
+  uint64_t _drawnCamera = ~0ull;
 
-  static void framebufferResizeCallback(GLFWwindow *window, int width,
-                                        int height) {
-    auto app = reinterpret_cast<VkApp *>(glfwGetWindowUserPointer(window));
-    app->_framebufferResized = true;
-  }
+  // Uploads the configured mesh and fills the scene; false leaves it empty
+  bool setupMeshes(const MeshAsset &mesh);
+  // Generates the galaxy or reads the catalog straight into upload memory;
+  // false leaves no stars
+  bool setupStars();
+  // False while minimized, hidden or without area: nothing is drawn then
+  bool windowVisible() const;
+  std::chrono::steady_clock::time_point _startupBegin;
+  double _startupMs = 0.0;
+  double _timeToFirstFrameMs = -1.0;
 };
\ No newline at end of file
@@ -1,7 +1,17 @@
 #pragma once
+#include "BindlessDescriptors.hpp"
+#include "DeviceProfile.hpp"
+#include "DynamicResolution.hpp"
+#include "FrameCapture.hpp"
+#include "RenderTarget.hpp"
+#include "VulkanResources.hpp"
 #include "VulkanSwapchain.hpp"
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -12,34 +22,193 @@ public:
   VulkanCore() = default;
   ~VulkanCore();
 
+  // Prefer VK_KHR_dynamic_rendering when the device supports it. Must be
+  // called before initialize(); falls back to a render pass otherwise.
+  void setDynamicRenderingEnabled(bool enabled) {
+    _dynamicRenderingRequested = enabled;
+  }
+
+  // Force a GPU by index or case-insensitive name substring instead of the
+  // highest-scoring one. Empty falls back to VKAPP_GPU, then the score.
+  void setDevicePreference(const std::string &selector) {
+    _devicePreference = selector;
+  }
+
+  // Render the scene into an offscreen target whose resolution follows a
+  // GPU frame-time budget, then upscale into the swapchain image. Must be
+  // called before initialize().
+  void setDynamicResolution(const DynamicResolutionSettings &settings) {
+    _resolutionSettings = settings;
+  }
+
+  // How a frame with several views is recorded
+  enum class ViewMode {
+    Multiview,     // one pass broadcast to every view (VK_KHR_multiview)
+    PerViewPasses, // one pass, and one callback, per view
+  };
+  // Render count (up to MAX_VIEWS) views side by side: each into one layer
+  // of the scene target, composed left to right into the output image. Must
+  // be called before initialize(); Multiview falls back to PerViewPasses
+  // when the device cannot do it.
+  void setViews(uint32_t count, ViewMode mode) {
+    _viewCount = std::clamp(count, 1u, MAX_VIEWS);
+    _viewMode = mode;
+  }
+
+  // Store the scene depth so compute passes recorded through splitPass()
+  // can read it. Must be called before initialize(); needs dynamic
+  // rendering, bindless descriptors and a single view.
+  void setDepthSampling(bool enabled) { _depthSamplingRequested = enabled; }
+
   // Initialize with an already-created GLFW window
   // returns false on failure
   bool initialize(GLFWwindow *window);
 
+  // initialize() split into phases for a parallel startup. After
+  // initializeDevice() the device and startupTargetLayout() are valid, so
+  // pipelines can be built while initializeFrameResources() creates the
+  // swapchain (main thread only: it queries the GLFW window).
+  bool initializeInstance(GLFWwindow *window);
+  bool initializeDevice();
+  bool initializeFrameResources();
+
+  // Initialize without a window or swapchain (benchmarks, tests, software
+  // ICDs). drawFrame renders into an offscreen target of the given extent,
+  // left in TRANSFER_SRC_OPTIMAL, and nothing is presented.
+  bool initializeHeadless(VkExtent2D extent);
+
   // Cleanup resources
   void cleanup();
 
   // Simple frame loop helper:
-  // recordFunc is called inside an active renderpass with (cmdBuffer,
-  // imageIndex)
-  bool
-  drawFrame(const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc);
+  // recordFunc is called inside an active renderpass (or dynamic rendering
+  // scope) with (cmdBuffer, imageIndex); prepareFunc, if given, once per
+  // frame before any pass begins (compute work the passes consume);
+  // staticFunc, if given and canExecuteStatic(), before each scene pass
+  // begins for a StaticPass buffer to open it with (VK_NULL_HANDLE for none)
+  bool drawFrame(
+      const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc,
+      const std::function<void(VkCommandBuffer)> &prepareFunc = nullptr,
+      const std::function<VkCommandBuffer()> &staticFunc = nullptr);
+
+  // Depth of the current frame as splitPass() hands it out
+  struct SceneDepth {
+    BindlessIndex texture = BINDLESS_INVALID; // g_textures index
+    VkExtent2D extent{};                      // region rendered this frame
+  };
+  // Inside drawFrame's callback: ends the pass, records `between` outside it
+  // with the depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL and visible to compute
+  // shaders, then resumes the pass keeping its color and depth. Returns
+  // false, recording nothing, unless canSplitPass().
+  bool splitPass(
+      VkCommandBuffer cmd,
+      const std::function<void(VkCommandBuffer, const SceneDepth &)> &between);
+  // Depth sampling was requested and is supported
+  auto canSplitPass() const -> bool { return _depthSampling; }
+
+  // Let renderers replay pre-recorded passes (StaticPass) through
+  // drawFrame's staticFunc. The scene pass is then begun with both secondary
+  // and inline contents, runs the buffer first and continues with recordFunc
+  // after binding the bindless set again. Takes effect from the next frame.
+  void setStaticPasses(bool enabled) { _staticPasses = enabled; }
+  // Static passes are enabled and can run here: dynamic rendering with
+  // nested command buffers, so a replay never has to break the pass
+  auto canExecuteStatic() const -> bool {
+    return _staticPasses && _dynamicRendering && _profile.nestedCommandBuffer;
+  }
+
+  // Dynamic rendering helpers for any color target (swapchain or offscreen).
+  // The image view must already be in COLOR_ATTACHMENT_OPTIMAL layout, the
+  // optional depth view in DEPTH_ATTACHMENT_OPTIMAL; depth is cleared to 1.
+  // A non-zero viewMask renders every layer it names in one multiview pass.
+  void beginRendering(VkCommandBuffer cmd, VkImageView colorView,
+                      VkExtent2D extent, const VkClearValue &clearColor,
+                      VkImageView depthView = VK_NULL_HANDLE,
+                      uint32_t viewMask = 0) const;
+  void endRendering(VkCommandBuffer cmd) const;
 
   // Accessors for renderers
   auto device() const -> VkDevice { return _device; }
   auto physicalDevice() const -> VkPhysicalDevice { return _physicalDevice; }
   auto renderPass() const -> VkRenderPass { return _renderPass; }
-  auto descriptorPool() const -> VkDescriptorPool { return _descriptorPool; }
+  auto usesDynamicRendering() const -> bool { return _dynamicRendering; }
+  // Capabilities and limits of the selected device; valid after
+  // initializeDevice(). Every feature it reports is enabled.
+  auto profile() const -> const DeviceProfile & { return _profile; }
+  auto renderTargetLayout() const -> RenderTargetLayout {
+    RenderTargetLayout layout;
+    layout.renderPass = _renderPass;
+    layout.colorFormat = swapchainImageFormat();
+    layout.depthFormat = _depthFormat;
+    layout.viewMask = viewMask();
+    return layout;
+  }
+  // renderTargetLayout() and extent() as initializeDevice() left them, for
+  // pipelines built while initializeFrameResources() creates the swapchain:
+  // reading them never touches the swapchain. The extent is the surface's
+  // at that point (800x600 if it reports none); renderers follow resizes.
+  auto startupTargetLayout() const -> RenderTargetLayout {
+    return _startupLayout;
+  }
+  auto startupExtent() const -> VkExtent2D { return _startupExtent; }
+  // Global descriptor set and the pipeline layout every renderer shares;
+  // valid after initializeDevice()
+  auto bindless() -> BindlessDescriptors & { return _bindless; }
+  // Frame-in-flight slot being recorded (valid inside drawFrame's callback)
+  // and the number of slots; per-frame buffers are indexed by it
+  auto frameIndex() const -> uint32_t {
+    return static_cast<uint32_t>(_currentFrame);
+  }
+  auto framesInFlight() const -> uint32_t {
+    return static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+  }
+  // Views per frame and how they are recorded, as settled by initialization
+  auto viewCount() const -> uint32_t { return _viewCount; }
+  auto usesMultiview() const -> bool {
+    return _viewCount > 1 && _viewMode == ViewMode::Multiview;
+  }
+  // View drawFrame's callback is recording under PerViewPasses (0 otherwise)
+  auto viewIndex() const -> uint32_t { return _viewIndex; }
   auto commandPool() const -> VkCommandPool { return _commandPool; }
   auto graphicsQueue() const -> VkQueue { return _graphicsQueue; }
   auto extent() const -> VkExtent2D {
+    if (_headless)
+      return _headlessExtent;
     return _swapchainManager ? _swapchainManager->extent()
                              : VkExtent2D{800, 600};
   }
+  // Extent each view is rendered at this frame (below extent() while
+  // dynamic resolution is scaling down or several views share the output).
+  // Valid inside drawFrame's callback.
+  auto renderExtent() const -> VkExtent2D {
+    return _headless || composesScene() ? _renderExtent : extent();
+  }
+  auto renderScale() const -> float {
+    return _governor ? _governor->scale() : 1.0f;
+  }
   auto swapchainImageFormat() const -> VkFormat {
+    if (_headless)
+      return HEADLESS_FORMAT;
     return _swapchainManager ? _swapchainManager->imageFormat()
                              : VK_FORMAT_UNDEFINED;
   }
+  auto isHeadless() const -> bool { return _headless; }
+  // Headless render target (valid after initializeHeadless)
+  auto headlessTarget() const -> const ImageResource & {
+    return _viewCount > 1 ? _headlessOutput : _sceneTarget;
+  }
+  // Last headless frame as RGBA8 rows with opaque alpha. Waits for the
+  // device; for tests and tools, not the frame loop (see capture()).
+  bool readHeadlessTarget(std::vector<uint8_t> &rgba);
+
+  // Screenshots and image sequences of the presented (or headless) image
+  auto capture() -> FrameCapture & { return _capture; }
+
+  // GPU time of the most recently completed frame and CPU time spent
+  // recording and submitting in the last drawFrame call, in milliseconds
+  auto lastGpuFrameMs() const -> float { return _lastGpuMs; }
+  auto lastCpuRecordMs() const -> float { return _lastCpuRecordMs; }
+  auto hasGpuTimestamps() const -> bool { return _gpuTimer.valid(); }
 
   bool recreateSwapchain();
 
@@ -53,13 +222,56 @@ private:
   bool createLogicalDevice();
   // bool createSwapchain();
   // bool createImageViews();
-  bool createRenderPass();
+  bool createRenderPass(VkImageLayout finalLayout);
   // bool createFramebuffers();
   bool createCommandPoolAndBuffers();
   bool createSyncObjects();
-  bool createDescriptorPool();
+  bool allocateCommandBuffers();
+  void resolveViews(bool canCompose);
+  bool createSceneTarget();
+  void destroySceneTarget();
+  auto chooseDepthFormat(bool sampled = false) const -> VkFormat;
+  void resolveDepthSampling();
+  void cmdBeginDepth(VkCommandBuffer cmd, VkImage depthImage) const;
+  // A null clear value loads both attachments instead of clearing them
+  void cmdBeginRendering(VkCommandBuffer cmd, VkImageView colorView,
+                         VkExtent2D extent, const VkClearValue *clearColor,
+                         VkImageView depthView, uint32_t viewMask,
+                         VkRenderingFlagsKHR flags = 0) const;
+
+  auto frameResourceCount() const -> uint32_t;
+  bool drawFrameHeadless(
+      const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc,
+      const std::function<void(VkCommandBuffer)> &prepareFunc,
+      const std::function<VkCommandBuffer()> &staticFunc);
+  // Begins _activePass, cleared, opened with staticFunc's buffer if any
+  void beginScenePass(VkCommandBuffer cmd, const VkClearValue &clearColor,
+                      const std::function<VkCommandBuffer()> &staticFunc);
+
+  // The scene is rendered into _sceneTarget and blitted into the output
+  auto composesScene() const -> bool {
+    return _dynamicResolution || _viewCount > 1;
+  }
+  auto viewMask() const -> uint32_t {
+    return usesMultiview() ? (1u << _viewCount) - 1 : 0;
+  }
+  // Output extent divided between the views
+  auto viewExtent() const -> VkExtent2D;
+
+  // dynamic resolution and multi-view per-frame steps
+  void updateRenderScale(float cpuFrameMs, float gpuMs, bool haveGpuTime);
+  void recordScene(VkCommandBuffer cmd, uint32_t imageIndex,
+                   const VkClearValue &clearColor,
+                   const std::function<void(VkCommandBuffer, uint32_t)> &
+                       recordFunc,
+                   const std::function<VkCommandBuffer()> &staticFunc);
+  void recordCompose(VkCommandBuffer cmd, VkImage output, VkExtent2D extent,
+                     ImageSyncState &state);
+  void recordCapture(VkCommandBuffer cmd, VkImage image, VkExtent2D extent,
+                     ImageSyncState &state);
 
   // helpers
+  auto supportsBlitUpscale(VkFormat format) const -> bool;
   auto chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &avail)
       -> VkSurfaceFormatKHR;
 
@@ -80,13 +292,23 @@ private:
   const bool _enableValidationLayers = true;
 #endif
 
+  static constexpr VkFormat HEADLESS_FORMAT = VK_FORMAT_B8G8R8A8_SRGB;
+  bool _headless = false;
+  VkExtent2D _headlessExtent{};
+  // Snapshots behind startupTargetLayout() and startupExtent()
+  RenderTargetLayout _startupLayout;
+  VkExtent2D _startupExtent{};
+
   VkInstance _instance = VK_NULL_HANDLE;
   VkDebugUtilsMessengerEXT _debugMessenger = VK_NULL_HANDLE;
   VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+  DeviceProfile _profile;
+  std::string _devicePreference;
   VkDevice _device = VK_NULL_HANDLE;
   VkQueue _graphicsQueue = VK_NULL_HANDLE;
   VkQueue _presentQueue = VK_NULL_HANDLE;
   VkSurfaceKHR _surface = VK_NULL_HANDLE;
+  GLFWwindow *_window = nullptr;
 
   uint32_t _graphicsFamily = UINT32_MAX; // store graphics queue family index
   uint32_t _presentFamily = UINT32_MAX;  // (optional, for clarity)
@@ -101,6 +323,71 @@ private:
   VkRenderPass _renderPass = VK_NULL_HANDLE;
   // std::vector<VkFramebuffer> _framebuffers;
 
+  // Every target gets a depth attachment of this format: the swapchain's
+  // when rendering straight into it, _sceneDepth otherwise
+  VkFormat _depthFormat = VK_FORMAT_UNDEFINED;
+
+  // dynamic rendering (VK_KHR_dynamic_rendering): no render pass and no
+  // per-image framebuffers, only swapchain image views
+  bool _dynamicRenderingRequested = true;
+  bool _dynamicRendering = false;
+
+  // dynamic resolution: scene target sized for the max scale, rendered at
+  // _renderExtent and blitted into the swapchain image
+  DynamicResolutionSettings _resolutionSettings;
+  bool _dynamicResolution = false;
+  std::unique_ptr<FrameTimeGovernor> _governor;
+  GpuFrameTimer _gpuTimer;
+  ImageResource _sceneTarget;
+  ImageResource _sceneDepth;
+  VkExtent2D _renderExtent{};
+
+  // Views: one layer of the scene target (and its depth) each. A pass
+  // renders every layer under multiview, otherwise one layer through its
+  // own views; a single view uses the target's views directly.
+  uint32_t _viewCount = 1;
+  ViewMode _viewMode = ViewMode::Multiview;
+  uint32_t _viewIndex = 0;
+  struct ScenePass {
+    VkImageView color = VK_NULL_HANDLE;
+    VkImageView depth = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE; // render pass path only
+  };
+  std::vector<ScenePass> _scenePasses;
+  // Headless output the views are composed into (views > 1)
+  ImageResource _headlessOutput;
+
+  // Depth kept (STORE) and sampled between the halves of a split pass
+  bool _depthSamplingRequested = false;
+  bool _depthSampling = false;
+  // Dynamic rendering pass drawFrame's callback is recording into
+  struct ActivePass {
+    VkImageView color = VK_NULL_HANDLE;
+    VkImage depthImage = VK_NULL_HANDLE;
+    VkImageView depth = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+    uint32_t viewMask = 0;
+  };
+  ActivePass _activePass;
+  // Scene passes may open with a StaticPass buffer
+  bool _staticPasses = false;
+  // Bindless registration of the depth view, redone when the view changes
+  VkImageView _depthTextureView = VK_NULL_HANDLE;
+  BindlessIndex _depthTexture = BINDLESS_INVALID;
+
+  // Swapchain images can be copied out (TRANSFER_SRC usage)
+  FrameCapture _capture;
+  bool _swapchainCapture = false;
+
+  float _lastGpuMs = 0.0f;
+  float _lastCpuRecordMs = 0.0f;
+
+  // frame-time log accumulation
+  std::chrono::steady_clock::time_point _lastFrameStart{};
+  double _logCpuMs = 0.0;
+  double _logGpuMs = 0.0;
+  uint32_t _logFrames = 0;
+
   VkCommandPool _commandPool = VK_NULL_HANDLE;
   std::vector<VkCommandBuffer> _commandBuffers;
 
@@ -111,6 +398,6 @@ private:
   size_t _currentFrame = 0;
   const size_t MAX_FRAMES_IN_FLIGHT = 2;
 
-  VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+  BindlessDescriptors _bindless;
 };
 } // namespace vulkan
\ No newline at end of file
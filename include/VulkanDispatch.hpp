@@ -0,0 +1,76 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+// Device-level entry points called while recording and submitting frames.
+// Every use of these goes through vulkan::dispatch; object creation and
+// destruction stay on the loader's exports.
+#define VKAPP_DEVICE_FUNCTIONS(X)                                              \
+  X(vkBeginCommandBuffer)                                                      \
+  X(vkCmdBeginRenderPass)                                                      \
+  X(vkCmdBindDescriptorSets)                                                   \
+  X(vkCmdBindIndexBuffer)                                                      \
+  X(vkCmdBindPipeline)                                                         \
+  X(vkCmdBindVertexBuffers)                                                    \
+  X(vkCmdBlitImage)                                                            \
+  X(vkCmdCopyBuffer)                                                           \
+  X(vkCmdCopyImageToBuffer)                                                    \
+  X(vkCmdDispatch)                                                             \
+  X(vkCmdDraw)                                                                 \
+  X(vkCmdDrawIndexed)                                                          \
+  X(vkCmdDrawIndexedIndirect)                                                  \
+  X(vkCmdEndRenderPass)                                                        \
+  X(vkCmdExecuteCommands)                                                      \
+  X(vkCmdFillBuffer)                                                           \
+  X(vkCmdPipelineBarrier)                                                      \
+  X(vkCmdPushConstants)                                                        \
+  X(vkCmdResetQueryPool)                                                       \
+  X(vkCmdSetScissor)                                                           \
+  X(vkCmdSetViewport)                                                          \
+  X(vkCmdWriteTimestamp)                                                       \
+  X(vkEndCommandBuffer)                                                        \
+  X(vkGetQueryPoolResults)                                                     \
+  X(vkInvalidateMappedMemoryRanges)                                            \
+  X(vkQueueSubmit)                                                             \
+  X(vkQueueWaitIdle)                                                           \
+  X(vkResetCommandBuffer)                                                      \
+  X(vkResetFences)                                                             \
+  X(vkUpdateDescriptorSets)                                                    \
+  X(vkWaitForFences)
+
+// From extensions the device may not enable; null when it doesn't
+#define VKAPP_DEVICE_OPTIONAL_FUNCTIONS(X)                                     \
+  X(vkAcquireNextImageKHR)                                                     \
+  X(vkQueuePresentKHR)                                                         \
+  X(vkCmdBeginRenderingKHR)                                                    \
+  X(vkCmdEndRenderingKHR)
+
+namespace vulkan {
+
+/*
+@brief Device-level function pointers, fetched with vkGetDeviceProcAddr.
+
+Calls through the loader's exports go through a trampoline that looks up the
+dispatchable object's table on every call; these pointers go straight to the
+driver (or the first enabled layer). Entries are named after the entry
+points, so a call reads `dispatch.vkCmdDraw(cmd, ...)`.
+
+The optional entries are null on a device without their extension: the
+swapchain ones when headless, the dynamic rendering ones when it falls back
+to render passes.
+*/
+struct DeviceDispatch {
+#define VKAPP_DISPATCH_MEMBER(name) PFN_##name name = nullptr;
+  VKAPP_DEVICE_FUNCTIONS(VKAPP_DISPATCH_MEMBER)
+  VKAPP_DEVICE_OPTIONAL_FUNCTIONS(VKAPP_DISPATCH_MEMBER)
+#undef VKAPP_DISPATCH_MEMBER
+
+  // Fills every entry for device; false if a core entry point is missing
+  auto load(VkDevice device) -> bool;
+};
+
+// The table of the device VulkanCore created last. Like the loader's own
+// globals there is one per process: devices used side by side must come
+// from the same driver.
+extern DeviceDispatch dispatch;
+
+} // namespace vulkan
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace vulkan {
+
+// A device-local 2D image with a single mip/layer and its view
+struct ImageResource {
+  VkImage image = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  VkExtent2D extent{};
+  uint32_t layers = 1; // view is a 2D array view when > 1
+};
+
+// A buffer with its own allocation; mapped stays null unless the memory is
+// HOST_VISIBLE
+struct BufferResource {
+  VkBuffer buffer = VK_NULL_HANDLE;
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize size = 0;
+  void *mapped = nullptr;
+};
+
+// Returns UINT32_MAX when no memory type matches
+auto findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits,
+                    VkMemoryPropertyFlags properties) -> uint32_t;
+
+auto createImage2D(VkDevice device, VkPhysicalDevice physicalDevice,
+                   VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+                   VkImageAspectFlags aspect, ImageResource &out,
+                   uint32_t layers = 1) -> bool;
+// 2D view of one layer of image; VK_NULL_HANDLE on failure
+auto createLayerView(VkDevice device, const ImageResource &image,
+                     uint32_t layer, VkImageAspectFlags aspect) -> VkImageView;
+void destroyImage(VkDevice device, ImageResource &image);
+
+// HOST_VISIBLE memory is mapped persistently
+auto createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+                  VkDeviceSize size, VkBufferUsageFlags usage,
+                  VkMemoryPropertyFlags properties, BufferResource &out)
+    -> bool;
+void destroyBuffer(VkDevice device, BufferResource &buffer);
+
+// Single-mip layout transition of every layer, with explicit scopes
+void cmdTransitionImage(VkCommandBuffer cmd, VkImage image,
+                        VkImageLayout oldLayout, VkImageLayout newLayout,
+                        VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+                        VkPipelineStageFlags dstStage, VkAccessFlags dstAccess,
+                        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+} // namespace vulkan
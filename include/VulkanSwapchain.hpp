@@ -1,4 +1,5 @@
 #pragma once
+#include "VulkanResources.hpp"
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <vulkan/vulkan.h>
@@ -14,11 +15,26 @@ public:
 
   auto querySurfaceCapabilities() -> bool;
 
-  // Initialize swapchain
-  auto create(VkRenderPass renderPass) -> bool;
+  // Request usage beyond COLOR_ATTACHMENT (e.g. TRANSFER_DST for blits).
+  // Returns false if the surface does not support it. Call before create().
+  auto addImageUsage(VkImageUsageFlags usage) -> bool;
 
-  // Recreate swapchain (on resize/out-of-date)
-  auto recreate(VkRenderPass renderPass) -> bool;
+  // Give every image a shared depth attachment of this format, rebuilt with
+  // the swapchain and included in its framebuffers. extraUsage is added to
+  // DEPTH_STENCIL_ATTACHMENT (e.g. SAMPLED). Call before create().
+  void setDepthFormat(VkFormat format, VkImageUsageFlags extraUsage = 0) {
+    _depthFormat = format;
+    _depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | extraUsage;
+  }
+
+  // Initialize swapchain. Framebuffers are only built when a render pass is
+  // given; the dynamic rendering path passes VK_NULL_HANDLE and renders
+  // straight into the image views.
+  auto create(VkRenderPass renderPass = VK_NULL_HANDLE) -> bool;
+
+  // Recreate swapchain (on resize/out-of-date). Fails without touching the
+  // current one while the framebuffer has no area (minimized)
+  auto recreate(VkRenderPass renderPass = VK_NULL_HANDLE) -> bool;
 
   // Cleanup current swapchain resources
   auto cleanup() -> void;
@@ -27,9 +43,14 @@ public:
   auto swapchain() const -> const VkSwapchainKHR * { return &_swapchain; }
   auto extent() const -> VkExtent2D { return _extent; }
   auto imageFormat() const -> VkFormat { return _imageFormat; }
+  auto imageUsage() const -> VkImageUsageFlags { return _imageUsage; }
   auto imageCount() const -> uint32_t {
     return static_cast<uint32_t>(_images.size());
   }
+  auto image(uint32_t index) const -> VkImage { return _images[index]; }
+  auto imageView(uint32_t index) const -> VkImageView {
+    return _imageViews[index];
+  }
   auto imageViews() const -> const std::vector<VkImageView> & {
     return _imageViews;
   }
@@ -39,12 +60,16 @@ public:
   auto framebuffer(uint32_t index) const -> VkFramebuffer {
     return _framebuffers[index];
   }
+  // Null unless setDepthFormat() was called
+  auto depthTarget() const -> const ImageResource & { return _depth; }
 
 private:
   // Creation helpers
   bool createSwapchain();
   bool createImageViews();
+  bool createDepthTarget();
   bool createFramebuffers(VkRenderPass renderPass);
+  void destroyFramebuffers();
 
   // Query helpers
   VkSurfaceFormatKHR
@@ -65,8 +90,12 @@ private:
   std::vector<VkImage> _images;
   std::vector<VkImageView> _imageViews;
   std::vector<VkFramebuffer> _framebuffers;
+  VkFormat _depthFormat = VK_FORMAT_UNDEFINED;
+  VkImageUsageFlags _depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  ImageResource _depth;
 
   VkFormat _imageFormat = VK_FORMAT_UNDEFINED;
+  VkImageUsageFlags _imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
   VkExtent2D _extent{};
 
   VkSurfaceFormatKHR _chosenFormat{};
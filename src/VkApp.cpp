@@ -1,45 +1,217 @@
 #include "VkApp.hpp"
 #include "CameraConstants.hpp"
+#include "GalaxyGenerator.hpp"
+#include "StarCatalog.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
 #include <glm/gtc/matrix_transform.hpp>
-#include <iostream>
-
-VkApp::VkApp() {
-  // initialize members if needed
+#include <algorithm>
+#include <ctime>
+#include <thread>
+
+// Local time as YYYYMMDD_HHMMSS, for capture file names
+static auto captureTimestamp() -> std::string {
+  std::time_t now = std::time(nullptr);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y%m%d_%H%M%S", std::localtime(&now));
+  return text;
 }
 
+VkApp::VkApp(const AppConfig &config) : _config(config) {}
+
 VkApp::~VkApp() {
   // ensure resources are released
   cleanup();
 }
 
 bool VkApp::initialize() {
-  if (!glfwInit()) {
-    std::cerr << "Failed to initialize GLFW\n";
-    return false;
+  _startupBegin = std::chrono::steady_clock::now();
+
+  // Before VulkanCore: the validation level picks the messenger severities
+  logging::setLevel(_config.logLevel);
+  logging::setLevel(logging::Category::Validation, _config.validationLogLevel);
+
+  if (!_config.traceFile.empty() && trace::start(_config.traceFile)) {
+    trace::setThreadName("main");
+    LOG_INFO(App, "Tracing to %s", _config.traceFile.c_str());
   }
 
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+  // After tracing starts so the workers' names reach the trace
+  _jobs = std::make_unique<JobSystem>(
+      std::max(std::thread::hardware_concurrency(), 2u) - 1);
 
-  _window = glfwCreateWindow(1280, 720, "vk-app", nullptr, nullptr);
-  glfwSetWindowUserPointer(_window, this);
-  glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+  {
+    TRACE_ZONE("CreateWindow");
+    if (!glfwInit()) {
+      LOG_ERROR(App, "Failed to initialize GLFW");
+      return false;
+    }
 
-  if (!_window) {
-    std::cerr << "Failed to create GLFW window\n";
-    glfwTerminate();
-    return false;
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+    _window = glfwCreateWindow(1280, 720, "vk-app", nullptr, nullptr);
+    if (!_window) {
+      LOG_ERROR(App, "Failed to create GLFW window");
+      glfwTerminate();
+      return false;
+    }
+    // InputSystem owns the user pointer and the window callbacks
   }
 
-  if (!_vulkanCore.initialize(_window)) {
-    std::cerr << "Failed to initialize VulkanCore\n";
-    glfwDestroyWindow(_window);
-    glfwTerminate();
+  _vulkanCore.setDynamicRenderingEnabled(_config.dynamicRendering);
+  _vulkanCore.setDevicePreference(_config.gpu);
+  _vulkanCore.setDynamicResolution(_config.dynamicResolution);
+  _vulkanCore.setViews(_config.views,
+                       _config.multiview
+                           ? vulkan::VulkanCore::ViewMode::Multiview
+                           : vulkan::VulkanCore::ViewMode::PerViewPasses);
+  // The mesh field draws from a single camera
+  if (_config.views > 1 && !_config.meshFile.empty()) {
+    LOG_WARN(App, "The mesh field is drawn with views = 1 only; skipping it");
+    _config.meshFile.clear();
+  }
+  // StarRenderer draws from a single camera too
+  bool stars = _config.stars > 0 || !_config.starCatalog.empty();
+  if (_config.views > 1 && stars) {
+    LOG_WARN(App, "Stars are drawn with views = 1 only; skipping them");
+    stars = false;
+  }
+  // The late cull phase reads the depth the early phase drew
+  _vulkanCore.setDepthSampling(_config.occlusionCulling &&
+                               !_config.meshFile.empty());
+  _vulkanCore.setStaticPasses(_config.staticPasses);
+
+  // File reads overlap instance/device creation; the grid pipeline compiles
+  // on a worker while the main thread creates the swapchain
+  GridShaders gridShaders;
+  MeshShaders meshShaders;
+  StarShaders starShaders;
+  MeshAsset meshAsset;
+  bool meshLoaded = false;
+  TaskGraph startup;
+  auto instance = startup.add("Instance", [&] {
+    return _vulkanCore.initializeInstance(_window);
+  });
+  auto device = startup.add(
+      "Device", [&] { return _vulkanCore.initializeDevice(); }, {instance});
+  auto shaders = startup.add("LoadShaders", [&] {
+    gridShaders = GridShaders::load(_config.views > 1 && _config.multiview);
+    if (!_config.meshFile.empty())
+      meshShaders = MeshShaders::load(_config.occlusionCulling);
+    if (stars)
+      starShaders = StarShaders::load();
+    return true;
+  });
+  if (!_config.meshFile.empty()) {
+    startup.add("LoadMesh", [&] {
+      meshLoaded = meshAsset.load(_config.meshFile);
+      return true; // the app still runs with the grid alone
+    });
+  }
+  auto cacheRead = startup.add("ReadPipelineCache", [&] {
+    if (!_config.pipelineCacheFile.empty())
+      _pipelineCache.load(_config.pipelineCacheFile);
+    return true; // a missing cache only costs compile time
+  });
+  auto cache = startup.add(
+      "CreatePipelineCache",
+      [&] {
+        _pipelineCache.create(_vulkanCore.device(),
+                              _vulkanCore.physicalDevice());
+        return true;
+      },
+      {device, cacheRead});
+  startup.add(
+      "FrameResources",
+      [&] { return _vulkanCore.initializeFrameResources(); }, {device},
+      TaskGraph::Affinity::MainThread);
+  startup.add(
+      "GridPipeline",
+      [&] {
+        _gridRenderer = std::make_unique<GridRenderer>(
+            _vulkanCore.device(), _vulkanCore.startupTargetLayout(),
+            _vulkanCore.startupExtent(), _pipelineCache.handle(),
+            &gridShaders, _vulkanCore.bindless().pipelineLayout(),
+            _config.grid);
+        if (_vulkanCore.usesMultiview())
+          _gridRenderer->enableMultiview(_vulkanCore.physicalDevice(),
+                                         _vulkanCore.bindless(),
+                                         _vulkanCore.framesInFlight());
+        if (!_config.staticPasses)
+          return true;
+        // One replay per frame: every view has to share the pass
+        if (_vulkanCore.canExecuteStatic() &&
+            (_vulkanCore.viewCount() == 1 || _vulkanCore.usesMultiview()))
+          _gridRenderer->enableStatic(_vulkanCore.physicalDevice(),
+                                      _vulkanCore.bindless(),
+                                      _vulkanCore.framesInFlight(),
+                                      _vulkanCore.profile().graphicsFamily);
+        else
+          LOG_WARN(Render, "Static passes need dynamic rendering, nested "
+                           "command buffers and one pass for all views; "
+                           "recording the grid inline");
+        return true;
+      },
+      {device, shaders, cache});
+  if (!_config.meshFile.empty()) {
+    startup.add(
+        "MeshPipelines",
+        [&] {
+          _meshRenderer = std::make_unique<MeshRenderer>(
+              _vulkanCore.device(), _vulkanCore.physicalDevice(),
+              _vulkanCore.profile(), _vulkanCore.startupTargetLayout(),
+              _vulkanCore.startupExtent(),
+              _vulkanCore.bindless().pipelineLayout(),
+              _vulkanCore.framesInFlight(), _config.meshObjects,
+              _pipelineCache.handle(), &meshShaders);
+          if (!_config.occlusionCulling)
+            return true;
+          if (_vulkanCore.canSplitPass() &&
+              _vulkanCore.profile().drawIndirectFirstInstance)
+            _meshRenderer->enableOcclusionCulling(_vulkanCore.physicalDevice(),
+                                                  _vulkanCore.bindless(),
+                                                  &meshShaders);
+          else
+            LOG_WARN(Render, "Occlusion culling is not supported here; "
+                             "drawing with frustum culling only");
+          return true;
+        },
+        {device, shaders, cache});
+  }
+
+  if (stars) {
+    startup.add(
+        "StarPipelines",
+        [&] {
+          _starRenderer = std::make_unique<StarRenderer>(
+              _vulkanCore.device(), _vulkanCore.physicalDevice(),
+              _vulkanCore.bindless(), _vulkanCore.startupTargetLayout(),
+              _vulkanCore.startupExtent(), _pipelineCache.handle(),
+              &starShaders);
+          _starRenderer->setMode(_config.starCompute
+                                     ? StarRenderer::Mode::Compute
+                                     : StarRenderer::Mode::Raster);
+          return true;
+        },
+        {device, shaders, cache});
+  }
+
+  bool ok = startup.run(*_jobs);
+  startup.report("Startup");
+  if (!ok) {
+    LOG_ERROR(Core, "Failed to initialize VulkanCore");
     return false;
   }
 
-  auto extent = _vulkanCore.extent();
+  auto extent = _vulkanCore.renderExtent();
   float aspect = extent.width / static_cast<float>(extent.height);
+  // The pipeline may have been built before the swapchain extent was known
+  _gridRenderer->resize(extent);
+  if (_meshRenderer && !(meshLoaded && setupMeshes(meshAsset)))
+    _meshRenderer.reset();
+  if (_starRenderer && !setupStars())
+    _starRenderer.reset();
 
   glm::vec3 cameraPos = CameraConstants::Defaults::FREE_CAMERA_POSITION;
 
@@ -48,34 +220,116 @@ bool VkApp::initialize() {
   _inputSystem->enableMouseCapture(false);
   _cameraController = std::make_unique<FreeCameraController>();
 
+  _vulkanCore.capture().setJobSystem(_jobs.get());
+  _vulkanCore.capture().setSequenceFormat(_config.captureFormat);
+
   // _triangleRenderer = std::make_unique<TriangleRenderer>(
-  //     _vulkanCore.device(), _vulkanCore.renderPass(), _vulkanCore.extent());
+  //     _vulkanCore.device(), _vulkanCore.renderTargetLayout(),
+  //     _vulkanCore.extent());
 
-  _gridRenderer = std::make_unique<GridRenderer>(
-      _vulkanCore.device(), _vulkanCore.renderPass(), _vulkanCore.extent());
+  _startupMs = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - _startupBegin)
+                   .count();
+  LOG_INFO(App, "Startup complete in %.2f ms", _startupMs);
+  return true;
+}
 
+bool VkApp::setupMeshes(const MeshAsset &mesh) {
+  TRACE_ZONE("SetupMeshes");
+  if (!_geometry.create(_vulkanCore.device(), _vulkanCore.physicalDevice(),
+                        _vulkanCore.graphicsQueue(),
+                        _vulkanCore.profile().graphicsFamily,
+                        mesh.header().vertexCount, mesh.header().indexCount,
+                        &_vulkanCore.bindless())) {
+    LOG_ERROR(Render, "Failed to create geometry pool");
+    return false;
+  }
+  vulkan::MeshAllocation allocation = _geometry.upload(mesh);
+  if (!allocation.valid())
+    return false;
+
+  uint32_t meshId = _scene.addMesh(allocation);
+  float halfWidth = vulkan::addObjectGrid(_scene, meshId, MeshRenderer::Opaque,
+                                          _config.meshObjects);
+
+  // One node per object under a shared root, so moving the root moves the
+  // whole field
+  vulkan::SceneNode field = _sceneStore.create(glm::mat4(1.0f));
+  for (uint32_t i = 0; i < _scene.size(); i++) {
+    vulkan::SceneNode node = _sceneStore.create(_scene.transforms()[i], field);
+    _sceneStore.setRenderObject(node, _scene.handles()[i]);
+  }
+  LOG_INFO(Render, "Mesh field: %u objects, %.1f units across",
+           _scene.size(), 2.0f * halfWidth);
   return true;
 }
 
-void VkApp::run() {
-  std::cout << "Entering main loop...\n";
+bool VkApp::setupStars() {
+  TRACE_ZONE("SetupStars");
+  // Ahead of and below the start position, so the disk is seen at an angle
+  float radius = _config.galaxyRadius;
+  _galaxyCenter = CameraConstants::Defaults::FREE_CAMERA_POSITION +
+                  glm::vec3(0.0f, -0.8f * radius, -2.5f * radius);
+
+  auto begin = std::chrono::steady_clock::now();
+  bool ok = false;
+  uint32_t count = 0;
+  if (!_config.starCatalog.empty()) {
+    StarCatalog catalog;
+    if (catalog.open(_config.starCatalog)) {
+      count = catalog.count();
+      ok = _starRenderer->upload(_vulkanCore.graphicsQueue(),
+                                 _vulkanCore.profile().graphicsFamily, count,
+                                 catalog.fill());
+    }
+  } else {
+    GalaxyDesc desc;
+    desc.seed = _config.galaxySeed;
+    desc.stars = _config.stars;
+    desc.radius = radius;
+    GalaxyGenerator galaxy(desc);
+    count = galaxy.count();
+    ok = _starRenderer->upload(_vulkanCore.graphicsQueue(),
+                               _vulkanCore.profile().graphicsFamily, count,
+                               galaxy.fill(_jobs.get()));
+  }
+  if (!ok)
+    return false;
+  LOG_INFO(Render, "Stars: %u uploaded in %.1f ms", count,
+           std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - begin)
+               .count());
+  return true;
+}
 
-  float angle = 0.0f;
-  float gridScale = 0.1f;
+void VkApp::run() {
+  LOG_INFO(App, "Entering main loop");
 
   _lastFrameTime = static_cast<float>(glfwGetTime());
   _deltaTime = 0.0f;
+  bool redraw = true;
 
   while (!glfwWindowShouldClose(_window)) {
+    TRACE_ZONE("Frame");
+    {
+      TRACE_ZONE("PollEvents");
+      // Nothing to show or nothing changed: sleep until the window or the
+      // user does something instead of redrawing the same frame
+      if (!windowVisible() || (_config.renderOnDemand && !redraw)) {
+        glfwWaitEvents();
+        // Time spent asleep is not frame time; movement starts from here
+        _lastFrameTime = static_cast<float>(glfwGetTime());
+      } else {
+        glfwPollEvents();
+      }
+
+      // Update input system FIRST
+      _inputSystem->update();
+    }
     float currentTime = glfwGetTime();         // Current time in seconds
     _deltaTime = currentTime - _lastFrameTime; // Time since last frame
     _lastFrameTime = currentTime;              // Store for next frame
 
-    glfwPollEvents();
-
-    // Update input system FIRST
-    _inputSystem->update();
-
     // Handle input actions
     if (_inputSystem->getButtonDown(InputAction::Exit)) {
       glfwSetWindowShouldClose(_window, true);
@@ -85,61 +339,226 @@ void VkApp::run() {
       _inputSystem->enableMouseCapture(!_inputSystem->isMouseCaptured());
     }
 
+    vulkan::FrameCapture &capture = _vulkanCore.capture();
+    if (_inputSystem->getButtonDown(InputAction::Screenshot))
+      capture.requestScreenshot(_config.captureDir + "/screenshot_" +
+                                captureTimestamp() + ".png");
+    if (_inputSystem->getButtonDown(InputAction::ToggleRecording)) {
+      if (capture.recording())
+        capture.stopSequence();
+      else
+        capture.startSequence(_config.captureDir + "/sequence_" +
+                              captureTimestamp());
+    }
+
     // Update camera controller
     _cameraController->update(*_camera, *_inputSystem, _deltaTime);
 
+    _jobs->runMainThreadJobs();
+
+    if (_inputSystem->wasResized())
+      _framebufferResized = true;
+    // Minimized or hidden: nothing would be presented, so nothing is drawn
+    // and the swapchain waits for the window to come back
+    if (!windowVisible()) {
+      _drawnCamera = ~0ull; // redraw once it does
+      continue;
+    }
+
+    // A capture is only written once its frame slot is drawn again
+    redraw = !_config.renderOnDemand || _inputSystem->hasActivity() ||
+             _framebufferResized || _camera->version() != _drawnCamera ||
+             capture.wanted() || capture.pending();
+    if (!redraw)
+      continue;
+
     if (_framebufferResized) {
-      _framebufferResized = false;
       _vulkanCore.waitIdle();
 
       if (!_vulkanCore.recreateSwapchain()) {
-        std::cerr << "Failed to recreate swapchain after resize\n";
+        // Minimized since the check above, so the window has no area: keep
+        // _framebufferResized and recreate once it is back
+        if (!windowVisible())
+          continue;
+        LOG_ERROR(Swapchain, "Failed to recreate swapchain after resize");
         break;
       }
+      _framebufferResized = false;
 
-      auto extent = _vulkanCore.extent();
+      // Each view gets its share of the window
+      auto extent = _vulkanCore.renderExtent();
       float aspect = extent.width / static_cast<float>(extent.height);
       _camera->updateAspect(aspect);
 
       _gridRenderer->resize(_vulkanCore.extent());
-      std::cout << "Swapchain recreated successfully\n";
+      if (_meshRenderer)
+        _meshRenderer->resize(_vulkanCore.extent());
+      if (_starRenderer)
+        _starRenderer->resize(_vulkanCore.extent());
+      LOG_INFO(Swapchain, "Swapchain recreated");
     }
 
-    // Update animation
-    angle += 0.01f;
-
-    GridPushConstants gridConstants;
-    gridConstants.viewProj = _camera->getViewProjectionMatrix();
-    gridConstants.invViewProj =
-        glm::inverse(_camera->getViewProjectionMatrix());
-    gridConstants.cameraPos = _camera->getPosition();
-    gridConstants.gridScale = gridScale;
+    _sceneStore.propagate(_jobs.get());
+    _sceneStore.syncTo(_scene);
+
+    GridPushConstants gridViews[MAX_VIEWS];
+    uint32_t viewCount = _vulkanCore.viewCount();
+    for (uint32_t v = 0; v < viewCount; v++)
+      gridViews[v] = GridRenderer::makeConstants(
+          _camera->getViewProjectionMatrix(v, viewCount,
+                                           _config.viewSeparation),
+          _camera->getViewPosition(v, viewCount, _config.viewSeparation));
+    MeshPushConstants meshConstants{_camera->getViewProjectionMatrix(),
+                                    glm::vec4(0.4f, 0.8f, 0.3f, 0.0f)};
+
+    // Stars are drawn in galaxy space
+    StarPushConstants starConstants = StarRenderer::makeConstants(
+        glm::translate(_camera->getViewProjectionMatrix(), _galaxyCenter),
+        _camera->getPosition() - _galaxyCenter,
+        _config.starExposure);
+    bool splatStars =
+        _starRenderer && _starRenderer->mode() == StarRenderer::Mode::Compute;
+
+    bool occlusion = _meshRenderer && _meshRenderer->occlusionCulling();
+    auto prepare = [&](VkCommandBuffer cmd) {
+      if (splatStars) {
+        _starRenderer->resize(_vulkanCore.renderExtent());
+        _starRenderer->rasterize(cmd, starConstants);
+      }
+      if (occlusion)
+        _meshRenderer->cullEarly(cmd, _vulkanCore.frameIndex(), _scene,
+                                 meshConstants, _jobs.get());
+    };
+
+    // A static grid replays its recorded draw at the start of the pass; only
+    // the views it reads change from frame to frame
+    auto staticGrid = [&]() {
+      _gridRenderer->resize(_vulkanCore.renderExtent());
+      return _gridRenderer->staticCommands(_vulkanCore.frameIndex(), gridViews,
+                                           viewCount);
+    };
 
     // Draw frame using VulkanCore
-    bool ok =
-        _vulkanCore.drawFrame([&](VkCommandBuffer cmd, uint32_t imageIndex) {
-          _gridRenderer->recordCommands(cmd, gridConstants); // Draw grid first
+    bool ok = _vulkanCore.drawFrame(
+        [&](VkCommandBuffer cmd, uint32_t imageIndex) {
+          // Follow the dynamic resolution scale picked for this frame
+          _gridRenderer->resize(_vulkanCore.renderExtent());
+          // Draw grid first, unless its replay opened the pass: every view
+          // at once under multiview, otherwise the one this pass renders
+          if (!_gridRenderer->isStatic()) {
+            if (_vulkanCore.usesMultiview())
+              _gridRenderer->recordViews(cmd, _vulkanCore.frameIndex(),
+                                         gridViews, viewCount);
+            else
+              _gridRenderer->recordCommands(
+                  cmd, gridViews[_vulkanCore.viewIndex()]);
+          }
+          // Stars add their light over the grid, behind the meshes
+          if (_starRenderer) {
+            _starRenderer->resize(_vulkanCore.renderExtent());
+            _starRenderer->recordCommands(cmd, starConstants);
+          }
+          if (_meshRenderer) {
+            _meshRenderer->resize(_vulkanCore.renderExtent());
+            _meshRenderer->recordCommands(cmd, _vulkanCore.frameIndex(),
+                                          _scene, _geometry, meshConstants,
+                                          _jobs.get());
+          }
+          // Objects the early phase rejected, tested against this frame's
+          // depth so far
+          if (occlusion &&
+              _vulkanCore.splitPass(
+                  cmd, [&](VkCommandBuffer cmd,
+                           const vulkan::VulkanCore::SceneDepth &depth) {
+                    _meshRenderer->cullLate(cmd, _vulkanCore.frameIndex(),
+                                            depth.texture, depth.extent);
+                  }))
+            _meshRenderer->recordLate(cmd, _vulkanCore.frameIndex(),
+                                      _geometry, meshConstants);
           // _triangleRenderer->recordCommands(cmd, camera);  // Then quad on
-        });
+        },
+        occlusion || splatStars ? std::function<void(VkCommandBuffer)>(prepare)
+                                : nullptr,
+        _gridRenderer->isStatic() ? std::function<VkCommandBuffer()>(staticGrid)
+                                  : nullptr);
+
+    if (occlusion && currentTime - _lastCullLogTime >= 5.0f) {
+      _lastCullLogTime = currentTime;
+      const MeshRenderer::CullStats &stats = _meshRenderer->cullStats();
+      LOG_DEBUG(Render,
+                "Culling: %u objects, %u outside the frustum, %u drawn early, "
+                "%u drawn late, %u occluded",
+                stats.objects, stats.frustumCulled, stats.earlyDrawn,
+                stats.lateDrawn, stats.occluded);
+    }
 
+    _drawnCamera = _camera->version();
     if (!ok) {
       _framebufferResized = true;
+    } else if (_timeToFirstFrameMs < 0.0) {
+      // Presentation was queued; this is what startup work should shorten
+      _timeToFirstFrameMs = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() -
+                                _startupBegin)
+                                .count();
+      LOG_INFO(App, "Time to first frame: %.2f ms (startup %.2f ms)",
+               _timeToFirstFrameMs, _startupMs);
     }
   }
 
-  std::cout << "Exiting main loop...\n";
+  trace::stop();
+  LOG_INFO(App, "Exiting main loop");
+}
+
+bool VkApp::windowVisible() const {
+  // GLFW has no portable occlusion query: a minimized or hidden window, or
+  // one with no area, is what can be detected as showing nothing
+  int width = 0, height = 0;
+  glfwGetFramebufferSize(_window, &width, &height);
+  return width > 0 && height > 0 &&
+         !glfwGetWindowAttrib(_window, GLFW_ICONIFIED) &&
+         glfwGetWindowAttrib(_window, GLFW_VISIBLE);
 }
 
 void VkApp::cleanup() {
+  trace::stop();
+
+  if (_pipelineCache.handle() && !_config.pipelineCacheFile.empty())
+    _pipelineCache.save(_config.pipelineCacheFile);
+  _pipelineCache.destroy();
+
+  // Renderers own buffers the last frames may still read
+  if (_vulkanCore.device())
+    _vulkanCore.waitIdle();
+  // Queued encodes finish before the workers go away
+  _vulkanCore.capture().stopSequence();
+  _vulkanCore.capture().setJobSystem(nullptr);
   // _triangleRenderer.reset();
   _gridRenderer.reset();
+  _meshRenderer.reset();
+  _starRenderer.reset();
+  _geometry.destroy();
+  _sceneStore.clear();
+  _scene.clear();
   _cameraController.reset();
   _inputSystem.reset();
   _camera.reset();
+  _jobs.reset();
 
   if (_window) {
     glfwDestroyWindow(_window);
     _window = nullptr;
+
+    logging::Stats stats = logging::stats();
+    if (stats.droppedFull || stats.suppressedRepeats || stats.truncated)
+      LOG_INFO(App,
+               "Log: %llu written, %llu dropped (ring full), %llu validation "
+               "repeats suppressed, %llu truncated",
+               static_cast<unsigned long long>(stats.written),
+               static_cast<unsigned long long>(stats.droppedFull),
+               static_cast<unsigned long long>(stats.suppressedRepeats),
+               static_cast<unsigned long long>(stats.truncated));
   }
   glfwTerminate();
+  logging::flush();
 }
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "AppConfig.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+auto trim(const std::string &s) -> std::string {
+  auto begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos)
+    return {};
+  auto end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+auto parseBool(const std::string &value, bool &out) -> bool {
+  if (value == "1" || value == "true" || value == "on" || value == "yes") {
+    out = true;
+    return true;
+  }
+  if (value == "0" || value == "false" || value == "off" || value == "no") {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+auto parseFloat(const std::string &value, float &out) -> bool {
+  char *end = nullptr;
+  float v = std::strtof(value.c_str(), &end);
+  if (end == value.c_str() || *end != '\0')
+    return false;
+  out = v;
+  return true;
+}
+
+auto parseUint(const std::string &value, uint32_t &out) -> bool {
+  char *end = nullptr;
+  unsigned long v = std::strtoul(value.c_str(), &end, 10);
+  if (end == value.c_str() || *end != '\0')
+    return false;
+  out = static_cast<uint32_t>(v);
+  return true;
+}
+
+// "r, g, b" or "r g b"
+auto parseColor(const std::string &value, glm::vec3 &out) -> bool {
+  glm::vec3 c;
+  const char *at = value.c_str();
+  for (int i = 0; i < 3; i++) {
+    char *end = nullptr;
+    c[i] = std::strtof(at, &end);
+    if (end == at)
+      return false;
+    at = end;
+    while (*at == ',' || *at == ' ')
+      at++;
+  }
+  if (*at != '\0')
+    return false;
+  out = c;
+  return true;
+}
+
+struct ConfigKey {
+  const char *name;
+  bool (*apply)(AppConfig &config, const std::string &value);
+};
+
+const ConfigKey configKeys[] = {
+    {"dynamic_rendering",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.dynamicRendering);
+     }},
+    {"gpu",
+     [](AppConfig &c, const std::string &v) {
+       c.gpu = v;
+       return true;
+     }},
+    {"dynamic_resolution",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.dynamicResolution.enabled);
+     }},
+    {"frame_budget_ms",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.dynamicResolution.frameBudgetMs);
+     }},
+    {"min_render_scale",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.dynamicResolution.minScale);
+     }},
+    {"max_render_scale",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.dynamicResolution.maxScale);
+     }},
+    {"resolution_log_interval",
+     [](AppConfig &c, const std::string &v) {
+       return parseUint(v, c.dynamicResolution.logInterval);
+     }},
+    {"render_on_demand",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.renderOnDemand);
+     }},
+    {"static_passes",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.staticPasses);
+     }},
+    {"grid_levels",
+     [](AppConfig &c, const std::string &v) {
+       uint32_t levels;
+       if (!parseUint(v, levels) || levels < 1 || levels > 2)
+         return false;
+       c.grid.levels = levels;
+       return true;
+     }},
+    {"grid_fade_start",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.grid.fadeStart);
+     }},
+    {"grid_fade_end",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.grid.fadeEnd);
+     }},
+    {"grid_axes",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.grid.axes);
+     }},
+    {"grid_axis_width",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.grid.axisWidth);
+     }},
+    {"grid_color",
+     [](AppConfig &c, const std::string &v) {
+       return parseColor(v, c.grid.color);
+     }},
+    {"grid_opacity",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.grid.opacity);
+     }},
+    {"views",
+     [](AppConfig &c, const std::string &v) {
+       uint32_t views;
+       if (!parseUint(v, views) || views < 1 || views > MAX_VIEWS)
+         return false;
+       c.views = views;
+       return true;
+     }},
+    {"view_mode",
+     [](AppConfig &c, const std::string &v) {
+       if (v == "multiview")
+         c.multiview = true;
+       else if (v == "passes")
+         c.multiview = false;
+       else
+         return false;
+       return true;
+     }},
+    {"view_separation",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.viewSeparation);
+     }},
+    {"log_level",
+     [](AppConfig &c, const std::string &v) {
+       return logging::parseLevel(v.c_str(), c.logLevel);
+     }},
+    {"validation_log_level",
+     [](AppConfig &c, const std::string &v) {
+       return logging::parseLevel(v.c_str(), c.validationLogLevel);
+     }},
+    {"pipeline_cache",
+     [](AppConfig &c, const std::string &v) {
+       c.pipelineCacheFile = v;
+       return true;
+     }},
+    {"mesh",
+     [](AppConfig &c, const std::string &v) {
+       c.meshFile = v;
+       return true;
+     }},
+    {"mesh_objects",
+     [](AppConfig &c, const std::string &v) {
+       return parseUint(v, c.meshObjects);
+     }},
+    {"occlusion_culling",
+     [](AppConfig &c, const std::string &v) {
+       return parseBool(v, c.occlusionCulling);
+     }},
+    {"stars",
+     [](AppConfig &c, const std::string &v) { return parseUint(v, c.stars); }},
+    {"galaxy_seed",
+     [](AppConfig &c, const std::string &v) {
+       return parseUint(v, c.galaxySeed);
+     }},
+    {"galaxy_radius",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.galaxyRadius) && c.galaxyRadius > 0.0f;
+     }},
+    {"star_catalog",
+     [](AppConfig &c, const std::string &v) {
+       c.starCatalog = v;
+       return true;
+     }},
+    {"star_exposure",
+     [](AppConfig &c, const std::string &v) {
+       return parseFloat(v, c.starExposure);
+     }},
+    {"star_mode",
+     [](AppConfig &c, const std::string &v) {
+       if (v == "compute")
+         c.starCompute = true;
+       else if (v == "raster")
+         c.starCompute = false;
+       else
+         return false;
+       return true;
+     }},
+    {"trace_file",
+     [](AppConfig &c, const std::string &v) {
+       c.traceFile = v;
+       return true;
+     }},
+    {"capture_dir",
+     [](AppConfig &c, const std::string &v) {
+       c.captureDir = v.empty() ? "." : v;
+       return true;
+     }},
+    {"capture_format",
+     [](AppConfig &c, const std::string &v) {
+       if (v == "png")
+         c.captureFormat = vulkan::CaptureFormat::Png;
+       else if (v == "pam")
+         c.captureFormat = vulkan::CaptureFormat::Pam;
+       else
+         return false;
+       return true;
+     }},
+};
+
+} // namespace
+
+auto AppConfig::set(const std::string &key, const std::string &value)
+    -> bool {
+  for (const auto &k : configKeys) {
+    if (key == k.name)
+      return k.apply(*this, value);
+  }
+  return false;
+}
+
+auto AppConfig::load(const std::string &path) -> AppConfig {
+  AppConfig config;
+
+  std::ifstream file(path);
+  std::string line;
+  int lineNumber = 0;
+  while (file && std::getline(file, line)) {
+    lineNumber++;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+
+    auto eq = line.find('=');
+    if (eq == std::string::npos ||
+        !config.set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+      std::cerr << path << ":" << lineNumber << ": ignoring '" << line
+                << "'\n";
+    }
+  }
+
+  for (const auto &k : configKeys) {
+    std::string envName = std::string("VKAPP_") + k.name;
+    std::transform(envName.begin(), envName.end(), envName.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    if (const char *value = std::getenv(envName.c_str())) {
+      if (!k.apply(config, value))
+        std::cerr << "Ignoring " << envName << "=" << value << "\n";
+    }
+  }
+
+  auto &drs = config.dynamicResolution;
+  drs.maxScale = std::clamp(drs.maxScale, 0.1f, 1.0f);
+  drs.minScale = std::clamp(drs.minScale, 0.1f, drs.maxScale);
+  return config;
+}
@@ -0,0 +1,245 @@
+#include "BindlessDescriptors.hpp"
+#include "Log.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+
+using namespace vulkan;
+
+// Array sizes, clamped to the device's update-after-bind limits
+static constexpr uint32_t BINDLESS_STORAGE_BUFFERS = 16384;
+static constexpr uint32_t BINDLESS_SAMPLED_IMAGES = 16384;
+static constexpr uint32_t BINDLESS_SAMPLERS = 64;
+
+void DescriptorIndexAllocator::reset(uint32_t capacity) {
+  _capacity = capacity;
+  _next = 0;
+  _free.clear();
+}
+
+auto DescriptorIndexAllocator::allocate() -> BindlessIndex {
+  if (!_free.empty()) {
+    BindlessIndex index = _free.back();
+    _free.pop_back();
+    return index;
+  }
+  if (_next >= _capacity)
+    return BINDLESS_INVALID;
+  return _next++;
+}
+
+void DescriptorIndexAllocator::release(BindlessIndex index) {
+  if (index < _next)
+    _free.push_back(index);
+}
+
+BindlessDescriptors::~BindlessDescriptors() { destroy(); }
+
+auto BindlessDescriptors::create(VkDevice device, const DeviceProfile &profile,
+                                 uint32_t framesInFlight) -> bool {
+  _device = device;
+  _retired.assign(framesInFlight, {});
+
+  if (profile.descriptorIndexing) {
+    uint32_t counts[KindCount] = {
+        std::min(BINDLESS_STORAGE_BUFFERS,
+                 profile.maxUpdateAfterBindStorageBuffers),
+        std::min(BINDLESS_SAMPLED_IMAGES,
+                 profile.maxUpdateAfterBindSampledImages),
+        std::min(BINDLESS_SAMPLERS, profile.maxUpdateAfterBindSamplers)};
+    const VkDescriptorType types[KindCount] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER};
+
+    VkDescriptorSetLayoutBinding bindings[KindCount]{};
+    VkDescriptorBindingFlags flags[KindCount]{};
+    VkDescriptorPoolSize poolSizes[KindCount]{};
+    for (uint32_t i = 0; i < KindCount; i++) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = types[i];
+      bindings[i].descriptorCount = counts[i];
+      bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+      flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                 VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                 VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+      poolSizes[i] = {types[i], counts[i]};
+      _slots[i].reset(counts[i]);
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{};
+    bindingFlags.sType =
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlags.bindingCount = KindCount;
+    bindingFlags.pBindingFlags = flags;
+
+    VkDescriptorSetLayoutCreateInfo dslci{};
+    dslci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    dslci.pNext = &bindingFlags;
+    dslci.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    dslci.bindingCount = KindCount;
+    dslci.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(_device, &dslci, nullptr, &_setLayout) !=
+        VK_SUCCESS) {
+      LOG_ERROR(Core, "Failed to create bindless descriptor set layout");
+      return false;
+    }
+
+    VkDescriptorPoolCreateInfo dpci{};
+    dpci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    dpci.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    dpci.maxSets = 1;
+    dpci.poolSizeCount = KindCount;
+    dpci.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(_device, &dpci, nullptr, &_pool) !=
+        VK_SUCCESS) {
+      LOG_ERROR(Core, "Failed to create bindless descriptor pool");
+      return false;
+    }
+
+    VkDescriptorSetAllocateInfo dsai{};
+    dsai.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    dsai.descriptorPool = _pool;
+    dsai.descriptorSetCount = 1;
+    dsai.pSetLayouts = &_setLayout;
+    if (vkAllocateDescriptorSets(_device, &dsai, &_set) != VK_SUCCESS) {
+      LOG_ERROR(Core, "Failed to allocate the bindless descriptor set");
+      _set = VK_NULL_HANDLE;
+      return false;
+    }
+    LOG_INFO(Core, "Bindless: %u buffers, %u images, %u samplers", counts[0],
+             counts[1], counts[2]);
+  } else {
+    LOG_WARN(Core, "Descriptor indexing unsupported; bindless set disabled");
+  }
+
+  VkPushConstantRange pushConstants{};
+  pushConstants.stageFlags = VK_SHADER_STAGE_ALL;
+  pushConstants.size = PUSH_CONSTANT_SIZE;
+
+  VkPipelineLayoutCreateInfo plci{};
+  plci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  plci.setLayoutCount = _setLayout ? 1 : 0;
+  plci.pSetLayouts = &_setLayout;
+  plci.pushConstantRangeCount = 1;
+  plci.pPushConstantRanges = &pushConstants;
+  if (vkCreatePipelineLayout(_device, &plci, nullptr, &_pipelineLayout) !=
+      VK_SUCCESS) {
+    LOG_ERROR(Core, "Failed to create the shared pipeline layout");
+    return false;
+  }
+  return true;
+}
+
+void BindlessDescriptors::destroy() {
+  if (_pipelineLayout)
+    vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+  if (_pool)
+    vkDestroyDescriptorPool(_device, _pool, nullptr); // frees _set
+  if (_setLayout)
+    vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+  _pipelineLayout = VK_NULL_HANDLE;
+  _pool = VK_NULL_HANDLE;
+  _setLayout = VK_NULL_HANDLE;
+  _set = VK_NULL_HANDLE;
+}
+
+auto BindlessDescriptors::allocate(Kind kind) -> BindlessIndex {
+  BindlessIndex index = _slots[kind].allocate();
+  if (index == BINDLESS_INVALID)
+    LOG_ERROR(Core, "Bindless array %d is full (%u slots)", kind,
+              _slots[kind].capacity());
+  return index;
+}
+
+auto BindlessDescriptors::registerStorageBuffer(VkBuffer buffer,
+                                                VkDeviceSize offset,
+                                                VkDeviceSize range)
+    -> BindlessIndex {
+  std::lock_guard<std::mutex> lock(_mutex);
+  BindlessIndex index = valid() ? allocate(StorageBuffer) : BINDLESS_INVALID;
+  if (index == BINDLESS_INVALID)
+    return index;
+
+  VkDescriptorBufferInfo info{buffer, offset, range};
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = _set;
+  write.dstBinding = StorageBuffer;
+  write.dstArrayElement = index;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.pBufferInfo = &info;
+  dispatch.vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+  return index;
+}
+
+auto BindlessDescriptors::registerSampledImage(VkImageView view,
+                                               VkImageLayout layout)
+    -> BindlessIndex {
+  std::lock_guard<std::mutex> lock(_mutex);
+  BindlessIndex index = valid() ? allocate(SampledImage) : BINDLESS_INVALID;
+  if (index == BINDLESS_INVALID)
+    return index;
+
+  VkDescriptorImageInfo info{VK_NULL_HANDLE, view, layout};
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = _set;
+  write.dstBinding = SampledImage;
+  write.dstArrayElement = index;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  write.pImageInfo = &info;
+  dispatch.vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+  return index;
+}
+
+auto BindlessDescriptors::registerSampler(VkSampler sampler) -> BindlessIndex {
+  std::lock_guard<std::mutex> lock(_mutex);
+  BindlessIndex index = valid() ? allocate(Sampler) : BINDLESS_INVALID;
+  if (index == BINDLESS_INVALID)
+    return index;
+
+  VkDescriptorImageInfo info{sampler, VK_NULL_HANDLE,
+                             VK_IMAGE_LAYOUT_UNDEFINED};
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = _set;
+  write.dstBinding = Sampler;
+  write.dstArrayElement = index;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  write.pImageInfo = &info;
+  dispatch.vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+  return index;
+}
+
+void BindlessDescriptors::release(Kind kind, BindlessIndex index) {
+  if (index == BINDLESS_INVALID)
+    return;
+  std::lock_guard<std::mutex> lock(_mutex);
+  // Frames in flight may still read the slot; the descriptor stays as is
+  // (partially bound) until the slot is handed out again
+  _retired[_frame].push_back({kind, index});
+}
+
+void BindlessDescriptors::beginFrame(uint32_t frame) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _frame = frame;
+  for (const auto &r : _retired[frame])
+    _slots[r.kind].release(r.index);
+  _retired[frame].clear();
+}
+
+void BindlessDescriptors::bind(VkCommandBuffer cmd) const {
+  if (!valid())
+    return;
+  dispatch.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   _pipelineLayout, 0, 1, &_set, 0, nullptr);
+  dispatch.vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                   _pipelineLayout, 0, 1, &_set, 0, nullptr);
+}
+
+auto BindlessDescriptors::used(Kind kind) const -> uint32_t {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _slots[kind].used();
+}
@@ -20,47 +20,54 @@ void Camera::update(float deltaTime) {
   // Update logic if needed
 }
 
-void Camera::updateAspect(float aspect) { _aspect = aspect; }
+void Camera::updateAspect(float aspect) {
+  if (aspect != _aspect)
+    _version++;
+  _aspect = aspect;
+}
 
 void Camera::moveForward(float amount) {
-  _position += _front * amount * _moveSpeed;
+  setPosition(_position + _front * amount * _moveSpeed);
 }
 
 void Camera::moveRight(float amount) {
-  _position += _right * amount * _moveSpeed;
+  setPosition(_position + _right * amount * _moveSpeed);
 }
 
 void Camera::moveUp(float amount) {
-  _position +=
-      _worldUp * amount * _moveSpeed; // Use WORLD_UP for vertical movement
+  // Use WORLD_UP for vertical movement
+  setPosition(_position + _worldUp * amount * _moveSpeed);
 }
 
 void Camera::rotate(float yawDelta, float pitchDelta) {
-  _yaw += yawDelta * _mouseSensitivity;
-  _pitch += pitchDelta * _mouseSensitivity;
-
-  // Constrain pitch using constants
-  _pitch = std::clamp(_pitch, CameraConstants::Defaults::MIN_PITCH,
-                      CameraConstants::Defaults::MAX_PITCH);
-
-  updateVectors();
+  setRotation(_yaw + yawDelta * _mouseSensitivity,
+              _pitch + pitchDelta * _mouseSensitivity);
 }
 
-void Camera::zoom(float amount) {
-  _fov -= amount * _zoomSpeed;
-  _fov = std::clamp(_fov, CameraConstants::Defaults::MIN_FOV,
-                    CameraConstants::Defaults::MAX_FOV);
+void Camera::zoom(float amount) { setFov(_fov - amount * _zoomSpeed); }
+
+void Camera::setPosition(const glm::vec3 &position) {
+  if (position != _position)
+    _version++;
+  _position = position;
 }
 
 void Camera::setFov(float fov) {
-  _fov = std::clamp(fov, CameraConstants::Defaults::MIN_FOV,
-                    CameraConstants::Defaults::MAX_FOV);
+  fov = std::clamp(fov, CameraConstants::Defaults::MIN_FOV,
+                   CameraConstants::Defaults::MAX_FOV);
+  if (fov != _fov)
+    _version++;
+  _fov = fov;
 }
 
 void Camera::setRotation(float yaw, float pitch) {
+  // Constrain pitch using constants
+  pitch = std::clamp(pitch, CameraConstants::Defaults::MIN_PITCH,
+                     CameraConstants::Defaults::MAX_PITCH);
+  if (yaw != _yaw || pitch != _pitch)
+    _version++;
   _yaw = yaw;
-  _pitch = std::clamp(pitch, CameraConstants::Defaults::MIN_PITCH,
-                      CameraConstants::Defaults::MAX_PITCH);
+  _pitch = pitch;
   updateVectors();
 }
 
@@ -80,6 +87,34 @@ auto Camera::getViewProjectionMatrix() const -> glm::mat4 {
   return getProjectionMatrix() * getViewMatrix();
 }
 
+// Offset of a rig view along the right axis
+static auto rigOffset(uint32_t view, uint32_t count, float separation)
+    -> float {
+  return (static_cast<float>(view) - (count - 1) * 0.5f) * separation;
+}
+
+auto Camera::getViewMatrix(uint32_t view, uint32_t count,
+                           float separation) const -> glm::mat4 {
+  // Moving the eye right is moving the world left in view space
+  float offset = rigOffset(view, count, separation);
+  return glm::translate(glm::mat4(1.0f), glm::vec3(-offset, 0.0f, 0.0f)) *
+         getViewMatrix();
+}
+
+auto Camera::getViewProjectionMatrix(uint32_t view, uint32_t count,
+                                     float separation) const -> glm::mat4 {
+  return getProjectionMatrix() * getViewMatrix(view, count, separation);
+}
+
+auto Camera::getViewPosition(uint32_t view, uint32_t count,
+                             float separation) const -> glm::vec3 {
+  // The view's right axis is the first row of its rotation; the camera
+  // looks at the origin, so it is not necessarily _right
+  glm::mat4 center = getViewMatrix();
+  glm::vec3 right(center[0][0], center[1][0], center[2][0]);
+  return _position + right * rigOffset(view, count, separation);
+}
+
 void Camera::updateVectors() {
   // Calculate new front vector from Euler angles
   glm::vec3 front;
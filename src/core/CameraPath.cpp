@@ -0,0 +1,35 @@
+#include "CameraPath.hpp"
+#include "Camera.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+CameraPath::CameraPath(std::vector<glm::vec3> points)
+    : _points(std::move(points)) {}
+
+auto CameraPath::sample(float t) const -> glm::vec3 {
+  if (_points.empty())
+    return glm::vec3(0.0f);
+  if (_points.size() == 1)
+    return _points.front();
+
+  size_t segments = _points.size() - 1;
+  float u = std::clamp(t, 0.0f, 1.0f) * static_cast<float>(segments);
+  size_t i = std::min(static_cast<size_t>(u), segments - 1);
+  float f = u - static_cast<float>(i);
+
+  const glm::vec3 &p0 = _points[i == 0 ? 0 : i - 1];
+  const glm::vec3 &p1 = _points[i];
+  const glm::vec3 &p2 = _points[i + 1];
+  const glm::vec3 &p3 = _points[std::min(i + 2, segments)];
+
+  float f2 = f * f;
+  float f3 = f2 * f;
+  return 0.5f * ((2.0f * p1) + (-p0 + p2) * f +
+                 (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * f2 +
+                 (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * f3);
+}
+
+void CameraPath::apply(Camera &camera, float t) const {
+  camera.setPosition(sample(t));
+}
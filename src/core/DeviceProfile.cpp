@@ -0,0 +1,293 @@
+#include "DeviceProfile.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+using namespace vulkan;
+
+static bool hasExtension(const std::vector<VkExtensionProperties> &exts,
+                         const char *name) {
+  return std::any_of(exts.begin(), exts.end(),
+                     [&](const VkExtensionProperties &e) {
+                       return std::strcmp(e.extensionName, name) == 0;
+                     });
+}
+
+auto DeviceProfile::query(VkPhysicalDevice device, VkSurfaceKHR surface,
+                          const std::vector<const char *> &requiredExtensions)
+    -> DeviceProfile {
+  DeviceProfile p;
+  p.device = device;
+
+  VkPhysicalDeviceProperties basic;
+  vkGetPhysicalDeviceProperties(device, &basic);
+  // The 1.2 property/feature structs may only be chained when the device
+  // reports 1.2; the instance is created for 1.2 so every 1.1 struct is fine.
+  bool is12 = VK_API_VERSION_MAJOR(basic.apiVersion) > 1 ||
+              VK_API_VERSION_MINOR(basic.apiVersion) >= 2;
+
+  VkPhysicalDeviceSubgroupProperties subgroup{};
+  subgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+  VkPhysicalDeviceMultiviewProperties multiviewProps{};
+  multiviewProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+  multiviewProps.pNext = &subgroup;
+  VkPhysicalDeviceDescriptorIndexingProperties indexingProps{};
+  indexingProps.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  indexingProps.pNext = &multiviewProps;
+  VkPhysicalDeviceProperties2 props2{};
+  props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  props2.pNext = is12 ? static_cast<void *>(&indexingProps)
+                      : static_cast<void *>(&multiviewProps);
+  vkGetPhysicalDeviceProperties2(device, &props2);
+
+  const VkPhysicalDeviceProperties &props = props2.properties;
+  const VkPhysicalDeviceLimits &limits = props.limits;
+  p.name = props.deviceName;
+  p.type = props.deviceType;
+  p.apiVersion = props.apiVersion;
+  p.vendorID = props.vendorID;
+  p.deviceID = props.deviceID;
+  p.maxImageDimension2D = limits.maxImageDimension2D;
+  p.maxPushConstantsSize = limits.maxPushConstantsSize;
+  p.maxDrawIndirectCount = limits.maxDrawIndirectCount;
+  p.maxComputeWorkGroupInvocations = limits.maxComputeWorkGroupInvocations;
+  p.maxComputeSharedMemorySize = limits.maxComputeSharedMemorySize;
+  p.maxBoundDescriptorSets = limits.maxBoundDescriptorSets;
+  p.timestampPeriod = limits.timestampPeriod;
+  p.minUniformBufferOffsetAlignment = limits.minUniformBufferOffsetAlignment;
+  p.minStorageBufferOffsetAlignment = limits.minStorageBufferOffsetAlignment;
+  p.subgroupSize = subgroup.subgroupSize;
+  p.maxMultiviewViewCount = multiviewProps.maxMultiviewViewCount;
+
+  VkPhysicalDeviceMemoryProperties mem;
+  vkGetPhysicalDeviceMemoryProperties(device, &mem);
+  for (uint32_t i = 0; i < mem.memoryHeapCount; i++) {
+    if (mem.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+      p.deviceLocalBytes =
+          std::max(p.deviceLocalBytes, mem.memoryHeaps[i].size);
+  }
+
+  // Extensions
+  uint32_t extCount = 0;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extCount, nullptr);
+  std::vector<VkExtensionProperties> exts(extCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extCount, exts.data());
+  for (auto req : requiredExtensions) {
+    if (!hasExtension(exts, req)) {
+      p.rejectReason = std::string("missing ") + req;
+      return p;
+    }
+  }
+
+  // Queue families: prefer one family that does graphics and present
+  uint32_t qCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &qCount, nullptr);
+  std::vector<VkQueueFamilyProperties> qprops(qCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &qCount, qprops.data());
+  for (uint32_t i = 0; i < qCount; i++) {
+    VkQueueFlags flags = qprops[i].queueFlags;
+    VkBool32 present = surface == VK_NULL_HANDLE;
+    if (surface != VK_NULL_HANDLE)
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present);
+
+    if (flags & VK_QUEUE_GRAPHICS_BIT) {
+      bool better = p.graphicsFamily == UINT32_MAX ||
+                    (present && p.presentFamily != p.graphicsFamily);
+      if (better) {
+        p.graphicsFamily = i;
+        p.timestampValidBits = qprops[i].timestampValidBits;
+        if (present)
+          p.presentFamily = i;
+      }
+    }
+    if (present && p.presentFamily == UINT32_MAX)
+      p.presentFamily = i;
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+        p.asyncComputeFamily == UINT32_MAX)
+      p.asyncComputeFamily = i;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+        p.transferFamily == UINT32_MAX)
+      p.transferFamily = i;
+  }
+  if (p.graphicsFamily == UINT32_MAX) {
+    p.rejectReason = "no graphics queue";
+    return p;
+  }
+  if (p.presentFamily == UINT32_MAX) {
+    p.rejectReason = "cannot present to the surface";
+    return p;
+  }
+  if (surface != VK_NULL_HANDLE) {
+    uint32_t formatCount = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount,
+                                         nullptr);
+    if (formatCount == 0) {
+      p.rejectReason = "no surface formats";
+      return p;
+    }
+  }
+
+  // Features
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{};
+  dynamicRendering.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  VkPhysicalDeviceVulkan12Features v12{};
+  v12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceMultiviewFeatures multiview{};
+  multiview.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &multiview;
+
+  bool hasDynamicRendering =
+      hasExtension(exts, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+  void **next = &multiview.pNext;
+  if (hasDynamicRendering) {
+    *next = &dynamicRendering;
+    next = &dynamicRendering.pNext;
+  }
+#ifdef VK_EXT_nested_command_buffer
+  VkPhysicalDeviceNestedCommandBufferFeaturesEXT nested{};
+  nested.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_NESTED_COMMAND_BUFFER_FEATURES_EXT;
+  bool hasNested =
+      hasExtension(exts, VK_EXT_NESTED_COMMAND_BUFFER_EXTENSION_NAME);
+  if (hasNested) {
+    *next = &nested;
+    next = &nested.pNext;
+  }
+#endif
+  if (is12)
+    *next = &v12;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  p.dynamicRendering = hasDynamicRendering && dynamicRendering.dynamicRendering;
+#ifdef VK_EXT_nested_command_buffer
+  p.nestedCommandBuffer = hasNested && nested.nestedCommandBuffer;
+#endif
+  p.multiDrawIndirect = features.features.multiDrawIndirect;
+  p.drawIndirectFirstInstance = features.features.drawIndirectFirstInstance;
+  p.shaderInt64 = features.features.shaderInt64;
+  p.samplerAnisotropy = features.features.samplerAnisotropy;
+  p.multiview = multiview.multiview;
+  if (is12) {
+    p.timelineSemaphore = v12.timelineSemaphore;
+    p.drawIndirectCount = v12.drawIndirectCount;
+    p.descriptorIndexing =
+        v12.descriptorIndexing && v12.runtimeDescriptorArray &&
+        v12.descriptorBindingPartiallyBound &&
+        v12.descriptorBindingUpdateUnusedWhilePending &&
+        v12.descriptorBindingSampledImageUpdateAfterBind &&
+        v12.descriptorBindingStorageBufferUpdateAfterBind &&
+        v12.shaderSampledImageArrayNonUniformIndexing &&
+        v12.shaderStorageBufferArrayNonUniformIndexing;
+    const auto &ip = indexingProps;
+    p.maxUpdateAfterBindStorageBuffers =
+        std::min(ip.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                 ip.maxDescriptorSetUpdateAfterBindStorageBuffers);
+    p.maxUpdateAfterBindSampledImages =
+        std::min(ip.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                 ip.maxDescriptorSetUpdateAfterBindSampledImages);
+    p.maxUpdateAfterBindSamplers =
+        std::min(ip.maxPerStageDescriptorUpdateAfterBindSamplers,
+                 ip.maxDescriptorSetUpdateAfterBindSamplers);
+  }
+
+  p.suitable = true;
+  p.score = scoreDevice(p);
+  return p;
+}
+
+auto DeviceProfile::typeName() const -> const char * {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    return "discrete";
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    return "integrated";
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    return "virtual";
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    return "cpu";
+  default:
+    return "other";
+  }
+}
+
+auto vulkan::scoreDevice(const DeviceProfile &p) -> int {
+  if (!p.suitable)
+    return -1;
+
+  int score = 0;
+  switch (p.type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    score += 1000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    score += 300;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    score += 100;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    score += 10;
+    break;
+  default:
+    break;
+  }
+
+  // 10 points per GiB of dedicated memory up to 16 GiB. With every bonus
+  // below this stays under the 700-point gap between discrete and
+  // integrated, so a large shared heap never lifts an iGPU over a dGPU.
+  constexpr VkDeviceSize GIB = 1024ull * 1024ull * 1024ull;
+  const VkDeviceSize gib = std::min<VkDeviceSize>(p.deviceLocalBytes / GIB, 16);
+  score += static_cast<int>(gib) * 10;
+
+  if (p.graphicsFamily == p.presentFamily)
+    score += 20;
+  if (p.asyncComputeFamily != UINT32_MAX)
+    score += 40;
+  if (p.transferFamily != UINT32_MAX)
+    score += 20;
+
+  if (p.dynamicRendering)
+    score += 50;
+  if (p.timelineSemaphore)
+    score += 30;
+  if (p.descriptorIndexing)
+    score += 50;
+  if (p.drawIndirectCount)
+    score += 50;
+  if (p.multiDrawIndirect)
+    score += 20;
+  if (p.timestampValidBits > 0)
+    score += 10;
+  return score;
+}
+
+auto vulkan::matchDeviceSelector(const std::vector<DeviceProfile> &candidates,
+                                 const std::string &selector) -> int {
+  if (selector.empty())
+    return -1;
+
+  char *end = nullptr;
+  long index = std::strtol(selector.c_str(), &end, 10);
+  if (*end == '\0')
+    return index >= 0 && index < static_cast<long>(candidates.size())
+               ? static_cast<int>(index)
+               : -1;
+
+  auto lower = [](std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return s;
+  };
+  std::string needle = lower(selector);
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (lower(candidates[i].name).find(needle) != std::string::npos)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
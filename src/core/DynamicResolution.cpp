@@ -0,0 +1,111 @@
+#include "DynamicResolution.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace vulkan;
+
+// Fraction of the budget the governor aims for, leaving room for spikes
+static constexpr float GOVERNOR_HEADROOM = 0.9f;
+// Exponential smoothing of the measured GPU time
+static constexpr float GOVERNOR_SMOOTHING = 0.2f;
+// Relative error ignored around the target
+static constexpr float GOVERNOR_DEADBAND = 0.03f;
+// Fraction of the error corrected per frame when over / under budget
+static constexpr float GOVERNOR_DOWN_RATE = 0.5f;
+static constexpr float GOVERNOR_UP_RATE = 0.05f;
+
+FrameTimeGovernor::FrameTimeGovernor(const DynamicResolutionSettings &settings)
+    : _settings(settings), _scale(settings.maxScale) {}
+
+auto FrameTimeGovernor::update(float gpuMs) -> float {
+  if (!_hasSample) {
+    _smoothedMs = gpuMs;
+    _hasSample = true;
+  } else {
+    _smoothedMs += (gpuMs - _smoothedMs) * GOVERNOR_SMOOTHING;
+  }
+
+  float target = _settings.frameBudgetMs * GOVERNOR_HEADROOM;
+  float ratio = std::sqrt(target / std::max(_smoothedMs, 0.01f));
+  if (std::abs(ratio - 1.0f) < GOVERNOR_DEADBAND)
+    return _scale;
+
+  float desired = _scale * ratio;
+  float rate = desired < _scale ? GOVERNOR_DOWN_RATE : GOVERNOR_UP_RATE;
+  _scale += (desired - _scale) * rate;
+  _scale = std::clamp(_scale, _settings.minScale, _settings.maxScale);
+  return _scale;
+}
+
+GpuFrameTimer::~GpuFrameTimer() { destroy(); }
+
+auto GpuFrameTimer::create(VkDevice device, VkPhysicalDevice physicalDevice,
+                           uint32_t queueFamily, uint32_t framesInFlight)
+    -> bool {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+  uint32_t qCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qCount, nullptr);
+  std::vector<VkQueueFamilyProperties> qprops(qCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qCount,
+                                           qprops.data());
+
+  uint32_t validBits = qprops[queueFamily].timestampValidBits;
+  if (validBits == 0 || props.limits.timestampPeriod == 0.0f)
+    return false;
+
+  _device = device;
+  _timestampPeriodNs = props.limits.timestampPeriod;
+  _timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+  _written.assign(framesInFlight, false);
+
+  VkQueryPoolCreateInfo qpci{};
+  qpci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  qpci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  qpci.queryCount = framesInFlight * 2;
+  if (vkCreateQueryPool(_device, &qpci, nullptr, &_queryPool) != VK_SUCCESS) {
+    _queryPool = VK_NULL_HANDLE;
+    return false;
+  }
+  return true;
+}
+
+void GpuFrameTimer::destroy() {
+  if (_queryPool)
+    vkDestroyQueryPool(_device, _queryPool, nullptr);
+  _queryPool = VK_NULL_HANDLE;
+}
+
+void GpuFrameTimer::begin(VkCommandBuffer cmd, uint32_t frame) {
+  if (!valid())
+    return;
+  dispatch.vkCmdResetQueryPool(cmd, _queryPool, frame * 2, 2);
+  dispatch.vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                               _queryPool, frame * 2);
+}
+
+void GpuFrameTimer::end(VkCommandBuffer cmd, uint32_t frame) {
+  if (!valid())
+    return;
+  dispatch.vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                               _queryPool, frame * 2 + 1);
+  _written[frame] = true;
+}
+
+auto GpuFrameTimer::collect(uint32_t frame, float &gpuMs) -> bool {
+  if (!valid() || !_written[frame])
+    return false;
+
+  uint64_t stamps[2] = {};
+  if (dispatch.vkGetQueryPoolResults(_device, _queryPool, frame * 2, 2,
+                                     sizeof(stamps), stamps, sizeof(uint64_t),
+                                     VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    return false;
+
+  uint64_t ticks = (stamps[1] - stamps[0]) & _timestampMask;
+  gpuMs = static_cast<float>(static_cast<double>(ticks) * _timestampPeriodNs *
+                             1e-6);
+  return true;
+}
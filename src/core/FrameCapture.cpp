@@ -0,0 +1,285 @@
+#include "FrameCapture.hpp"
+#include "ImageWrite.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+using namespace vulkan;
+
+// Readback slots beyond one per frame in flight, for frames still encoding
+static constexpr uint32_t ENCODE_SLOTS = 3;
+
+void FrameCapture::create(VkDevice device, VkPhysicalDevice physicalDevice,
+                          uint32_t framesInFlight) {
+  _device = device;
+  _physicalDevice = physicalDevice;
+  // Buffers are allocated on first use, sized for the captured image
+  _slots.clear();
+  for (uint32_t i = 0; i < framesInFlight + ENCODE_SLOTS; i++)
+    _slots.push_back(std::make_unique<Slot>());
+}
+
+void FrameCapture::destroy() {
+  if (!_device)
+    return;
+  // The device is idle: every copy still marked Copying has landed
+  for (auto &slot : _slots) {
+    if (slot->state.load(std::memory_order_acquire) == Copying) {
+      slot->state.store(Encoding, std::memory_order_relaxed);
+      encode(*slot);
+    }
+  }
+  waitForEncoders();
+  for (auto &slot : _slots)
+    destroyBuffer(_device, slot->buffer);
+  _slots.clear();
+  _recording = false;
+  _screenshotPath.clear();
+  _device = VK_NULL_HANDLE;
+}
+
+void FrameCapture::setJobSystem(JobSystem *jobs) {
+  if (jobs == _jobs)
+    return;
+  waitForEncoders();
+  _jobs = jobs;
+}
+
+void FrameCapture::waitForEncoders() {
+  if (_jobs)
+    _jobs->wait(_encoding);
+}
+
+void FrameCapture::requestScreenshot(const std::string &path) {
+  std::error_code ec;
+  std::filesystem::path parent = std::filesystem::path(path).parent_path();
+  if (!parent.empty())
+    std::filesystem::create_directories(parent, ec);
+  _screenshotPath = path;
+}
+
+auto FrameCapture::startSequence(const std::string &directory) -> bool {
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  if (ec) {
+    LOG_ERROR(Core, "Cannot create capture directory %s: %s",
+              directory.c_str(), ec.message().c_str());
+    return false;
+  }
+  _sequenceDir = directory;
+  _sequenceFrame = 0;
+  _recording = true;
+  _warnedDrop = false;
+  LOG_INFO(Core, "Recording frames to %s", directory.c_str());
+  return true;
+}
+
+void FrameCapture::stopSequence() {
+  if (!_recording)
+    return;
+  _recording = false;
+  LOG_INFO(Core, "Recorded %u frames to %s (%llu dropped in total)",
+           _sequenceFrame, _sequenceDir.c_str(),
+           static_cast<unsigned long long>(_dropped));
+}
+
+auto FrameCapture::supportsFormat(VkFormat format) -> bool {
+  switch (format) {
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_B8G8R8A8_SRGB:
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+  case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+  case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// A free slot whose buffer holds at least size bytes, or null
+auto FrameCapture::acquireSlot(VkDeviceSize size) -> Slot * {
+  for (auto &slot : _slots) {
+    if (slot->state.load(std::memory_order_acquire) != Free)
+      continue;
+    if (slot->buffer.size >= size)
+      return slot.get();
+  }
+  // Grow (or first allocate) a free slot; nothing references its buffer
+  for (auto &slot : _slots) {
+    if (slot->state.load(std::memory_order_acquire) != Free)
+      continue;
+    destroyBuffer(_device, slot->buffer);
+    // Cached memory keeps the encoder's reads fast; non-coherent cached
+    // memory is invalidated in collect()
+    const VkMemoryPropertyFlags candidates[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+    for (VkMemoryPropertyFlags properties : candidates) {
+      if (findMemoryType(_physicalDevice, ~0u, properties) == UINT32_MAX)
+        continue;
+      if (createBuffer(_device, _physicalDevice, size,
+                       VK_BUFFER_USAGE_TRANSFER_DST_BIT, properties,
+                       slot->buffer)) {
+        slot->coherent =
+            (properties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+        return slot.get();
+      }
+    }
+    LOG_ERROR(Core, "Failed to allocate a %llu-byte capture buffer",
+              static_cast<unsigned long long>(size));
+    return nullptr;
+  }
+  return nullptr;
+}
+
+auto FrameCapture::record(VkCommandBuffer cmd, uint32_t frameSlot,
+                          VkImage image, VkFormat format, VkExtent2D extent,
+                          ImageSyncState &state) -> bool {
+  if (!wanted() || !_device)
+    return false;
+  if (!supportsFormat(format)) {
+    if (!_warnedFormat)
+      LOG_WARN(Core, "Frame capture does not support image format %d",
+               static_cast<int>(format));
+    _warnedFormat = true;
+    _screenshotPath.clear();
+    _recording = false;
+    return false;
+  }
+
+  VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+  Slot *slot = acquireSlot(size);
+  if (!slot) {
+    // A pending screenshot simply tries again next frame
+    if (_recording) {
+      _dropped++;
+      _sequenceFrame++; // keep frame numbers on the timeline
+      if (!_warnedDrop)
+        LOG_WARN(Core, "Capture encoder is behind; dropping frames");
+      _warnedDrop = true;
+    }
+    return false;
+  }
+
+  TRACE_GPU_ZONE(cmd, "Capture");
+  slot->frameSlot = frameSlot;
+  slot->extent = extent;
+  slot->format = format;
+  slot->screenshot = std::move(_screenshotPath);
+  _screenshotPath.clear();
+  slot->sequenceFile.clear();
+  if (_recording) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06u.%s", _sequenceFrame++,
+                  _sequenceFormat == CaptureFormat::Png ? "png" : "pam");
+    slot->sequenceFile = (std::filesystem::path(_sequenceDir) / name).string();
+    slot->sequenceFormat = _sequenceFormat;
+  }
+
+  if (state.layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+    cmdTransitionImage(cmd, image, state.layout,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, state.stage,
+                       state.access, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {extent.width, extent.height, 1};
+  dispatch.vkCmdCopyImageToBuffer(cmd, image,
+                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  slot->buffer.buffer, 1, &region);
+
+  // Made visible to the host when the frame's fence signals
+  VkBufferMemoryBarrier toHost{};
+  toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer = slot->buffer.buffer;
+  toHost.size = size;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                                &toHost, 0, nullptr);
+
+  // The copy only reads: later barriers need an execution dependency only
+  state = {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+           0};
+  slot->state.store(Copying, std::memory_order_relaxed);
+  _captured++;
+  return true;
+}
+
+void FrameCapture::collect(uint32_t frameSlot) {
+  for (auto &slot : _slots) {
+    if (slot->state.load(std::memory_order_relaxed) != Copying ||
+        slot->frameSlot != frameSlot)
+      continue;
+
+    if (!slot->coherent) {
+      VkMappedMemoryRange range{};
+      range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+      range.memory = slot->buffer.memory;
+      range.size = VK_WHOLE_SIZE;
+      dispatch.vkInvalidateMappedMemoryRanges(_device, 1, &range);
+    }
+    slot->state.store(Encoding, std::memory_order_relaxed);
+    if (_jobs) {
+      Slot *s = slot.get();
+      _jobs->run([this, s] { encode(*s); }, &_encoding,
+                 JobSystem::Affinity::Background);
+    } else {
+      encode(*slot);
+    }
+  }
+}
+
+auto FrameCapture::pending() const -> bool {
+  for (const auto &slot : _slots) {
+    if (slot->state.load(std::memory_order_relaxed) == Copying)
+      return true;
+  }
+  return false;
+}
+
+void FrameCapture::toRgba(VkFormat format, const void *src, size_t pixels,
+                          uint8_t *rgba) {
+  std::memcpy(rgba, src, pixels * 4);
+  bool bgra =
+      format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+  for (size_t i = 0; i < pixels; i++, rgba += 4) {
+    if (bgra)
+      std::swap(rgba[0], rgba[2]);
+    rgba[3] = 255; // swapchain alpha is not meaningful
+  }
+}
+
+// Converts, writes the files and frees the slot
+void FrameCapture::encode(Slot &slot) {
+  TRACE_ZONE("FrameCapture::encode");
+  uint32_t width = slot.extent.width, height = slot.extent.height;
+  std::vector<uint8_t> rgba(size_t(width) * height * 4);
+  toRgba(slot.format, slot.buffer.mapped, size_t(width) * height, rgba.data());
+
+  if (!slot.screenshot.empty() &&
+      image::writePng(slot.screenshot, width, height, rgba.data()))
+    LOG_INFO(Core, "Saved screenshot %s", slot.screenshot.c_str());
+  if (!slot.sequenceFile.empty()) {
+    if (slot.sequenceFormat == CaptureFormat::Png)
+      image::writePng(slot.sequenceFile, width, height, rgba.data());
+    else
+      image::writePam(slot.sequenceFile, width, height, rgba.data());
+  }
+  slot.state.store(Free, std::memory_order_release);
+}
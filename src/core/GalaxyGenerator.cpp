@@ -0,0 +1,337 @@
+#include "GalaxyGenerator.hpp"
+#include "JobSystem.hpp"
+#include "SimdMath.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace simd;
+
+// Stars are written in parsecs, the world unit Stars.slang's flux assumes
+static_assert(CameraConstants::Galaxy::PARSEC_TO_UNITS == 1.0f,
+              "GalaxyGenerator and Stars.slang work in parsecs");
+
+static constexpr float TWO_PI = 6.28318531f;
+// Nearest neighbours each web node is joined to
+static constexpr uint32_t WEB_LINKS = 3;
+
+namespace {
+
+// Absolute magnitudes from bright to faint, and how blue the brightest get
+// (0 red, 1 blue-white)
+struct Population {
+  float bright, faint, hot;
+};
+
+constexpr Population YOUNG{-6.0f, 12.0f, 1.0f};  // spiral arms
+constexpr Population DISK{-3.0f, 14.0f, 0.65f};  // old thin and thick disk
+constexpr Population BULGE{-3.0f, 12.0f, 0.4f};
+constexpr Population HALO{-2.0f, 13.0f, 0.45f};
+constexpr Population CLUSTER{-3.0f, 10.0f, 0.35f};
+
+// Four stars, structure of arrays
+struct Group {
+  float4 x, y, z;
+  float4 magnitude;
+  float4 temperature; // 0 red .. 1 blue-white
+};
+
+auto lerp(float a, float b, float4 t) -> float4 {
+  return splat(a) + splat(b - a) * t;
+}
+
+// Magnitudes skewed to the faint end (a steep luminosity function), the
+// brightest also the hottest, with some scatter
+void sample(Random4 &rng, const Population &pop, Group &g) {
+  float4 u = exp(log(rng.uniform()) * splat(1.0f / 3.0f));
+  g.magnitude = lerp(pop.bright, pop.faint, u);
+  g.temperature = (splat(1.0f) - u) * splat(pop.hot) +
+                  (rng.uniform() - splat(0.5f)) * splat(0.2f);
+}
+
+// Plummer sphere of scale a, cut off at 10a
+auto plummerRadius(Random4 &rng, float a) -> float4 {
+  float4 q = exp(log(rng.uniform()) * splat(-2.0f / 3.0f)) - splat(1.0f);
+  return splat(a) / sqrt(max(q, splat(0.01f)));
+}
+
+// Isotropic direction times radius, y scaled by flattening
+void sphere(Random4 &rng, float4 radius, float flattening, Group &g) {
+  float4 cosTheta = rng.uniform() * splat(2.0f) - splat(1.0f);
+  float4 sinTheta = sqrt(max(splat(1.0f) - cosTheta * cosTheta, splat(0.0f)));
+  float4 s, c;
+  sincos(rng.uniform() * splat(TWO_PI), s, c);
+  g.x = radius * sinTheta * c;
+  g.y = radius * cosTheta * splat(flattening);
+  g.z = radius * sinTheta * s;
+}
+
+// Red-orange through white to blue-white, roughly M to O stars
+auto packColors(const Group &g) -> uint4 {
+  float4 t = clamp(g.temperature, 0.0f, 1.0f);
+  uint4 hot = less(splat(0.5f), t);
+  float4 u = select(hot, t * splat(2.0f) - splat(1.0f), t * splat(2.0f));
+  float4 r = select(hot, lerp(1.0f, 0.62f, u), splat(1.0f));
+  float4 gr = select(hot, lerp(0.95f, 0.74f, u), lerp(0.55f, 0.95f, u));
+  float4 b = select(hot, lerp(0.9f, 1.0f, u), lerp(0.3f, 0.9f, u));
+  auto unorm8 = [](float4 v) {
+    return roundToInt(clamp(v, 0.0f, 1.0f) * splat(255.0f));
+  };
+  // As packStarColor
+  uint4 m = roundToInt((clamp(g.magnitude, -10.0f, 20.0f) + splat(10.0f)) *
+                       splat(255.0f / 30.0f));
+  return unorm8(r) | shiftLeft<8>(unorm8(gr)) | shiftLeft<16>(unorm8(b)) |
+         shiftLeft<24>(m);
+}
+
+} // namespace
+
+GalaxyGenerator::GalaxyGenerator(const GalaxyDesc &desc) : _desc(desc) {
+  float shares[COMPONENTS] = {0.0f, std::max(desc.bulgeShare, 0.0f),
+                              std::max(desc.haloShare, 0.0f),
+                              desc.clusters ? std::max(desc.clusterShare, 0.0f)
+                                            : 0.0f,
+                              desc.webNodes > 1
+                                  ? std::max(desc.filamentShare, 0.0f)
+                                  : 0.0f};
+  float total = shares[Bulge] + shares[Halo] + shares[Cluster] +
+                shares[Filament];
+  if (total > 1.0f) {
+    for (float &share : shares)
+      share /= total;
+  }
+  uint32_t rest = desc.stars;
+  for (int c = Bulge; c < COMPONENTS; c++) {
+    _ranges[c].count = std::min(
+        rest, static_cast<uint32_t>(double(desc.stars) * shares[c]));
+    rest -= _ranges[c].count;
+  }
+  _ranges[Disk].count = rest;
+  for (int c = 1; c < COMPONENTS; c++)
+    _ranges[c].first = _ranges[c - 1].first + _ranges[c - 1].count;
+
+  // Cluster centers and web nodes come from their own scalar stream
+  uint64_t state = desc.seed ^ 0x5EEDC1D5u;
+  auto uniform = [&state] {
+    return (simd::Random4::splitmix64(state) >> 40) * (1.0f / 16777216.0f) +
+           (0.5f / 16777216.0f);
+  };
+
+  if (_ranges[Cluster].count) {
+    // A spherical cluster system a few kiloparsecs across
+    float a = 0.15f * desc.radius;
+    for (uint32_t i = 0; i < desc.clusters; i++) {
+      float q = std::pow(uniform(), -2.0f / 3.0f) - 1.0f;
+      float r = a / std::sqrt(std::max(q, 0.01f));
+      float cosTheta = 2.0f * uniform() - 1.0f;
+      float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+      float phi = TWO_PI * uniform();
+      _clusters.emplace_back(r * sinTheta * std::cos(phi), r * cosTheta,
+                             r * sinTheta * std::sin(phi),
+                             1.0f + 5.0f * uniform());
+    }
+  }
+
+  if (_ranges[Filament].count) {
+    std::vector<glm::vec3> nodes(desc.webNodes);
+    for (auto &node : nodes)
+      node = (glm::vec3(uniform(), uniform(), uniform()) -
+              glm::vec3(0.5f)) *
+             desc.webSize;
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    std::vector<std::pair<float, uint32_t>> byDistance;
+    for (uint32_t i = 0; i < nodes.size(); i++) {
+      byDistance.clear();
+      for (uint32_t j = 0; j < nodes.size(); j++) {
+        glm::vec3 d = nodes[j] - nodes[i];
+        if (j != i)
+          byDistance.emplace_back(glm::dot(d, d), j);
+      }
+      uint32_t k = std::min<uint32_t>(WEB_LINKS, byDistance.size());
+      std::partial_sort(byDistance.begin(), byDistance.begin() + k,
+                        byDistance.end());
+      for (uint32_t n = 0; n < k; n++)
+        links.emplace_back(std::min(i, byDistance[n].second),
+                           std::max(i, byDistance[n].second));
+    }
+    std::sort(links.begin(), links.end());
+    links.erase(std::unique(links.begin(), links.end()), links.end());
+    for (auto [a, b] : links)
+      _filaments.push_back({nodes[a], nodes[b]});
+  }
+}
+
+void GalaxyGenerator::generateBlock(Component component, uint32_t block,
+                                    uint32_t skip, uint32_t count,
+                                    Star *out) const {
+  uint64_t key = _desc.seed ^ (uint64_t(component) << 32 | block);
+  Random4 rng(Random4::splitmix64(key));
+  const GalaxyDesc &d = _desc;
+
+  // Disk shape, from the radius
+  float scaleLength = 0.25f * d.radius;
+  float armStart = 0.5f * scaleLength;
+  float armTwist = 1.0f / std::tan(glm::radians(std::max(d.armPitch, 1.0f)));
+  float arms = static_cast<float>(std::max(d.arms, 1u));
+  float thinHeight = d.radius / 150.0f, thickHeight = d.radius / 50.0f;
+
+  uint32_t end = skip + count;
+  for (uint32_t first = 0; first < end; first += 4) {
+    // Every group draws the same numbers, so skipped groups still advance
+    // the streams exactly as a full block would
+    Group g;
+    switch (component) {
+    case Disk: {
+      float4 radius = splat(-scaleLength) * log(rng.uniform() * rng.uniform());
+      uint4 inArm = less(rng.uniform(), splat(d.armShare));
+      float4 u = rng.uniform();
+      float4 arm = toFloat(roundToInt(u * splat(arms) - splat(0.5f)));
+      float4 spread, unused;
+      rng.normal(spread, unused);
+      float4 wound = max(radius, splat(armStart));
+      float4 armAngle = arm * splat(TWO_PI / arms) +
+                        log(wound / splat(armStart)) * splat(armTwist) +
+                        spread * splat(0.5f * d.armWidth) /
+                            max(radius, splat(d.armWidth));
+      float4 angle = select(inArm, armAngle, u * splat(TWO_PI));
+      // sech^2 profile: the logistic distribution
+      float4 v = rng.uniform();
+      float4 height = select(inArm, splat(0.5f * thinHeight),
+                             splat(0.5f * thickHeight)) *
+                      log(v / (splat(1.0f) - v));
+      float4 s, c;
+      sincos(angle, s, c);
+      g.x = radius * c;
+      g.y = height;
+      g.z = radius * s;
+      Group young, old;
+      sample(rng, YOUNG, young);
+      sample(rng, DISK, old);
+      g.magnitude = select(inArm, young.magnitude, old.magnitude);
+      g.temperature = select(inArm, young.temperature, old.temperature);
+      break;
+    }
+    case Bulge:
+      sphere(rng, plummerRadius(rng, 0.05f * d.radius), 0.6f, g);
+      sample(rng, BULGE, g);
+      break;
+    case Halo:
+      sphere(rng, plummerRadius(rng, 0.5f * d.radius), 0.8f, g);
+      sample(rng, HALO, g);
+      break;
+    case Cluster: {
+      float center[4][4];
+      for (uint32_t lane = 0; lane < 4; lane++) {
+        const glm::vec4 &cluster =
+            _clusters[(block * BLOCK + first + lane) % _clusters.size()];
+        for (int k = 0; k < 4; k++)
+          center[k][lane] = cluster[k];
+      }
+      float4 a = load(center[3]);
+      float4 q = exp(log(rng.uniform()) * splat(-2.0f / 3.0f)) - splat(1.0f);
+      sphere(rng, a / sqrt(max(q, splat(0.01f))), 1.0f, g);
+      g.x = g.x + load(center[0]);
+      g.y = g.y + load(center[1]);
+      g.z = g.z + load(center[2]);
+      sample(rng, CLUSTER, g);
+      break;
+    }
+    case Filament: {
+      float from[3][4], to[3][4];
+      for (uint32_t lane = 0; lane < 4; lane++) {
+        const Segment &segment =
+            _filaments[(block * BLOCK + first + lane) % _filaments.size()];
+        for (int k = 0; k < 3; k++) {
+          from[k][lane] = segment.a[k];
+          to[k][lane] = segment.b[k];
+        }
+      }
+      float4 t = rng.uniform();
+      float4 n[4];
+      rng.normal(n[0], n[1]);
+      rng.normal(n[2], n[3]);
+      float4 thickness = splat(d.webSize / 300.0f);
+      float4 *axes[3] = {&g.x, &g.y, &g.z};
+      for (int k = 0; k < 3; k++) {
+        float4 a = load(from[k]);
+        *axes[k] = a + (load(to[k]) - a) * t + n[k] * thickness;
+      }
+      g.magnitude = splat(-10.0f);
+      g.temperature = splat(0.45f) + n[3] * splat(0.05f);
+      break;
+    }
+    default:
+      return;
+    }
+
+    float4 x = g.x, y = g.y, z = g.z, w = asFloat(packColors(g));
+    transpose(x, y, z, w);
+    if (first >= skip && first + 4 <= end) {
+      float *dst = reinterpret_cast<float *>(out + (first - skip));
+      store(dst, x);
+      store(dst + 4, y);
+      store(dst + 8, z);
+      store(dst + 12, w);
+    } else if (first + 4 > skip) {
+      Star lanes[4];
+      float *dst = reinterpret_cast<float *>(lanes);
+      store(dst, x);
+      store(dst + 4, y);
+      store(dst + 8, z);
+      store(dst + 12, w);
+      for (uint32_t lane = 0; lane < 4; lane++) {
+        uint32_t index = first + lane;
+        if (index >= skip && index < end)
+          out[index - skip] = lanes[lane];
+      }
+    }
+  }
+}
+
+void GalaxyGenerator::generate(Star *out, uint32_t first, uint32_t count,
+                               JobSystem *jobs) const {
+  TRACE_ZONE("GalaxyGenerator::generate");
+  struct Task {
+    Component component;
+    uint32_t block, skip, count;
+    Star *out;
+  };
+  std::vector<Task> tasks;
+  uint64_t end = uint64_t(first) + count;
+  for (int c = 0; c < COMPONENTS; c++) {
+    const Range &range = _ranges[c];
+    uint64_t lo = std::max<uint64_t>(first, range.first);
+    uint64_t hi = std::min<uint64_t>(end, uint64_t(range.first) + range.count);
+    if (lo >= hi)
+      continue;
+    // Blocks are numbered from the start of the component
+    for (uint64_t b = (lo - range.first) / BLOCK;
+         range.first + b * BLOCK < hi; b++) {
+      uint64_t blockFirst = range.first + b * BLOCK;
+      uint64_t from = std::max(lo, blockFirst);
+      uint64_t to = std::min(hi, blockFirst + BLOCK);
+      tasks.push_back({static_cast<Component>(c), static_cast<uint32_t>(b),
+                       static_cast<uint32_t>(from - blockFirst),
+                       static_cast<uint32_t>(to - from), out + (from - first)});
+    }
+  }
+
+  auto run = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+      generateBlock(tasks[i].component, tasks[i].block, tasks[i].skip,
+                    tasks[i].count, tasks[i].out);
+  };
+  auto taskCount = static_cast<uint32_t>(tasks.size());
+  if (jobs)
+    jobs->parallelFor(taskCount, run);
+  else
+    run(0, taskCount);
+}
+
+auto GalaxyGenerator::fill(JobSystem *jobs) const -> StarFill {
+  return [this, jobs](Star *out, uint32_t first, uint32_t count) {
+    generate(out, first, count, jobs);
+    return true;
+  };
+}
@@ -0,0 +1,262 @@
+#include "GeometryPool.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace vulkan;
+
+void RangeAllocator::reset(uint32_t capacity) {
+  _capacity = capacity;
+  _used = 0;
+  _free.clear();
+  if (capacity)
+    _free.push_back({0, capacity});
+}
+
+auto RangeAllocator::allocate(uint32_t count) -> uint32_t {
+  if (count == 0)
+    return INVALID;
+  for (size_t i = 0; i < _free.size(); i++) {
+    Range &r = _free[i];
+    if (r.count < count)
+      continue;
+    uint32_t offset = r.offset;
+    r.offset += count;
+    r.count -= count;
+    if (r.count == 0)
+      _free.erase(_free.begin() + static_cast<std::ptrdiff_t>(i));
+    _used += count;
+    return offset;
+  }
+  return INVALID;
+}
+
+void RangeAllocator::release(uint32_t offset, uint32_t count) {
+  if (count == 0)
+    return;
+  auto it = std::lower_bound(
+      _free.begin(), _free.end(), offset,
+      [](const Range &r, uint32_t o) { return r.offset < o; });
+  it = _free.insert(it, {offset, count});
+  _used -= count;
+
+  // Coalesce with the following and preceding neighbours
+  auto next = it + 1;
+  if (next != _free.end() && it->offset + it->count == next->offset) {
+    it->count += next->count;
+    _free.erase(next);
+  }
+  if (it != _free.begin()) {
+    auto prev = it - 1;
+    if (prev->offset + prev->count == it->offset) {
+      prev->count += it->count;
+      _free.erase(it);
+    }
+  }
+}
+
+GeometryPool::~GeometryPool() { destroy(); }
+
+auto GeometryPool::create(VkDevice device, VkPhysicalDevice physicalDevice,
+                          VkQueue queue, uint32_t queueFamily,
+                          uint32_t maxVertices, uint32_t maxIndices,
+                          BindlessDescriptors *bindless) -> bool {
+  _device = device;
+  _physicalDevice = physicalDevice;
+  _queue = queue;
+  _bindless = bindless;
+
+  if (!createBuffer(_device, _physicalDevice,
+                    VkDeviceSize(maxVertices) * sizeof(vmesh::PackedVertex),
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _vertices) ||
+      !createBuffer(_device, _physicalDevice,
+                    VkDeviceSize(maxIndices) * sizeof(uint32_t),
+                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _indices)) {
+    LOG_ERROR(Render, "Failed to allocate the geometry pool");
+    return false;
+  }
+  _vertexRanges.reset(maxVertices);
+  _indexRanges.reset(maxIndices);
+
+  VkCommandPoolCreateInfo cpci{};
+  cpci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  cpci.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  cpci.queueFamilyIndex = queueFamily;
+  if (vkCreateCommandPool(_device, &cpci, nullptr, &_commandPool) !=
+      VK_SUCCESS) {
+    LOG_ERROR(Render, "Failed to create the geometry upload command pool");
+    return false;
+  }
+
+  if (_bindless)
+    _vertexIndex = _bindless->registerStorageBuffer(_vertices.buffer);
+  return true;
+}
+
+void GeometryPool::destroy() {
+  if (!_device)
+    return;
+  if (_bindless && _vertexIndex != BINDLESS_INVALID)
+    _bindless->release(BindlessDescriptors::StorageBuffer, _vertexIndex);
+  _vertexIndex = BINDLESS_INVALID;
+  if (_commandPool)
+    vkDestroyCommandPool(_device, _commandPool, nullptr);
+  _commandPool = VK_NULL_HANDLE;
+  destroyBuffer(_device, _vertices);
+  destroyBuffer(_device, _indices);
+  _device = VK_NULL_HANDLE;
+}
+
+auto GeometryPool::upload(const std::vector<const MeshAsset *> &meshes)
+    -> std::vector<MeshAllocation> {
+  TRACE_ZONE("GeometryPool::upload");
+  std::vector<MeshAllocation> result(meshes.size());
+
+  // Reserve ranges first to size the staging buffer
+  VkDeviceSize stagingBytes = 0;
+  for (size_t i = 0; i < meshes.size(); i++) {
+    const auto &h = meshes[i]->header();
+    uint32_t vertexOffset = _vertexRanges.allocate(h.vertexCount);
+    uint32_t firstIndex = vertexOffset == RangeAllocator::INVALID
+                              ? RangeAllocator::INVALID
+                              : _indexRanges.allocate(h.indexCount);
+    if (firstIndex == RangeAllocator::INVALID) {
+      if (vertexOffset != RangeAllocator::INVALID)
+        _vertexRanges.release(vertexOffset, h.vertexCount);
+      LOG_ERROR(Render, "Geometry pool full (%u vertices, %u indices)",
+                h.vertexCount, h.indexCount);
+      continue;
+    }
+
+    MeshAllocation &a = result[i];
+    a.firstIndex = firstIndex;
+    a.indexCount = h.indexCount;
+    a.vertexOffset = static_cast<int32_t>(vertexOffset);
+    a.vertexCount = h.vertexCount;
+    std::copy(h.boundsMin, h.boundsMin + 3, a.boundsMin);
+    std::copy(h.boundsMax, h.boundsMax + 3, a.boundsMax);
+    std::copy(h.sphere, h.sphere + 4, a.sphere);
+    stagingBytes += meshes[i]->vertexBytes() + h.indexCount * sizeof(uint32_t);
+  }
+  if (stagingBytes == 0)
+    return result;
+
+  BufferResource staging;
+  if (!createBuffer(_device, _physicalDevice, stagingBytes,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    staging)) {
+    for (auto &a : result)
+      release(a);
+    return std::vector<MeshAllocation>(meshes.size());
+  }
+
+  // Vertices are copied verbatim; indices widened to 32 bits
+  std::vector<VkBufferCopy> vertexCopies, indexCopies;
+  auto *dst = static_cast<char *>(staging.mapped);
+  VkDeviceSize offset = 0;
+  for (size_t i = 0; i < meshes.size(); i++) {
+    const MeshAllocation &a = result[i];
+    if (!a.valid())
+      continue;
+    const MeshAsset &mesh = *meshes[i];
+
+    std::memcpy(dst + offset, mesh.vertices(), mesh.vertexBytes());
+    vertexCopies.push_back(
+        {offset, VkDeviceSize(a.vertexOffset) * sizeof(vmesh::PackedVertex),
+         mesh.vertexBytes()});
+    offset += mesh.vertexBytes();
+
+    auto *out = reinterpret_cast<uint32_t *>(dst + offset);
+    if (mesh.indexSize() == 2) {
+      const auto *in = static_cast<const uint16_t *>(mesh.indices());
+      std::copy(in, in + a.indexCount, out);
+    } else {
+      std::memcpy(out, mesh.indices(), mesh.indexBytes());
+    }
+    VkDeviceSize bytes = VkDeviceSize(a.indexCount) * sizeof(uint32_t);
+    indexCopies.push_back(
+        {offset, VkDeviceSize(a.firstIndex) * sizeof(uint32_t), bytes});
+    offset += bytes;
+  }
+
+  VkCommandBufferAllocateInfo cbai{};
+  cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbai.commandPool = _commandPool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = 1;
+  VkCommandBuffer cmd;
+  vkAllocateCommandBuffers(_device, &cbai, &cmd);
+
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  dispatch.vkBeginCommandBuffer(cmd, &begin);
+  dispatch.vkCmdCopyBuffer(cmd, staging.buffer, _vertices.buffer,
+                           static_cast<uint32_t>(vertexCopies.size()),
+                           vertexCopies.data());
+  dispatch.vkCmdCopyBuffer(cmd, staging.buffer, _indices.buffer,
+                           static_cast<uint32_t>(indexCopies.size()),
+                           indexCopies.data());
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+                          VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                0, 1, &barrier, 0, nullptr, 0, nullptr);
+  dispatch.vkEndCommandBuffer(cmd);
+
+  VkFenceCreateInfo fci{};
+  fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  vkCreateFence(_device, &fci, nullptr, &fence);
+  VkSubmitInfo submit{};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &cmd;
+  if (dispatch.vkQueueSubmit(_queue, 1, &submit, fence) == VK_SUCCESS) {
+    dispatch.vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
+  } else {
+    LOG_ERROR(Render, "Failed to submit the geometry upload");
+    for (auto &a : result) {
+      release(a);
+      a = MeshAllocation{};
+    }
+  }
+
+  vkDestroyFence(_device, fence, nullptr);
+  vkFreeCommandBuffers(_device, _commandPool, 1, &cmd);
+  destroyBuffer(_device, staging);
+  return result;
+}
+
+auto GeometryPool::upload(const MeshAsset &mesh) -> MeshAllocation {
+  return upload(std::vector<const MeshAsset *>{&mesh}).front();
+}
+
+void GeometryPool::release(const MeshAllocation &allocation) {
+  if (!allocation.valid())
+    return;
+  _vertexRanges.release(static_cast<uint32_t>(allocation.vertexOffset),
+                        allocation.vertexCount);
+  _indexRanges.release(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryPool::bind(VkCommandBuffer cmd) const {
+  VkDeviceSize offset = 0;
+  dispatch.vkCmdBindVertexBuffers(cmd, 0, 1, &_vertices.buffer, &offset);
+  dispatch.vkCmdBindIndexBuffer(cmd, _indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
@@ -0,0 +1,150 @@
+#include "ImageWrite.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+static constexpr size_t MAX_STORED_BLOCK = 65535;
+// Bytes Adler-32 can sum before its 32-bit accumulators need the modulo
+static constexpr size_t ADLER_NMAX = 5552;
+
+static auto crcTable() -> const std::array<uint32_t, 256> & {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[n] = c;
+    }
+    return t;
+  }();
+  return table;
+}
+
+auto image::crc32(const uint8_t *data, size_t size, uint32_t crc) -> uint32_t {
+  const auto &table = crcTable();
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void putBE32(std::vector<uint8_t> &out, uint32_t v) {
+  out.push_back(static_cast<uint8_t>(v >> 24));
+  out.push_back(static_cast<uint8_t>(v >> 16));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+  out.push_back(static_cast<uint8_t>(v));
+}
+
+// Length, type, data, CRC over type and data
+static void putChunk(std::vector<uint8_t> &out, const char type[4],
+                     const std::vector<uint8_t> &data) {
+  putBE32(out, static_cast<uint32_t>(data.size()));
+  size_t typeAt = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  putBE32(out, image::crc32(out.data() + typeAt, 4 + data.size()));
+}
+
+// Writes head then body, so large pixel data is not copied behind a header
+static auto writeFile(const std::string &path, const void *head,
+                      size_t headSize, const void *body = nullptr,
+                      size_t bodySize = 0) -> bool {
+  FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file) {
+    LOG_ERROR(Core, "Cannot open %s for writing", path.c_str());
+    return false;
+  }
+  bool ok = std::fwrite(head, 1, headSize, file) == headSize &&
+            std::fwrite(body, 1, bodySize, file) == bodySize;
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok)
+    LOG_ERROR(Core, "Failed to write %s", path.c_str());
+  return ok;
+}
+
+auto image::writePng(const std::string &path, uint32_t width, uint32_t height,
+                     const uint8_t *rgba) -> bool {
+  std::vector<uint8_t> header;
+  putBE32(header, width);
+  putBE32(header, height);
+  header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, no interlace
+
+  // Each scanline is prefixed by its filter type (0, none)
+  size_t rowBytes = size_t(width) * 4;
+  size_t rawSize = (rowBytes + 1) * height;
+  size_t blocks = (rawSize + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+
+  static const uint8_t signature[] = {0x89, 'P',  'N',  'G',
+                                      '\r', '\n', 0x1A, '\n'};
+  std::vector<uint8_t> file(signature, signature + sizeof(signature));
+  file.reserve(sizeof(signature) + rawSize + blocks * 5 + 64);
+  putChunk(file, "IHDR", header);
+
+  // IDAT is assembled in place; its length is patched in afterwards
+  size_t idatAt = file.size();
+  putBE32(file, 0);
+  file.insert(file.end(), {'I', 'D', 'A', 'T'});
+  file.push_back(0x78); // zlib: deflate, 32K window
+  file.push_back(0x01); // no preset dictionary, fastest; header % 31 == 0
+
+  uint32_t adlerA = 1, adlerB = 0;
+  size_t blockLeft = 0;
+  size_t rawLeft = rawSize;
+  auto emit = [&](const uint8_t *data, size_t size) {
+    while (size > 0) {
+      if (blockLeft == 0) {
+        blockLeft = std::min(rawLeft, MAX_STORED_BLOCK);
+        rawLeft -= blockLeft;
+        auto len = static_cast<uint16_t>(blockLeft);
+        auto nlen = static_cast<uint16_t>(~len);
+        file.push_back(rawLeft == 0 ? 1 : 0); // BFINAL, BTYPE 00 (stored)
+        file.insert(file.end(), {static_cast<uint8_t>(len),
+                                 static_cast<uint8_t>(len >> 8),
+                                 static_cast<uint8_t>(nlen),
+                                 static_cast<uint8_t>(nlen >> 8)});
+      }
+      size_t n = std::min(size, blockLeft);
+      file.insert(file.end(), data, data + n);
+      for (size_t i = 0; i < n;) {
+        size_t end = std::min(n, i + ADLER_NMAX);
+        for (; i < end; i++) {
+          adlerA += data[i];
+          adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+      }
+      data += n;
+      size -= n;
+      blockLeft -= n;
+    }
+  };
+
+  static const uint8_t filterNone = 0;
+  for (uint32_t y = 0; y < height; y++) {
+    emit(&filterNone, 1);
+    emit(rgba + y * rowBytes, rowBytes);
+  }
+  putBE32(file, (adlerB << 16) | adlerA);
+
+  auto idatSize = static_cast<uint32_t>(file.size() - idatAt - 8);
+  for (int i = 0; i < 4; i++)
+    file[idatAt + i] = static_cast<uint8_t>(idatSize >> (24 - 8 * i));
+  putBE32(file, crc32(file.data() + idatAt + 4, 4 + idatSize));
+  putChunk(file, "IEND", {});
+  return writeFile(path, file.data(), file.size());
+}
+
+auto image::writePam(const std::string &path, uint32_t width, uint32_t height,
+                     const uint8_t *rgba) -> bool {
+  char header[128];
+  int headerSize = std::snprintf(header, sizeof(header),
+                                 "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL "
+                                 "255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+                                 width, height);
+  return writeFile(path, header, static_cast<size_t>(headerSize), rgba,
+                   size_t(width) * height * 4);
+}
@@ -1,5 +1,5 @@
 #include "InputSystem.hpp"
-#include <iostream>
+#include "Log.hpp"
 
 InputSystem::InputSystem(GLFWwindow *window)
     : _window(window), _mouseCaptured(false), _firstMouse(true),
@@ -10,6 +10,11 @@ InputSystem::InputSystem(GLFWwindow *window)
   glfwSetCursorPosCallback(window, mouseCallback);
   glfwSetScrollCallback(window, scrollCallback);
   glfwSetKeyCallback(window, keyCallback);
+  // Window events share the user pointer, so they are tracked here too
+  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  glfwSetWindowIconifyCallback(window, windowEventCallback);
+  glfwSetWindowFocusCallback(window, windowEventCallback);
+  glfwSetWindowRefreshCallback(window, refreshCallback);
 
   // Default bindings
   bindKey(GLFW_KEY_W, InputAction::MoveForward, 1.0f);
@@ -20,6 +25,8 @@ InputSystem::InputSystem(GLFWwindow *window)
   bindKey(GLFW_KEY_Q, InputAction::MoveUp, -1.0f);
   bindKey(GLFW_KEY_LEFT_SHIFT, InputAction::SpeedBoost, 1.0f);
   bindKey(GLFW_KEY_TAB, InputAction::ToggleMouseCapture, 1.0f);
+  bindKey(GLFW_KEY_F12, InputAction::Screenshot, 1.0f);
+  bindKey(GLFW_KEY_F11, InputAction::ToggleRecording, 1.0f);
   bindKey(GLFW_KEY_ESCAPE, InputAction::Exit, 1.0f);
 }
 
@@ -37,11 +44,18 @@ void InputSystem::update() {
 
   // Update axis values from key states
   _axisValues.clear();
+  bool held = false;
   for (const auto &[key, binding] : _keyBindings) {
     if (glfwGetKey(_window, key) == GLFW_PRESS) {
       _axisValues[binding.action] += binding.scale;
+      held = true;
     }
   }
+
+  _activity = _eventPending || held;
+  _resized = _resizePending;
+  _eventPending = false;
+  _resizePending = false;
 }
 
 float InputSystem::getAxis(InputAction action) const {
@@ -72,10 +86,10 @@ void InputSystem::enableMouseCapture(bool capture) {
   if (capture) {
     glfwSetInputMode(_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     _firstMouse = true;
-    std::cout << "Mouse captured\n";
+    LOG_INFO(Input, "Mouse captured");
   } else {
     glfwSetInputMode(_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-    std::cout << "Mouse released\n";
+    LOG_INFO(Input, "Mouse released");
   }
 }
 
@@ -96,9 +110,28 @@ void InputSystem::keyCallback(GLFWwindow *window, int key, int scancode,
   input->handleKey(key, action);
 }
 
+void InputSystem::framebufferSizeCallback(GLFWwindow *window, int width,
+                                          int height) {
+  auto input = static_cast<InputSystem *>(glfwGetWindowUserPointer(window));
+  input->_resizePending = true;
+  input->_eventPending = true;
+}
+
+void InputSystem::windowEventCallback(GLFWwindow *window, int state) {
+  auto input = static_cast<InputSystem *>(glfwGetWindowUserPointer(window));
+  input->_eventPending = true;
+}
+
+void InputSystem::refreshCallback(GLFWwindow *window) {
+  auto input = static_cast<InputSystem *>(glfwGetWindowUserPointer(window));
+  input->_eventPending = true;
+}
+
 void InputSystem::handleMouseMove(double xpos, double ypos) {
+  // A free cursor moves nothing
   if (!_mouseCaptured)
     return;
+  _eventPending = true;
 
   if (_firstMouse) {
     _lastMouseX = xpos;
@@ -115,10 +148,12 @@ void InputSystem::handleMouseMove(double xpos, double ypos) {
 }
 
 void InputSystem::handleScroll(double xoffset, double yoffset) {
+  _eventPending = true;
   _scrollDelta = static_cast<float>(yoffset);
 }
 
 void InputSystem::handleKey(int key, int action) {
+  _eventPending = true;
   auto it = _keyBindings.find(key);
   if (it != _keyBindings.end()) {
     InputAction inputAction = it->second.action;
@@ -0,0 +1,269 @@
+#include "JobSystem.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <exception>
+#include <string>
+
+// A job that becomes runnable when `remaining` dependencies have drained
+struct JobCounter::Join {
+  std::atomic<uint32_t> remaining;
+  JobSystem::Job fn;
+  JobCounter *counter;
+  JobSystem::Affinity affinity;
+};
+
+static thread_local const JobSystem *t_system = nullptr;
+static thread_local uint32_t t_index = 0;
+
+JobSystem::JobSystem(uint32_t workerCount)
+    : _mainThread(std::this_thread::get_id()) {
+  for (uint32_t i = 0; i <= workerCount; i++)
+    _queues.push_back(std::make_unique<Queue>());
+  t_system = this;
+  t_index = 0;
+  for (uint32_t i = 1; i <= workerCount; i++)
+    _workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+JobSystem::~JobSystem() {
+  _stop.store(true);
+  notify(true);
+  for (auto &worker : _workers)
+    worker.join();
+  if (t_system == this)
+    t_system = nullptr;
+}
+
+auto JobSystem::threadIndex() const -> uint32_t {
+  return t_system == this ? t_index : 0;
+}
+
+void JobSystem::run(Job job, JobCounter *counter, Affinity affinity) {
+  if (counter)
+    counter->_pending.fetch_add(1, std::memory_order_relaxed);
+  push(Task{std::move(job), counter}, affinity);
+}
+
+void JobSystem::runAfter(std::initializer_list<JobCounter *> dependencies,
+                         Job job, JobCounter *counter, Affinity affinity) {
+  if (counter)
+    counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+  auto join = std::make_shared<JobCounter::Join>();
+  // +1 so the job cannot start before every dependency was registered
+  join->remaining.store(static_cast<uint32_t>(dependencies.size()) + 1);
+  join->fn = std::move(job);
+  join->counter = counter;
+  join->affinity = affinity;
+
+  for (JobCounter *dependency : dependencies) {
+    std::unique_lock<std::mutex> lock(dependency->_mutex);
+    // Checked under the lock: a counter that drains after this point
+    // releases its continuations under the same lock
+    if (dependency->_pending.load(std::memory_order_acquire) == 0) {
+      lock.unlock();
+      release(*join);
+    } else {
+      dependency->_continuations.push_back(join);
+    }
+  }
+  release(*join);
+}
+
+void JobSystem::release(JobCounter::Join &join) {
+  if (join.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    push(Task{std::move(join.fn), join.counter}, join.affinity);
+}
+
+void JobSystem::push(Task task, Affinity affinity) {
+  if (affinity == Affinity::MainThread) {
+    {
+      std::lock_guard<std::mutex> lock(_mainOnly.mutex);
+      _mainOnly.tasks.push_back(std::move(task));
+    }
+    _mainQueued.fetch_add(1);
+    notify(true); // only the main thread can take it
+    return;
+  }
+  if (affinity == Affinity::Background && !_workers.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(_background.mutex);
+      _background.tasks.push_back(std::move(task));
+    }
+    _backgroundQueued.fetch_add(1);
+    notify(true); // a sleeping main thread cannot take it
+    return;
+  }
+
+  Queue &queue = *_queues[threadIndex()];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  _queued.fetch_add(1);
+  notify(false);
+}
+
+// Sleepers publish themselves in _sleeping before re-checking the queue
+// counts, and pushers bump the counts before reading _sleeping, so one of
+// the two always sees the other
+void JobSystem::notify(bool all) {
+  if (_sleeping.load() == 0)
+    return;
+  std::lock_guard<std::mutex> lock(_sleepMutex);
+  if (all)
+    _wake.notify_all();
+  else
+    _wake.notify_one();
+}
+
+auto JobSystem::tryRunOne(uint32_t self, bool mainThread) -> bool {
+  Task task;
+  bool found = false;
+
+  if (mainThread && _mainQueued.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(_mainOnly.mutex);
+    if (!_mainOnly.tasks.empty()) {
+      task = std::move(_mainOnly.tasks.front());
+      _mainOnly.tasks.pop_front();
+      _mainQueued.fetch_sub(1);
+      found = true;
+    }
+  }
+
+  // Own deque from the back (most recent, still warm in cache), then steal
+  // the oldest job from the others
+  uint32_t n = threadCount();
+  for (uint32_t k = 0; !found && k < n; k++) {
+    Queue &queue = *_queues[(self + k) % n];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+    if (k == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    _queued.fetch_sub(1);
+    found = true;
+  }
+
+  if (!found && !mainThread &&
+      _backgroundQueued.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(_background.mutex);
+    if (!_background.tasks.empty()) {
+      task = std::move(_background.tasks.front());
+      _background.tasks.pop_front();
+      _backgroundQueued.fetch_sub(1);
+      found = true;
+    }
+  }
+
+  if (found)
+    execute(task);
+  return found;
+}
+
+void JobSystem::execute(Task &task) {
+  try {
+    task.fn();
+  } catch (const std::exception &e) {
+    LOG_ERROR(Core, "Job threw: %s", e.what());
+  } catch (...) {
+    LOG_ERROR(Core, "Job threw an unknown exception");
+  }
+  task.fn = nullptr; // drop captures before the counter says we are done
+
+  JobCounter *counter = task.counter;
+  if (!counter)
+    return;
+
+  // Decrement under the lock: wait() takes it before returning, so the
+  // counter cannot be destroyed while this thread still touches it
+  std::vector<std::shared_ptr<JobCounter::Join>> continuations;
+  {
+    std::lock_guard<std::mutex> lock(counter->_mutex);
+    if (counter->_pending.fetch_sub(1) != 1)
+      return;
+    continuations.swap(counter->_continuations);
+  }
+  for (auto &join : continuations)
+    release(*join);
+  notify(true); // waiters sleep on counters
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  uint32_t self = threadIndex();
+  bool mainThread = std::this_thread::get_id() == _mainThread;
+  while (!counter.done()) {
+    if (tryRunOne(self, mainThread))
+      continue;
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _sleeping.fetch_add(1);
+    _wake.wait(lock, [&] {
+      return counter._pending.load() == 0 || _queued.load() > 0 ||
+             (mainThread ? _mainQueued.load() > 0
+                         : _backgroundQueued.load() > 0);
+    });
+    _sleeping.fetch_sub(1);
+  }
+  // Let the job that drained the counter leave its critical section
+  std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+void JobSystem::parallelFor(uint32_t count, const RangeFn &fn,
+                            uint32_t minGrain) {
+  if (count == 0)
+    return;
+  uint32_t chunks = threadCount() * 4;
+  uint32_t grain = std::max({(count + chunks - 1) / chunks, minGrain, 1u});
+  if (threadCount() == 1 || count <= grain) {
+    fn(0, count);
+    return;
+  }
+
+  // The caller takes the first chunk and helps with the rest in wait()
+  JobCounter counter;
+  for (uint32_t begin = grain; begin < count; begin += grain) {
+    uint32_t end = std::min(begin + grain, count);
+    run([&fn, begin, end] { fn(begin, end); }, &counter);
+  }
+  fn(0, grain);
+  wait(counter);
+}
+
+void JobSystem::runMainThreadJobs() {
+  while (_mainQueued.load(std::memory_order_relaxed) > 0) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(_mainOnly.mutex);
+      if (_mainOnly.tasks.empty())
+        return;
+      task = std::move(_mainOnly.tasks.front());
+      _mainOnly.tasks.pop_front();
+      _mainQueued.fetch_sub(1);
+    }
+    execute(task);
+  }
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+  t_system = this;
+  t_index = index;
+  trace::setThreadName(("job" + std::to_string(index)).c_str());
+
+  while (!_stop.load()) {
+    if (tryRunOne(index, false))
+      continue;
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _sleeping.fetch_add(1);
+    _wake.wait(lock, [&] {
+      return _stop.load() || _queued.load() > 0 ||
+             _backgroundQueued.load() > 0;
+    });
+    _sleeping.fetch_sub(1);
+  }
+}
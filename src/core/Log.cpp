@@ -0,0 +1,328 @@
+#include "Log.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+using namespace logging;
+
+namespace {
+
+// Power of two; each slot holds one formatted message. Longer ones (most
+// validation messages, with their object list and spec text) spill to the
+// heap.
+constexpr size_t RING_CAPACITY = 1024;
+constexpr size_t MESSAGE_BYTES = 240;
+// Writer wakes at least this often even without errors
+constexpr auto WRITER_PERIOD = std::chrono::milliseconds(10);
+
+// Validation rate limit: messages per ID let through per window
+constexpr uint32_t VALIDATION_BURST = 3;
+constexpr auto VALIDATION_WINDOW = std::chrono::seconds(1);
+constexpr size_t VALIDATION_IDS = 256;
+
+const char *const categoryNames[] = {"core",  "validation", "swapchain",
+                                     "input", "render",     "app"};
+const char *const levelNames[] = {"debug", "info", "warning", "error", "off"};
+
+struct Record {
+  Category category;
+  Level level;
+  char *spill; // the whole message when it outgrew text; freed by the writer
+  char text[MESSAGE_BYTES];
+};
+
+struct Slot {
+  std::atomic<size_t> sequence;
+  Record record;
+};
+
+/*
+Bounded multi-producer ring (Vyukov): producers claim a slot with one CAS on
+the enqueue position, the single writer thread consumes in order.
+*/
+class Ring {
+public:
+  Ring() {
+    for (size_t i = 0; i < RING_CAPACITY; i++)
+      _slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  auto claim() -> Slot * {
+    size_t pos = _enqueue.load(std::memory_order_relaxed);
+    while (true) {
+      Slot &slot = _slots[pos & (RING_CAPACITY - 1)];
+      size_t seq = slot.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (_enqueue.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+          return &slot;
+      } else if (diff < 0) {
+        return nullptr; // full
+      } else {
+        pos = _enqueue.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void publish(Slot *slot) {
+    size_t pos = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  // Single consumer
+  auto front() -> Slot * {
+    Slot &slot = _slots[_dequeue & (RING_CAPACITY - 1)];
+    size_t seq = slot.sequence.load(std::memory_order_acquire);
+    return seq == _dequeue + 1 ? &slot : nullptr;
+  }
+
+  void pop(Slot *slot) {
+    slot->sequence.store(_dequeue + RING_CAPACITY, std::memory_order_release);
+    _dequeue++;
+  }
+
+private:
+  Slot _slots[RING_CAPACITY];
+  alignas(64) std::atomic<size_t> _enqueue{0};
+  alignas(64) size_t _dequeue = 0;
+};
+
+struct ValidationEntry {
+  int32_t id = 0;
+  bool used = false;
+  uint32_t inWindow = 0;
+  uint64_t suppressed = 0;
+  std::chrono::steady_clock::time_point windowStart;
+  char name[64] = {};
+};
+
+class Logger {
+public:
+  Logger() {
+    for (auto &level : _levels)
+      level.store(static_cast<uint8_t>(Level::Info), std::memory_order_relaxed);
+    _writer = std::thread([this] { run(); });
+  }
+
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _wake.notify_one();
+    _writer.join();
+  }
+
+  auto levelOf(Category category) -> Level {
+    return static_cast<Level>(
+        _levels[static_cast<size_t>(category)].load(std::memory_order_relaxed));
+  }
+
+  void setLevel(Category category, Level level) {
+    _levels[static_cast<size_t>(category)].store(static_cast<uint8_t>(level),
+                                                 std::memory_order_relaxed);
+  }
+
+  void push(Category category, Level level, const char *format,
+            va_list args) {
+    Slot *slot = _ring.claim();
+    if (!slot) {
+      _droppedFull.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    slot->record.category = category;
+    slot->record.level = level;
+    slot->record.spill = nullptr;
+    va_list again;
+    va_copy(again, args);
+    int n = std::vsnprintf(slot->record.text, MESSAGE_BYTES, format, args);
+    if (n >= static_cast<int>(MESSAGE_BYTES)) {
+      slot->record.spill = static_cast<char *>(std::malloc(n + 1));
+      if (slot->record.spill) {
+        std::vsnprintf(slot->record.spill, n + 1, format, again);
+        _spilled.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        _truncated.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    va_end(again);
+    _ring.publish(slot);
+
+    // Errors should reach the console promptly; everything else waits for
+    // the writer's next period
+    if (level >= Level::Warning)
+      _wake.notify_one();
+  }
+
+  void validation(Level level, int32_t id, const char *name,
+                  const char *message) {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t reportSuppressed = 0;
+    char reportName[64] = {};
+    {
+      std::lock_guard<std::mutex> lock(_validationMutex);
+      ValidationEntry &e = entryFor(id, name);
+      if (now - e.windowStart >= VALIDATION_WINDOW) {
+        reportSuppressed = e.suppressed;
+        std::memcpy(reportName, e.name, sizeof(reportName));
+        e.windowStart = now;
+        e.inWindow = 0;
+        e.suppressed = 0;
+      }
+      if (++e.inWindow > VALIDATION_BURST) {
+        e.suppressed++;
+        _suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    if (reportSuppressed)
+      logging::write(Category::Validation, Level::Warning,
+            "(%llu repeats of %s suppressed)",
+            static_cast<unsigned long long>(reportSuppressed), reportName);
+    logging::write(Category::Validation, level, "%s", message);
+  }
+
+  void flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    uint64_t target = _flushRequests + 1;
+    _flushRequests = target;
+    _wake.notify_one();
+    _flushed.wait(lock, [&] { return _flushesDone >= target || _stopping; });
+  }
+
+  auto stats() -> Stats {
+    Stats s;
+    s.written = _written.load(std::memory_order_relaxed);
+    s.droppedFull = _droppedFull.load(std::memory_order_relaxed);
+    s.spilled = _spilled.load(std::memory_order_relaxed);
+    s.truncated = _truncated.load(std::memory_order_relaxed);
+    s.suppressedRepeats = _suppressed.load(std::memory_order_relaxed);
+    return s;
+  }
+
+private:
+  auto entryFor(int32_t id, const char *name) -> ValidationEntry & {
+    size_t start = static_cast<uint32_t>(id) * 2654435761u % VALIDATION_IDS;
+    for (size_t i = 0; i < VALIDATION_IDS; i++) {
+      ValidationEntry &e = _validationIds[(start + i) % VALIDATION_IDS];
+      if (e.used && e.id == id)
+        return e;
+      if (!e.used) {
+        e.used = true;
+        e.id = id;
+        std::snprintf(e.name, sizeof(e.name), "%s", name ? name : "?");
+        return e;
+      }
+    }
+    // Table full: share the home slot
+    return _validationIds[start];
+  }
+
+  void drain() {
+    while (Slot *slot = _ring.front()) {
+      const Record &r = slot->record;
+      FILE *out = r.level >= Level::Warning ? stderr : stdout;
+      std::fprintf(out, "[%s][%s] %s\n",
+                   levelNames[static_cast<size_t>(r.level)],
+                   categoryNames[static_cast<size_t>(r.category)],
+                   r.spill ? r.spill : r.text);
+      std::free(r.spill);
+      _ring.pop(slot);
+      _written.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::fflush(stdout);
+    std::fflush(stderr);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      _wake.wait_for(lock, WRITER_PERIOD);
+      bool stopping = _stopping;
+      uint64_t requested = _flushRequests;
+      lock.unlock();
+      drain();
+      lock.lock();
+      if (requested > _flushesDone) {
+        _flushesDone = requested;
+        _flushed.notify_all();
+      }
+      if (stopping)
+        return;
+    }
+  }
+
+  Ring _ring;
+  std::atomic<uint8_t> _levels[static_cast<size_t>(Category::Count)];
+
+  std::atomic<uint64_t> _written{0};
+  std::atomic<uint64_t> _droppedFull{0};
+  std::atomic<uint64_t> _spilled{0};
+  std::atomic<uint64_t> _truncated{0};
+  std::atomic<uint64_t> _suppressed{0};
+
+  std::mutex _validationMutex;
+  ValidationEntry _validationIds[VALIDATION_IDS];
+
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _flushed;
+  uint64_t _flushRequests = 0;
+  uint64_t _flushesDone = 0;
+  bool _stopping = false;
+  std::thread _writer;
+};
+
+Logger &logger() {
+  static Logger instance;
+  return instance;
+}
+
+} // namespace
+
+void logging::setLevel(Category category, Level level) {
+  logger().setLevel(category, level);
+}
+
+void logging::setLevel(Level level) {
+  for (size_t i = 0; i < static_cast<size_t>(Category::Count); i++)
+    logger().setLevel(static_cast<Category>(i), level);
+}
+
+auto logging::enabled(Category category, Level level) -> bool {
+  return level != Level::Off && level >= logger().levelOf(category);
+}
+
+void logging::write(Category category, Level level, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  logger().push(category, level, format, args);
+  va_end(args);
+}
+
+void logging::validation(Level level, int32_t messageId,
+                         const char *messageName, const char *message) {
+  if (enabled(Category::Validation, level))
+    logger().validation(level, messageId, messageName, message);
+}
+
+void logging::flush() { logger().flush(); }
+
+auto logging::stats() -> Stats { return logger().stats(); }
+
+auto logging::parseLevel(const char *text, Level &out) -> bool {
+  for (size_t i = 0; i < sizeof(levelNames) / sizeof(levelNames[0]); i++) {
+    if (std::strcmp(text, levelNames[i]) == 0) {
+      out = static_cast<Level>(i);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,62 @@
+#include "MeshAsset.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include <cstring>
+#include <fstream>
+
+auto MeshAsset::load(const std::string &path) -> bool {
+  TRACE_ZONE("MeshAsset::load");
+  _data.clear();
+
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    LOG_ERROR(Render, "Cannot open mesh %s", path.c_str());
+    return false;
+  }
+  auto size = static_cast<size_t>(file.tellg());
+  if (size < sizeof(vmesh::FileHeader)) {
+    LOG_ERROR(Render, "%s: truncated mesh", path.c_str());
+    return false;
+  }
+  std::vector<char> data(size);
+  file.seekg(0);
+  if (!file.read(data.data(), static_cast<std::streamsize>(size))) {
+    LOG_ERROR(Render, "%s: read failed", path.c_str());
+    return false;
+  }
+
+  vmesh::FileHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  uint64_t expected =
+      sizeof(header) +
+      uint64_t(header.vertexCount) * sizeof(vmesh::PackedVertex) +
+      uint64_t(header.indexCount) * header.indexSize;
+  if (header.magic != vmesh::MAGIC || header.version != vmesh::VERSION ||
+      (header.indexSize != 2 && header.indexSize != 4) ||
+      header.indexCount % 3 != 0 || expected > size) {
+    LOG_ERROR(Render, "%s: not a version %u .vmesh file", path.c_str(),
+              vmesh::VERSION);
+    return false;
+  }
+
+  _header = header;
+  _data = std::move(data);
+  return true;
+}
+
+auto MeshAsset::vertices() const -> const vmesh::PackedVertex * {
+  return reinterpret_cast<const vmesh::PackedVertex *>(
+      _data.data() + sizeof(vmesh::FileHeader));
+}
+
+auto MeshAsset::vertexBytes() const -> size_t {
+  return size_t(_header.vertexCount) * sizeof(vmesh::PackedVertex);
+}
+
+auto MeshAsset::indices() const -> const void * {
+  return _data.data() + sizeof(vmesh::FileHeader) + vertexBytes();
+}
+
+auto MeshAsset::indexBytes() const -> size_t {
+  return size_t(_header.indexCount) * _header.indexSize;
+}
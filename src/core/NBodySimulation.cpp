@@ -0,0 +1,410 @@
+#include "NBodySimulation.hpp"
+#include "JobSystem.hpp"
+#include "SimdMath.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+// Bodies per part of the parallel passes; fixed so results do not depend on
+// the thread count
+static constexpr uint32_t PART = 4096;
+// Fewer per part in the force pass, whose cost per body varies
+static constexpr uint32_t FORCE_PART = 512;
+// Morton keys hold 10 bits per axis, so the tree is at most 10 levels deep
+static constexpr uint32_t KEY_LEVELS = 10;
+// Levels assembled serially; the 64 cells below them are built in parallel
+static constexpr uint32_t TOP_LEVELS = 2;
+static constexpr uint32_t TOP_CELLS = 1u << (3 * TOP_LEVELS);
+static constexpr uint32_t TOP_SHIFT = 3 * (KEY_LEVELS - TOP_LEVELS);
+
+static void forParts(JobSystem *jobs, uint32_t parts,
+                     const std::function<void(uint32_t)> &fn) {
+  if (!jobs) {
+    for (uint32_t p = 0; p < parts; p++)
+      fn(p);
+    return;
+  }
+  jobs->parallelFor(parts, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t p = begin; p < end; p++)
+      fn(p);
+  });
+}
+
+// 10 bits spread to every third bit
+static auto spreadBits(uint32_t v) -> uint32_t {
+  v &= 0x3ff;
+  v = (v | v << 16) & 0x030000ff;
+  v = (v | v << 8) & 0x0300f00f;
+  v = (v | v << 4) & 0x030c30c3;
+  v = (v | v << 2) & 0x09249249;
+  return v;
+}
+
+static const float LANES[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+
+static auto mortonOf(uint64_t key) -> uint32_t {
+  return static_cast<uint32_t>(key >> 32);
+}
+static auto bodyOf(uint64_t key) -> uint32_t {
+  return static_cast<uint32_t>(key);
+}
+
+// Mass and mass-weighted position summed in double, then one node
+struct MassSum {
+  double mass = 0.0, x = 0.0, y = 0.0, z = 0.0;
+
+  void add(float m, float px, float py, float pz) {
+    mass += m;
+    x += double(m) * px;
+    y += double(m) * py;
+    z += double(m) * pz;
+  }
+  auto node(float size, uint32_t next, uint32_t first, uint32_t count) const
+      -> OctreeNode {
+    glm::vec3 center(0.0f);
+    if (mass > 0.0)
+      center = glm::vec3(float(x / mass), float(y / mass), float(z / mass));
+    return {center, float(mass), size, next, first, count};
+  }
+};
+
+NBodySimulation::NBodySimulation(NBodySnapshot snapshot,
+                                 const NBodySettings &settings)
+    : _snapshot(std::move(snapshot)), _settings(settings) {
+  _snapshot.motion.resize(_snapshot.stars.size(), BodyMotion{});
+}
+
+void NBodySimulation::buildTree(JobSystem *jobs) {
+  TRACE_ZONE("NBody::buildTree");
+  const std::vector<Star> &stars = _snapshot.stars;
+  uint32_t n = _snapshot.count();
+  uint32_t parts = (n + PART - 1) / PART;
+  _nodes.clear();
+  if (n == 0)
+    return;
+
+  // Bounding cube, a little larger so every key stays below 1024
+  std::vector<glm::vec3> lows(parts), highs(parts);
+  forParts(jobs, parts, [&](uint32_t part) {
+    glm::vec3 lo(stars[part * PART].position), hi = lo;
+    for (uint32_t i = part * PART; i < std::min(n, (part + 1) * PART); i++) {
+      lo = glm::min(lo, stars[i].position);
+      hi = glm::max(hi, stars[i].position);
+    }
+    lows[part] = lo;
+    highs[part] = hi;
+  });
+  glm::vec3 lo = lows[0], hi = highs[0];
+  for (uint32_t part = 1; part < parts; part++) {
+    lo = glm::min(lo, lows[part]);
+    hi = glm::max(hi, highs[part]);
+  }
+  glm::vec3 extent = hi - lo;
+  _size = std::max({extent.x, extent.y, extent.z, 1e-3f}) * 1.001f;
+  _origin = (lo + hi) * 0.5f - glm::vec3(0.5f * _size);
+
+  // Keys, counted per part and top cell so the scatter below is stable
+  _unsorted.resize(n);
+  std::vector<uint32_t> offsets(size_t(parts) * TOP_CELLS, 0);
+  float scale = 1024.0f / _size;
+  forParts(jobs, parts, [&](uint32_t part) {
+    uint32_t *counts = &offsets[size_t(part) * TOP_CELLS];
+    for (uint32_t i = part * PART; i < std::min(n, (part + 1) * PART); i++) {
+      glm::vec3 cell = (stars[i].position - _origin) * scale;
+      auto axis = [](float v) {
+        return static_cast<uint32_t>(std::clamp(v, 0.0f, 1023.0f));
+      };
+      uint32_t morton = spreadBits(axis(cell.x)) << 2 |
+                        spreadBits(axis(cell.y)) << 1 |
+                        spreadBits(axis(cell.z));
+      _unsorted[i] = uint64_t(morton) << 32 | i;
+      counts[morton >> TOP_SHIFT]++;
+    }
+  });
+  _cells.assign(TOP_CELLS + 1, 0);
+  uint32_t total = 0;
+  for (uint32_t cell = 0; cell < TOP_CELLS; cell++) {
+    _cells[cell] = total;
+    for (uint32_t part = 0; part < parts; part++) {
+      uint32_t count = offsets[size_t(part) * TOP_CELLS + cell];
+      offsets[size_t(part) * TOP_CELLS + cell] = total;
+      total += count;
+    }
+  }
+  _cells[TOP_CELLS] = total;
+
+  // Scatter into top cells, then sort each; keys are unique, so the order
+  // is the same however the work is split
+  _keys.resize(n);
+  forParts(jobs, parts, [&](uint32_t part) {
+    uint32_t *next = &offsets[size_t(part) * TOP_CELLS];
+    for (uint32_t i = part * PART; i < std::min(n, (part + 1) * PART); i++)
+      _keys[next[mortonOf(_unsorted[i]) >> TOP_SHIFT]++] = _unsorted[i];
+  });
+  forParts(jobs, TOP_CELLS, [&](uint32_t cell) {
+    std::sort(_keys.begin() + _cells[cell], _keys.begin() + _cells[cell + 1]);
+  });
+
+  // Leaf loads read up to three bodies past the last one
+  for (auto *axis : {&_x, &_y, &_z, &_m})
+    axis->assign(n + 3, 0.0f);
+  forParts(jobs, parts, [&](uint32_t part) {
+    for (uint32_t k = part * PART; k < std::min(n, (part + 1) * PART); k++) {
+      uint32_t i = bodyOf(_keys[k]);
+      _x[k] = stars[i].position.x;
+      _y[k] = stars[i].position.y;
+      _z[k] = stars[i].position.z;
+      _m[k] = _snapshot.motion[i].mass;
+    }
+  });
+
+  _subtrees.resize(TOP_CELLS);
+  forParts(jobs, TOP_CELLS, [&](uint32_t cell) {
+    _subtrees[cell].clear();
+    if (_cells[cell + 1] > _cells[cell])
+      buildSubtree(_cells[cell], _cells[cell + 1], TOP_LEVELS,
+                   _subtrees[cell]);
+  });
+  assemble(0, 0);
+}
+
+auto NBodySimulation::buildSubtree(uint32_t begin, uint32_t end,
+                                   uint32_t level,
+                                   std::vector<OctreeNode> &nodes) const
+    -> uint32_t {
+  auto index = static_cast<uint32_t>(nodes.size());
+  nodes.emplace_back();
+  float size = _size / float(1u << level);
+  MassSum sum;
+  if (end - begin <= LEAF_SIZE || level == KEY_LEVELS) {
+    for (uint32_t k = begin; k < end; k++)
+      sum.add(_m[k], _x[k], _y[k], _z[k]);
+    nodes[index] = sum.node(size, index + 1, begin, end - begin);
+    return index;
+  }
+
+  // Children are runs of keys sharing the next octal digit
+  uint32_t shift = 3 * (KEY_LEVELS - 1 - level);
+  uint32_t childBegin = begin;
+  for (uint32_t digit = 0; digit < 8 && childBegin < end; digit++) {
+    auto childEnd = static_cast<uint32_t>(
+        std::partition_point(_keys.begin() + childBegin, _keys.begin() + end,
+                             [&](uint64_t key) {
+                               return (mortonOf(key) >> shift & 7) <= digit;
+                             }) -
+        _keys.begin());
+    if (childEnd > childBegin) {
+      uint32_t child = buildSubtree(childBegin, childEnd, level + 1, nodes);
+      const OctreeNode &node = nodes[child];
+      sum.add(node.mass, node.center.x, node.center.y, node.center.z);
+    }
+    childBegin = childEnd;
+  }
+  nodes[index] =
+      sum.node(size, static_cast<uint32_t>(nodes.size()), 0, 0);
+  return index;
+}
+
+auto NBodySimulation::assemble(uint32_t level, uint32_t cell) -> uint32_t {
+  auto index = static_cast<uint32_t>(_nodes.size());
+  if (level == TOP_LEVELS) {
+    for (OctreeNode node : _subtrees[cell]) {
+      node.next += index;
+      _nodes.push_back(node);
+    }
+    return index;
+  }
+
+  _nodes.emplace_back();
+  MassSum sum;
+  uint32_t span = 1u << (3 * (TOP_LEVELS - level - 1)); // top cells per child
+  for (uint32_t digit = 0; digit < 8; digit++) {
+    uint32_t child = cell * 8 + digit;
+    if (_cells[(child + 1) * span] == _cells[child * span])
+      continue;
+    const OctreeNode &node = _nodes[assemble(level + 1, child)];
+    sum.add(node.mass, node.center.x, node.center.y, node.center.z);
+  }
+  _nodes[index] = sum.node(_size / float(1u << level),
+                           static_cast<uint32_t>(_nodes.size()), 0, 0);
+  return index;
+}
+
+// Acceleration / G on body k (key order); returns the terms summed
+auto NBodySimulation::walk(uint32_t k, glm::vec3 &acceleration) const
+    -> uint32_t {
+  using namespace simd;
+  float eps2 = std::max(_settings.softening * _settings.softening, 1e-12f);
+  float theta2 = _settings.theta * _settings.theta;
+  float px = _x[k], py = _y[k], pz = _z[k];
+  float4 px4 = splat(px), py4 = splat(py), pz4 = splat(pz);
+  float4 eps4 = splat(eps2), one = splat(1.0f), zero = splat(0.0f);
+  float4 ax4 = zero, ay4 = zero, az4 = zero;
+  float ax = 0.0f, ay = 0.0f, az = 0.0f;
+  uint32_t terms = 0;
+
+  auto count = static_cast<uint32_t>(_nodes.size());
+  for (uint32_t n = 0; n < count;) {
+    const OctreeNode &node = _nodes[n];
+    float dx = node.center.x - px, dy = node.center.y - py,
+          dz = node.center.z - pz;
+    float r2 = dx * dx + dy * dy + dz * dz + eps2;
+    if (node.size * node.size < theta2 * r2) {
+      float inv = 1.0f / std::sqrt(r2);
+      float f = node.mass * inv * inv * inv;
+      ax += dx * f;
+      ay += dy * f;
+      az += dz * f;
+      terms++;
+      n = node.next;
+      continue;
+    }
+    if (node.count == 0) {
+      n++;
+      continue;
+    }
+
+    // Too close: every body of the leaf, four at a time, the lanes past
+    // its end massless
+    uint32_t end = node.first + node.count;
+    for (uint32_t j = node.first; j < end; j += 4) {
+      float4 m = load(&_m[j]);
+      if (end - j < 4)
+        m = select(less(load(LANES), splat(float(end - j))), m, zero);
+      float4 dx4 = load(&_x[j]) - px4, dy4 = load(&_y[j]) - py4,
+             dz4 = load(&_z[j]) - pz4;
+      float4 d2 = dx4 * dx4 + dy4 * dy4 + dz4 * dz4 + eps4;
+      float4 inv = one / sqrt(d2);
+      float4 f = m * inv * inv * inv;
+      ax4 = ax4 + dx4 * f;
+      ay4 = ay4 + dy4 * f;
+      az4 = az4 + dz4 * f;
+    }
+    terms += node.count;
+    n = node.next;
+  }
+
+  float sx[4], sy[4], sz[4];
+  store(sx, ax4);
+  store(sy, ay4);
+  store(sz, az4);
+  acceleration = glm::vec3(ax + (sx[0] + sx[1]) + (sx[2] + sx[3]),
+                           ay + (sy[0] + sy[1]) + (sy[2] + sy[3]),
+                           az + (sz[0] + sz[1]) + (sz[2] + sz[3]));
+  return terms;
+}
+
+void NBodySimulation::computeForces(JobSystem *jobs) {
+  TRACE_ZONE("NBody::computeForces");
+  uint32_t n = _snapshot.count();
+  uint32_t parts = (n + FORCE_PART - 1) / FORCE_PART;
+  _accelerations.resize(n);
+  std::vector<uint64_t> terms(parts, 0);
+  // Consecutive bodies in key order are neighbours and walk the same nodes
+  forParts(jobs, parts, [&](uint32_t part) {
+    uint64_t sum = 0;
+    uint32_t end = std::min(n, (part + 1) * FORCE_PART);
+    for (uint32_t k = part * FORCE_PART; k < end; k++) {
+      sum += walk(k, _accelerations[k]);
+      _accelerations[k] *= NBODY_G;
+    }
+    terms[part] = sum;
+  });
+  _interactions = std::accumulate(terms.begin(), terms.end(), uint64_t(0));
+}
+
+void NBodySimulation::accelerations(std::vector<glm::vec3> &out,
+                                    JobSystem *jobs) {
+  buildTree(jobs);
+  computeForces(jobs);
+  out.resize(_snapshot.count());
+  for (uint32_t k = 0; k < _snapshot.count(); k++)
+    out[bodyOf(_keys[k])] = _accelerations[k];
+}
+
+void NBodySimulation::step(JobSystem *jobs) {
+  TRACE_ZONE("NBody::step");
+  buildTree(jobs);
+  computeForces(jobs);
+
+  // Kick, then drift with the new velocity
+  uint32_t n = _snapshot.count();
+  float dt = _settings.dt;
+  forParts(jobs, (n + PART - 1) / PART, [&](uint32_t part) {
+    for (uint32_t k = part * PART; k < std::min(n, (part + 1) * PART); k++) {
+      uint32_t i = bodyOf(_keys[k]);
+      BodyMotion &motion = _snapshot.motion[i];
+      motion.velocity += _accelerations[k] * dt;
+      _snapshot.stars[i].position += motion.velocity * dt;
+    }
+  });
+  _snapshot.time += dt;
+}
+
+void NBodySimulation::directAccelerations(const NBodySnapshot &snapshot,
+                                          float softening,
+                                          std::vector<glm::vec3> &out,
+                                          JobSystem *jobs) {
+  TRACE_ZONE("NBody::directAccelerations");
+  uint32_t n = snapshot.count();
+  double eps2 = double(softening) * softening;
+  out.resize(n);
+  forParts(jobs, (n + FORCE_PART - 1) / FORCE_PART, [&](uint32_t part) {
+    uint32_t end = std::min(n, (part + 1) * FORCE_PART);
+    for (uint32_t i = part * FORCE_PART; i < end; i++) {
+      const glm::vec3 &p = snapshot.stars[i].position;
+      double ax = 0.0, ay = 0.0, az = 0.0;
+      for (uint32_t j = 0; j < n; j++) {
+        if (j == i)
+          continue;
+        const glm::vec3 &q = snapshot.stars[j].position;
+        double dx = double(q.x) - p.x, dy = double(q.y) - p.y,
+               dz = double(q.z) - p.z;
+        double r2 = dx * dx + dy * dy + dz * dz + eps2;
+        double f = snapshot.motion[j].mass / (r2 * std::sqrt(r2));
+        ax += dx * f;
+        ay += dy * f;
+        az += dz * f;
+      }
+      out[i] = glm::vec3(float(ax), float(ay), float(az)) * NBODY_G;
+    }
+  });
+}
+
+auto makeRotatingSnapshot(std::vector<Star> stars, float totalMass,
+                          float softening) -> NBodySnapshot {
+  NBodySnapshot snapshot;
+  snapshot.stars = std::move(stars);
+  uint32_t n = snapshot.count();
+  snapshot.motion.resize(n);
+  if (n == 0)
+    return snapshot;
+
+  // Mass inside each body's radius from its rank by radius
+  std::vector<std::pair<float, uint32_t>> radii(n);
+  for (uint32_t i = 0; i < n; i++)
+    radii[i] = {glm::length(snapshot.stars[i].position), i};
+  std::sort(radii.begin(), radii.end());
+  float mass = totalMass / float(n);
+  float eps2 = softening * softening;
+  for (uint32_t rank = 0; rank < n; rank++) {
+    auto [r, i] = radii[rank];
+    const glm::vec3 &p = snapshot.stars[i].position;
+    BodyMotion &motion = snapshot.motion[i];
+    motion.mass = mass;
+    motion.velocity = glm::vec3(0.0f);
+    float rho2 = p.x * p.x + p.z * p.z;
+    if (rho2 <= 0.0f)
+      continue;
+    // Balance the pull toward the axis: v^2 / rho = G M rho / (r^2 + eps^2)^1.5
+    float soft = r * r + eps2;
+    float speed =
+        std::sqrt(NBODY_G * mass * rank * rho2 / (soft * std::sqrt(soft)));
+    // Against the direction the arms wind outward, so they trail
+    motion.velocity =
+        glm::vec3(p.z, 0.0f, -p.x) * (speed / std::sqrt(rho2));
+  }
+  return snapshot;
+}
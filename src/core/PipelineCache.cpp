@@ -0,0 +1,91 @@
+#include "PipelineCache.hpp"
+#include "Log.hpp"
+#include <cstring>
+#include <fstream>
+
+using namespace vulkan;
+
+PipelineCache::~PipelineCache() { destroy(); }
+
+auto PipelineCache::load(const std::string &path) -> bool {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file)
+    return false;
+  _initialData.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(_initialData.data(), _initialData.size());
+  if (!file) {
+    _initialData.clear();
+    return false;
+  }
+  return true;
+}
+
+// Cache data from another driver/device is rejected or ignored by some
+// implementations and crashes others, so check the header ourselves
+static bool headerMatches(const std::vector<char> &data,
+                          VkPhysicalDevice physicalDevice) {
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(physicalDevice, &props);
+  return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == props.vendorID &&
+         header.deviceID == props.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID,
+                     VK_UUID_SIZE) == 0;
+}
+
+auto PipelineCache::create(VkDevice device, VkPhysicalDevice physicalDevice)
+    -> bool {
+  _device = device;
+
+  bool seeded =
+      !_initialData.empty() && headerMatches(_initialData, physicalDevice);
+  if (!_initialData.empty() && !seeded)
+    LOG_INFO(Core, "Pipeline cache on disk is for another device; ignoring");
+
+  VkPipelineCacheCreateInfo pcci{};
+  pcci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  pcci.initialDataSize = seeded ? _initialData.size() : 0;
+  pcci.pInitialData = seeded ? _initialData.data() : nullptr;
+  VkResult res = vkCreatePipelineCache(_device, &pcci, nullptr, &_cache);
+  _initialData.clear();
+  _initialData.shrink_to_fit();
+  if (res != VK_SUCCESS) {
+    LOG_WARN(Core, "Failed to create pipeline cache");
+    _cache = VK_NULL_HANDLE;
+    return false;
+  }
+  LOG_INFO(Core, "Pipeline cache %s", seeded ? "loaded" : "created empty");
+  return true;
+}
+
+auto PipelineCache::save(const std::string &path) const -> bool {
+  if (!_cache)
+    return false;
+  size_t size = 0;
+  if (vkGetPipelineCacheData(_device, _cache, &size, nullptr) != VK_SUCCESS)
+    return false;
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(_device, _cache, &size, data.data()) !=
+      VK_SUCCESS)
+    return false;
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(data.data(), static_cast<std::streamsize>(size));
+  if (!file) {
+    LOG_WARN(Core, "Failed to write pipeline cache %s", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void PipelineCache::destroy() {
+  if (_cache)
+    vkDestroyPipelineCache(_device, _cache, nullptr);
+  _cache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,230 @@
+#include "RenderScene.hpp"
+#include "JobSystem.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace vulkan;
+
+static constexpr uint32_t NO_KEY = UINT32_MAX;
+// Smallest culling chunk worth a job
+static constexpr uint32_t CULL_GRAIN = 4096;
+
+auto RenderScene::addMesh(const MeshAllocation &mesh) -> uint32_t {
+  _meshes.push_back(mesh);
+  return static_cast<uint32_t>(_meshes.size() - 1);
+}
+
+auto RenderScene::add(uint32_t mesh, uint32_t pipeline,
+                      const glm::mat4 &transform) -> SceneObject {
+  if (mesh >= _meshes.size())
+    return INVALID_OBJECT;
+
+  SceneObject handle;
+  if (!_freeHandles.empty()) {
+    handle = _freeHandles.back();
+    _freeHandles.pop_back();
+  } else {
+    handle = static_cast<SceneObject>(_dense.size());
+    _dense.push_back(UINT32_MAX);
+  }
+
+  uint32_t dense = size();
+  _dense[handle] = dense;
+  _handles.push_back(handle);
+  _transforms.push_back(transform);
+  _spheres.emplace_back();
+  _meshIds.push_back(mesh);
+  _pipelineIds.push_back(pipeline);
+  _instances.emplace_back();
+  _pipelineCount = std::max(_pipelineCount, pipeline + 1);
+  updateDerived(dense);
+  return handle;
+}
+
+void RenderScene::remove(SceneObject object) {
+  if (!contains(object))
+    return;
+  uint32_t dense = _dense[object];
+  uint32_t last = size() - 1;
+  if (dense != last) {
+    _transforms[dense] = _transforms[last];
+    _spheres[dense] = _spheres[last];
+    _meshIds[dense] = _meshIds[last];
+    _pipelineIds[dense] = _pipelineIds[last];
+    _instances[dense] = _instances[last];
+    _handles[dense] = _handles[last];
+    _dense[_handles[dense]] = dense;
+  }
+  _transforms.pop_back();
+  _spheres.pop_back();
+  _meshIds.pop_back();
+  _pipelineIds.pop_back();
+  _instances.pop_back();
+  _handles.pop_back();
+
+  _dense[object] = UINT32_MAX;
+  _freeHandles.push_back(object);
+}
+
+void RenderScene::setTransform(SceneObject object, const glm::mat4 &transform) {
+  if (!contains(object))
+    return;
+  uint32_t dense = _dense[object];
+  _transforms[dense] = transform;
+  updateDerived(dense);
+}
+
+void RenderScene::clear() {
+  _transforms.clear();
+  _spheres.clear();
+  _meshIds.clear();
+  _pipelineIds.clear();
+  _instances.clear();
+  _handles.clear();
+  _dense.clear();
+  _freeHandles.clear();
+  _pipelineCount = 0;
+}
+
+auto RenderScene::contains(SceneObject object) const -> bool {
+  return object < _dense.size() && _dense[object] != UINT32_MAX;
+}
+
+// World sphere and instance data follow the transform, so frames only read
+void RenderScene::updateDerived(uint32_t dense) {
+  const glm::mat4 &m = _transforms[dense];
+  const MeshAllocation &mesh = _meshes[_meshIds[dense]];
+
+  glm::vec3 center(mesh.sphere[0], mesh.sphere[1], mesh.sphere[2]);
+  float scale = std::sqrt(std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+                                    glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+                                    glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))}));
+  _spheres[dense] = glm::vec4(glm::vec3(m * glm::vec4(center, 1.0f)),
+                              mesh.sphere[3] * scale);
+
+  // Quantized positions are (p - boundsMin) / extent; flat axes quantize to 0
+  glm::vec3 boundsMin(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]);
+  glm::vec3 extent(mesh.boundsMax[0] - mesh.boundsMin[0],
+                   mesh.boundsMax[1] - mesh.boundsMin[1],
+                   mesh.boundsMax[2] - mesh.boundsMin[2]);
+  for (int k = 0; k < 3; k++)
+    extent[k] = extent[k] > 0.0f ? extent[k] : 1.0f;
+
+  glm::mat4 folded = m;
+  folded[3] = m * glm::vec4(boundsMin, 1.0f);
+  folded[0] *= extent.x;
+  folded[1] *= extent.y;
+  folded[2] *= extent.z;
+
+  MeshInstance &instance = _instances[dense];
+  for (int row = 0; row < 3; row++)
+    instance.model[row] = glm::vec4(folded[0][row], folded[1][row],
+                                    folded[2][row], folded[3][row]);
+  instance.normalScale = glm::vec4(1.0f / extent, 0.0f);
+}
+
+void RenderScene::buildBatches(DrawBatches &out, const glm::mat4 *viewProj,
+                               JobSystem *jobs) const {
+  uint32_t meshes = meshCount();
+  uint32_t keyCount = _pipelineCount * meshes;
+  uint32_t n = size();
+
+  // Gribb-Hartmann planes, normalized so the sphere test is a distance
+  glm::vec4 planes[6];
+  if (viewProj) {
+    glm::mat4 t = glm::transpose(*viewProj);
+    planes[0] = t[3] + t[0];
+    planes[1] = t[3] - t[0];
+    planes[2] = t[3] + t[1];
+    planes[3] = t[3] - t[1];
+    planes[4] = t[3] + t[2];
+    planes[5] = t[3] - t[2];
+    for (auto &p : planes)
+      p /= glm::length(glm::vec3(p));
+  }
+
+  // Key per object, NO_KEY when culled; iterations are independent
+  out.keys.resize(n);
+  uint32_t *keys = out.keys.data();
+  auto cull = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (viewProj) {
+        const glm::vec4 &s = _spheres[i];
+        bool outside = false;
+        for (const auto &p : planes)
+          outside |= glm::dot(glm::vec3(p), glm::vec3(s)) + p.w < -s.w;
+        if (outside) {
+          keys[i] = NO_KEY;
+          continue;
+        }
+      }
+      keys[i] = _pipelineIds[i] * meshes + _meshIds[i];
+    }
+  };
+  if (jobs)
+    jobs->parallelFor(n, cull, CULL_GRAIN);
+  else
+    cull(0, n);
+
+  // Count per (pipeline, mesh) key
+  out.offsets.assign(keyCount + 1, 0);
+  out.culled = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (keys[i] == NO_KEY)
+      out.culled++;
+    else
+      out.offsets[keys[i] + 1]++;
+  }
+
+  // Prefix sum into instance offsets; one command per non-empty key
+  out.commands.clear();
+  out.pipelines.assign(_pipelineCount, {});
+  for (uint32_t key = 0; key < keyCount; key++) {
+    uint32_t count = out.offsets[key + 1];
+    out.offsets[key + 1] += out.offsets[key];
+    if (count == 0)
+      continue;
+
+    const MeshAllocation &mesh = _meshes[key % meshes];
+    VkDrawIndexedIndirectCommand cmd{};
+    cmd.indexCount = mesh.indexCount;
+    cmd.instanceCount = count;
+    cmd.firstIndex = mesh.firstIndex;
+    cmd.vertexOffset = mesh.vertexOffset;
+    cmd.firstInstance = out.offsets[key];
+
+    auto &range = out.pipelines[key / meshes];
+    if (range.commandCount == 0)
+      range.firstCommand = static_cast<uint32_t>(out.commands.size());
+    range.commandCount++;
+    out.commands.push_back(cmd);
+  }
+
+  // Scatter object indices; offsets[key] becomes the key's write cursor
+  out.instances.resize(n - out.culled);
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t key = out.keys[i];
+    if (key != NO_KEY)
+      out.instances[out.offsets[key]++] = i;
+  }
+}
+
+auto vulkan::addObjectGrid(RenderScene &scene, uint32_t mesh,
+                           uint32_t pipeline, uint32_t count) -> float {
+  const MeshAllocation &m = scene.mesh(mesh);
+  float spacing = std::max(m.sphere[3] * 2.5f, 1e-3f);
+  uint32_t side = static_cast<uint32_t>(
+      std::ceil(std::sqrt(static_cast<float>(count))));
+  float half = 0.5f * spacing * (side - 1);
+
+  for (uint32_t i = 0; i < count; i++) {
+    glm::vec3 position(spacing * (i % side) - half, -m.boundsMin[1],
+                       spacing * (i / side) - half);
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    // Golden-angle yaw steps so neighbours never face the same way
+    transform = glm::rotate(transform, 2.39996f * i, glm::vec3(0, 1, 0));
+    scene.add(mesh, pipeline, transform);
+  }
+  return half;
+}
@@ -0,0 +1,226 @@
+#include "SceneStore.hpp"
+#include "JobSystem.hpp"
+#include "SimdMath.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace vulkan;
+
+static constexpr uint32_t NO_PARENT = UINT32_MAX;
+// Smallest chunk worth a job; small levels run on the calling thread
+static constexpr uint32_t PROPAGATE_GRAIN = 2048;
+
+// Moves element i to to[i]; dropped elements have to[i] == UINT32_MAX
+template <typename T>
+static void remap(std::vector<T> &v, const std::vector<uint32_t> &to,
+                  uint32_t newSize) {
+  std::vector<T> out(newSize);
+  for (size_t i = 0; i < v.size(); i++) {
+    if (to[i] != UINT32_MAX)
+      out[to[i]] = v[i];
+  }
+  v.swap(out);
+}
+
+auto SceneStore::create(const glm::mat4 &local, SceneNode parent)
+    -> SceneNode {
+  uint32_t parentDense = NO_PARENT;
+  if (parent != INVALID_NODE) {
+    if (!contains(parent))
+      return INVALID_NODE;
+    parentDense = _dense[parent];
+  }
+
+  SceneNode handle;
+  if (!_freeHandles.empty()) {
+    handle = _freeHandles.back();
+    _freeHandles.pop_back();
+  } else {
+    handle = static_cast<SceneNode>(_dense.size());
+    _dense.push_back(UINT32_MAX);
+  }
+
+  _dense[handle] = size();
+  _handles.push_back(handle);
+  _locals.push_back(local);
+  _worlds.push_back(local);
+  _parents.push_back(parentDense);
+  _depths.push_back(parentDense == NO_PARENT ? 0 : _depths[parentDense] + 1);
+  _renderObjects.push_back(INVALID_OBJECT);
+  _localDirty.push_back(1);
+  _changed.push_back(0);
+  _structureDirty = true;
+  return handle;
+}
+
+void SceneStore::destroy(SceneNode node) {
+  if (!contains(node))
+    return;
+  // Depth order puts every descendant after its parent
+  sortByDepth();
+
+  uint32_t n = size();
+  uint32_t root = _dense[node];
+  std::vector<uint8_t> dead(n, 0);
+  dead[root] = 1;
+  for (uint32_t i = root + 1; i < n; i++)
+    dead[i] = _parents[i] != NO_PARENT && dead[_parents[i]];
+
+  std::vector<uint32_t> to(n, UINT32_MAX);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (dead[i]) {
+      _dense[_handles[i]] = UINT32_MAX;
+      _freeHandles.push_back(_handles[i]);
+    } else {
+      to[i] = kept++;
+    }
+  }
+  for (auto &p : _parents)
+    p = p == NO_PARENT ? NO_PARENT : to[p];
+
+  remap(_locals, to, kept);
+  remap(_worlds, to, kept);
+  remap(_parents, to, kept);
+  remap(_depths, to, kept);
+  remap(_renderObjects, to, kept);
+  remap(_localDirty, to, kept);
+  remap(_changed, to, kept);
+  remap(_handles, to, kept);
+  for (uint32_t i = 0; i < kept; i++)
+    _dense[_handles[i]] = i;
+  _structureDirty = true;
+}
+
+void SceneStore::clear() {
+  _locals.clear();
+  _worlds.clear();
+  _parents.clear();
+  _depths.clear();
+  _renderObjects.clear();
+  _localDirty.clear();
+  _changed.clear();
+  _handles.clear();
+  _dense.clear();
+  _freeHandles.clear();
+  _levels.clear();
+  _structureDirty = false;
+}
+
+void SceneStore::setLocal(SceneNode node, const glm::mat4 &local) {
+  if (!contains(node))
+    return;
+  uint32_t dense = _dense[node];
+  _locals[dense] = local;
+  _localDirty[dense] = 1;
+}
+
+auto SceneStore::local(SceneNode node) const -> const glm::mat4 & {
+  return _locals[_dense[node]];
+}
+
+auto SceneStore::world(SceneNode node) const -> const glm::mat4 & {
+  return _worlds[_dense[node]];
+}
+
+auto SceneStore::parent(SceneNode node) const -> SceneNode {
+  uint32_t p = _parents[_dense[node]];
+  return p == NO_PARENT ? INVALID_NODE : _handles[p];
+}
+
+void SceneStore::setRenderObject(SceneNode node, SceneObject object) {
+  if (!contains(node))
+    return;
+  uint32_t dense = _dense[node];
+  _renderObjects[dense] = object;
+  _localDirty[dense] = 1;
+}
+
+auto SceneStore::contains(SceneNode node) const -> bool {
+  return node < _dense.size() && _dense[node] != UINT32_MAX;
+}
+
+// Stable counting sort by depth; also rebuilds the level table
+void SceneStore::sortByDepth() {
+  if (!_structureDirty)
+    return;
+  _structureDirty = false;
+
+  uint32_t n = size();
+  uint32_t maxDepth = 0;
+  for (uint32_t d : _depths)
+    maxDepth = std::max(maxDepth, d);
+  _levels.assign(n ? maxDepth + 2 : 0, 0);
+  for (uint32_t d : _depths)
+    _levels[d + 1]++;
+  for (size_t d = 1; d < _levels.size(); d++)
+    _levels[d] += _levels[d - 1];
+
+  if (std::is_sorted(_depths.begin(), _depths.end()))
+    return;
+
+  std::vector<uint32_t> cursor(_levels.begin(), _levels.end());
+  std::vector<uint32_t> to(n);
+  for (uint32_t i = 0; i < n; i++)
+    to[i] = cursor[_depths[i]]++;
+  for (auto &p : _parents)
+    p = p == NO_PARENT ? NO_PARENT : to[p];
+
+  remap(_locals, to, n);
+  remap(_worlds, to, n);
+  remap(_parents, to, n);
+  remap(_depths, to, n);
+  remap(_renderObjects, to, n);
+  remap(_localDirty, to, n);
+  remap(_changed, to, n);
+  remap(_handles, to, n);
+  for (uint32_t i = 0; i < n; i++)
+    _dense[_handles[i]] = i;
+}
+
+void SceneStore::propagate(JobSystem *jobs) {
+  TRACE_ZONE("SceneStore::propagate");
+  sortByDepth();
+
+  const uint32_t *parents = _parents.data();
+  const glm::mat4 *locals = _locals.data();
+  glm::mat4 *worlds = _worlds.data();
+  const uint8_t *localDirty = _localDirty.data();
+  uint8_t *changed = _changed.data();
+
+  for (uint32_t level = 0; level < levelCount(); level++) {
+    uint32_t first = _levels[level];
+    auto body = [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = first + begin; i < first + end; i++) {
+        uint32_t p = parents[i];
+        if (p == NO_PARENT) {
+          changed[i] = localDirty[i];
+          if (changed[i])
+            worlds[i] = locals[i];
+        } else {
+          changed[i] = localDirty[i] | changed[p];
+          if (changed[i])
+            simd::mul(worlds[p], locals[i], worlds[i]);
+        }
+      }
+    };
+
+    uint32_t count = _levels[level + 1] - first;
+    if (jobs)
+      jobs->parallelFor(count, body, PROPAGATE_GRAIN);
+    else
+      body(0, count);
+  }
+
+  if (!_localDirty.empty())
+    std::memset(_localDirty.data(), 0, _localDirty.size());
+}
+
+void SceneStore::syncTo(RenderScene &scene) const {
+  TRACE_ZONE("SceneStore::syncTo");
+  for (uint32_t i = 0; i < size(); i++) {
+    if (_changed[i] && _renderObjects[i] != INVALID_OBJECT)
+      scene.setTransform(_renderObjects[i], _worlds[i]);
+  }
+}
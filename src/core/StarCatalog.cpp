@@ -0,0 +1,104 @@
+#include "StarCatalog.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Stars per write() block: 16 MiB
+static constexpr uint32_t WRITE_BLOCK = 1u << 20;
+
+auto StarCatalog::open(const std::string &path) -> bool {
+  TRACE_ZONE("StarCatalog::open");
+  _file = std::ifstream(path, std::ios::binary | std::ios::ate);
+  _header = vstars::FileHeader{};
+  _path = path;
+  if (!_file) {
+    LOG_ERROR(Render, "Cannot open star catalog %s", path.c_str());
+    return false;
+  }
+  auto size = static_cast<uint64_t>(_file.tellg());
+  vstars::FileHeader header;
+  _file.seekg(0);
+  if (size < sizeof(header) ||
+      !_file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    LOG_ERROR(Render, "%s: truncated star catalog", path.c_str());
+    return false;
+  }
+  if (header.magic != vstars::MAGIC || header.version != vstars::VERSION ||
+      sizeof(header) + uint64_t(header.count) * sizeof(Star) > size) {
+    LOG_ERROR(Render, "%s: not a version %u .vstars file", path.c_str(),
+              vstars::VERSION);
+    return false;
+  }
+  _header = header;
+  return true;
+}
+
+auto StarCatalog::read(Star *out, uint32_t first, uint32_t count) -> bool {
+  TRACE_ZONE("StarCatalog::read");
+  if (uint64_t(first) + count > _header.count) {
+    LOG_ERROR(Render, "%s: stars %u-%u are past the end", _path.c_str(),
+              first, first + count);
+    return false;
+  }
+  _file.seekg(static_cast<std::streamoff>(sizeof(vstars::FileHeader) +
+                                          uint64_t(first) * sizeof(Star)));
+  if (!_file.read(reinterpret_cast<char *>(out),
+                  static_cast<std::streamsize>(uint64_t(count) *
+                                               sizeof(Star)))) {
+    LOG_ERROR(Render, "%s: read failed", _path.c_str());
+    _file.clear();
+    return false;
+  }
+  return true;
+}
+
+auto StarCatalog::fill() -> StarFill {
+  return [this](Star *out, uint32_t first, uint32_t count) {
+    return read(out, first, count);
+  };
+}
+
+auto StarCatalog::write(const std::string &path, uint32_t count, uint64_t seed,
+                        const StarFill &fill) -> bool {
+  TRACE_ZONE("StarCatalog::write");
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    LOG_ERROR(Render, "Cannot create star catalog %s", path.c_str());
+    return false;
+  }
+  vstars::FileHeader header;
+  header.count = count;
+  header.seed = seed;
+  for (int k = 0; k < 3; k++) {
+    header.boundsMin[k] = count ? INFINITY : 0.0f;
+    header.boundsMax[k] = count ? -INFINITY : 0.0f;
+  }
+  // Placeholder until the bounds are known
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  std::vector<Star> block(std::min(count, WRITE_BLOCK));
+  for (uint32_t first = 0; first < count; first += WRITE_BLOCK) {
+    uint32_t n = std::min(count - first, WRITE_BLOCK);
+    if (!fill(block.data(), first, n))
+      return false;
+    for (uint32_t i = 0; i < n; i++) {
+      for (int k = 0; k < 3; k++) {
+        header.boundsMin[k] = std::min(header.boundsMin[k],
+                                       block[i].position[k]);
+        header.boundsMax[k] = std::max(header.boundsMax[k],
+                                       block[i].position[k]);
+      }
+    }
+    file.write(reinterpret_cast<const char *>(block.data()),
+               static_cast<std::streamsize>(uint64_t(n) * sizeof(Star)));
+  }
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  if (!file) {
+    LOG_ERROR(Render, "%s: write failed", path.c_str());
+    return false;
+  }
+  return true;
+}
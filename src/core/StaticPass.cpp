@@ -0,0 +1,95 @@
+#include "StaticPass.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+
+using namespace vulkan;
+
+auto StaticPass::create(VkDevice device, uint32_t queueFamily,
+                        uint32_t framesInFlight,
+                        const RenderTargetLayout &target) -> bool {
+  destroy();
+  if (!target.usesDynamicRendering()) {
+    LOG_WARN(Core, "Static passes need dynamic rendering");
+    return false;
+  }
+  _device = device;
+  _target = target;
+
+  VkCommandPoolCreateInfo cpci{};
+  cpci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  cpci.queueFamilyIndex = queueFamily;
+  cpci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  if (vkCreateCommandPool(_device, &cpci, nullptr, &_pool) != VK_SUCCESS) {
+    LOG_ERROR(Core, "failed to create static pass command pool");
+    _pool = VK_NULL_HANDLE;
+    return false;
+  }
+
+  _buffers.resize(framesInFlight);
+  VkCommandBufferAllocateInfo cbai{};
+  cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbai.commandPool = _pool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  cbai.commandBufferCount = framesInFlight;
+  if (vkAllocateCommandBuffers(_device, &cbai, _buffers.data()) !=
+      VK_SUCCESS) {
+    LOG_ERROR(Core, "failed to allocate static pass command buffers");
+    destroy();
+    return false;
+  }
+  _keys.assign(framesInFlight, 0);
+  _current.assign(framesInFlight, false);
+  return true;
+}
+
+void StaticPass::destroy() {
+  // Freed with the pool
+  if (_pool)
+    vkDestroyCommandPool(_device, _pool, nullptr);
+  _pool = VK_NULL_HANDLE;
+  _buffers.clear();
+  _keys.clear();
+  _current.clear();
+}
+
+auto StaticPass::get(uint32_t frameSlot, uint64_t key,
+                     const std::function<void(VkCommandBuffer)> &record)
+    -> VkCommandBuffer {
+  VkCommandBuffer cmd = _buffers[frameSlot];
+  if (_current[frameSlot] && _keys[frameSlot] == key)
+    return cmd;
+
+  TRACE_ZONE("StaticPass::record");
+  dispatch.vkResetCommandBuffer(cmd, 0);
+
+  // Only the attachment formats are inherited; the pass that executes the
+  // buffer must have been begun with secondary contents
+  VkCommandBufferInheritanceRenderingInfoKHR rendering{};
+  rendering.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+  rendering.viewMask = _target.viewMask;
+  rendering.colorAttachmentCount = 1;
+  rendering.pColorAttachmentFormats = &_target.colorFormat;
+  rendering.depthAttachmentFormat = _target.depthFormat;
+  rendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkCommandBufferInheritanceInfo inheritance{};
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.pNext = &rendering;
+
+  VkCommandBufferBeginInfo binfo{};
+  binfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  binfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  binfo.pInheritanceInfo = &inheritance;
+  dispatch.vkBeginCommandBuffer(cmd, &binfo);
+  record(cmd);
+  dispatch.vkEndCommandBuffer(cmd);
+
+  _keys[frameSlot] = key;
+  _current[frameSlot] = true;
+  _recorded++;
+  return cmd;
+}
+
+void StaticPass::invalidate() { _current.assign(_current.size(), false); }
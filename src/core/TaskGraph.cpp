@@ -0,0 +1,128 @@
+#include "TaskGraph.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include <chrono>
+#include <exception>
+#include <mutex>
+
+auto TaskGraph::add(const char *name, std::function<bool()> fn,
+                    std::initializer_list<TaskId> dependencies,
+                    Affinity affinity) -> TaskId {
+  TaskId id = _tasks.size();
+  Task task;
+  task.name = name;
+  task.fn = std::move(fn);
+  task.affinity = affinity;
+  for (TaskId dep : dependencies) {
+    _tasks[dep].dependents.push_back(id);
+    task.dependencyCount++;
+  }
+  _tasks.push_back(std::move(task));
+  return id;
+}
+
+auto TaskGraph::run(JobSystem &jobs) -> bool {
+  using Clock = std::chrono::steady_clock;
+  enum class State { Waiting, Launched, Skipped };
+
+  std::mutex mutex;
+  std::vector<uint32_t> remaining(_tasks.size());
+  std::vector<State> state(_tasks.size(), State::Waiting);
+  bool failed = false;
+  JobCounter all;
+
+  _timings.assign(_tasks.size(), Timing{});
+  for (TaskId i = 0; i < _tasks.size(); i++) {
+    _timings[i].name = _tasks[i].name;
+    remaining[i] = _tasks[i].dependencyCount;
+  }
+
+  auto start = Clock::now();
+  auto sinceStart = [&](Clock::time_point t) {
+    return std::chrono::duration<double, std::milli>(t - start).count();
+  };
+
+  // Caller holds the lock
+  std::function<void(TaskId)> skip = [&](TaskId id) {
+    if (state[id] == State::Skipped)
+      return;
+    state[id] = State::Skipped;
+    for (TaskId d : _tasks[id].dependents)
+      skip(d);
+  };
+
+  // Dependents are launched from inside the finishing job, so `all` cannot
+  // drain while any task is still to come
+  std::function<void(TaskId)> launch = [&](TaskId id) {
+    auto affinity = _tasks[id].affinity == Affinity::MainThread
+                        ? JobSystem::Affinity::MainThread
+                        : JobSystem::Affinity::Any;
+    jobs.run(
+        [&, id] {
+          Timing timing{_tasks[id].name, 0.0, 0.0, jobs.threadIndex(), true,
+                        false};
+          auto taskStart = Clock::now();
+          {
+            TRACE_ZONE(_tasks[id].name);
+            try {
+              timing.ok = _tasks[id].fn();
+            } catch (const std::exception &e) {
+              LOG_ERROR(Core, "%s: %s", _tasks[id].name, e.what());
+            }
+          }
+          timing.startMs = sinceStart(taskStart);
+          timing.endMs = sinceStart(Clock::now());
+
+          std::vector<TaskId> ready;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            _timings[id] = timing;
+            if (timing.ok) {
+              for (TaskId d : _tasks[id].dependents) {
+                if (--remaining[d] == 0 && state[d] == State::Waiting) {
+                  state[d] = State::Launched;
+                  ready.push_back(d);
+                }
+              }
+            } else {
+              failed = true;
+              LOG_ERROR(Core, "Task '%s' failed", _tasks[id].name);
+              for (TaskId d : _tasks[id].dependents)
+                skip(d);
+            }
+          }
+          for (TaskId d : ready)
+            launch(d);
+        },
+        &all, affinity);
+  };
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (TaskId i = 0; i < _tasks.size(); i++) {
+      if (remaining[i] == 0)
+        state[i] = State::Launched;
+    }
+  }
+  for (TaskId i = 0; i < _tasks.size(); i++) {
+    if (_tasks[i].dependencyCount == 0)
+      launch(i);
+  }
+  jobs.wait(all);
+
+  _totalMs = sinceStart(Clock::now());
+  return !failed;
+}
+
+void TaskGraph::report(const char *title) const {
+  for (const auto &t : _timings) {
+    if (!t.ran) {
+      LOG_INFO(App, "%s: %-20s skipped", title, t.name);
+      continue;
+    }
+    LOG_INFO(App, "%s: %-20s %7.2f ms  [%7.2f .. %7.2f] thread %u%s", title,
+             t.name, t.endMs - t.startMs, t.startMs, t.endMs, t.thread,
+             t.ok ? "" : "  FAILED");
+  }
+  LOG_INFO(App, "%s: total %.2f ms", title, _totalMs);
+}
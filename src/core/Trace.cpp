@@ -0,0 +1,225 @@
+#include "Trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Events per thread buffer before it is handed to the writer
+constexpr size_t CHUNK_EVENTS = 4096;
+
+struct Event {
+  const char *name;
+  uint64_t beginNs;
+  uint64_t endNs;
+};
+
+struct Chunk {
+  uint32_t tid;
+  std::vector<Event> events;
+};
+
+struct ThreadBuffer {
+  uint32_t tid;
+  std::mutex mutex; // only contended while stop() drains it
+  std::vector<Event> events;
+  std::string name;
+};
+
+struct Session {
+  std::atomic<bool> active{false};
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<Chunk> pending;
+  std::vector<std::shared_ptr<ThreadBuffer>> threads;
+  std::thread writer;
+  std::ofstream file;
+  bool stopping = false;
+  bool firstEvent = true;
+  uint64_t originNs = 0;
+  uint32_t nextTid = 1;
+};
+
+Session &session() {
+  static Session s;
+  return s;
+}
+
+PFN_vkCmdBeginDebugUtilsLabelEXT beginLabelFn = nullptr;
+PFN_vkCmdEndDebugUtilsLabelEXT endLabelFn = nullptr;
+
+void writeEscaped(std::ostream &os, const char *text) {
+  for (const char *c = text; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      os << '\\';
+    os << *c;
+  }
+}
+
+// Called with session().mutex released; only the writer thread writes
+void writeChunk(Session &s, const Chunk &chunk) {
+  for (const auto &e : chunk.events) {
+    s.file << (s.firstEvent ? "\n" : ",\n") << "{\"name\":\"";
+    writeEscaped(s.file, e.name);
+    s.file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << chunk.tid
+           << ",\"ts\":" << (e.beginNs - s.originNs) / 1000.0
+           << ",\"dur\":" << (e.endNs - e.beginNs) / 1000.0 << "}";
+    s.firstEvent = false;
+  }
+}
+
+void writerLoop() {
+  Session &s = session();
+  std::unique_lock<std::mutex> lock(s.mutex);
+  while (true) {
+    s.wake.wait(lock, [&] { return s.stopping || !s.pending.empty(); });
+    while (!s.pending.empty()) {
+      Chunk chunk = std::move(s.pending.front());
+      s.pending.pop_front();
+      lock.unlock();
+      writeChunk(s, chunk);
+      lock.lock();
+    }
+    if (s.stopping)
+      return;
+  }
+}
+
+auto threadBuffer() -> ThreadBuffer & {
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer) {
+    Session &s = session();
+    buffer = std::make_shared<ThreadBuffer>();
+    buffer->events.reserve(CHUNK_EVENTS);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    buffer->tid = s.nextTid++;
+    s.threads.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void submit(uint32_t tid, std::vector<Event> &events) {
+  Session &s = session();
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.pending.push_back({tid, std::move(events)});
+  }
+  s.wake.notify_one();
+  events = {};
+  events.reserve(CHUNK_EVENTS);
+}
+
+} // namespace
+
+auto trace::nowNs() -> uint64_t {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+auto trace::active() -> bool {
+  return session().active.load(std::memory_order_relaxed);
+}
+
+auto trace::start(const std::string &path) -> bool {
+  Session &s = session();
+  if (s.active)
+    return true;
+
+  s.file.open(path, std::ios::trunc);
+  if (!s.file) {
+    std::cerr << "Failed to open trace file " << path << "\n";
+    return false;
+  }
+  s.file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  s.firstEvent = true;
+  s.stopping = false;
+  s.originNs = nowNs();
+  s.writer = std::thread(writerLoop);
+  s.active = true;
+  return true;
+}
+
+void trace::stop() {
+  Session &s = session();
+  if (!s.active)
+    return;
+  s.active = false;
+
+  std::vector<std::shared_ptr<ThreadBuffer>> threads;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    threads = s.threads;
+  }
+  for (auto &t : threads) {
+    std::lock_guard<std::mutex> lock(t->mutex);
+    if (!t->events.empty())
+      submit(t->tid, t->events);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stopping = true;
+  }
+  s.wake.notify_one();
+  s.writer.join();
+
+  // Thread names as metadata events
+  for (auto &t : threads) {
+    if (t->name.empty())
+      continue;
+    s.file << (s.firstEvent ? "\n" : ",\n")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << t->tid << ",\"args\":{\"name\":\"";
+    writeEscaped(s.file, t->name.c_str());
+    s.file << "\"}}";
+    s.firstEvent = false;
+  }
+  s.file << "\n]}\n";
+  s.file.close();
+}
+
+void trace::setThreadName(const char *name) {
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+void trace::record(const char *name, uint64_t beginNs, uint64_t endNs) {
+  if (!active())
+    return; // zone outlived the session
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({name, beginNs, endNs});
+  if (buffer.events.size() >= CHUNK_EVENTS)
+    submit(buffer.tid, buffer.events);
+}
+
+void trace::loadDebugLabels(VkInstance instance) {
+  beginLabelFn = reinterpret_cast<PFN_vkCmdBeginDebugUtilsLabelEXT>(
+      vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT"));
+  endLabelFn = reinterpret_cast<PFN_vkCmdEndDebugUtilsLabelEXT>(
+      vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT"));
+}
+
+void trace::beginLabel(VkCommandBuffer cmd, const char *name) {
+  if (!beginLabelFn)
+    return;
+  VkDebugUtilsLabelEXT label{};
+  label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+  label.pLabelName = name;
+  beginLabelFn(cmd, &label);
+}
+
+void trace::endLabel(VkCommandBuffer cmd) {
+  if (endLabelFn)
+    endLabelFn(cmd);
+}
@@ -1,11 +1,15 @@
 #define GLFW_INCLUDE_VULKAN
 
 #include "VulkanCore.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
 #include "vulkan/vulkan_core.h"
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <set>
 
 using namespace vulkan;
@@ -62,15 +66,25 @@ bool VulkanCore::checkValidationLayerSupport() const {
   return true;
 }
 
+// Verbose/info messages are only requested from the layers when the
+// validation log category would show them
+static VkDebugUtilsMessageSeverityFlagsEXT messengerSeverity() {
+  VkDebugUtilsMessageSeverityFlagsEXT severity =
+      VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+      VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+  if (logging::enabled(logging::Category::Validation, logging::Level::Debug))
+    severity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+                VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+  return severity;
+}
+
 void VulkanCore::setupDebugMessenger() {
   if (!_enableValidationLayers)
     return;
 
   VkDebugUtilsMessengerCreateInfoEXT createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-  createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-                               VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+  createInfo.messageSeverity = messengerSeverity();
   createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
                            VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
                            VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
@@ -79,7 +93,7 @@ void VulkanCore::setupDebugMessenger() {
 
   if (CreateDebugUtilsMessengerEXT(_instance, &createInfo, nullptr,
                                    &_debugMessenger) != VK_SUCCESS) {
-    std::cerr << "Failed to set up debug messenger\n";
+    LOG_WARN(Core, "Failed to set up debug messenger");
   }
 }
 
@@ -98,40 +112,164 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanCore::debugCallback(
 
   (void)messageType;
   (void)pUserData;
-  if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
-    std::cerr << "Validation ERROR: " << pCallbackData->pMessage << "\n";
-  } else if (messageSeverity &
-             VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
-    std::cerr << "Validation WARNING: " << pCallbackData->pMessage << "\n";
-  } else {
-    std::cout << "Validation: " << pCallbackData->pMessage << "\n";
-  }
+  // Queued for the log writer thread; repeats of one message ID are rate
+  // limited there
+  logging::Level level;
+  if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    level = logging::Level::Error;
+  else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    level = logging::Level::Warning;
+  else
+    level = logging::Level::Debug;
+  logging::validation(level, pCallbackData->messageIdNumber,
+                      pCallbackData->pMessageIdName, pCallbackData->pMessage);
   return VK_FALSE;
 }
 
 bool VulkanCore::initialize(GLFWwindow *window) {
+  return initializeInstance(window) && initializeDevice() &&
+         initializeFrameResources();
+}
+
+bool VulkanCore::initializeInstance(GLFWwindow *window) {
+  _window = window;
   if (!createInstance())
     return false;
   setupDebugMessenger();
-  if (!createSurface(window))
-    return false;
+  return createSurface(window);
+}
+
+bool VulkanCore::initializeDevice() {
   if (!pickPhysicalDevice())
     return false;
   if (!createLogicalDevice())
     return false;
+  if (!_bindless.create(_device, _profile,
+                        static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)))
+    return false;
+  _depthFormat = chooseDepthFormat();
+  if (_depthFormat == VK_FORMAT_UNDEFINED) {
+    LOG_ERROR(Core, "No supported depth format");
+    return false;
+  }
 
   _swapchainManager = std::make_unique<VulkanSwapchain>(
-      _device, _physicalDevice, _surface, window);
+      _device, _physicalDevice, _surface, _window);
+
+  // The scene is blitted into the swapchain image under dynamic resolution
+  // and when several views share it
+  bool canBlit =
+      (_resolutionSettings.enabled || _viewCount > 1) &&
+      supportsBlitUpscale(_swapchainManager->imageFormat()) &&
+      _swapchainManager->addImageUsage(VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+  _dynamicResolution = _resolutionSettings.enabled && canBlit;
+  if (_resolutionSettings.enabled && !_dynamicResolution)
+    LOG_WARN(Core, "Dynamic resolution unavailable (no blit support)");
+  resolveViews(canBlit);
+  resolveDepthSampling();
+  _swapchainCapture =
+      _swapchainManager->addImageUsage(VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+  if (!_swapchainCapture)
+    LOG_WARN(Core, "Swapchain images cannot be copied; frame capture disabled");
+  // The scene target carries its own depth when it is composed
+  if (!composesScene())
+    _swapchainManager->setDepthFormat(
+        _depthFormat, _depthSampling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+
+  // Dynamic rendering needs neither a render pass nor framebuffers. When
+  // the scene is composed the pass targets the scene image, which is read by
+  // the compose blit, and the swapchain images get no framebuffers.
+  VkImageLayout finalLayout = composesScene()
+                                  ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                  : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  if (!_dynamicRendering && !createRenderPass(finalLayout))
+    return false;
+
+  // Pipeline tasks read these while the main thread creates the swapchain.
+  // No GLFW query here: this may run on a worker.
+  _startupLayout = renderTargetLayout();
+  VkSurfaceCapabilitiesKHR capabilities;
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physicalDevice, _surface,
+                                            &capabilities);
+  _startupExtent = capabilities.currentExtent.width != UINT32_MAX
+                       ? capabilities.currentExtent
+                       : VkExtent2D{800, 600};
+  return true;
+}
 
-  if (!createRenderPass())
+bool VulkanCore::initializeFrameResources() {
+  if (!_swapchainManager->create(composesScene() ? VK_NULL_HANDLE
+                                                 : _renderPass))
     return false;
 
-  if (!_swapchainManager->create(_renderPass))
+  bool haveTimestamps =
+      _gpuTimer.create(_device, _physicalDevice, _graphicsFamily,
+                       static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+  if (_dynamicResolution) {
+    _governor = std::make_unique<FrameTimeGovernor>(_resolutionSettings);
+    if (!haveTimestamps)
+      LOG_WARN(Core, "GPU timestamps unavailable; governing on CPU frame time");
+  }
+  if (composesScene() && !createSceneTarget())
     return false;
 
+  _capture.create(_device, _physicalDevice,
+                  static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
   if (!createCommandPoolAndBuffers())
     return false;
-  if (!createDescriptorPool())
+  if (!createSyncObjects())
+    return false;
+  return true;
+}
+
+bool VulkanCore::initializeHeadless(VkExtent2D extent) {
+  _headless = true;
+  _headlessExtent = extent;
+
+  if (!createInstance())
+    return false;
+  setupDebugMessenger();
+  if (!pickPhysicalDevice())
+    return false;
+  if (!createLogicalDevice())
+    return false;
+  if (!_bindless.create(_device, _profile,
+                        static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)))
+    return false;
+  _depthFormat = chooseDepthFormat();
+  if (_depthFormat == VK_FORMAT_UNDEFINED) {
+    LOG_ERROR(Core, "No supported depth format");
+    return false;
+  }
+
+  resolveViews(supportsBlitUpscale(HEADLESS_FORMAT));
+  resolveDepthSampling();
+
+  // With one view the headless target doubles as the scene target, always
+  // at full scale; several are composed into a separate output image
+  if (!_dynamicRendering &&
+      !createRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL))
+    return false;
+  _startupLayout = renderTargetLayout();
+  _startupExtent = extent;
+  if (!createSceneTarget())
+    return false;
+  if (_viewCount > 1 &&
+      !createImage2D(_device, _physicalDevice, extent, HEADLESS_FORMAT,
+                     VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                         VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_IMAGE_ASPECT_COLOR_BIT, _headlessOutput)) {
+    LOG_ERROR(Core, "Failed to create headless output");
+    return false;
+  }
+
+  if (!_gpuTimer.create(_device, _physicalDevice, _graphicsFamily,
+                        static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)))
+    LOG_WARN(Core, "GPU timestamps unavailable");
+
+  _capture.create(_device, _physicalDevice,
+                  static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+  if (!createCommandPoolAndBuffers())
     return false;
   if (!createSyncObjects())
     return false;
@@ -142,6 +280,7 @@ VulkanCore::~VulkanCore() { cleanup(); }
 
 void VulkanCore::cleanup() {
   vkDeviceWaitIdle(_device);
+  _capture.destroy();
 
   for (auto f : _inFlightFences)
     vkDestroyFence(_device, f, nullptr);
@@ -150,8 +289,13 @@ void VulkanCore::cleanup() {
   for (auto s : _renderFinished)
     vkDestroySemaphore(_device, s, nullptr);
 
-  if (_descriptorPool)
-    vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+  _bindless.destroy();
+  _depthTexture = BINDLESS_INVALID;
+  _depthTextureView = VK_NULL_HANDLE;
+
+  _gpuTimer.destroy();
+  destroySceneTarget();
+  destroyImage(_device, _headlessOutput);
 
   if (_commandPool)
     vkDestroyCommandPool(_device, _commandPool, nullptr);
@@ -173,10 +317,22 @@ void VulkanCore::cleanup() {
     vkDestroyInstance(_instance, nullptr);
 }
 
+static bool instanceExtensionSupported(const char *name) {
+  uint32_t count = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+  std::vector<VkExtensionProperties> props(count);
+  vkEnumerateInstanceExtensionProperties(nullptr, &count, props.data());
+  for (const auto &p : props) {
+    if (std::strcmp(p.extensionName, name) == 0)
+      return true;
+  }
+  return false;
+}
+
 bool VulkanCore::createInstance() {
 
   if (_enableValidationLayers && !checkValidationLayerSupport()) {
-    std::cerr << "Validation layers requested, but not available!\n";
+    LOG_ERROR(Core, "Validation layers requested, but not available!");
     return false;
   }
 
@@ -188,11 +344,17 @@ bool VulkanCore::createInstance() {
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.apiVersion = VK_API_VERSION_1_2;
 
-  uint32_t glfwExtCount = 0;
-  const char **glfwExt = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-  std::vector<const char *> extensions(glfwExt, glfwExt + glfwExtCount);
+  std::vector<const char *> extensions;
+  if (!_headless) {
+    uint32_t glfwExtCount = 0;
+    const char **glfwExt = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+    extensions.assign(glfwExt, glfwExt + glfwExtCount);
+  }
 
-  if (_enableValidationLayers) {
+  // Debug utils also carries the command buffer labels emitted by trace zones
+  if (_enableValidationLayers ||
+      (VKAPP_TRACING && instanceExtensionSupported(
+                            VK_EXT_DEBUG_UTILS_EXTENSION_NAME))) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
   }
 
@@ -219,10 +381,7 @@ bool VulkanCore::createInstance() {
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
     debugCreateInfo.sType =
         VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-    debugCreateInfo.messageSeverity =
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-        VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+    debugCreateInfo.messageSeverity = messengerSeverity();
     debugCreateInfo.messageType =
         VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
         VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
@@ -235,16 +394,17 @@ bool VulkanCore::createInstance() {
   }
 
   if (vkCreateInstance(&createInfo, nullptr, &_instance) != VK_SUCCESS) {
-    std::cerr << "Failed to create instance\n";
+    LOG_ERROR(Core, "Failed to create instance");
     return false;
   }
+  trace::loadDebugLabels(_instance);
   return true;
 }
 
 bool VulkanCore::createSurface(GLFWwindow *windowPtr) {
   if (glfwCreateWindowSurface(_instance, windowPtr, nullptr, &_surface) !=
       VK_SUCCESS) {
-    std::cerr << "Failed to create window surface\n";
+    LOG_ERROR(Core, "Failed to create window surface");
     return false;
   }
   return true;
@@ -254,109 +414,179 @@ bool VulkanCore::pickPhysicalDevice() {
   uint32_t count = 0;
   vkEnumeratePhysicalDevices(_instance, &count, nullptr);
   if (count == 0) {
-    std::cerr << "No GPUs with Vulkan support\n";
+    LOG_ERROR(Core, "No GPUs with Vulkan support");
     return false;
   }
   std::vector<VkPhysicalDevice> devices(count);
   vkEnumeratePhysicalDevices(_instance, &count, devices.data());
 
-  // pick first suitable
-  for (auto dev : devices) {
-    // check swapchain support + required extensions
-    uint32_t extCount = 0;
-    vkEnumerateDeviceExtensionProperties(dev, nullptr, &extCount, nullptr);
-    std::vector<VkExtensionProperties> exts(extCount);
-    vkEnumerateDeviceExtensionProperties(dev, nullptr, &extCount, exts.data());
-
-    std::set<std::string> avail;
-    for (auto &e : exts)
-      avail.insert(e.extensionName);
-    bool ok = true;
-    for (auto req : deviceExtensions)
-      if (!avail.count(req)) {
-        ok = false;
-        break;
-      }
+  std::vector<const char *> required;
+  for (auto ext : deviceExtensions) {
+    if (!_headless || std::strcmp(ext, VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0)
+      required.push_back(ext);
+  }
 
-    if (!ok)
-      continue;
+  std::vector<DeviceProfile> candidates;
+  int best = -1;
+  for (auto dev : devices) {
+    candidates.push_back(DeviceProfile::query(dev, _surface, required));
+    const DeviceProfile &c = candidates.back();
+    int index = static_cast<int>(candidates.size()) - 1;
+    if (c.suitable) {
+      LOG_INFO(Core, "GPU %d: %s (%s, %llu MiB) score %d", index,
+               c.name.c_str(), c.typeName(),
+               static_cast<unsigned long long>(c.deviceLocalBytes >> 20),
+               c.score);
+      if (best < 0 || c.score > candidates[best].score)
+        best = index;
+    } else {
+      LOG_INFO(Core, "GPU %d: %s rejected: %s", index, c.name.c_str(),
+               c.rejectReason.c_str());
+    }
+  }
 
-    // surface capabilities check
-    VkBool32 supported = VK_FALSE;
-    vkGetPhysicalDeviceSurfaceSupportKHR(dev, 0, _surface, &supported);
-    // above is simplistic; just accept device if extensions present
-    _physicalDevice = dev;
-    break;
+  // An explicit selector wins over the score, but never picks a device that
+  // cannot run the renderer
+  std::string selector = _devicePreference;
+  if (selector.empty()) {
+    if (const char *env = std::getenv("VKAPP_GPU"))
+      selector = env;
+  }
+  if (!selector.empty()) {
+    int chosen = matchDeviceSelector(candidates, selector);
+    if (chosen < 0)
+      LOG_WARN(Core, "No GPU matches '%s'", selector.c_str());
+    else if (!candidates[chosen].suitable)
+      LOG_WARN(Core, "GPU '%s' is not suitable (%s)",
+               candidates[chosen].name.c_str(),
+               candidates[chosen].rejectReason.c_str());
+    else
+      best = chosen;
   }
 
-  if (_physicalDevice == VK_NULL_HANDLE) {
-    std::cerr << "Failed to find suitable GPU\n";
+  if (best < 0) {
+    LOG_ERROR(Core, "Failed to find suitable GPU");
     return false;
   }
+
+  _profile = candidates[best];
+  _physicalDevice = _profile.device;
+  _dynamicRendering = _dynamicRenderingRequested && _profile.dynamicRendering;
+  LOG_INFO(Core, "Using %s", _profile.name.c_str());
+  LOG_INFO(Core,
+           "Features: timeline semaphores %d, descriptor indexing %d, "
+           "draw indirect count %d, multi draw indirect %d, multiview %d",
+           _profile.timelineSemaphore, _profile.descriptorIndexing,
+           _profile.drawIndirectCount, _profile.multiDrawIndirect,
+           _profile.multiview);
+  LOG_INFO(Core, "Render path: %s",
+           _dynamicRendering ? "dynamic rendering" : "render pass");
   return true;
 }
 
 bool VulkanCore::createLogicalDevice() {
-  // find queue families
-  uint32_t qCount = 0;
-  vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount, nullptr);
-  std::vector<VkQueueFamilyProperties> qprops(qCount);
-  vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &qCount,
-                                           qprops.data());
-
-  int graphicsFamily = -1;
-  int presentFamily = -1;
-  for (uint32_t i = 0; i < qCount; i++) {
-    if (qprops[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
-      graphicsFamily = i;
-    VkBool32 present = VK_FALSE;
-    vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, i, _surface,
-                                         &present);
-    if (present)
-      presentFamily = i;
-  }
-  if (graphicsFamily < 0 || presentFamily < 0) {
-    std::cerr << "No suitable queue families\n";
-    return false;
-  }
-
-  // store the graphics family index for later use
-  _graphicsFamily = static_cast<uint32_t>(graphicsFamily);
-  _presentFamily = static_cast<uint32_t>(presentFamily);
+  _graphicsFamily = _profile.graphicsFamily;
+  _presentFamily = _headless ? _graphicsFamily : _profile.presentFamily;
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<int> uniqueFamilies = {graphicsFamily, presentFamily};
+  std::set<uint32_t> uniqueFamilies = {_graphicsFamily, _presentFamily};
   float qPriority = 1.0f;
-  for (int f : uniqueFamilies) {
+  for (uint32_t f : uniqueFamilies) {
     VkDeviceQueueCreateInfo qi{};
     qi.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    qi.queueFamilyIndex = static_cast<uint32_t>(f);
+    qi.queueFamilyIndex = f;
     qi.queueCount = 1;
     qi.pQueuePriorities = &qPriority;
     queueCreateInfos.push_back(qi);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures{};
+  std::vector<const char *> enabledExtensions;
+  for (auto ext : deviceExtensions) {
+    if (!_headless || std::strcmp(ext, VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0)
+      enabledExtensions.push_back(ext);
+  }
+
+  // Enable every optional feature the profile reports so subsystems can
+  // rely on profile() alone
+  VkPhysicalDeviceFeatures2 features{};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.features.multiDrawIndirect = _profile.multiDrawIndirect;
+  features.features.drawIndirectFirstInstance =
+      _profile.drawIndirectFirstInstance;
+  features.features.shaderInt64 = _profile.shaderInt64;
+  features.features.samplerAnisotropy = _profile.samplerAnisotropy;
+
+  VkPhysicalDeviceMultiviewFeatures multiview{};
+  multiview.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+  multiview.multiview = _profile.multiview;
+  features.pNext = &multiview;
+  void **next = &multiview.pNext;
+
+  VkPhysicalDeviceVulkan12Features v12{};
+  v12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  v12.timelineSemaphore = _profile.timelineSemaphore;
+  v12.drawIndirectCount = _profile.drawIndirectCount;
+  if (_profile.descriptorIndexing) {
+    v12.descriptorIndexing = VK_TRUE;
+    v12.runtimeDescriptorArray = VK_TRUE;
+    v12.descriptorBindingPartiallyBound = VK_TRUE;
+    v12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    v12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    v12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    v12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    v12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  }
+  if (_profile.timelineSemaphore || _profile.drawIndirectCount ||
+      _profile.descriptorIndexing) {
+    *next = &v12;
+    next = &v12.pNext;
+  }
+
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{};
+  dynamicRendering.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  dynamicRendering.dynamicRendering = VK_TRUE;
+  if (_dynamicRendering) {
+    enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    *next = &dynamicRendering;
+    next = &dynamicRendering.pNext;
+  }
+
+#ifdef VK_EXT_nested_command_buffer
+  VkPhysicalDeviceNestedCommandBufferFeaturesEXT nested{};
+  nested.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_NESTED_COMMAND_BUFFER_FEATURES_EXT;
+  nested.nestedCommandBuffer = VK_TRUE;
+  if (_dynamicRendering && _profile.nestedCommandBuffer) {
+    enabledExtensions.push_back(VK_EXT_NESTED_COMMAND_BUFFER_EXTENSION_NAME);
+    *next = &nested;
+  }
+#endif
+
   VkDeviceCreateInfo dci{};
   dci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  dci.pNext = &features;
   dci.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   dci.pQueueCreateInfos = queueCreateInfos.data();
-  dci.pEnabledFeatures = &deviceFeatures;
-  dci.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-  dci.ppEnabledExtensionNames = deviceExtensions.data();
-
-#ifdef __APPLE__
-  dci.pNext = nullptr;
-#endif
-  dci.pNext = nullptr;
+  dci.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+  dci.ppEnabledExtensionNames = enabledExtensions.data();
 
   if (vkCreateDevice(_physicalDevice, &dci, nullptr, &_device) != VK_SUCCESS) {
-    std::cerr << "Failed to create logical device\n";
+    LOG_ERROR(Core, "Failed to create logical device");
     return false;
   }
 
   vkGetDeviceQueue(_device, _graphicsFamily, 0, &_graphicsQueue);
   vkGetDeviceQueue(_device, _presentFamily, 0, &_presentQueue);
+
+  // Frame recording and submission skip the loader's trampolines from here
+  if (!dispatch.load(_device))
+    return false;
+  if (_dynamicRendering &&
+      (!dispatch.vkCmdBeginRenderingKHR || !dispatch.vkCmdEndRenderingKHR)) {
+    LOG_ERROR(Core, "Failed to load dynamic rendering entry points");
+    return false;
+  }
   return true;
 }
 
@@ -371,64 +601,120 @@ VulkanCore::chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &avail) {
 }
 
 bool VulkanCore::recreateSwapchain() {
+  if (_headless)
+    return true;
+  TRACE_ZONE("VulkanCore::recreateSwapchain");
   vkDeviceWaitIdle(_device);
 
-  // Let swapchain manager handle recreation
-  if (!_swapchainManager->recreate(_renderPass)) {
-    std::cerr << "Failed to recreate swapchain\n";
+  // Let swapchain manager handle recreation. Under dynamic rendering
+  // _renderPass is null and only the image views are rebuilt.
+  if (!_swapchainManager->recreate(composesScene() ? VK_NULL_HANDLE
+                                                   : _renderPass)) {
+    LOG_ERROR(Core, "Failed to recreate swapchain");
     return false;
   }
 
-  // Reallocate command buffers if needed (size might have changed)
+  if (composesScene()) {
+    destroySceneTarget();
+    if (!createSceneTarget())
+      return false;
+  }
+
+  // Command buffers are per swapchain image; keep them unless the image count
+  // changed
+  if (_commandBuffers.size() == frameResourceCount())
+    return true;
+
   vkFreeCommandBuffers(_device, _commandPool,
                        static_cast<uint32_t>(_commandBuffers.size()),
                        _commandBuffers.data());
-
-  _commandBuffers.resize(_swapchainManager->imageCount());
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.commandPool = _commandPool;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
-
-  if (vkAllocateCommandBuffers(_device, &allocInfo, _commandBuffers.data()) !=
-      VK_SUCCESS) {
-    std::cerr << "Failed to reallocate command buffers\n";
+  if (!allocateCommandBuffers()) {
+    LOG_ERROR(Core, "Failed to reallocate command buffers");
     return false;
   }
 
   return true;
 }
 
-bool VulkanCore::createRenderPass() {
+bool VulkanCore::createRenderPass(VkImageLayout finalLayout) {
   VkAttachmentDescription colorAtt{};
-  colorAtt.format = _swapchainManager->imageFormat();
+  colorAtt.format = swapchainImageFormat();
   colorAtt.samples = VK_SAMPLE_COUNT_1_BIT;
   colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   colorAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAtt.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAtt.finalLayout = finalLayout;
+
+  // Depth is cleared every frame and never read back
+  VkAttachmentDescription depthAtt{};
+  depthAtt.format = _depthFormat;
+  depthAtt.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAtt.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  VkAttachmentDescription attachments[] = {colorAtt, depthAtt};
 
   VkAttachmentReference colorRef{};
   colorRef.attachment = 0;
   colorRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference depthRef{};
+  depthRef.attachment = 1;
+  depthRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
   VkSubpassDescription subpass{};
   subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &colorRef;
+  subpass.pDepthStencilAttachment = &depthRef;
+
+  // The shared depth image is still written by the previous frame
+  VkSubpassDependency dependencies[2] = {};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  // Color writes and the final layout transition happen before transfers
+  // after the pass (upscale blit, frame capture copy)
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
 
   VkRenderPassCreateInfo rpci{};
   rpci.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-  rpci.attachmentCount = 1;
-  rpci.pAttachments = &colorAtt;
+  rpci.attachmentCount = 2;
+  rpci.pAttachments = attachments;
   rpci.subpassCount = 1;
   rpci.pSubpasses = &subpass;
+  rpci.dependencyCount = 2;
+  rpci.pDependencies = dependencies;
+
+  // Every view of the subpass at once; the views are rendered from nearby
+  // cameras, so the implementation may share work between them
+  uint32_t mask = viewMask();
+  VkRenderPassMultiviewCreateInfo multiview{};
+  multiview.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+  multiview.subpassCount = 1;
+  multiview.pViewMasks = &mask;
+  multiview.correlationMaskCount = 1;
+  multiview.pCorrelationMasks = &mask;
+  if (mask)
+    rpci.pNext = &multiview;
 
   if (vkCreateRenderPass(_device, &rpci, nullptr, &_renderPass) != VK_SUCCESS) {
-    std::cerr << "failed to create render pass\n";
+    LOG_ERROR(Core, "failed to create render pass");
     return false;
   }
   return true;
@@ -443,7 +729,17 @@ bool VulkanCore::createCommandPoolAndBuffers() {
   if (vkCreateCommandPool(_device, &cpci, nullptr, &_commandPool) != VK_SUCCESS)
     return false;
 
-  _commandBuffers.resize(_swapchainManager->framebuffers().size());
+  return allocateCommandBuffers();
+}
+
+auto VulkanCore::frameResourceCount() const -> uint32_t {
+  // Headless frames cycle through frame-in-flight slots, not images
+  return _headless ? static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)
+                   : _swapchainManager->imageCount();
+}
+
+bool VulkanCore::allocateCommandBuffers() {
+  _commandBuffers.resize(frameResourceCount());
   VkCommandBufferAllocateInfo cbai{};
   cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   cbai.commandPool = _commandPool;
@@ -455,27 +751,6 @@ bool VulkanCore::createCommandPoolAndBuffers() {
   return true;
 }
 
-bool VulkanCore::createDescriptorPool() {
-  VkDescriptorPoolSize poolSizes[1]{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount =
-      static_cast<uint32_t>(_swapchainManager->framebuffers().size());
-
-  VkDescriptorPoolCreateInfo dpci{};
-  dpci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  dpci.poolSizeCount = 1;
-  dpci.pPoolSizes = poolSizes;
-  dpci.maxSets =
-      static_cast<uint32_t>(_swapchainManager->framebuffers().size());
-
-  if (vkCreateDescriptorPool(_device, &dpci, nullptr, &_descriptorPool) !=
-      VK_SUCCESS) {
-    std::cerr << "failed to create descriptor pool\n";
-    return false;
-  }
-  return true;
-}
-
 bool VulkanCore::createSyncObjects() {
   _imageAvailable.resize(MAX_FRAMES_IN_FLIGHT);
   _renderFinished.resize(MAX_FRAMES_IN_FLIGHT);
@@ -501,57 +776,339 @@ bool VulkanCore::createSyncObjects() {
   return true;
 }
 
+void VulkanCore::beginRendering(VkCommandBuffer cmd, VkImageView colorView,
+                                VkExtent2D extent,
+                                const VkClearValue &clearColor,
+                                VkImageView depthView,
+                                uint32_t viewMask) const {
+  cmdBeginRendering(cmd, colorView, extent, &clearColor, depthView, viewMask);
+}
+
+void VulkanCore::cmdBeginRendering(VkCommandBuffer cmd, VkImageView colorView,
+                                   VkExtent2D extent,
+                                   const VkClearValue *clearColor,
+                                   VkImageView depthView,
+                                   uint32_t viewMask,
+                                   VkRenderingFlagsKHR flags) const {
+  VkAttachmentLoadOp loadOp =
+      clearColor ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+  VkRenderingAttachmentInfoKHR colorAttachment{};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  colorAttachment.imageView = colorView;
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.loadOp = loadOp;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  if (clearColor)
+    colorAttachment.clearValue = *clearColor;
+
+  // Depth outlives the pass only when a split pass samples it
+  VkRenderingAttachmentInfoKHR depthAttachment{};
+  depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  depthAttachment.imageView = depthView;
+  depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.loadOp = loadOp;
+  depthAttachment.storeOp = _depthSampling ? VK_ATTACHMENT_STORE_OP_STORE
+                                           : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.clearValue.depthStencil = {1.0f, 0};
+
+  VkRenderingInfoKHR renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+  renderingInfo.flags = flags;
+  renderingInfo.renderArea.offset = {0, 0};
+  renderingInfo.renderArea.extent = extent;
+  renderingInfo.layerCount = 1; // ignored under multiview
+  renderingInfo.viewMask = viewMask;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  if (depthView)
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+  dispatch.vkCmdBeginRenderingKHR(cmd, &renderingInfo);
+}
+
+void VulkanCore::endRendering(VkCommandBuffer cmd) const {
+  dispatch.vkCmdEndRenderingKHR(cmd);
+}
+
+// Discards the previous frame's depth once its tests have finished
+void VulkanCore::cmdBeginDepth(VkCommandBuffer cmd, VkImage depthImage) const {
+  cmdTransitionImage(cmd, depthImage, VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                     VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                         VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     VK_IMAGE_ASPECT_DEPTH_BIT);
+}
+
+bool VulkanCore::splitPass(
+    VkCommandBuffer cmd,
+    const std::function<void(VkCommandBuffer, const SceneDepth &)> &between) {
+  if (!_depthSampling || !_activePass.depth)
+    return false;
+  const ActivePass pass = _activePass;
+  endRendering(cmd);
+
+  // The swapchain depth is rebuilt on resize
+  if (pass.depth != _depthTextureView) {
+    if (_depthTexture != BINDLESS_INVALID)
+      _bindless.release(BindlessDescriptors::SampledImage, _depthTexture);
+    _depthTexture = _bindless.registerSampledImage(
+        pass.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    _depthTextureView = pass.depth;
+  }
+
+  cmdTransitionImage(cmd, pass.depthImage,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                     VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_ASPECT_DEPTH_BIT);
+  between(cmd, SceneDepth{_depthTexture, pass.extent});
+  cmdTransitionImage(cmd, pass.depthImage,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                     VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                     VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                         VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                     VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                         VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                     VK_IMAGE_ASPECT_DEPTH_BIT);
+
+  // Separate passes: the first half's color writes must land before the
+  // second half blends over them
+  VkMemoryBarrier colorWrites{};
+  colorWrites.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  colorWrites.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  colorWrites.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                              VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd,
+                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                0, 1, &colorWrites, 0, nullptr, 0, nullptr);
+  cmdBeginRendering(cmd, pass.color, pass.extent, nullptr, pass.depth, 0);
+  return true;
+}
+
+#ifdef VK_EXT_nested_command_buffer
+static constexpr VkRenderingFlagsKHR MIXED_CONTENTS =
+    VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR |
+    VK_RENDERING_CONTENTS_INLINE_BIT_EXT;
+#else
+// Unreachable: the profile never reports nested command buffers
+static constexpr VkRenderingFlagsKHR MIXED_CONTENTS =
+    VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+#endif
+
+// With nested command buffers a static buffer and the inline commands share
+// the one clearing pass, so the replay costs no pass break
+void VulkanCore::beginScenePass(
+    VkCommandBuffer cmd, const VkClearValue &clearColor,
+    const std::function<VkCommandBuffer()> &staticFunc) {
+  const ActivePass &pass = _activePass;
+  VkCommandBuffer secondary =
+      staticFunc && canExecuteStatic() ? staticFunc() : VK_NULL_HANDLE;
+  if (!secondary) {
+    cmdBeginRendering(cmd, pass.color, pass.extent, &clearColor, pass.depth,
+                      pass.viewMask);
+    return;
+  }
+  cmdBeginRendering(cmd, pass.color, pass.extent, &clearColor, pass.depth,
+                    pass.viewMask, MIXED_CONTENTS);
+  dispatch.vkCmdExecuteCommands(cmd, 1, &secondary);
+  // Executing a secondary leaves the primary's bound state undefined
+  _bindless.bind(cmd);
+}
+
+auto VulkanCore::chooseDepthFormat(bool sampled) const -> VkFormat {
+  // D16 and one of the 24/32-bit formats are guaranteed as attachments
+  const VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT,
+                                 VK_FORMAT_X8_D24_UNORM_PACK32,
+                                 VK_FORMAT_D16_UNORM};
+  VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  if (sampled)
+    required |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  for (VkFormat format : candidates) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &props);
+    if ((props.optimalTilingFeatures & required) == required)
+      return format;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+
+// Settles depth sampling against the device and the settled views; may
+// switch to a depth format that can be sampled
+void VulkanCore::resolveDepthSampling() {
+  if (!_depthSamplingRequested)
+    return;
+  VkFormat sampled = chooseDepthFormat(true);
+  if (!_dynamicRendering)
+    LOG_WARN(Core, "Depth sampling needs dynamic rendering; disabled");
+  else if (_viewCount > 1)
+    LOG_WARN(Core, "Depth sampling needs a single view; disabled");
+  else if (!_bindless.valid())
+    LOG_WARN(Core, "Depth sampling needs bindless descriptors; disabled");
+  else if (sampled == VK_FORMAT_UNDEFINED)
+    LOG_WARN(Core, "No depth format can be sampled; depth sampling disabled");
+  else {
+    _depthFormat = sampled;
+    _depthSampling = true;
+  }
+}
+
 bool VulkanCore::drawFrame(
-    const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc) {
-  vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame], VK_TRUE,
-                  UINT64_MAX);
+    const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc,
+    const std::function<void(VkCommandBuffer)> &prepareFunc,
+    const std::function<VkCommandBuffer()> &staticFunc) {
+  TRACE_ZONE("VulkanCore::drawFrame");
+  if (_headless)
+    return drawFrameHeadless(recordFunc, prepareFunc, staticFunc);
+
+  {
+    TRACE_ZONE("WaitForFrameFence");
+    dispatch.vkWaitForFences(_device, 1, &_inFlightFences[_currentFrame],
+                             VK_TRUE, UINT64_MAX);
+  }
   uint32_t imageIndex;
-  VkResult res = vkAcquireNextImageKHR(
-      _device, *_swapchainManager->swapchain(), UINT64_MAX,
-      _imageAvailable[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+  VkResult res;
+  {
+    TRACE_ZONE("AcquireNextImage");
+    res = dispatch.vkAcquireNextImageKHR(
+        _device, *_swapchainManager->swapchain(), UINT64_MAX,
+        _imageAvailable[_currentFrame], VK_NULL_HANDLE, &imageIndex);
+  }
   if (res == VK_ERROR_OUT_OF_DATE_KHR)
     return false;
   if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR) {
-    std::cerr << "failed to acquire image\n";
+    LOG_ERROR(Core, "failed to acquire image");
     return false;
   }
 
-  vkResetFences(_device, 1, &_inFlightFences[_currentFrame]);
+  dispatch.vkResetFences(_device, 1, &_inFlightFences[_currentFrame]);
+
+  // CPU frame time, start to start; also the governor's input when the
+  // queue has no timestamps
+  auto frameStart = std::chrono::steady_clock::now();
+  float cpuFrameMs = 0.0f;
+  if (_lastFrameStart.time_since_epoch().count() != 0)
+    cpuFrameMs = std::chrono::duration<float, std::milli>(frameStart -
+                                                          _lastFrameStart)
+                     .count();
+  _lastFrameStart = frameStart;
+
+  // This frame slot's previous timestamps are complete once its fence has
+  // signaled, so the scale for this frame is picked before recording
+  uint32_t frame = static_cast<uint32_t>(_currentFrame);
+  float gpuMs = 0.0f;
+  bool haveGpuTime = _gpuTimer.collect(frame, gpuMs);
+  if (haveGpuTime)
+    _lastGpuMs = gpuMs;
+  _capture.collect(frame);
+  _bindless.beginFrame(frame);
+  if (_dynamicResolution)
+    updateRenderScale(cpuFrameMs, gpuMs, haveGpuTime);
 
   // record command buffer: begin, begin renderpass, user callback, end
   // renderpass, end
   VkCommandBuffer cmd = _commandBuffers[imageIndex];
-  vkResetCommandBuffer(cmd, 0);
+  dispatch.vkResetCommandBuffer(cmd, 0);
 
   VkCommandBufferBeginInfo binfo{};
   binfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-  vkBeginCommandBuffer(cmd, &binfo);
-
-  VkClearValue clearColor{{{0.0f, 0.0f, 0.0f, 1.0f}}};
-  VkRenderPassBeginInfo rpbi{};
-  rpbi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  rpbi.renderPass = _renderPass;
-  rpbi.framebuffer = _swapchainManager->framebuffer(imageIndex);
-  rpbi.renderArea.offset = {0, 0};
-  rpbi.renderArea.extent = _swapchainManager->extent();
-  rpbi.clearValueCount = 1;
-  rpbi.pClearValues = &clearColor;
-
-  vkCmdBeginRenderPass(cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
+  dispatch.vkBeginCommandBuffer(cmd, &binfo);
 
-  // user records draw commands here
-  recordFunc(cmd, imageIndex);
+  _gpuTimer.begin(cmd, frame);
+  _bindless.bind(cmd);
+  if (prepareFunc)
+    prepareFunc(cmd);
 
-  vkCmdEndRenderPass(cmd);
-  vkEndCommandBuffer(cmd);
+  VkClearValue clearColor{{{0.0f, 0.0f, 0.0f, 1.0f}}};
+  if (composesScene()) {
+    recordScene(cmd, imageIndex, clearColor, recordFunc, staticFunc);
+    // Before the compose blit, which waits on the acquire
+    _gpuTimer.end(cmd, frame);
+    VkImage image = _swapchainManager->image(imageIndex);
+    ImageSyncState state{VK_IMAGE_LAYOUT_UNDEFINED,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    recordCompose(cmd, image, _swapchainManager->extent(), state);
+    recordCapture(cmd, image, _swapchainManager->extent(), state);
+    cmdTransitionImage(cmd, image, state.layout,
+                       VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, state.stage,
+                       state.access, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+  } else if (_dynamicRendering) {
+    TRACE_GPU_ZONE(cmd, "Scene");
+    VkImage image = _swapchainManager->image(imageIndex);
+    cmdTransitionImage(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED,
+                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    cmdBeginDepth(cmd, _swapchainManager->depthTarget().image);
+
+    _activePass = {_swapchainManager->imageView(imageIndex),
+                   _swapchainManager->depthTarget().image,
+                   _swapchainManager->depthTarget().view,
+                   _swapchainManager->extent()};
+    beginScenePass(cmd, clearColor, staticFunc);
+    recordFunc(cmd, imageIndex);
+    endRendering(cmd);
+    _activePass = {};
+    _gpuTimer.end(cmd, frame);
+
+    ImageSyncState state{VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+    recordCapture(cmd, image, _swapchainManager->extent(), state);
+    cmdTransitionImage(cmd, image, state.layout,
+                       VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, state.stage,
+                       state.access, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+  } else {
+    VkRenderPassBeginInfo rpbi{};
+    rpbi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rpbi.renderPass = _renderPass;
+    rpbi.framebuffer = _swapchainManager->framebuffer(imageIndex);
+    rpbi.renderArea.offset = {0, 0};
+    rpbi.renderArea.extent = _swapchainManager->extent();
+    VkClearValue clearValues[2] = {clearColor, {}};
+    clearValues[1].depthStencil = {1.0f, 0};
+    rpbi.clearValueCount = 2;
+    rpbi.pClearValues = clearValues;
+
+    TRACE_GPU_ZONE(cmd, "Scene");
+    dispatch.vkCmdBeginRenderPass(cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
+
+    // user records draw commands here
+    recordFunc(cmd, imageIndex);
+
+    dispatch.vkCmdEndRenderPass(cmd);
+    _gpuTimer.end(cmd, frame);
+
+    // The pass left the image in PRESENT_SRC, ordered before transfers
+    VkImage image = _swapchainManager->image(imageIndex);
+    ImageSyncState state{VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    recordCapture(cmd, image, _swapchainManager->extent(), state);
+    if (state.layout != VK_IMAGE_LAYOUT_PRESENT_SRC_KHR)
+      cmdTransitionImage(cmd, image, state.layout,
+                         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, state.stage,
+                         state.access, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+  }
+  dispatch.vkEndCommandBuffer(cmd);
 
   VkSemaphore waitSem = _imageAvailable[_currentFrame];
   VkSemaphore signalSem = _renderFinished[_currentFrame];
   VkSubmitInfo submit{};
   submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   VkSemaphore waitSems[] = {waitSem};
+  // The swapchain image is first touched by the compose blit when the scene
+  // is rendered offscreen, otherwise by color attachment output
   VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+      composesScene() ? VK_PIPELINE_STAGE_TRANSFER_BIT
+                      : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
   submit.waitSemaphoreCount = 1;
   submit.pWaitSemaphores = waitSems;
   submit.pWaitDstStageMask = waitStages;
@@ -560,11 +1117,17 @@ bool VulkanCore::drawFrame(
   submit.signalSemaphoreCount = 1;
   submit.pSignalSemaphores = &signalSem;
 
-  if (vkQueueSubmit(_graphicsQueue, 1, &submit,
-                    _inFlightFences[_currentFrame]) != VK_SUCCESS) {
-    std::cerr << "failed to submit draw command buffer\n";
-    return false;
+  {
+    TRACE_ZONE("QueueSubmit");
+    if (dispatch.vkQueueSubmit(_graphicsQueue, 1, &submit,
+                               _inFlightFences[_currentFrame]) != VK_SUCCESS) {
+      LOG_ERROR(Core, "failed to submit draw command buffer");
+      return false;
+    }
   }
+  _lastCpuRecordMs = std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - frameStart)
+                         .count();
 
   VkPresentInfoKHR present{};
   present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -574,14 +1137,417 @@ bool VulkanCore::drawFrame(
   present.pSwapchains = _swapchainManager->swapchain();
   present.pImageIndices = &imageIndex;
 
-  res = vkQueuePresentKHR(_presentQueue, &present);
+  {
+    TRACE_ZONE("QueuePresent");
+    res = dispatch.vkQueuePresentKHR(_presentQueue, &present);
+  }
   if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR)
     return false;
   if (res != VK_SUCCESS) {
-    std::cerr << "failed to present swapchain image\n";
+    LOG_ERROR(Core, "failed to present swapchain image");
+    return false;
+  }
+
+  _currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  return true;
+}
+
+bool VulkanCore::drawFrameHeadless(
+    const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc,
+    const std::function<void(VkCommandBuffer)> &prepareFunc,
+    const std::function<VkCommandBuffer()> &staticFunc) {
+  uint32_t frame = static_cast<uint32_t>(_currentFrame);
+  {
+    TRACE_ZONE("WaitForFrameFence");
+    dispatch.vkWaitForFences(_device, 1, &_inFlightFences[frame], VK_TRUE,
+                             UINT64_MAX);
+  }
+  auto recordStart = std::chrono::steady_clock::now();
+
+  float gpuMs = 0.0f;
+  if (_gpuTimer.collect(frame, gpuMs))
+    _lastGpuMs = gpuMs;
+  _capture.collect(frame);
+  _bindless.beginFrame(frame);
+
+  dispatch.vkResetFences(_device, 1, &_inFlightFences[frame]);
+
+  VkCommandBuffer cmd = _commandBuffers[frame];
+  dispatch.vkResetCommandBuffer(cmd, 0);
+
+  VkCommandBufferBeginInfo binfo{};
+  binfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  dispatch.vkBeginCommandBuffer(cmd, &binfo);
+  _gpuTimer.begin(cmd, frame);
+  _bindless.bind(cmd);
+  if (prepareFunc)
+    prepareFunc(cmd);
+
+  VkClearValue clearColor{{{0.0f, 0.0f, 0.0f, 1.0f}}};
+  recordScene(cmd, frame, clearColor, recordFunc, staticFunc);
+  _gpuTimer.end(cmd, frame);
+  // recordScene made the target readable by transfers
+  ImageSyncState state{VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+  if (_viewCount > 1) {
+    state = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+    recordCompose(cmd, _headlessOutput.image, _headlessExtent, state);
+    cmdTransitionImage(cmd, _headlessOutput.image, state.layout,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, state.stage,
+                       state.access, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT);
+    state = {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+             VK_PIPELINE_STAGE_TRANSFER_BIT, 0};
+  }
+  recordCapture(cmd, headlessTarget().image, _headlessExtent, state);
+  dispatch.vkEndCommandBuffer(cmd);
+
+  VkSubmitInfo submit{};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &cmd;
+  if (dispatch.vkQueueSubmit(_graphicsQueue, 1, &submit,
+                             _inFlightFences[frame]) != VK_SUCCESS) {
+    LOG_ERROR(Core, "failed to submit headless command buffer");
     return false;
   }
+  _lastCpuRecordMs = std::chrono::duration<float, std::milli>(
+                         std::chrono::steady_clock::now() - recordStart)
+                         .count();
 
   _currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
   return true;
-}
\ No newline at end of file
+}
+
+bool VulkanCore::readHeadlessTarget(std::vector<uint8_t> &rgba) {
+  const ImageResource &target = headlessTarget();
+  if (!_headless || !FrameCapture::supportsFormat(target.format))
+    return false;
+  vkDeviceWaitIdle(_device);
+
+  VkExtent2D size = _headlessExtent;
+  size_t pixels = size_t(size.width) * size.height;
+  BufferResource readback;
+  if (!createBuffer(_device, _physicalDevice, pixels * 4,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    readback))
+    return false;
+
+  VkCommandBufferAllocateInfo cbai{};
+  cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbai.commandPool = _commandPool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = 1;
+  VkCommandBuffer cmd;
+  vkAllocateCommandBuffers(_device, &cbai, &cmd);
+
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  dispatch.vkBeginCommandBuffer(cmd, &begin);
+  // drawFrame left the target in TRANSFER_SRC_OPTIMAL
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {size.width, size.height, 1};
+  dispatch.vkCmdCopyImageToBuffer(cmd, target.image,
+                                  VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                  readback.buffer, 1, &region);
+  dispatch.vkEndCommandBuffer(cmd);
+
+  VkSubmitInfo submit{};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &cmd;
+  bool ok = dispatch.vkQueueSubmit(_graphicsQueue, 1, &submit,
+                                   VK_NULL_HANDLE) == VK_SUCCESS;
+  dispatch.vkQueueWaitIdle(_graphicsQueue);
+  if (ok) {
+    rgba.resize(pixels * 4);
+    FrameCapture::toRgba(target.format, readback.mapped, pixels,
+                         rgba.data());
+  } else {
+    LOG_ERROR(Core, "Failed to submit the headless readback");
+  }
+  vkFreeCommandBuffers(_device, _commandPool, 1, &cmd);
+  destroyBuffer(_device, readback);
+  return ok;
+}
+
+// ============ Dynamic resolution and views ============
+
+bool VulkanCore::supportsBlitUpscale(VkFormat format) const {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(_physicalDevice, format, &props);
+  VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  return (props.optimalTilingFeatures & needed) == needed;
+}
+
+// Settles the requested views against the device; canCompose says whether
+// the scene target can be blitted into the output image
+void VulkanCore::resolveViews(bool canCompose) {
+  if (_viewCount > 1 && !canCompose) {
+    LOG_WARN(Core, "Cannot compose %u views (no blit support); rendering one",
+             _viewCount);
+    _viewCount = 1;
+  }
+  if (_viewCount == 1 || _viewMode != ViewMode::Multiview)
+    return;
+
+  // Renderers read per-view constants from bindless buffers by view index
+  if (!_profile.multiview)
+    LOG_WARN(Core, "Multiview unsupported; rendering views in separate passes");
+  else if (_viewCount > _profile.maxMultiviewViewCount)
+    LOG_WARN(Core,
+             "Multiview limited to %u views; rendering %u in separate passes",
+             _profile.maxMultiviewViewCount, _viewCount);
+  else if (!_bindless.valid())
+    LOG_WARN(Core, "Multiview needs bindless descriptors; rendering views in "
+                   "separate passes");
+  else
+    return;
+  _viewMode = ViewMode::PerViewPasses;
+}
+
+auto VulkanCore::viewExtent() const -> VkExtent2D {
+  VkExtent2D full = extent();
+  return {std::max(1u, full.width / _viewCount), full.height};
+}
+
+bool VulkanCore::createSceneTarget() {
+  VkExtent2D view = viewExtent();
+  float maxScale = _dynamicResolution ? _resolutionSettings.maxScale : 1.0f;
+  VkExtent2D target;
+  target.width = std::max(1u, static_cast<uint32_t>(view.width * maxScale));
+  target.height = std::max(1u, static_cast<uint32_t>(view.height * maxScale));
+
+  if (!createImage2D(_device, _physicalDevice, target,
+                     swapchainImageFormat(),
+                     VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                         VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                     VK_IMAGE_ASPECT_COLOR_BIT, _sceneTarget, _viewCount)) {
+    LOG_ERROR(Core, "Failed to create scene target");
+    return false;
+  }
+  VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  if (_depthSampling)
+    depthUsage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+  if (!createImage2D(_device, _physicalDevice, target, _depthFormat,
+                     depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT, _sceneDepth,
+                     _viewCount)) {
+    LOG_ERROR(Core, "Failed to create scene depth target");
+    return false;
+  }
+
+  // One pass over the whole array, or one per layer through layer views
+  bool perLayer = _viewCount > 1 && !usesMultiview();
+  _scenePasses.resize(perLayer ? _viewCount : 1);
+  for (uint32_t v = 0; v < _scenePasses.size(); v++) {
+    ScenePass &pass = _scenePasses[v];
+    if (perLayer) {
+      pass.color = createLayerView(_device, _sceneTarget, v,
+                                   VK_IMAGE_ASPECT_COLOR_BIT);
+      pass.depth =
+          createLayerView(_device, _sceneDepth, v, VK_IMAGE_ASPECT_DEPTH_BIT);
+      if (!pass.color || !pass.depth)
+        return false;
+    } else {
+      pass.color = _sceneTarget.view;
+      pass.depth = _sceneDepth.view;
+    }
+    if (_dynamicRendering)
+      continue;
+
+    // Multiview framebuffers have one layer; the view mask picks the rest
+    VkImageView attachments[] = {pass.color, pass.depth};
+    VkFramebufferCreateInfo fci{};
+    fci.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fci.renderPass = _renderPass;
+    fci.attachmentCount = 2;
+    fci.pAttachments = attachments;
+    fci.width = target.width;
+    fci.height = target.height;
+    fci.layers = 1;
+    if (vkCreateFramebuffer(_device, &fci, nullptr, &pass.framebuffer) !=
+        VK_SUCCESS) {
+      LOG_ERROR(Core, "Failed to create scene framebuffer");
+      return false;
+    }
+  }
+
+  // Start at the governor's current scale
+  float scale = renderScale();
+  _renderExtent.width = std::clamp(
+      static_cast<uint32_t>(std::lround(view.width * scale)), 1u, target.width);
+  _renderExtent.height =
+      std::clamp(static_cast<uint32_t>(std::lround(view.height * scale)), 1u,
+                 target.height);
+  return true;
+}
+
+void VulkanCore::destroySceneTarget() {
+  for (ScenePass &pass : _scenePasses) {
+    if (pass.framebuffer)
+      vkDestroyFramebuffer(_device, pass.framebuffer, nullptr);
+    // Layer views only; a single pass borrows the target's own views
+    if (pass.color && pass.color != _sceneTarget.view)
+      vkDestroyImageView(_device, pass.color, nullptr);
+    if (pass.depth && pass.depth != _sceneDepth.view)
+      vkDestroyImageView(_device, pass.depth, nullptr);
+  }
+  _scenePasses.clear();
+  destroyImage(_device, _sceneTarget);
+  destroyImage(_device, _sceneDepth);
+}
+
+void VulkanCore::updateRenderScale(float cpuFrameMs, float gpuMs,
+                                   bool haveGpuTime) {
+  if (!haveGpuTime)
+    gpuMs = cpuFrameMs;
+  if (gpuMs <= 0.0f)
+    return; // first frame: nothing measured yet
+
+  float scale = _governor->update(gpuMs);
+  VkExtent2D view = viewExtent();
+  _renderExtent.width =
+      std::clamp(static_cast<uint32_t>(std::lround(view.width * scale)), 1u,
+                 _sceneTarget.extent.width);
+  _renderExtent.height =
+      std::clamp(static_cast<uint32_t>(std::lround(view.height * scale)), 1u,
+                 _sceneTarget.extent.height);
+
+  if (_resolutionSettings.logInterval == 0)
+    return;
+  _logCpuMs += cpuFrameMs;
+  _logGpuMs += gpuMs;
+  if (++_logFrames < _resolutionSettings.logInterval)
+    return;
+
+  LOG_INFO(Core,
+           "Dynamic resolution: scale %.2f (%ux%u), %s%.2f ms, frame %.2f ms, "
+           "budget %.2f ms",
+           scale, _renderExtent.width, _renderExtent.height,
+           haveGpuTime ? "gpu " : "cpu-estimated gpu ", _logGpuMs / _logFrames,
+           _logCpuMs / _logFrames, _resolutionSettings.frameBudgetMs);
+  _logCpuMs = 0.0;
+  _logGpuMs = 0.0;
+  _logFrames = 0;
+}
+
+void VulkanCore::recordScene(
+    VkCommandBuffer cmd, uint32_t imageIndex, const VkClearValue &clearColor,
+    const std::function<void(VkCommandBuffer, uint32_t)> &recordFunc,
+    const std::function<VkCommandBuffer()> &staticFunc) {
+  TRACE_GPU_ZONE(cmd, "Scene");
+  // The previous frame's compose blit still reads the scene target
+  if (_dynamicRendering) {
+    cmdTransitionImage(cmd, _sceneTarget.image, VK_IMAGE_LAYOUT_UNDEFINED,
+                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    cmdBeginDepth(cmd, _sceneDepth.image);
+
+    for (uint32_t v = 0; v < _scenePasses.size(); v++) {
+      _viewIndex = v;
+      _activePass = {_scenePasses[v].color, _sceneDepth.image,
+                     _scenePasses[v].depth, _renderExtent, viewMask()};
+      beginScenePass(cmd, clearColor, staticFunc);
+      recordFunc(cmd, imageIndex);
+      endRendering(cmd);
+    }
+    _viewIndex = 0;
+    _activePass = {};
+
+    cmdTransitionImage(cmd, _sceneTarget.image,
+                       VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_READ_BIT);
+    return;
+  }
+
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+  VkRenderPassBeginInfo rpbi{};
+  rpbi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  rpbi.renderPass = _renderPass;
+  rpbi.renderArea.offset = {0, 0};
+  rpbi.renderArea.extent = _renderExtent;
+  VkClearValue clearValues[2] = {clearColor, {}};
+  clearValues[1].depthStencil = {1.0f, 0};
+  rpbi.clearValueCount = 2;
+  rpbi.pClearValues = clearValues;
+
+  for (uint32_t v = 0; v < _scenePasses.size(); v++) {
+    _viewIndex = v;
+    rpbi.framebuffer = _scenePasses[v].framebuffer;
+    dispatch.vkCmdBeginRenderPass(cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
+    recordFunc(cmd, imageIndex);
+    dispatch.vkCmdEndRenderPass(cmd);
+  }
+  _viewIndex = 0;
+
+  // The render pass already left the image in TRANSFER_SRC; make the color
+  // writes visible to the blit
+  cmdTransitionImage(cmd, _sceneTarget.image,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_READ_BIT);
+}
+
+// Blits view v of the scene target, upscaled, into the v-th of equal
+// columns of output; state tracks output and ends in TRANSFER_DST
+void VulkanCore::recordCompose(VkCommandBuffer cmd, VkImage output,
+                               VkExtent2D extent, ImageSyncState &state) {
+  TRACE_GPU_ZONE(cmd, "Compose");
+  cmdTransitionImage(cmd, output, state.layout,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, state.stage,
+                     state.access, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT);
+
+  VkImageBlit blits[MAX_VIEWS] = {};
+  for (uint32_t v = 0; v < _viewCount; v++) {
+    VkImageBlit &blit = blits[v];
+    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.baseArrayLayer = v;
+    blit.srcSubresource.layerCount = 1;
+    blit.srcOffsets[1] = {static_cast<int32_t>(_renderExtent.width),
+                          static_cast<int32_t>(_renderExtent.height), 1};
+    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.dstSubresource.layerCount = 1;
+    blit.dstOffsets[0] = {static_cast<int32_t>(extent.width * v / _viewCount),
+                          0, 0};
+    blit.dstOffsets[1] = {
+        static_cast<int32_t>(extent.width * (v + 1) / _viewCount),
+        static_cast<int32_t>(extent.height), 1};
+  }
+  dispatch.vkCmdBlitImage(cmd, _sceneTarget.image,
+                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, output,
+                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, _viewCount,
+                          blits, VK_FILTER_LINEAR);
+
+  state = {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+           VK_ACCESS_TRANSFER_WRITE_BIT};
+}
+
+// ============ Frame capture ============
+
+void VulkanCore::recordCapture(VkCommandBuffer cmd, VkImage image,
+                               VkExtent2D extent, ImageSyncState &state) {
+  if (!_capture.wanted() || (!_headless && !_swapchainCapture))
+    return;
+  _capture.record(cmd, frameIndex(), image, swapchainImageFormat(), extent,
+                  state);
+}
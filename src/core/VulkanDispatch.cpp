@@ -0,0 +1,23 @@
+#include "VulkanDispatch.hpp"
+#include "Log.hpp"
+
+using namespace vulkan;
+
+DeviceDispatch vulkan::dispatch;
+
+auto DeviceDispatch::load(VkDevice device) -> bool {
+  bool complete = true;
+#define VKAPP_LOAD_REQUIRED(name)                                              \
+  name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));     \
+  if (!name) {                                                                 \
+    LOG_ERROR(Core, "Device has no %s", #name);                                \
+    complete = false;                                                          \
+  }
+#define VKAPP_LOAD_OPTIONAL(name)                                              \
+  name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));
+  VKAPP_DEVICE_FUNCTIONS(VKAPP_LOAD_REQUIRED)
+  VKAPP_DEVICE_OPTIONAL_FUNCTIONS(VKAPP_LOAD_OPTIONAL)
+#undef VKAPP_LOAD_REQUIRED
+#undef VKAPP_LOAD_OPTIONAL
+  return complete;
+}
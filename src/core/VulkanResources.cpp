@@ -0,0 +1,178 @@
+#include "VulkanResources.hpp"
+#include "VulkanDispatch.hpp"
+#include <iostream>
+
+using namespace vulkan;
+
+auto vulkan::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits,
+                            VkMemoryPropertyFlags properties) -> uint32_t {
+  VkPhysicalDeviceMemoryProperties memProps;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+  for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+    if ((typeBits & (1u << i)) &&
+        (memProps.memoryTypes[i].propertyFlags & properties) == properties)
+      return i;
+  }
+  return UINT32_MAX;
+}
+
+auto vulkan::createImage2D(VkDevice device, VkPhysicalDevice physicalDevice,
+                           VkExtent2D extent, VkFormat format,
+                           VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                           ImageResource &out, uint32_t layers) -> bool {
+  VkImageCreateInfo ici{};
+  ici.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  ici.imageType = VK_IMAGE_TYPE_2D;
+  ici.format = format;
+  ici.extent = {extent.width, extent.height, 1};
+  ici.mipLevels = 1;
+  ici.arrayLayers = layers;
+  ici.samples = VK_SAMPLE_COUNT_1_BIT;
+  ici.tiling = VK_IMAGE_TILING_OPTIMAL;
+  ici.usage = usage;
+  ici.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  ici.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  if (vkCreateImage(device, &ici, nullptr, &out.image) != VK_SUCCESS) {
+    std::cerr << "Failed to create image\n";
+    return false;
+  }
+
+  VkMemoryRequirements req;
+  vkGetImageMemoryRequirements(device, out.image, &req);
+  VkMemoryAllocateInfo mai{};
+  mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  mai.allocationSize = req.size;
+  mai.memoryTypeIndex = findMemoryType(physicalDevice, req.memoryTypeBits,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (mai.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(device, &mai, nullptr, &out.memory) != VK_SUCCESS) {
+    std::cerr << "Failed to allocate image memory\n";
+    destroyImage(device, out);
+    return false;
+  }
+  vkBindImageMemory(device, out.image, out.memory, 0);
+
+  VkImageViewCreateInfo ivci{};
+  ivci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  ivci.image = out.image;
+  ivci.viewType =
+      layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+  ivci.format = format;
+  ivci.subresourceRange.aspectMask = aspect;
+  ivci.subresourceRange.levelCount = 1;
+  ivci.subresourceRange.layerCount = layers;
+  if (vkCreateImageView(device, &ivci, nullptr, &out.view) != VK_SUCCESS) {
+    std::cerr << "Failed to create image view\n";
+    destroyImage(device, out);
+    return false;
+  }
+
+  out.format = format;
+  out.extent = extent;
+  out.layers = layers;
+  return true;
+}
+
+auto vulkan::createLayerView(VkDevice device, const ImageResource &image,
+                             uint32_t layer, VkImageAspectFlags aspect)
+    -> VkImageView {
+  VkImageViewCreateInfo ivci{};
+  ivci.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  ivci.image = image.image;
+  ivci.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  ivci.format = image.format;
+  ivci.subresourceRange.aspectMask = aspect;
+  ivci.subresourceRange.levelCount = 1;
+  ivci.subresourceRange.baseArrayLayer = layer;
+  ivci.subresourceRange.layerCount = 1;
+  VkImageView view;
+  if (vkCreateImageView(device, &ivci, nullptr, &view) != VK_SUCCESS) {
+    std::cerr << "Failed to create image layer view\n";
+    return VK_NULL_HANDLE;
+  }
+  return view;
+}
+
+void vulkan::destroyImage(VkDevice device, ImageResource &image) {
+  if (image.view)
+    vkDestroyImageView(device, image.view, nullptr);
+  if (image.image)
+    vkDestroyImage(device, image.image, nullptr);
+  if (image.memory)
+    vkFreeMemory(device, image.memory, nullptr);
+  image = ImageResource{};
+}
+
+auto vulkan::createBuffer(VkDevice device, VkPhysicalDevice physicalDevice,
+                          VkDeviceSize size, VkBufferUsageFlags usage,
+                          VkMemoryPropertyFlags properties, BufferResource &out)
+    -> bool {
+  VkBufferCreateInfo bci{};
+  bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bci.size = size;
+  bci.usage = usage;
+  bci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  if (vkCreateBuffer(device, &bci, nullptr, &out.buffer) != VK_SUCCESS) {
+    std::cerr << "Failed to create buffer\n";
+    return false;
+  }
+
+  VkMemoryRequirements req;
+  vkGetBufferMemoryRequirements(device, out.buffer, &req);
+  VkMemoryAllocateInfo mai{};
+  mai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  mai.allocationSize = req.size;
+  mai.memoryTypeIndex =
+      findMemoryType(physicalDevice, req.memoryTypeBits, properties);
+  if (mai.memoryTypeIndex == UINT32_MAX ||
+      vkAllocateMemory(device, &mai, nullptr, &out.memory) != VK_SUCCESS) {
+    std::cerr << "Failed to allocate buffer memory\n";
+    destroyBuffer(device, out);
+    return false;
+  }
+  vkBindBufferMemory(device, out.buffer, out.memory, 0);
+
+  if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+      vkMapMemory(device, out.memory, 0, VK_WHOLE_SIZE, 0, &out.mapped) !=
+          VK_SUCCESS) {
+    std::cerr << "Failed to map buffer memory\n";
+    destroyBuffer(device, out);
+    return false;
+  }
+  out.size = size;
+  return true;
+}
+
+void vulkan::destroyBuffer(VkDevice device, BufferResource &buffer) {
+  if (buffer.buffer)
+    vkDestroyBuffer(device, buffer.buffer, nullptr);
+  if (buffer.memory)
+    vkFreeMemory(device, buffer.memory, nullptr); // implicitly unmaps
+  buffer = BufferResource{};
+}
+
+void vulkan::cmdTransitionImage(VkCommandBuffer cmd, VkImage image,
+                                VkImageLayout oldLayout,
+                                VkImageLayout newLayout,
+                                VkPipelineStageFlags srcStage,
+                                VkAccessFlags srcAccess,
+                                VkPipelineStageFlags dstStage,
+                                VkAccessFlags dstAccess,
+                                VkImageAspectFlags aspect) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = aspect;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+  dispatch.vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0,
+                                nullptr, 1, &barrier);
+}
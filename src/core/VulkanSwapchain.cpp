@@ -1,6 +1,7 @@
 #include "VulkanSwapchain.hpp"
+#include "Log.hpp"
+#include "Trace.hpp"
 #include <algorithm>
-#include <iostream>
 #include <limits>
 
 using namespace vulkan;
@@ -21,7 +22,7 @@ auto VulkanSwapchain::querySurfaceCapabilities() -> bool {
   vkGetPhysicalDeviceSurfaceFormatsKHR(_physicalDevice, _surface, &formatCount,
                                        nullptr);
   if (formatCount == 0) {
-    std::cerr << "No surface formats available\n";
+    LOG_ERROR(Swapchain, "No surface formats available");
     return false;
   }
   std::vector<VkSurfaceFormatKHR> formats(formatCount);
@@ -41,7 +42,18 @@ auto VulkanSwapchain::querySurfaceCapabilities() -> bool {
   _chosenPresentMode = choosePresentMode(presentModes);
   _imageFormat = _chosenFormat.format; // Expose format early
 
-  std::cout << "Swapchain format selected: " << _imageFormat << "\n";
+  LOG_INFO(Swapchain, "Swapchain format selected: %d",
+           static_cast<int>(_imageFormat));
+  return true;
+}
+
+auto VulkanSwapchain::addImageUsage(VkImageUsageFlags usage) -> bool {
+  VkSurfaceCapabilitiesKHR capabilities;
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_physicalDevice, _surface,
+                                            &capabilities);
+  if ((capabilities.supportedUsageFlags & usage) != usage)
+    return false;
+  _imageUsage |= usage;
   return true;
 }
 
@@ -50,18 +62,22 @@ bool VulkanSwapchain::create(VkRenderPass renderPass) {
     return false;
   if (!createImageViews())
     return false;
-  if (!createFramebuffers(renderPass))
+  if (!createDepthTarget())
+    return false;
+  if (renderPass != VK_NULL_HANDLE && !createFramebuffers(renderPass))
     return false;
   return true;
 }
 
 bool VulkanSwapchain::recreate(VkRenderPass renderPass) {
-  // Wait for window to have valid size (handle minimization)
+  TRACE_ZONE("VulkanSwapchain::recreate");
+  // A minimized window has no area to build images for; the caller waits
+  // for a size instead of this blocking inside the resize path
   int width = 0, height = 0;
   glfwGetFramebufferSize(_window, &width, &height);
-  while (width == 0 || height == 0) {
-    glfwGetFramebufferSize(_window, &width, &height);
-    glfwWaitEvents();
+  if (width == 0 || height == 0) {
+    LOG_WARN(Swapchain, "Not recreated: the window has no area");
+    return false;
   }
 
   vkDeviceWaitIdle(_device);
@@ -70,10 +86,8 @@ bool VulkanSwapchain::recreate(VkRenderPass renderPass) {
   _oldSwapchain = _swapchain;
 
   // Clean up dependent resources
-  for (auto fb : _framebuffers) {
-    vkDestroyFramebuffer(_device, fb, nullptr);
-  }
-  _framebuffers.clear();
+  destroyFramebuffers();
+  destroyImage(_device, _depth);
 
   for (auto iv : _imageViews) {
     vkDestroyImageView(_device, iv, nullptr);
@@ -86,7 +100,9 @@ bool VulkanSwapchain::recreate(VkRenderPass renderPass) {
     return false;
   if (!createImageViews())
     return false;
-  if (!createFramebuffers(renderPass))
+  if (!createDepthTarget())
+    return false;
+  if (renderPass != VK_NULL_HANDLE && !createFramebuffers(renderPass))
     return false;
 
   // Destroy old swapchain after new one is created
@@ -99,10 +115,8 @@ bool VulkanSwapchain::recreate(VkRenderPass renderPass) {
 }
 
 void VulkanSwapchain::cleanup() {
-  for (auto fb : _framebuffers) {
-    vkDestroyFramebuffer(_device, fb, nullptr);
-  }
-  _framebuffers.clear();
+  destroyFramebuffers();
+  destroyImage(_device, _depth);
 
   for (auto iv : _imageViews) {
     vkDestroyImageView(_device, iv, nullptr);
@@ -126,7 +140,7 @@ bool VulkanSwapchain::createSwapchain() {
   vkGetPhysicalDeviceSurfaceFormatsKHR(_physicalDevice, _surface, &formatCount,
                                        nullptr);
   if (formatCount == 0) {
-    std::cerr << "No surface formats available\n";
+    LOG_ERROR(Swapchain, "No surface formats available");
     return false;
   }
   std::vector<VkSurfaceFormatKHR> formats(formatCount);
@@ -162,7 +176,7 @@ bool VulkanSwapchain::createSwapchain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
-  createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  createInfo.imageUsage = _imageUsage;
 
   // For simplicity, assume graphics and present are same queue family
   createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -177,7 +191,7 @@ bool VulkanSwapchain::createSwapchain() {
 
   if (vkCreateSwapchainKHR(_device, &createInfo, nullptr, &_swapchain) !=
       VK_SUCCESS) {
-    std::cerr << "Failed to create swapchain\n";
+    LOG_ERROR(Swapchain, "Failed to create swapchain");
     return false;
   }
 
@@ -190,8 +204,8 @@ bool VulkanSwapchain::createSwapchain() {
   _imageFormat = surfaceFormat.format;
   _extent = extent;
 
-  std::cout << "Swapchain created: " << _extent.width << "x" << _extent.height
-            << " (" << imageCount << " images)\n";
+  LOG_INFO(Swapchain, "Swapchain created: %ux%u (%u images)", _extent.width,
+           _extent.height, imageCount);
 
   return true;
 }
@@ -217,7 +231,8 @@ bool VulkanSwapchain::createImageViews() {
 
     if (vkCreateImageView(_device, &createInfo, nullptr, &_imageViews[i]) !=
         VK_SUCCESS) {
-      std::cerr << "Failed to create image view " << i << "\n";
+      LOG_ERROR(Swapchain, "Failed to create image view %zu",
+                static_cast<size_t>(i));
       return false;
     }
   }
@@ -225,16 +240,29 @@ bool VulkanSwapchain::createImageViews() {
   return true;
 }
 
+bool VulkanSwapchain::createDepthTarget() {
+  if (_depthFormat == VK_FORMAT_UNDEFINED)
+    return true;
+  // One image serves every swapchain image: frames on the queue are ordered
+  // by the barrier each frame records before clearing it
+  if (!createImage2D(_device, _physicalDevice, _extent, _depthFormat,
+                     _depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT, _depth)) {
+    LOG_ERROR(Swapchain, "Failed to create depth target");
+    return false;
+  }
+  return true;
+}
+
 bool VulkanSwapchain::createFramebuffers(VkRenderPass renderPass) {
   _framebuffers.resize(_imageViews.size());
 
   for (size_t i = 0; i < _imageViews.size(); i++) {
-    VkImageView attachments[] = {_imageViews[i]};
+    VkImageView attachments[] = {_imageViews[i], _depth.view};
 
     VkFramebufferCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
     createInfo.renderPass = renderPass;
-    createInfo.attachmentCount = 1;
+    createInfo.attachmentCount = _depth.view ? 2 : 1;
     createInfo.pAttachments = attachments;
     createInfo.width = _extent.width;
     createInfo.height = _extent.height;
@@ -242,7 +270,8 @@ bool VulkanSwapchain::createFramebuffers(VkRenderPass renderPass) {
 
     if (vkCreateFramebuffer(_device, &createInfo, nullptr, &_framebuffers[i]) !=
         VK_SUCCESS) {
-      std::cerr << "Failed to create framebuffer " << i << "\n";
+      LOG_ERROR(Swapchain, "Failed to create framebuffer %zu",
+                static_cast<size_t>(i));
       return false;
     }
   }
@@ -250,6 +279,13 @@ bool VulkanSwapchain::createFramebuffers(VkRenderPass renderPass) {
   return true;
 }
 
+void VulkanSwapchain::destroyFramebuffers() {
+  for (auto fb : _framebuffers) {
+    vkDestroyFramebuffer(_device, fb, nullptr);
+  }
+  _framebuffers.clear();
+}
+
 VkSurfaceFormatKHR VulkanSwapchain::chooseFormat(
     const std::vector<VkSurfaceFormatKHR> &available) {
   // Prefer SRGB if available
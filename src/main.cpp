@@ -1,8 +1,19 @@
+#include <cstring>
 #include <iostream>
 #include "VkApp.hpp"
 
-int main() {
-    VkApp app;
+int main(int argc, char **argv) {
+    AppConfig config = AppConfig::load("vkapp.cfg");
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--gpu") == 0 && i + 1 < argc) {
+            config.gpu = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--gpu index|name]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    VkApp app(config);
 
     if (!app.initialize()) {
         std::cerr << "Failed to initialize the application." << std::endl;
@@ -0,0 +1,137 @@
+#include "DepthPyramid.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace vulkan;
+
+// HiZBuild.slang
+struct PyramidPushConstants {
+  uint32_t source;
+  uint32_t pyramid;
+  uint32_t sourceSize[2];
+  uint32_t sourceOffset;
+  uint32_t targetOffset;
+  uint32_t targetSize[2];
+};
+
+static constexpr uint32_t GROUP_SIZE = 8;
+
+static auto floorPow2(uint32_t v) -> uint32_t {
+  uint32_t p = 1;
+  while (p * 2 <= v)
+    p *= 2;
+  return p;
+}
+
+static auto levelSize(uint32_t size0, uint32_t level) -> uint32_t {
+  return std::max(size0 >> level, 1u);
+}
+
+DepthPyramid::DepthPyramid(VkDevice device, VkPhysicalDevice physicalDevice,
+                           BindlessDescriptors &bindless,
+                           VkPipelineCache pipelineCache,
+                           const std::vector<char> &initCode,
+                           const std::vector<char> &reduceCode)
+    : _device(device), _bindless(bindless), _pipelineCache(pipelineCache) {
+  if (!bindless.valid())
+    throw std::runtime_error("depth pyramid needs bindless descriptors");
+  _init = createPipeline(initCode);
+  _reduce = createPipeline(reduceCode);
+
+  // A full chain over MAX_SIZE^2 is under 4/3 of level 0
+  VkDeviceSize texels = VkDeviceSize(MAX_SIZE) * MAX_SIZE * 4 / 3 + 32;
+  if (!createBuffer(_device, physicalDevice, texels * sizeof(float),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _buffer))
+    throw std::runtime_error("failed to create depth pyramid buffer");
+  _index = bindless.registerStorageBuffer(_buffer.buffer);
+  if (_index == BINDLESS_INVALID)
+    throw std::runtime_error("no bindless slot for the depth pyramid");
+}
+
+DepthPyramid::~DepthPyramid() {
+  if (_index != BINDLESS_INVALID)
+    _bindless.release(BindlessDescriptors::StorageBuffer, _index);
+  destroyBuffer(_device, _buffer);
+  if (_init)
+    vkDestroyPipeline(_device, _init, nullptr);
+  if (_reduce)
+    vkDestroyPipeline(_device, _reduce, nullptr);
+}
+
+auto DepthPyramid::createPipeline(const std::vector<char> &code)
+    -> VkPipeline {
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+  VkShaderModule module;
+  if (vkCreateShaderModule(_device, &moduleInfo, nullptr, &module) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create depth pyramid shader module");
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = module;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = _bindless.pipelineLayout();
+  VkPipeline pipeline;
+  VkResult result = vkCreateComputePipelines(_device, _pipelineCache, 1,
+                                             &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(_device, module, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create depth pyramid pipeline");
+  return pipeline;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd, BindlessIndex depth,
+                         VkExtent2D extent) {
+  TRACE_GPU_ZONE(cmd, "DepthPyramid");
+  _width = std::min(floorPow2(std::max(extent.width, 1u)), MAX_SIZE);
+  _height = std::min(floorPow2(std::max(extent.height, 1u)), MAX_SIZE);
+  _levels = 1;
+  while ((std::max(_width, _height) >> _levels) > 0)
+    _levels++;
+
+  VkMemoryBarrier levelDone{};
+  levelDone.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  levelDone.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  levelDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  PyramidPushConstants pc{};
+  pc.source = depth;
+  pc.pyramid = _index;
+  pc.sourceSize[0] = extent.width;
+  pc.sourceSize[1] = extent.height;
+  uint32_t offset = 0;
+  for (uint32_t level = 0; level < _levels; level++) {
+    uint32_t w = levelSize(_width, level), h = levelSize(_height, level);
+    if (level > 0) {
+      dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                    &levelDone, 0, nullptr, 0, nullptr);
+      pc.source = _index;
+      pc.sourceSize[0] = levelSize(_width, level - 1);
+      pc.sourceSize[1] = levelSize(_height, level - 1);
+      pc.sourceOffset = pc.targetOffset;
+    }
+    dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                               level == 0 ? _init : _reduce);
+    pc.targetOffset = offset;
+    pc.targetSize[0] = w;
+    pc.targetSize[1] = h;
+    dispatch.vkCmdPushConstants(cmd, _bindless.pipelineLayout(),
+                                VK_SHADER_STAGE_ALL, 0, sizeof(pc), &pc);
+    dispatch.vkCmdDispatch(cmd, (w + GROUP_SIZE - 1) / GROUP_SIZE,
+                           (h + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+    offset += w * h;
+  }
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                &levelDone, 0, nullptr, 0, nullptr);
+}
@@ -1,8 +1,19 @@
 #include "GridRenderer.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 
+// Closest the camera height gets to the plane when picking grid levels
+static constexpr float GRID_MIN_HEIGHT = 0.01f;
+// Finer active level has cells ~10x the camera height apart at the level
+// switch, matching the old fixed 0.1 scale at the default camera height
+static constexpr float GRID_LOD_BIAS = 1.0f;
+
 static std::vector<char> readFile(const std::string &filename) {
   std::ifstream file(filename, std::ios::ate | std::ios::binary);
   if (!file.is_open()) {
@@ -16,21 +27,152 @@ static std::vector<char> readFile(const std::string &filename) {
   return buffer;
 }
 
-GridRenderer::GridRenderer(VkDevice device, VkRenderPass renderPass,
-                           VkExtent2D extent)
-    : _device(device), _renderPass(renderPass), _extent(extent) {
-  createPipeline();
+auto GridVariant::operator==(const GridVariant &other) const -> bool {
+  return levels == other.levels && fadeStart == other.fadeStart &&
+         fadeEnd == other.fadeEnd && axes == other.axes &&
+         axisWidth == other.axisWidth && color == other.color &&
+         opacity == other.opacity;
+}
+
+auto GridShaders::load(bool multiview) -> GridShaders {
+  TRACE_ZONE("GridShaders::load");
+  GridShaders shaders;
+  shaders.vertex = readFile("build/shaders/grid.vert.spv");
+  shaders.fragment = readFile("build/shaders/grid.frag.spv");
+  if (multiview) {
+    shaders.multiviewVertex = readFile("build/shaders/grid_multiview.vert.spv");
+    shaders.multiviewFragment =
+        readFile("build/shaders/grid_multiview.frag.spv");
+  }
+  return shaders;
+}
+
+GridRenderer::GridRenderer(VkDevice device, const RenderTargetLayout &target,
+                           VkExtent2D extent, VkPipelineCache pipelineCache,
+                           const GridShaders *shaders,
+                           VkPipelineLayout sharedLayout,
+                           const GridVariant &variant)
+    : _device(device), _target(target), _extent(extent),
+      _pipelineCache(pipelineCache) {
+  if (sharedLayout) {
+    // Push constant ranges of the shared layout cover every stage
+    _pipelineLayout = sharedLayout;
+    _ownsLayout = false;
+    _pushStages = VK_SHADER_STAGE_ALL;
+  } else {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = _pushStages;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(GridPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr,
+                               &_pipelineLayout) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline layout");
+    }
+  }
+
+  bool multiview = target.viewMask != 0;
+  GridShaders loaded;
+  if (!shaders || (multiview && shaders->multiviewVertex.empty())) {
+    loaded = GridShaders::load(multiview);
+    shaders = &loaded;
+  }
+  _vertModule = loadShaderModule(multiview ? shaders->multiviewVertex
+                                           : shaders->vertex);
+  _fragModule = loadShaderModule(multiview ? shaders->multiviewFragment
+                                           : shaders->fragment);
+  _variants.emplace_back(variant, createPipeline(variant));
 }
 
 GridRenderer::~GridRenderer() {
-  if (_graphicsPipeline)
-    vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
-  if (_pipelineLayout)
+  for (auto &[variant, pipeline] : _variants)
+    vkDestroyPipeline(_device, pipeline, nullptr);
+  if (_vertModule)
+    vkDestroyShaderModule(_device, _vertModule, nullptr);
+  if (_fragModule)
+    vkDestroyShaderModule(_device, _fragModule, nullptr);
+  if (_pipelineLayout && _ownsLayout)
     vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+  for (size_t i = 0; i < _viewBuffers.size(); i++) {
+    _bindless->release(vulkan::BindlessDescriptors::StorageBuffer,
+                       _viewIndices[i]);
+    vulkan::destroyBuffer(_device, _viewBuffers[i]);
+  }
+}
+
+void GridRenderer::enableMultiview(VkPhysicalDevice physicalDevice,
+                                   vulkan::BindlessDescriptors &bindless,
+                                   uint32_t framesInFlight) {
+  if (!bindless.valid() || _ownsLayout)
+    throw std::runtime_error("multiview grid needs the bindless layout");
+  createViewBuffers(physicalDevice, bindless, framesInFlight);
 }
 
-VkShaderModule GridRenderer::loadShaderModule(const char *path) {
-  auto code = readFile(path);
+void GridRenderer::enableStatic(VkPhysicalDevice physicalDevice,
+                                vulkan::BindlessDescriptors &bindless,
+                                uint32_t framesInFlight,
+                                uint32_t queueFamily) {
+  if (!bindless.valid() || _ownsLayout)
+    throw std::runtime_error("static grid needs the bindless layout");
+  createViewBuffers(physicalDevice, bindless, framesInFlight);
+  if (!_static.create(_device, queueFamily, framesInFlight, _target))
+    throw std::runtime_error("failed to create static grid pass");
+
+  // The multiview entry points read the buffer already; the single-view
+  // ones are switched over by recompiling the variants built so far
+  if (_target.viewMask == 0 && !_viewFromBuffer) {
+    _viewFromBuffer = true;
+    for (auto &[variant, pipeline] : _variants) {
+      vkDestroyPipeline(_device, pipeline, nullptr);
+      pipeline = createPipeline(variant);
+    }
+  }
+}
+
+// Shared by multiview and static passes; created by whichever comes first
+void GridRenderer::createViewBuffers(VkPhysicalDevice physicalDevice,
+                                     vulkan::BindlessDescriptors &bindless,
+                                     uint32_t framesInFlight) {
+  if (!_viewBuffers.empty())
+    return;
+  _bindless = &bindless;
+  _viewBuffers.resize(framesInFlight);
+  _viewIndices.resize(framesInFlight, vulkan::BINDLESS_INVALID);
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    if (!vulkan::createBuffer(_device, physicalDevice,
+                              GRID_VIEW_SIZE * MAX_VIEWS,
+                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                              _viewBuffers[i]))
+      throw std::runtime_error("failed to create grid view buffers");
+    _viewIndices[i] = bindless.registerStorageBuffer(_viewBuffers[i].buffer);
+    if (_viewIndices[i] == vulkan::BINDLESS_INVALID)
+      throw std::runtime_error("no bindless slot for grid view buffers");
+  }
+}
+
+void GridRenderer::setVariant(const GridVariant &variant) {
+  for (size_t i = 0; i < _variants.size(); i++) {
+    if (_variants[i].first == variant) {
+      if (_active != i)
+        _drawStateVersion++;
+      _active = i;
+      return;
+    }
+  }
+  _variants.emplace_back(variant, createPipeline(variant));
+  _active = _variants.size() - 1;
+  _drawStateVersion++;
+}
+
+VkShaderModule GridRenderer::loadShaderModule(const std::vector<char> &code) {
+  TRACE_ZONE("GridRenderer::loadShaderModule");
   VkShaderModuleCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
   createInfo.codeSize = code.size();
@@ -39,27 +181,56 @@ VkShaderModule GridRenderer::loadShaderModule(const char *path) {
   VkShaderModule shaderModule;
   if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) !=
       VK_SUCCESS) {
-    throw std::runtime_error(std::string("failed to create shader module: ") +
-                             path);
+    throw std::runtime_error("failed to create grid shader module");
   }
   return shaderModule;
 }
 
-void GridRenderer::createPipeline() {
-  VkShaderModule vertModule = loadShaderModule("build/shaders/grid.vert.spv");
-  VkShaderModule fragModule = loadShaderModule("build/shaders/grid.frag.spv");
+auto GridRenderer::createPipeline(const GridVariant &variant) -> VkPipeline {
+  TRACE_ZONE("GridRenderer::createPipeline");
+
+  // Laid out in constant_id order; booleans are VkBool32
+  struct Constants {
+    uint32_t levels;
+    float fadeStart, fadeEnd;
+    VkBool32 axes;
+    float axisWidth;
+    float color[3];
+    float opacity;
+    VkBool32 viewFromBuffer;
+  } constants{std::clamp(variant.levels, 1u, 2u),
+              variant.fadeStart,
+              variant.fadeEnd,
+              variant.axes ? VK_TRUE : VK_FALSE,
+              variant.axisWidth,
+              {variant.color.r, variant.color.g, variant.color.b},
+              variant.opacity,
+              _viewFromBuffer ? VK_TRUE : VK_FALSE};
+  constexpr uint32_t count = sizeof(Constants) / 4;
+  static_assert(count == 10, "one 4-byte value per constant_id in Grid.slang");
+  VkSpecializationMapEntry entries[count];
+  for (uint32_t i = 0; i < count; i++)
+    entries[i] = {i, i * 4u, 4};
+
+  VkSpecializationInfo specialization{};
+  specialization.mapEntryCount = count;
+  specialization.pMapEntries = entries;
+  specialization.dataSize = sizeof(Constants);
+  specialization.pData = &constants;
 
   VkPipelineShaderStageCreateInfo vertStage{};
   vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
-  vertStage.module = vertModule;
+  vertStage.module = _vertModule;
   vertStage.pName = "main";
+  vertStage.pSpecializationInfo = &specialization;
 
   VkPipelineShaderStageCreateInfo fragStage{};
   fragStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-  fragStage.module = fragModule;
+  fragStage.module = _fragModule;
   fragStage.pName = "main";
+  fragStage.pSpecializationInfo = &specialization;
 
   VkPipelineShaderStageCreateInfo stages[] = {vertStage, fragStage};
 
@@ -69,13 +240,9 @@ void GridRenderer::createPipeline() {
   VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
   inputAssembly.sType =
       VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
-
-#ifdef __APPLE__
-  inputAssembly.primitiveRestartEnable = VK_TRUE;
-#else
+  // Up to three triangles fanning the horizon-clipped quad
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
   inputAssembly.primitiveRestartEnable = VK_FALSE;
-#endif
 
   std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT,
                                                VK_DYNAMIC_STATE_SCISSOR};
@@ -127,21 +294,12 @@ void GridRenderer::createPipeline() {
   colorBlending.attachmentCount = 1;
   colorBlending.pAttachments = &colorBlendAttachment;
 
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags =
-      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(GridPushConstants);
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-  if (vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr,
-                             &_pipelineLayout) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create pipeline layout");
-  }
+  // Drawn first over the cleared target; the plane doesn't occlude meshes
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = VK_FALSE;
+  depthStencil.depthWriteEnable = VK_FALSE;
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -153,23 +311,137 @@ void GridRenderer::createPipeline() {
   pipelineInfo.pRasterizationState = &rasterizer;
   pipelineInfo.pMultisampleState = &multisampling;
   pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDepthStencilState = &depthStencil;
   pipelineInfo.pDynamicState = &dynamicState;
   pipelineInfo.layout = _pipelineLayout;
-  pipelineInfo.renderPass = _renderPass;
-  pipelineInfo.subpass = 0;
 
-  if (vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo,
-                                nullptr, &_graphicsPipeline) != VK_SUCCESS) {
+  VkPipelineRenderingCreateInfoKHR renderingInfo{};
+  applyRenderTarget(pipelineInfo, renderingInfo, _target);
+
+  VkPipeline pipeline;
+  if (vkCreateGraphicsPipelines(_device, _pipelineCache, 1, &pipelineInfo,
+                                nullptr, &pipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
+  return pipeline;
+}
+
+auto GridRenderer::makeConstants(const Camera &camera) -> GridPushConstants {
+  return makeConstants(camera.getViewProjectionMatrix(), camera.getPosition());
+}
+
+auto GridRenderer::makeConstants(const glm::mat4 &viewProj,
+                                 const glm::vec3 &cameraPos)
+    -> GridPushConstants {
+  GridPushConstants constants{};
+  constants.invViewProj = glm::inverse(viewProj);
+  constants.cameraPos = cameraPos;
+
+  // Level selection: one decade per level, blended by the fractional part so
+  // the finer level fades out as the camera climbs towards the next switch
+  float height = std::max(std::abs(constants.cameraPos.y), GRID_MIN_HEIGHT);
+  float level = std::log10(height) + GRID_LOD_BIAS;
+  float baseLevel = std::floor(level);
+  constants.gridScale = std::pow(10.0f, -baseLevel);
+  constants.lodBlend = level - baseLevel;
+  constants.fadeScale = std::pow(10.0f, -level);
+
+  // Horizon: directions d on the plane (n.d = 0) project through the x, y, w
+  // rows of viewProj, p = M d, so the vanishing line is l = M^-T n
+  glm::mat3 m;
+  for (int c = 0; c < 3; ++c) {
+    m[c][0] = viewProj[c][0];
+    m[c][1] = viewProj[c][1];
+    m[c][2] = viewProj[c][3];
+  }
+  glm::vec3 line = glm::transpose(glm::inverse(m)) * glm::vec3(0, 1, 0);
 
-  vkDestroyShaderModule(_device, vertModule, nullptr);
-  vkDestroyShaderModule(_device, fragModule, nullptr);
+  // The ground is on the side whose rays head towards the plane
+  float side = constants.cameraPos.y >= 0.0f ? 1.0f : -1.0f;
+  constants.horizon = glm::vec4(line * side, 0.0f);
+  return constants;
+}
+
+auto GridRenderer::isGroundVisible(const GridPushConstants &constants)
+    -> bool {
+  const glm::vec2 corners[4] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (const auto &c : corners) {
+    if (glm::dot(glm::vec3(constants.horizon), glm::vec3(c, 1.0f)) <= 0.0f)
+      return true;
+  }
+  return false;
 }
 
 void GridRenderer::recordCommands(VkCommandBuffer cmd,
                                   const GridPushConstants &constants) {
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+  if (!isGroundVisible(constants))
+    return;
+
+  TRACE_GPU_ZONE(cmd, "Grid");
+  setDrawState(cmd);
+  vulkan::dispatch.vkCmdPushConstants(cmd, _pipelineLayout, _pushStages, 0,
+                                      sizeof(GridPushConstants), &constants);
+
+  // Clipped quad as a 3-triangle fan
+  vulkan::dispatch.vkCmdDraw(cmd, 9, 1, 0, 0);
+}
+
+void GridRenderer::recordViews(VkCommandBuffer cmd, uint32_t frame,
+                               const GridPushConstants *views,
+                               uint32_t count) {
+  if (!writeViews(frame, views, count))
+    return;
+
+  TRACE_GPU_ZONE(cmd, "Grid");
+  setDrawState(cmd);
+  uint32_t viewBuffer = _viewIndices[frame];
+  vulkan::dispatch.vkCmdPushConstants(cmd, _pipelineLayout, _pushStages,
+                                      offsetof(GridPushConstants, viewBuffer),
+                                      sizeof(viewBuffer), &viewBuffer);
+  vulkan::dispatch.vkCmdDraw(cmd, 9, 1, 0, 0);
+}
+
+auto GridRenderer::staticCommands(uint32_t frame,
+                                  const GridPushConstants *views,
+                                  uint32_t count) -> VkCommandBuffer {
+  if (!writeViews(frame, views, count))
+    return VK_NULL_HANDLE;
+  // The slot's buffer index is fixed, so only the draw state goes in the key
+  return _static.get(frame, _drawStateVersion, [&](VkCommandBuffer cmd) {
+    recordStatic(cmd, frame);
+  });
+}
+
+void GridRenderer::recordStatic(VkCommandBuffer cmd, uint32_t frame) {
+  TRACE_GPU_ZONE(cmd, "Grid");
+  // A secondary inherits no bound state
+  _bindless->bind(cmd);
+  setDrawState(cmd);
+  uint32_t viewBuffer = _viewIndices[frame];
+  vulkan::dispatch.vkCmdPushConstants(cmd, _pipelineLayout, _pushStages,
+                                      offsetof(GridPushConstants, viewBuffer),
+                                      sizeof(viewBuffer), &viewBuffer);
+  vulkan::dispatch.vkCmdDraw(cmd, 9, 1, 0, 0);
+}
+
+// Copies the views into frame's buffer; false, copying nothing, when none of
+// them sees the ground, since one draw covers every view
+auto GridRenderer::writeViews(uint32_t frame, const GridPushConstants *views,
+                              uint32_t count) -> bool {
+  bool visible = false;
+  for (uint32_t v = 0; v < count; v++)
+    visible = visible || isGroundVisible(views[v]);
+  if (!visible)
+    return false;
+  auto *dst = static_cast<char *>(_viewBuffers[frame].mapped);
+  for (uint32_t v = 0; v < std::min(count, MAX_VIEWS); v++)
+    std::memcpy(dst + v * GRID_VIEW_SIZE, &views[v], GRID_VIEW_SIZE);
+  return true;
+}
+
+void GridRenderer::setDrawState(VkCommandBuffer cmd) {
+  vulkan::dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                     _variants[_active].second);
 
   VkViewport viewport{};
   viewport.x = 0.0f;
@@ -178,18 +450,17 @@ void GridRenderer::recordCommands(VkCommandBuffer cmd,
   viewport.height = static_cast<float>(_extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  vkCmdSetViewport(cmd, 0, 1, &viewport);
+  vulkan::dispatch.vkCmdSetViewport(cmd, 0, 1, &viewport);
 
   VkRect2D scissor{};
   scissor.offset = {0, 0};
   scissor.extent = _extent;
-  vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-  vkCmdPushConstants(cmd, _pipelineLayout,
-                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                     0, sizeof(GridPushConstants), &constants);
-
-  vkCmdDraw(cmd, 4, 1, 0, 0); // 4 vertices (fullscreen quad)
+  vulkan::dispatch.vkCmdSetScissor(cmd, 0, 1, &scissor);
 }
 
-void GridRenderer::resize(VkExtent2D newExtent) { _extent = newExtent; }
\ No newline at end of file
+void GridRenderer::resize(VkExtent2D newExtent) {
+  if (newExtent.width == _extent.width && newExtent.height == _extent.height)
+    return;
+  _extent = newExtent;
+  _drawStateVersion++;
+}
\ No newline at end of file
@@ -0,0 +1,677 @@
+#include "MeshRenderer.hpp"
+#include "JobSystem.hpp"
+#include "Log.hpp"
+#include "MeshFormat.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace vulkan;
+
+// Smallest instance gather chunk worth a job
+static constexpr uint32_t GATHER_GRAIN = 4096;
+
+// MeshCull.slang
+struct CullInput {
+  glm::vec4 sphere;
+  uint32_t command;
+  uint32_t _pad[3];
+};
+static_assert(sizeof(CullInput) == 32, "CullInput in MeshCull.slang");
+
+struct CullPushConstants {
+  glm::mat4 viewProj;
+  uint32_t inputs;
+  uint32_t sourceInstances;
+  uint32_t instances;
+  uint32_t commands;
+  uint32_t visibility;
+  uint32_t stats;
+  uint32_t pyramid;
+  uint32_t pyramidWidth;
+  uint32_t pyramidHeight;
+  uint32_t pyramidLevels;
+  uint32_t count;
+  uint32_t phase;
+  uint32_t commandBase;
+};
+static_assert(sizeof(CullPushConstants) <= 128,
+              "must fit BindlessDescriptors::PUSH_CONSTANT_SIZE");
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+static std::vector<char> readFile(const std::string &filename) {
+  std::ifstream file(filename, std::ios::ate | std::ios::binary);
+  if (!file)
+    throw std::runtime_error("failed to open file: " + filename);
+  size_t size = static_cast<size_t>(file.tellg());
+  std::vector<char> buffer(size);
+  file.seekg(0);
+  file.read(buffer.data(), size);
+  return buffer;
+}
+
+auto MeshShaders::load(bool occlusion) -> MeshShaders {
+  TRACE_ZONE("MeshShaders::load");
+  MeshShaders shaders;
+  shaders.vertex = readFile("build/shaders/mesh.vert.spv");
+  shaders.fragment = readFile("build/shaders/mesh.frag.spv");
+  if (occlusion) {
+    shaders.cull = readFile("build/shaders/mesh_cull.comp.spv");
+    shaders.pyramidInit = readFile("build/shaders/hiz_init.comp.spv");
+    shaders.pyramidReduce = readFile("build/shaders/hiz_reduce.comp.spv");
+  }
+  return shaders;
+}
+
+MeshRenderer::MeshRenderer(VkDevice device, VkPhysicalDevice physicalDevice,
+                           const DeviceProfile &profile,
+                           const RenderTargetLayout &target, VkExtent2D extent,
+                           VkPipelineLayout sharedLayout,
+                           uint32_t framesInFlight, uint32_t maxObjects,
+                           VkPipelineCache pipelineCache,
+                           const MeshShaders *shaders)
+    : _device(device), _target(target), _extent(extent),
+      _pipelineLayout(sharedLayout), _pipelineCache(pipelineCache),
+      _multiDraw(profile.multiDrawIndirect),
+      _indirectFirstInstance(profile.drawIndirectFirstInstance),
+      _maxObjects(std::max(maxObjects, 1u)) {
+  if (shaders)
+    createPipelines(*shaders);
+  else
+    createPipelines(MeshShaders::load());
+
+  // Host-visible and rewritten every frame, so one set per frame slot. The
+  // indirect buffer never needs more commands than instances.
+  _instanceBuffers.resize(framesInFlight);
+  _indirectBuffers.resize(framesInFlight);
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    if (!createBuffer(_device, physicalDevice,
+                      sizeof(MeshInstance) * _maxObjects,
+                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      _instanceBuffers[i]) ||
+        !createBuffer(_device, physicalDevice,
+                      sizeof(VkDrawIndexedIndirectCommand) * _maxObjects,
+                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                      _indirectBuffers[i])) {
+      throw std::runtime_error("failed to create mesh instance buffers");
+    }
+  }
+}
+
+MeshRenderer::~MeshRenderer() {
+  for (auto pipeline : _pipelines) {
+    if (pipeline)
+      vkDestroyPipeline(_device, pipeline, nullptr);
+  }
+  for (auto &buffer : _instanceBuffers)
+    destroyBuffer(_device, buffer);
+  for (auto &buffer : _indirectBuffers)
+    destroyBuffer(_device, buffer);
+  if (_cullPipeline)
+    vkDestroyPipeline(_device, _cullPipeline, nullptr);
+  for (auto &frame : _cullFrames) {
+    for (BindlessIndex index :
+         {frame.inputsIndex, frame.sourceIndex, frame.drawnIndex,
+          frame.commandsIndex, frame.visibilityIndex, frame.statsIndex}) {
+      if (index != BINDLESS_INVALID)
+        _bindless->release(BindlessDescriptors::StorageBuffer, index);
+    }
+    destroyBuffer(_device, frame.inputs);
+    destroyBuffer(_device, frame.drawn);
+    destroyBuffer(_device, frame.visibility);
+    destroyBuffer(_device, frame.stats);
+  }
+}
+
+void MeshRenderer::enableOcclusionCulling(VkPhysicalDevice physicalDevice,
+                                          BindlessDescriptors &bindless,
+                                          const MeshShaders *shaders) {
+  TRACE_ZONE("MeshRenderer::enableOcclusionCulling");
+  if (!bindless.valid())
+    throw std::runtime_error("occlusion culling needs bindless descriptors");
+  if (!_indirectFirstInstance)
+    throw std::runtime_error("occlusion culling needs drawIndirectFirstInstance");
+  MeshShaders loaded;
+  if (!shaders || shaders->cull.empty()) {
+    loaded = MeshShaders::load(true);
+    shaders = &loaded;
+  }
+  _bindless = &bindless;
+
+  VkShaderModule module = loadShaderModule(shaders->cull);
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = module;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = _pipelineLayout;
+  VkResult result = vkCreateComputePipelines(
+      _device, _pipelineCache, 1, &pipelineInfo, nullptr, &_cullPipeline);
+  vkDestroyShaderModule(_device, module, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create mesh cull pipeline");
+
+  _pyramid = std::make_unique<DepthPyramid>(
+      _device, physicalDevice, bindless, _pipelineCache, shaders->pyramidInit,
+      shaders->pyramidReduce);
+
+  // The GPU now reads the gathered instances and fills the commands, which
+  // hold an early and a late region
+  constexpr VkMemoryPropertyFlags mapped =
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  uint32_t framesInFlight = static_cast<uint32_t>(_instanceBuffers.size());
+  _cullFrames.resize(framesInFlight);
+  for (uint32_t i = 0; i < framesInFlight; i++) {
+    destroyBuffer(_device, _instanceBuffers[i]);
+    destroyBuffer(_device, _indirectBuffers[i]);
+    CullFrame &frame = _cullFrames[i];
+    if (!createBuffer(_device, physicalDevice,
+                      sizeof(MeshInstance) * _maxObjects,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mapped,
+                      _instanceBuffers[i]) ||
+        !createBuffer(_device, physicalDevice,
+                      sizeof(VkDrawIndexedIndirectCommand) * _maxObjects * 2,
+                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      mapped, _indirectBuffers[i]) ||
+        !createBuffer(_device, physicalDevice, sizeof(CullInput) * _maxObjects,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mapped,
+                      frame.inputs) ||
+        !createBuffer(_device, physicalDevice,
+                      sizeof(MeshInstance) * _maxObjects * 2,
+                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawn) ||
+        !createBuffer(_device, physicalDevice, sizeof(uint32_t) * _maxObjects,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.visibility) ||
+        !createBuffer(_device, physicalDevice, sizeof(uint32_t) * 2,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, mapped,
+                      frame.stats)) {
+      throw std::runtime_error("failed to create mesh cull buffers");
+    }
+    frame.inputsIndex = bindless.registerStorageBuffer(frame.inputs.buffer);
+    frame.sourceIndex =
+        bindless.registerStorageBuffer(_instanceBuffers[i].buffer);
+    frame.drawnIndex = bindless.registerStorageBuffer(frame.drawn.buffer);
+    frame.commandsIndex =
+        bindless.registerStorageBuffer(_indirectBuffers[i].buffer);
+    frame.visibilityIndex =
+        bindless.registerStorageBuffer(frame.visibility.buffer);
+    frame.statsIndex = bindless.registerStorageBuffer(frame.stats.buffer);
+    for (BindlessIndex index :
+         {frame.inputsIndex, frame.sourceIndex, frame.drawnIndex,
+          frame.commandsIndex, frame.visibilityIndex, frame.statsIndex}) {
+      if (index == BINDLESS_INVALID)
+        throw std::runtime_error("no bindless slot for mesh cull buffers");
+    }
+  }
+}
+
+auto MeshRenderer::loadShaderModule(const std::vector<char> &code)
+    -> VkShaderModule {
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create mesh shader module");
+  }
+  return shaderModule;
+}
+
+void MeshRenderer::createPipelines(const MeshShaders &shaders) {
+  TRACE_ZONE("MeshRenderer::createPipelines");
+  VkShaderModule vertModule = loadShaderModule(shaders.vertex);
+  VkShaderModule fragModule = loadShaderModule(shaders.fragment);
+
+  VkPipelineShaderStageCreateInfo stages[2]{};
+  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  stages[0].module = vertModule;
+  stages[0].pName = "main";
+  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  stages[1].module = fragModule;
+  stages[1].pName = "main";
+
+  // Binding 0: packed .vmesh vertices from the GeometryPool. Binding 1:
+  // MeshInstance per instance, so firstInstance selects the object.
+  VkVertexInputBindingDescription bindings[2]{};
+  bindings[0].binding = 0;
+  bindings[0].stride = sizeof(vmesh::PackedVertex);
+  bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  bindings[1].binding = 1;
+  bindings[1].stride = sizeof(MeshInstance);
+  bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+  // Position is read as 4 x unorm16 (the 4th lane overlaps the normal and
+  // is ignored): 3-component 16-bit formats are not guaranteed for vertices
+  VkVertexInputAttributeDescription attributes[7]{};
+  attributes[0] = {0, 0, VK_FORMAT_R16G16B16A16_UNORM,
+                   offsetof(vmesh::PackedVertex, position)};
+  attributes[1] = {1, 0, VK_FORMAT_R8G8_SNORM,
+                   offsetof(vmesh::PackedVertex, normal)};
+  attributes[2] = {2, 0, VK_FORMAT_R16G16_SFLOAT,
+                   offsetof(vmesh::PackedVertex, uv)};
+  for (uint32_t row = 0; row < 3; row++)
+    attributes[3 + row] = {3 + row, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+                           static_cast<uint32_t>(sizeof(glm::vec4) * row)};
+  attributes[6] = {6, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+                   offsetof(MeshInstance, normalScale)};
+
+  VkPipelineVertexInputStateCreateInfo vertexInput{};
+  vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+  vertexInput.vertexBindingDescriptionCount = 2;
+  vertexInput.pVertexBindingDescriptions = bindings;
+  vertexInput.vertexAttributeDescriptionCount = 7;
+  vertexInput.pVertexAttributeDescriptions = attributes;
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+  inputAssembly.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                    VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState{};
+  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates = dynamicStates;
+
+  VkPipelineViewportStateCreateInfo viewportState{};
+  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount = 1;
+
+  // Camera flips Y in the projection, which keeps CCW front faces CCW
+  VkPipelineRasterizationStateCreateInfo rasterizer{};
+  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth = 1.0f;
+  rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling{};
+  multisampling.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = VK_TRUE;
+  depthStencil.depthWriteEnable = VK_TRUE;
+  depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+  colorBlendAttachment.colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending{};
+  colorBlending.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments = &colorBlendAttachment;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount = 2;
+  pipelineInfo.pStages = stages;
+  pipelineInfo.pVertexInputState = &vertexInput;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = _pipelineLayout;
+
+  VkPipelineRenderingCreateInfoKHR renderingInfo{};
+  applyRenderTarget(pipelineInfo, renderingInfo, _target);
+
+  // The variants differ only in culling
+  const VkCullModeFlags cullModes[PipelineCount] = {VK_CULL_MODE_BACK_BIT,
+                                                    VK_CULL_MODE_NONE};
+  for (uint32_t i = 0; i < PipelineCount; i++) {
+    rasterizer.cullMode = cullModes[i];
+    if (vkCreateGraphicsPipelines(_device, _pipelineCache, 1, &pipelineInfo,
+                                  nullptr, &_pipelines[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create mesh pipeline");
+    }
+  }
+
+  vkDestroyShaderModule(_device, vertModule, nullptr);
+  vkDestroyShaderModule(_device, fragModule, nullptr);
+}
+
+void MeshRenderer::recordCommands(VkCommandBuffer cmd, uint32_t frame,
+                                  const RenderScene &scene,
+                                  const GeometryPool &geometry,
+                                  const MeshPushConstants &constants,
+                                  JobSystem *jobs) {
+  TRACE_ZONE("MeshRenderer::recordCommands");
+  _drawCalls = 0;
+  if (_pyramid) {
+    // Batches and instances came from cullEarly; the GPU filled the counts
+    if (_batches.commands.empty())
+      return;
+    TRACE_GPU_ZONE(cmd, "Meshes");
+    setDrawState(cmd, geometry, constants, _cullFrames[frame].drawn.buffer);
+    recordIndirect(cmd, frame);
+    return;
+  }
+  {
+    TRACE_ZONE("BuildBatches");
+    scene.buildBatches(_batches, &constants.viewProj, jobs);
+  }
+  clampToCapacity();
+  _visibleObjects = static_cast<uint32_t>(_batches.instances.size());
+  if (_batches.commands.empty())
+    return;
+
+  // Gather instance data in batch order: the only per-object work
+  auto *instances =
+      static_cast<MeshInstance *>(_instanceBuffers[frame].mapped);
+  const MeshInstance *source = scene.instances().data();
+  const uint32_t *order = _batches.instances.data();
+  auto gather = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+      instances[i] = source[order[i]];
+  };
+  if (jobs)
+    jobs->parallelFor(_visibleObjects, gather, GATHER_GRAIN);
+  else
+    gather(0, _visibleObjects);
+
+  TRACE_GPU_ZONE(cmd, "Meshes");
+  setDrawState(cmd, geometry, constants, _instanceBuffers[frame].buffer);
+  if (_drawMode == DrawMode::PerObject)
+    recordPerObject(cmd);
+  else
+    recordIndirect(cmd, frame);
+}
+
+// Commands are ordered by firstInstance; drops what exceeds the buffers
+void MeshRenderer::clampToCapacity() {
+  auto &commands = _batches.commands;
+  if (_batches.instances.size() > _maxObjects) {
+    if (!_warnedOverflow) {
+      LOG_WARN(Render, "MeshRenderer: %zu visible objects, capacity %u",
+               _batches.instances.size(), _maxObjects);
+      _warnedOverflow = true;
+    }
+    while (!commands.empty() && commands.back().firstInstance >= _maxObjects)
+      commands.pop_back();
+    if (!commands.empty())
+      commands.back().instanceCount = std::min(
+          commands.back().instanceCount,
+          _maxObjects - commands.back().firstInstance);
+    _batches.instances.resize(_maxObjects);
+    uint32_t kept = static_cast<uint32_t>(commands.size());
+    for (auto &range : _batches.pipelines) {
+      uint32_t end = std::min(range.firstCommand + range.commandCount, kept);
+      range.commandCount = end > range.firstCommand ? end - range.firstCommand
+                                                    : 0;
+    }
+  }
+}
+
+void MeshRenderer::setDrawState(VkCommandBuffer cmd,
+                                const GeometryPool &geometry,
+                                const MeshPushConstants &constants,
+                                VkBuffer instances) {
+  VkViewport viewport{};
+  viewport.width = static_cast<float>(_extent.width);
+  viewport.height = static_cast<float>(_extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  dispatch.vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.extent = _extent;
+  dispatch.vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+  dispatch.vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_ALL, 0,
+                              sizeof(MeshPushConstants), &constants);
+  geometry.bind(cmd);
+  VkDeviceSize offset = 0;
+  dispatch.vkCmdBindVertexBuffers(cmd, 1, 1, &instances, &offset);
+}
+
+void MeshRenderer::recordIndirect(VkCommandBuffer cmd, uint32_t frame,
+                                  uint32_t commandBase) {
+  const auto &commands = _batches.commands;
+  VkBuffer indirect = _indirectBuffers[frame].buffer;
+  // Under occlusion culling cullEarly wrote the commands
+  if (_indirectFirstInstance && !_pyramid)
+    std::memcpy(_indirectBuffers[frame].mapped, commands.data(),
+                commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  for (uint32_t p = 0; p < PipelineCount && p < _batches.pipelines.size();
+       p++) {
+    const auto &range = _batches.pipelines[p];
+    if (range.commandCount == 0)
+      continue;
+    dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                               _pipelines[p]);
+
+    VkDeviceSize first =
+        (commandBase + range.firstCommand) * VkDeviceSize{stride};
+    if (!_indirectFirstInstance) {
+      // Indirect draws must start at instance 0; record them directly
+      for (uint32_t c = 0; c < range.commandCount; c++) {
+        const auto &dc = commands[range.firstCommand + c];
+        dispatch.vkCmdDrawIndexed(cmd, dc.indexCount, dc.instanceCount,
+                                  dc.firstIndex, dc.vertexOffset,
+                                  dc.firstInstance);
+      }
+      _drawCalls += range.commandCount;
+    } else if (_multiDraw) {
+      dispatch.vkCmdDrawIndexedIndirect(cmd, indirect, first,
+                                        range.commandCount, stride);
+      _drawCalls++;
+    } else {
+      for (uint32_t c = 0; c < range.commandCount; c++)
+        dispatch.vkCmdDrawIndexedIndirect(cmd, indirect, first + c * stride, 1,
+                                          stride);
+      _drawCalls += range.commandCount;
+    }
+  }
+}
+
+void MeshRenderer::recordPerObject(VkCommandBuffer cmd) {
+  // Same visible set and order as the indirect path, one draw per object
+  for (uint32_t p = 0; p < PipelineCount && p < _batches.pipelines.size();
+       p++) {
+    const auto &range = _batches.pipelines[p];
+    if (range.commandCount == 0)
+      continue;
+    dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                               _pipelines[p]);
+    for (uint32_t c = 0; c < range.commandCount; c++) {
+      const auto &dc = _batches.commands[range.firstCommand + c];
+      for (uint32_t i = 0; i < dc.instanceCount; i++) {
+        dispatch.vkCmdDrawIndexed(cmd, dc.indexCount, 1, dc.firstIndex,
+                                  dc.vertexOffset, dc.firstInstance + i);
+      }
+      _drawCalls += dc.instanceCount;
+    }
+  }
+}
+
+void MeshRenderer::cullEarly(VkCommandBuffer cmd, uint32_t frame,
+                             const RenderScene &scene,
+                             const MeshPushConstants &constants,
+                             JobSystem *jobs) {
+  TRACE_ZONE("MeshRenderer::cullEarly");
+  CullFrame &slot = _cullFrames[frame];
+  // The slot's fence has signaled: its GPU counts are final
+  auto *drawn = static_cast<uint32_t *>(slot.stats.mapped);
+  if (slot.recorded) {
+    CullStats stats = slot.pending;
+    stats.earlyDrawn = drawn[0];
+    stats.lateDrawn = drawn[1];
+    stats.occluded -= std::min(stats.occluded, drawn[0] + drawn[1]);
+    _cullStats = stats;
+  }
+  drawn[0] = drawn[1] = 0;
+
+  {
+    TRACE_ZONE("BuildBatches");
+    scene.buildBatches(_batches, &constants.viewProj, jobs);
+  }
+  clampToCapacity();
+  _visibleObjects = static_cast<uint32_t>(_batches.instances.size());
+  _viewProj = constants.viewProj;
+  slot.pending = {};
+  slot.pending.objects = scene.size();
+  slot.pending.frustumCulled = _batches.culled;
+  slot.pending.occluded = _visibleObjects; // less what gets drawn
+  slot.recorded = true;
+  const auto &commands = _batches.commands;
+  if (commands.empty())
+    return;
+
+  // Both regions of commands start empty; the late one draws from the late
+  // half of the instances
+  uint32_t count = static_cast<uint32_t>(commands.size());
+  auto *gpuCommands =
+      static_cast<VkDrawIndexedIndirectCommand *>(_indirectBuffers[frame].mapped);
+  for (uint32_t c = 0; c < count; c++) {
+    gpuCommands[c] = commands[c];
+    gpuCommands[c].instanceCount = 0;
+    gpuCommands[count + c] = gpuCommands[c];
+    gpuCommands[count + c].firstInstance += _maxObjects;
+  }
+
+  // Instance data and bounds of every candidate, in batch order
+  auto *instances =
+      static_cast<MeshInstance *>(_instanceBuffers[frame].mapped);
+  auto *inputs = static_cast<CullInput *>(slot.inputs.mapped);
+  const MeshInstance *source = scene.instances().data();
+  const glm::vec4 *spheres = scene.spheres().data();
+  const uint32_t *order = _batches.instances.data();
+  auto gather = [&](uint32_t begin, uint32_t end) {
+    auto it = std::upper_bound(
+        commands.begin(), commands.end(), begin,
+        [](uint32_t i, const VkDrawIndexedIndirectCommand &dc) {
+          return i < dc.firstInstance;
+        });
+    uint32_t c = static_cast<uint32_t>(it - commands.begin()) - 1;
+    for (uint32_t i = begin; i < end; i++) {
+      while (i >= commands[c].firstInstance + commands[c].instanceCount)
+        c++;
+      instances[i] = source[order[i]];
+      inputs[i] = {spheres[order[i]], c, {}};
+    }
+  };
+  if (jobs)
+    jobs->parallelFor(_visibleObjects, gather, GATHER_GRAIN);
+  else
+    gather(0, _visibleObjects);
+
+  TRACE_GPU_ZONE(cmd, "CullEarly");
+  // The pyramid was written by the previous frame's cullLate
+  VkMemoryBarrier pyramidReady{};
+  pyramidReady.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  pyramidReady.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  pyramidReady.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                &pyramidReady, 0, nullptr, 0, nullptr);
+  dispatchCull(cmd, frame, 0, _pyramidViewProj);
+}
+
+void MeshRenderer::cullLate(VkCommandBuffer cmd, uint32_t frame,
+                            BindlessIndex depth, VkExtent2D extent) {
+  TRACE_ZONE("MeshRenderer::cullLate");
+  TRACE_GPU_ZONE(cmd, "CullLate");
+  // The early cull is done reading the old pyramid and writing visibility
+  VkMemoryBarrier earlyDone{};
+  earlyDone.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  earlyDone.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  earlyDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                &earlyDone, 0, nullptr, 0, nullptr);
+  _pyramid->build(cmd, depth, extent);
+  _pyramidViewProj = _viewProj;
+  if (!_batches.commands.empty())
+    dispatchCull(cmd, frame, 1, _viewProj);
+
+  // The counts are read back once the frame's fence signals
+  VkMemoryBarrier toHost{};
+  toHost.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  toHost.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &toHost, 0,
+                                nullptr, 0, nullptr);
+}
+
+void MeshRenderer::recordLate(VkCommandBuffer cmd, uint32_t frame,
+                              const GeometryPool &geometry,
+                              const MeshPushConstants &constants) {
+  if (!_pyramid || _batches.commands.empty())
+    return;
+  TRACE_GPU_ZONE(cmd, "MeshesLate");
+  setDrawState(cmd, geometry, constants, _cullFrames[frame].drawn.buffer);
+  recordIndirect(cmd, frame,
+                 static_cast<uint32_t>(_batches.commands.size()));
+}
+
+// One phase of MeshCull.slang over every frustum-visible object
+void MeshRenderer::dispatchCull(VkCommandBuffer cmd, uint32_t frame,
+                                uint32_t phase, const glm::mat4 &viewProj) {
+  const CullFrame &slot = _cullFrames[frame];
+  CullPushConstants pc{};
+  pc.viewProj = viewProj;
+  pc.inputs = slot.inputsIndex;
+  pc.sourceInstances = slot.sourceIndex;
+  pc.instances = slot.drawnIndex;
+  pc.commands = slot.commandsIndex;
+  pc.visibility = slot.visibilityIndex;
+  pc.stats = slot.statsIndex;
+  pc.pyramid = _pyramid->buffer();
+  pc.pyramidWidth = _pyramid->width();
+  pc.pyramidHeight = _pyramid->height();
+  pc.pyramidLevels = _pyramid->levels();
+  pc.count = _visibleObjects;
+  pc.phase = phase;
+  pc.commandBase =
+      phase == 0 ? 0 : static_cast<uint32_t>(_batches.commands.size());
+  dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                             _cullPipeline);
+  dispatch.vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_ALL, 0,
+                              sizeof(pc), &pc);
+  dispatch.vkCmdDispatch(
+      cmd, (_visibleObjects + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+  // Counts and instances feed the draws
+  VkMemoryBarrier toDraw{};
+  toDraw.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  toDraw.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  toDraw.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                         VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(
+      cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+      0, 1, &toDraw, 0, nullptr, 0, nullptr);
+}
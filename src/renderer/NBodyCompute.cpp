@@ -0,0 +1,296 @@
+#include "NBodyCompute.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+using namespace vulkan;
+
+static std::vector<char> readFile(const std::string &filename) {
+  std::ifstream file(filename, std::ios::ate | std::ios::binary);
+  if (!file)
+    throw std::runtime_error("failed to open file: " + filename);
+  size_t size = static_cast<size_t>(file.tellg());
+  std::vector<char> buffer(size);
+  file.seekg(0);
+  file.read(buffer.data(), size);
+  return buffer;
+}
+
+// Records with record into a transient command buffer, submits it on queue
+// and waits
+static void submitAndWait(VkDevice device, VkQueue queue,
+                          uint32_t queueFamily,
+                          const std::function<void(VkCommandBuffer)> &record) {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = queueFamily;
+  VkCommandPool pool;
+  if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    throw std::runtime_error("failed to create n-body command pool");
+  VkCommandBufferAllocateInfo cbai{};
+  cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbai.commandPool = pool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = 1;
+  VkCommandBuffer cmd;
+  vkAllocateCommandBuffers(device, &cbai, &cmd);
+  VkFenceCreateInfo fci{};
+  fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  vkCreateFence(device, &fci, nullptr, &fence);
+
+  VkCommandBufferBeginInfo begin{};
+  begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  dispatch.vkBeginCommandBuffer(cmd, &begin);
+  record(cmd);
+  dispatch.vkEndCommandBuffer(cmd);
+
+  VkSubmitInfo submit{};
+  submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit.commandBufferCount = 1;
+  submit.pCommandBuffers = &cmd;
+  bool ok = dispatch.vkQueueSubmit(queue, 1, &submit, fence) == VK_SUCCESS &&
+            dispatch.vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) ==
+                VK_SUCCESS;
+  vkDestroyFence(device, fence, nullptr);
+  vkDestroyCommandPool(device, pool, nullptr);
+  if (!ok)
+    throw std::runtime_error("n-body submission failed");
+}
+
+NBodyCompute::NBodyCompute(VkDevice device, VkPhysicalDevice physicalDevice,
+                           BindlessDescriptors &bindless,
+                           VkPipelineCache pipelineCache,
+                           const std::vector<char> *code)
+    : _device(device), _physicalDevice(physicalDevice), _bindless(bindless) {
+  if (!bindless.valid())
+    throw std::runtime_error("n-body compute needs bindless descriptors");
+  std::vector<char> loaded;
+  if (!code) {
+    loaded = readFile("build/shaders/nbody.comp.spv");
+    code = &loaded;
+  }
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code->size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code->data());
+  VkShaderModule module;
+  if (vkCreateShaderModule(_device, &moduleInfo, nullptr, &module) !=
+      VK_SUCCESS)
+    throw std::runtime_error("failed to create n-body shader module");
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = module;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = _bindless.pipelineLayout();
+  VkResult result = vkCreateComputePipelines(
+      _device, pipelineCache, 1, &pipelineInfo, nullptr, &_pipeline);
+  vkDestroyShaderModule(_device, module, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create n-body pipeline");
+}
+
+NBodyCompute::~NBodyCompute() {
+  destroyBuffers();
+  if (_pipeline)
+    vkDestroyPipeline(_device, _pipeline, nullptr);
+}
+
+void NBodyCompute::createBuffers(uint32_t count) {
+  VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                             VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  for (uint32_t i = 0; i < 2; i++) {
+    if (!createBuffer(_device, _physicalDevice,
+                      VkDeviceSize(count) * sizeof(Star), usage,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _stars[i]))
+      throw std::runtime_error("failed to create n-body star buffer");
+    _starIndex[i] = _bindless.registerStorageBuffer(_stars[i].buffer);
+    if (_starIndex[i] == BINDLESS_INVALID)
+      throw std::runtime_error("no bindless slot for n-body stars");
+  }
+  if (!createBuffer(_device, _physicalDevice,
+                    VkDeviceSize(count) * sizeof(BodyMotion), usage,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _motion))
+    throw std::runtime_error("failed to create n-body motion buffer");
+  _motionIndex = _bindless.registerStorageBuffer(_motion.buffer);
+  if (_motionIndex == BINDLESS_INVALID)
+    throw std::runtime_error("no bindless slot for n-body motion");
+  _count = count;
+}
+
+void NBodyCompute::destroyBuffers() {
+  for (uint32_t i = 0; i < 2; i++) {
+    if (_starIndex[i] != BINDLESS_INVALID)
+      _bindless.release(BindlessDescriptors::StorageBuffer, _starIndex[i]);
+    _starIndex[i] = BINDLESS_INVALID;
+    destroyBuffer(_device, _stars[i]);
+  }
+  if (_motionIndex != BINDLESS_INVALID)
+    _bindless.release(BindlessDescriptors::StorageBuffer, _motionIndex);
+  _motionIndex = BINDLESS_INVALID;
+  destroyBuffer(_device, _motion);
+  _count = 0;
+  _current = 0;
+}
+
+void NBodyCompute::upload(VkQueue queue, uint32_t queueFamily,
+                          const NBodySnapshot &snapshot) {
+  TRACE_ZONE("NBodyCompute::upload");
+  uint32_t count = snapshot.count();
+  if (count > MAX_BODIES || snapshot.motion.size() != count)
+    throw std::runtime_error("n-body snapshot too large or inconsistent");
+  destroyBuffers();
+  _time = snapshot.time;
+  if (count == 0)
+    return;
+  createBuffers(count);
+
+  VkDeviceSize starBytes = VkDeviceSize(count) * sizeof(Star);
+  VkDeviceSize motionBytes = VkDeviceSize(count) * sizeof(BodyMotion);
+  BufferResource staging;
+  if (!createBuffer(_device, _physicalDevice, starBytes + motionBytes,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    staging))
+    throw std::runtime_error("failed to create n-body staging buffer");
+  auto *mapped = static_cast<char *>(staging.mapped);
+  std::memcpy(mapped, snapshot.stars.data(), starBytes);
+  std::memcpy(mapped + starBytes, snapshot.motion.data(), motionBytes);
+
+  try {
+    submitAndWait(_device, queue, queueFamily, [&](VkCommandBuffer cmd) {
+      VkBufferCopy stars{0, 0, starBytes};
+      dispatch.vkCmdCopyBuffer(cmd, staging.buffer, _stars[0].buffer, 1,
+                               &stars);
+      VkBufferCopy motion{starBytes, 0, motionBytes};
+      dispatch.vkCmdCopyBuffer(cmd, staging.buffer, _motion.buffer, 1, &motion);
+      VkMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask =
+          VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+      dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    0, 1, &barrier, 0, nullptr, 0, nullptr);
+    });
+  } catch (...) {
+    destroyBuffer(_device, staging);
+    throw;
+  }
+  destroyBuffer(_device, staging);
+}
+
+void NBodyCompute::download(VkQueue queue, uint32_t queueFamily,
+                            NBodySnapshot &snapshot) {
+  TRACE_ZONE("NBodyCompute::download");
+  snapshot.stars.resize(_count);
+  snapshot.motion.resize(_count);
+  snapshot.time = _time;
+  if (_count == 0)
+    return;
+
+  VkDeviceSize starBytes = VkDeviceSize(_count) * sizeof(Star);
+  VkDeviceSize motionBytes = VkDeviceSize(_count) * sizeof(BodyMotion);
+  BufferResource staging;
+  if (!createBuffer(_device, _physicalDevice, starBytes + motionBytes,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    staging))
+    throw std::runtime_error("failed to create n-body readback buffer");
+
+  try {
+    submitAndWait(_device, queue, queueFamily, [&](VkCommandBuffer cmd) {
+      VkMemoryBarrier written{};
+      written.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+      written.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                    VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+                                    &written, 0, nullptr, 0, nullptr);
+      VkBufferCopy stars{0, 0, starBytes};
+      dispatch.vkCmdCopyBuffer(cmd, _stars[_current].buffer, staging.buffer, 1,
+                               &stars);
+      VkBufferCopy motion{0, starBytes, motionBytes};
+      dispatch.vkCmdCopyBuffer(cmd, _motion.buffer, staging.buffer, 1, &motion);
+      VkMemoryBarrier copied{};
+      copied.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      copied.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      copied.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+      dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &copied,
+                                    0, nullptr, 0, nullptr);
+    });
+  } catch (...) {
+    destroyBuffer(_device, staging);
+    throw;
+  }
+  auto *mapped = static_cast<const char *>(staging.mapped);
+  std::memcpy(snapshot.stars.data(), mapped, starBytes);
+  std::memcpy(snapshot.motion.data(), mapped + starBytes, motionBytes);
+  destroyBuffer(_device, staging);
+}
+
+void NBodyCompute::step(VkCommandBuffer cmd, const NBodySettings &settings) {
+  if (_count == 0)
+    return;
+  TRACE_GPU_ZONE(cmd, "NBodyStep");
+
+  // The target buffer was drawn from two steps ago; those reads finish
+  // before this step overwrites it
+  dispatch.vkCmdPipelineBarrier(cmd,
+                                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                                nullptr, 0, nullptr, 0, nullptr);
+
+  NBodyPushConstants pc{};
+  pc.source = _starIndex[_current];
+  pc.target = _starIndex[_current ^ 1];
+  pc.motion = _motionIndex;
+  pc.count = _count;
+  pc.dt = settings.dt;
+  pc.g = NBODY_G;
+  pc.softening2 = std::max(settings.softening * settings.softening, 1e-12f);
+  dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+  dispatch.vkCmdPushConstants(cmd, _bindless.pipelineLayout(),
+                              VK_SHADER_STAGE_ALL, 0, sizeof(pc), &pc);
+  dispatch.vkCmdDispatch(cmd, (_count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+  VkMemoryBarrier stepped{};
+  stepped.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  stepped.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  stepped.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                0, 1, &stepped, 0, nullptr, 0, nullptr);
+  _current ^= 1;
+  _time += settings.dt;
+}
+
+void NBodyCompute::simulate(VkQueue queue, uint32_t queueFamily,
+                            uint32_t steps, const NBodySettings &settings) {
+  TRACE_ZONE("NBodyCompute::simulate");
+  if (_count == 0 || steps == 0)
+    return;
+  submitAndWait(_device, queue, queueFamily, [&](VkCommandBuffer cmd) {
+    _bindless.bind(cmd);
+    for (uint32_t i = 0; i < steps; i++)
+      step(cmd, settings);
+  });
+}
@@ -0,0 +1,462 @@
+#include "StarRenderer.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace vulkan;
+
+static constexpr uint32_t SPLAT_GROUP_SIZE = 256;
+// Bytes of accumulation per pixel: fixed-point R, G and B
+static constexpr VkDeviceSize PIXEL_BYTES = 3 * sizeof(uint32_t);
+
+static std::vector<char> readFile(const std::string &filename) {
+  std::ifstream file(filename, std::ios::ate | std::ios::binary);
+  if (!file)
+    throw std::runtime_error("failed to open file: " + filename);
+  size_t size = static_cast<size_t>(file.tellg());
+  std::vector<char> buffer(size);
+  file.seekg(0);
+  file.read(buffer.data(), size);
+  return buffer;
+}
+
+auto StarShaders::load() -> StarShaders {
+  TRACE_ZONE("StarShaders::load");
+  StarShaders shaders;
+  shaders.splat = readFile("build/shaders/star_splat.comp.spv");
+  shaders.resolveVertex = readFile("build/shaders/star_resolve.vert.spv");
+  shaders.resolveFragment = readFile("build/shaders/star_resolve.frag.spv");
+  shaders.pointVertex = readFile("build/shaders/star_points.vert.spv");
+  shaders.pointFragment = readFile("build/shaders/star_points.frag.spv");
+  return shaders;
+}
+
+StarRenderer::StarRenderer(VkDevice device, VkPhysicalDevice physicalDevice,
+                           BindlessDescriptors &bindless,
+                           const RenderTargetLayout &target, VkExtent2D extent,
+                           VkPipelineCache pipelineCache,
+                           const StarShaders *shaders)
+    : _device(device), _physicalDevice(physicalDevice), _bindless(bindless),
+      _target(target), _extent(extent), _pipelineCache(pipelineCache) {
+  if (!bindless.valid())
+    throw std::runtime_error("star renderer needs bindless descriptors");
+  if (shaders)
+    createPipelines(*shaders);
+  else
+    createPipelines(StarShaders::load());
+  createAccumulation(extent);
+}
+
+StarRenderer::~StarRenderer() {
+  releaseChunks();
+  destroyAccumulation();
+  for (VkPipeline pipeline : {_splat, _resolve, _points}) {
+    if (pipeline)
+      vkDestroyPipeline(_device, pipeline, nullptr);
+  }
+}
+
+auto StarRenderer::makeConstants(const glm::mat4 &viewProj,
+                                 const glm::vec3 &eye, float exposure)
+    -> StarPushConstants {
+  StarPushConstants constants{};
+  constants.viewProj = viewProj;
+  constants.eye = eye;
+  constants.exposure = exposure;
+  return constants;
+}
+
+void StarRenderer::createAccumulation(VkExtent2D extent) {
+  VkDeviceSize pixels =
+      VkDeviceSize(std::max(extent.width, 1u)) * std::max(extent.height, 1u);
+  if (!createBuffer(_device, _physicalDevice, pixels * PIXEL_BYTES,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _accumulation))
+    throw std::runtime_error("failed to create star accumulation buffer");
+  _accumulationIndex = _bindless.registerStorageBuffer(_accumulation.buffer);
+  if (_accumulationIndex == BINDLESS_INVALID)
+    throw std::runtime_error("no bindless slot for star accumulation");
+  _capacity = pixels;
+}
+
+void StarRenderer::destroyAccumulation() {
+  if (_accumulationIndex != BINDLESS_INVALID)
+    _bindless.release(BindlessDescriptors::StorageBuffer, _accumulationIndex);
+  _accumulationIndex = BINDLESS_INVALID;
+  destroyBuffer(_device, _accumulation);
+  _capacity = 0;
+}
+
+void StarRenderer::resize(VkExtent2D newExtent) {
+  _extent = newExtent;
+  if (VkDeviceSize(newExtent.width) * newExtent.height <= _capacity)
+    return;
+  destroyAccumulation();
+  createAccumulation(newExtent);
+}
+
+void StarRenderer::releaseChunks() {
+  for (auto &chunk : _chunks) {
+    if (!chunk.owned)
+      continue;
+    if (chunk.index != BINDLESS_INVALID)
+      _bindless.release(BindlessDescriptors::StorageBuffer, chunk.index);
+    destroyBuffer(_device, chunk.buffer);
+  }
+  _chunks.clear();
+  _count = 0;
+}
+
+void StarRenderer::attach(BindlessIndex stars, uint32_t count) {
+  if (count > CHUNK_STARS)
+    throw std::runtime_error("attached star buffer exceeds CHUNK_STARS");
+  releaseChunks();
+  if (count == 0 || stars == BINDLESS_INVALID)
+    return;
+  Chunk chunk;
+  chunk.index = stars;
+  chunk.count = count;
+  chunk.owned = false;
+  _chunks.push_back(chunk);
+  _count = count;
+}
+
+void StarRenderer::upload(VkQueue queue, uint32_t queueFamily,
+                          const Star *stars, uint32_t count) {
+  upload(queue, queueFamily, count,
+         [stars](Star *out, uint32_t first, uint32_t n) {
+           std::memcpy(out, stars + first, size_t(n) * sizeof(Star));
+           return true;
+         });
+}
+
+auto StarRenderer::upload(VkQueue queue, uint32_t queueFamily, uint32_t count,
+                          const StarFill &fill) -> bool {
+  TRACE_ZONE("StarRenderer::upload");
+  releaseChunks();
+  if (count == 0)
+    return true;
+
+  // One staging buffer, refilled for every chunk
+  uint32_t chunkStars = std::min(count, CHUNK_STARS);
+  BufferResource staging;
+  if (!createBuffer(_device, _physicalDevice,
+                    VkDeviceSize(chunkStars) * sizeof(Star),
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    staging))
+    throw std::runtime_error("failed to create star staging buffer");
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = queueFamily;
+  VkCommandPool pool;
+  vkCreateCommandPool(_device, &poolInfo, nullptr, &pool);
+  VkCommandBufferAllocateInfo cbai{};
+  cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  cbai.commandPool = pool;
+  cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  cbai.commandBufferCount = 1;
+  VkCommandBuffer cmd;
+  vkAllocateCommandBuffers(_device, &cbai, &cmd);
+  VkFenceCreateInfo fci{};
+  fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  VkFence fence;
+  vkCreateFence(_device, &fci, nullptr, &fence);
+
+  bool ok = true, filled = true;
+  for (uint32_t first = 0; first < count && ok; first += CHUNK_STARS) {
+    Chunk chunk;
+    chunk.count = std::min(count - first, CHUNK_STARS);
+    VkDeviceSize bytes = VkDeviceSize(chunk.count) * sizeof(Star);
+    if (!createBuffer(_device, _physicalDevice, bytes,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunk.buffer)) {
+      ok = false;
+      break;
+    }
+    chunk.index = _bindless.registerStorageBuffer(chunk.buffer.buffer);
+    _chunks.push_back(chunk);
+    if (chunk.index == BINDLESS_INVALID) {
+      ok = false;
+      break;
+    }
+    if (!fill(static_cast<Star *>(staging.mapped), first, chunk.count)) {
+      filled = false;
+      break;
+    }
+
+    VkCommandBufferBeginInfo begin{};
+    begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    dispatch.vkBeginCommandBuffer(cmd, &begin);
+    VkBufferCopy region{0, 0, bytes};
+    dispatch.vkCmdCopyBuffer(cmd, staging.buffer, chunk.buffer.buffer, 1,
+                             &region);
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                  VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                  0, 1, &barrier, 0, nullptr, 0, nullptr);
+    dispatch.vkEndCommandBuffer(cmd);
+
+    VkSubmitInfo submit{};
+    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &cmd;
+    ok = dispatch.vkQueueSubmit(queue, 1, &submit, fence) == VK_SUCCESS &&
+         dispatch.vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX) ==
+             VK_SUCCESS;
+    dispatch.vkResetFences(_device, 1, &fence);
+    dispatch.vkResetCommandBuffer(cmd, 0);
+  }
+
+  vkDestroyFence(_device, fence, nullptr);
+  vkDestroyCommandPool(_device, pool, nullptr);
+  destroyBuffer(_device, staging);
+  if (!ok) {
+    releaseChunks();
+    throw std::runtime_error("failed to upload stars");
+  }
+  if (!filled) {
+    releaseChunks();
+    return false;
+  }
+  _count = count;
+  return true;
+}
+
+auto StarRenderer::loadShaderModule(const std::vector<char> &code)
+    -> VkShaderModule {
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create star shader module");
+  }
+  return shaderModule;
+}
+
+void StarRenderer::createPipelines(const StarShaders &shaders) {
+  TRACE_ZONE("StarRenderer::createPipelines");
+  VkShaderModule splatModule = loadShaderModule(shaders.splat);
+  VkComputePipelineCreateInfo computeInfo{};
+  computeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  computeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  computeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  computeInfo.stage.module = splatModule;
+  computeInfo.stage.pName = "main";
+  computeInfo.layout = _bindless.pipelineLayout();
+  VkResult result = vkCreateComputePipelines(_device, _pipelineCache, 1,
+                                             &computeInfo, nullptr, &_splat);
+  vkDestroyShaderModule(_device, splatModule, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create star splat pipeline");
+
+  _resolve = createGraphicsPipeline(shaders.resolveVertex,
+                                    shaders.resolveFragment,
+                                    VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+  _points = createGraphicsPipeline(shaders.pointVertex, shaders.pointFragment,
+                                   VK_PRIMITIVE_TOPOLOGY_POINT_LIST);
+}
+
+// Additive, no vertex input and no depth test: both the resolve and the
+// points add light over what the pass has drawn
+auto StarRenderer::createGraphicsPipeline(const std::vector<char> &vertex,
+                                          const std::vector<char> &fragment,
+                                          VkPrimitiveTopology topology)
+    -> VkPipeline {
+  VkShaderModule vertModule = loadShaderModule(vertex);
+  VkShaderModule fragModule = loadShaderModule(fragment);
+
+  VkPipelineShaderStageCreateInfo stages[2]{};
+  stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+  stages[0].module = vertModule;
+  stages[0].pName = "main";
+  stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+  stages[1].module = fragModule;
+  stages[1].pName = "main";
+
+  VkPipelineVertexInputStateCreateInfo vertexInput{};
+  vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+  VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+  inputAssembly.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+  inputAssembly.topology = topology;
+
+  VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                    VK_DYNAMIC_STATE_SCISSOR};
+  VkPipelineDynamicStateCreateInfo dynamicState{};
+  dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+  dynamicState.dynamicStateCount = 2;
+  dynamicState.pDynamicStates = dynamicStates;
+
+  VkPipelineViewportStateCreateInfo viewportState{};
+  viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount = 1;
+
+  VkPipelineRasterizationStateCreateInfo rasterizer{};
+  rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+  rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+  rasterizer.lineWidth = 1.0f;
+  rasterizer.cullMode = VK_CULL_MODE_NONE;
+
+  VkPipelineMultisampleStateCreateInfo multisampling{};
+  multisampling.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+  multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+  VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+  colorBlendAttachment.colorWriteMask =
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+      VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+  colorBlendAttachment.blendEnable = VK_TRUE;
+  colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+  colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+  VkPipelineColorBlendStateCreateInfo colorBlending{};
+  colorBlending.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+  colorBlending.attachmentCount = 1;
+  colorBlending.pAttachments = &colorBlendAttachment;
+
+  VkGraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+  pipelineInfo.stageCount = 2;
+  pipelineInfo.pStages = stages;
+  pipelineInfo.pVertexInputState = &vertexInput;
+  pipelineInfo.pInputAssemblyState = &inputAssembly;
+  pipelineInfo.pViewportState = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizer;
+  pipelineInfo.pMultisampleState = &multisampling;
+  pipelineInfo.pDepthStencilState = &depthStencil;
+  pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDynamicState = &dynamicState;
+  pipelineInfo.layout = _bindless.pipelineLayout();
+
+  VkPipelineRenderingCreateInfoKHR renderingInfo{};
+  applyRenderTarget(pipelineInfo, renderingInfo, _target);
+
+  VkPipeline pipeline;
+  VkResult result = vkCreateGraphicsPipelines(_device, _pipelineCache, 1,
+                                              &pipelineInfo, nullptr, &pipeline);
+  vkDestroyShaderModule(_device, vertModule, nullptr);
+  vkDestroyShaderModule(_device, fragModule, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create star pipeline");
+  return pipeline;
+}
+
+void StarRenderer::rasterize(VkCommandBuffer cmd,
+                             const StarPushConstants &constants) {
+  if (_mode != Mode::Compute || _count == 0)
+    return;
+  TRACE_GPU_ZONE(cmd, "StarSplat");
+
+  // The previous frame's resolve is done reading before the clear
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                                0, nullptr, 0, nullptr);
+  dispatch.vkCmdFillBuffer(
+      cmd, _accumulation.buffer, 0,
+      VkDeviceSize(_extent.width) * _extent.height * PIXEL_BYTES, 0);
+  VkMemoryBarrier cleared{};
+  cleared.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  cleared.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  cleared.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                                &cleared, 0, nullptr, 0, nullptr);
+
+  StarPushConstants pc = constants;
+  pc.accumulation = _accumulationIndex;
+  pc.width = _extent.width;
+  pc.height = _extent.height;
+  dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _splat);
+  for (const auto &chunk : _chunks) {
+    pc.stars = chunk.index;
+    pc.count = chunk.count;
+    dispatch.vkCmdPushConstants(cmd, _bindless.pipelineLayout(),
+                                VK_SHADER_STAGE_ALL, 0, sizeof(pc), &pc);
+    dispatch.vkCmdDispatch(
+        cmd, (chunk.count + SPLAT_GROUP_SIZE - 1) / SPLAT_GROUP_SIZE, 1, 1);
+  }
+
+  VkMemoryBarrier splatted{};
+  splatted.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  splatted.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  splatted.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dispatch.vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1,
+                                &splatted, 0, nullptr, 0, nullptr);
+}
+
+void StarRenderer::setViewport(VkCommandBuffer cmd) {
+  VkViewport viewport{};
+  viewport.width = static_cast<float>(_extent.width);
+  viewport.height = static_cast<float>(_extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  dispatch.vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+  VkRect2D scissor{};
+  scissor.extent = _extent;
+  dispatch.vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+void StarRenderer::recordCommands(VkCommandBuffer cmd,
+                                  const StarPushConstants &constants) {
+  if (_count == 0)
+    return;
+  TRACE_GPU_ZONE(cmd, "Stars");
+  setViewport(cmd);
+  StarPushConstants pc = constants;
+  pc.accumulation = _accumulationIndex;
+  pc.width = _extent.width;
+  pc.height = _extent.height;
+
+  if (_mode == Mode::Compute) {
+    dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _resolve);
+    dispatch.vkCmdPushConstants(cmd, _bindless.pipelineLayout(),
+                                VK_SHADER_STAGE_ALL, 0, sizeof(pc), &pc);
+    dispatch.vkCmdDraw(cmd, 3, 1, 0, 0);
+    return;
+  }
+
+  dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _points);
+  for (const auto &chunk : _chunks) {
+    pc.stars = chunk.index;
+    pc.count = chunk.count;
+    dispatch.vkCmdPushConstants(cmd, _bindless.pipelineLayout(),
+                                VK_SHADER_STAGE_ALL, 0, sizeof(pc), &pc);
+    dispatch.vkCmdDraw(cmd, chunk.count, 1, 0, 0);
+  }
+}
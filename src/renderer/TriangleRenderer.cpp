@@ -1,4 +1,6 @@
 #include "TriangleRenderer.hpp"
+#include "Trace.hpp"
+#include "VulkanDispatch.hpp"
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -14,9 +16,10 @@ static std::vector<char> readFile(const std::string &filename) {
   return buffer;
 }
 
-TriangleRenderer::TriangleRenderer(VkDevice device, VkRenderPass renderPass,
+TriangleRenderer::TriangleRenderer(VkDevice device,
+                                   const RenderTargetLayout &target,
                                    VkExtent2D extent)
-    : device_(device), renderPass_(renderPass), extent_(extent) {
+    : device_(device), target_(target), extent_(extent) {
   createPipeline();
 }
 
@@ -28,6 +31,7 @@ TriangleRenderer::~TriangleRenderer() {
 }
 
 VkShaderModule TriangleRenderer::loadShaderModule(const char *path) {
+  TRACE_ZONE("TriangleRenderer::loadShaderModule");
   auto code = readFile(path);
   VkShaderModuleCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -43,6 +47,7 @@ VkShaderModule TriangleRenderer::loadShaderModule(const char *path) {
 }
 
 void TriangleRenderer::createPipeline() {
+  TRACE_ZONE("TriangleRenderer::createPipeline");
   // Load shaders
   VkShaderModule vertModule =
       loadShaderModule("build/shaders/triangle.vert.spv");
@@ -126,6 +131,13 @@ void TriangleRenderer::createPipeline() {
   colorBlending.attachmentCount = 1;
   colorBlending.pAttachments = &colorBlendAttachment;
 
+  // Overlay: no depth test against the scene
+  VkPipelineDepthStencilStateCreateInfo depthStencil{};
+  depthStencil.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+  depthStencil.depthTestEnable = VK_FALSE;
+  depthStencil.depthWriteEnable = VK_FALSE;
+
   // Pipeline layout (empty for now)
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -148,9 +160,11 @@ void TriangleRenderer::createPipeline() {
   pipelineInfo.pRasterizationState = &rasterizer;
   pipelineInfo.pMultisampleState = &multisampling;
   pipelineInfo.pColorBlendState = &colorBlending;
+  pipelineInfo.pDepthStencilState = &depthStencil;
   pipelineInfo.layout = pipelineLayout_;
-  pipelineInfo.renderPass = renderPass_;
-  pipelineInfo.subpass = 0;
+
+  VkPipelineRenderingCreateInfoKHR renderingInfo{};
+  applyRenderTarget(pipelineInfo, renderingInfo, target_);
 
   if (vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &pipelineInfo,
                                 nullptr, &graphicsPipeline_) != VK_SUCCESS) {
@@ -162,8 +176,10 @@ void TriangleRenderer::createPipeline() {
 }
 
 void TriangleRenderer::recordCommands(VkCommandBuffer cmd) {
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
-  vkCmdDraw(cmd, 3, 1, 0, 0);
+  TRACE_GPU_ZONE(cmd, "Triangle");
+  vulkan::dispatch.vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                     graphicsPipeline_);
+  vulkan::dispatch.vkCmdDraw(cmd, 3, 1, 0, 0);
 }
 
 void TriangleRenderer::resize(VkExtent2D newExtent) {
@@ -0,0 +1,135 @@
+#include "GalaxyGenerator.hpp"
+#include "JobSystem.hpp"
+#include "SimdMath.hpp"
+#include "StarCatalog.hpp"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static auto sameStars(const std::vector<Star> &a, const std::vector<Star> &b)
+    -> bool {
+  return a.size() == b.size() &&
+         std::memcmp(a.data(), b.data(), a.size() * sizeof(Star)) == 0;
+}
+
+// Every component, with a few web nodes so filaments are cheap
+static auto smallGalaxy() -> GalaxyDesc {
+  GalaxyDesc desc;
+  desc.seed = 1234;
+  desc.stars = 100003; // not a multiple of the block or group size
+  desc.radius = 500.0f;
+  desc.filamentShare = 0.05f;
+  desc.webNodes = 16;
+  desc.webSize = 20000.0f;
+  return desc;
+}
+
+TEST(SimdMath, LogExpSinCosMatchLibm) {
+  double worst[4] = {};
+  for (int i = 0; i < 4096; i++) {
+    float x[4];
+    for (int lane = 0; lane < 4; lane++)
+      x[lane] = (i * 4 + lane) * 0.01f - 80.0f;
+    float logs[4], exps[4], sines[4], cosines[4], positive[4];
+    for (int lane = 0; lane < 4; lane++)
+      positive[lane] = std::exp2(x[lane] * 0.5f);
+    simd::store(logs, simd::log(simd::load(positive)));
+    simd::store(exps, simd::exp(simd::load(x)));
+    simd::float4 s, c;
+    simd::sincos(simd::load(x), s, c);
+    simd::store(sines, s);
+    simd::store(cosines, c);
+    for (int lane = 0; lane < 4; lane++) {
+      double p = positive[lane], v = x[lane];
+      worst[0] = std::max(worst[0], std::abs(logs[lane] - std::log(p)) /
+                                        std::max(1.0, std::abs(std::log(p))));
+      worst[1] = std::max(worst[1], std::abs(exps[lane] - std::exp(v)) /
+                                        std::exp(v));
+      worst[2] = std::max(worst[2], std::abs(sines[lane] - std::sin(v)));
+      worst[3] = std::max(worst[3], std::abs(cosines[lane] - std::cos(v)));
+    }
+  }
+  EXPECT_LT(worst[0], 1e-6);
+  EXPECT_LT(worst[1], 1e-6);
+  EXPECT_LT(worst[2], 1e-6);
+  EXPECT_LT(worst[3], 1e-6);
+}
+
+TEST(GalaxyGenerator, SameStarsForAnySplitAndThreadCount) {
+  GalaxyGenerator galaxy(smallGalaxy());
+  uint32_t count = galaxy.count();
+  std::vector<Star> serial(count), parallel(count), pieces(count);
+  galaxy.generate(serial.data(), 0, count);
+
+  JobSystem jobs(3);
+  galaxy.generate(parallel.data(), 0, count, &jobs);
+  EXPECT_TRUE(sameStars(serial, parallel));
+
+  // Ranges that start and end inside blocks and four-star groups
+  for (uint32_t first = 0; first < count;) {
+    uint32_t n = std::min(count - first, 6151u);
+    galaxy.generate(pieces.data() + first, first, n, first % 2 ? &jobs : nullptr);
+    first += n;
+  }
+  EXPECT_TRUE(sameStars(serial, pieces));
+
+  GalaxyDesc other = smallGalaxy();
+  other.seed++;
+  std::vector<Star> reseeded(count);
+  GalaxyGenerator(other).generate(reseeded.data(), 0, count);
+  EXPECT_FALSE(sameStars(serial, reseeded));
+}
+
+TEST(GalaxyGenerator, DiskIsThinAndWithinReach) {
+  GalaxyDesc desc = smallGalaxy();
+  desc.bulgeShare = desc.haloShare = desc.clusterShare = 0.0f;
+  desc.filamentShare = 0.0f;
+  GalaxyGenerator galaxy(desc);
+  std::vector<Star> stars(galaxy.count());
+  galaxy.generate(stars.data(), 0, galaxy.count());
+
+  uint32_t inside = 0;
+  double height = 0.0;
+  for (const Star &star : stars) {
+    ASSERT_TRUE(std::isfinite(star.position.x) &&
+                std::isfinite(star.position.y) &&
+                std::isfinite(star.position.z));
+    float r = std::sqrt(star.position.x * star.position.x +
+                        star.position.z * star.position.z);
+    inside += r < 2.0f * desc.radius;
+    height += std::abs(star.position.y);
+  }
+  EXPECT_GT(inside, stars.size() * 95 / 100);
+  EXPECT_LT(height / stars.size(), 0.05 * desc.radius);
+}
+
+TEST(StarCatalog, RoundTripsGeneratedStars) {
+  GalaxyGenerator galaxy(smallGalaxy());
+  uint32_t count = galaxy.count();
+  std::string path = ::testing::TempDir() + "galaxy.vstars";
+  ASSERT_TRUE(
+      StarCatalog::write(path, count, galaxy.desc().seed, galaxy.fill()));
+
+  StarCatalog catalog;
+  ASSERT_TRUE(catalog.open(path));
+  EXPECT_EQ(catalog.count(), count);
+  EXPECT_EQ(catalog.header().seed, galaxy.desc().seed);
+
+  uint32_t first = 40000, n = 20000;
+  std::vector<Star> read(n), generated(n);
+  ASSERT_TRUE(catalog.read(read.data(), first, n));
+  galaxy.generate(generated.data(), first, n);
+  EXPECT_TRUE(sameStars(read, generated));
+  for (const Star &star : read) {
+    for (int k = 0; k < 3; k++) {
+      EXPECT_GE(star.position[k], catalog.header().boundsMin[k]);
+      EXPECT_LE(star.position[k], catalog.header().boundsMax[k]);
+    }
+  }
+  EXPECT_FALSE(catalog.read(read.data(), count - 1, 2));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,97 @@
+#include "ImageWrite.hpp"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static auto readFile(const std::string &path) -> std::vector<uint8_t> {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+static auto be32(const uint8_t *p) -> uint32_t {
+  return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 |
+         p[3];
+}
+
+TEST(ImageWrite, Crc32MatchesKnownValue) {
+  const char *text = "123456789";
+  EXPECT_EQ(image::crc32(reinterpret_cast<const uint8_t *>(text), 9),
+            0xCBF43926u);
+}
+
+// Large enough to span several stored deflate blocks
+TEST(ImageWrite, PngRoundTripsThroughStoredBlocks) {
+  const uint32_t width = 300, height = 120;
+  std::vector<uint8_t> rgba(width * height * 4);
+  for (size_t i = 0; i < rgba.size(); i++)
+    rgba[i] = static_cast<uint8_t>(i * 7);
+  std::string path = ::testing::TempDir() + "image_write.png";
+  ASSERT_TRUE(image::writePng(path, width, height, rgba.data()));
+
+  std::vector<uint8_t> file = readFile(path);
+  std::remove(path.c_str());
+  ASSERT_GT(file.size(), 8u);
+  EXPECT_EQ(file[1], 'P');
+
+  std::vector<uint8_t> zlib;
+  size_t at = 8;
+  while (at + 12 <= file.size()) {
+    uint32_t length = be32(&file[at]);
+    std::string type(file.begin() + at + 4, file.begin() + at + 8);
+    ASSERT_LE(at + 12 + length, file.size());
+    EXPECT_EQ(be32(&file[at + 8 + length]),
+              image::crc32(&file[at + 4], 4 + length))
+        << type;
+    if (type == "IHDR") {
+      EXPECT_EQ(be32(&file[at + 8]), width);
+      EXPECT_EQ(be32(&file[at + 12]), height);
+    } else if (type == "IDAT") {
+      zlib.insert(zlib.end(), file.begin() + at + 8,
+                  file.begin() + at + 8 + length);
+    }
+    at += 12 + length;
+  }
+  ASSERT_EQ(at, file.size());
+
+  // Inflate: every block is stored, so this is only header parsing
+  std::vector<uint8_t> raw;
+  size_t p = 2;
+  bool final = false;
+  while (!final) {
+    ASSERT_LE(p + 5, zlib.size());
+    final = zlib[p] & 1;
+    EXPECT_EQ(zlib[p] & 6, 0) << "not a stored block";
+    uint16_t len = zlib[p + 1] | zlib[p + 2] << 8;
+    uint16_t nlen = zlib[p + 3] | zlib[p + 4] << 8;
+    EXPECT_EQ(len, static_cast<uint16_t>(~nlen));
+    raw.insert(raw.end(), zlib.begin() + p + 5, zlib.begin() + p + 5 + len);
+    p += 5 + len;
+  }
+  EXPECT_EQ(p + 4, zlib.size()); // Adler-32 trailer
+
+  ASSERT_EQ(raw.size(), (width * 4 + 1) * height);
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t *row = &raw[y * (width * 4 + 1)];
+    ASSERT_EQ(row[0], 0) << "filter byte, row " << y;
+    ASSERT_TRUE(std::equal(row + 1, row + 1 + width * 4,
+                           &rgba[y * width * 4]))
+        << "row " << y;
+  }
+}
+
+TEST(ImageWrite, PamHasHeaderAndPixels) {
+  const uint8_t rgba[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  std::string path = ::testing::TempDir() + "image_write.pam";
+  ASSERT_TRUE(image::writePam(path, 2, 1, rgba));
+  std::vector<uint8_t> file = readFile(path);
+  std::remove(path.c_str());
+  std::string text(file.begin(), file.end());
+  EXPECT_EQ(text.rfind("P7\nWIDTH 2\nHEIGHT 1\n", 0), 0u);
+  ASSERT_GE(file.size(), 8u);
+  EXPECT_TRUE(std::equal(file.end() - 8, file.end(), rgba));
+}
@@ -0,0 +1,217 @@
+#include "JobSystem.hpp"
+#include "SceneStore.hpp"
+#include "TaskGraph.hpp"
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Enough threads to interleave even on small CI machines
+static constexpr uint32_t WORKERS = 4;
+
+TEST(JobSystem, RunsEveryJobOnce) {
+  JobSystem jobs(WORKERS);
+  std::atomic<uint32_t> ran{0};
+  JobCounter counter;
+  for (int i = 0; i < 1000; i++)
+    jobs.run([&] { ran++; }, &counter);
+  jobs.wait(counter);
+  EXPECT_EQ(ran.load(), 1000u);
+  EXPECT_TRUE(counter.done());
+}
+
+TEST(JobSystem, RunAfterWaitsForEveryDependency) {
+  JobSystem jobs(WORKERS);
+  for (int round = 0; round < 50; round++) {
+    std::atomic<uint32_t> first{0}, second{0};
+    bool orderOk = true;
+    JobCounter a, b, joined;
+    for (int i = 0; i < 20; i++) {
+      jobs.run([&] { first++; }, &a);
+      jobs.run([&] { second++; }, &b);
+    }
+    jobs.runAfter(
+        {&a, &b},
+        [&] { orderOk = first.load() == 20 && second.load() == 20; },
+        &joined);
+    jobs.wait(joined);
+    EXPECT_TRUE(orderOk);
+  }
+}
+
+TEST(JobSystem, RunAfterDrainedCounterRunsImmediately) {
+  JobSystem jobs(WORKERS);
+  JobCounter drained, counter;
+  bool ran = false;
+  jobs.runAfter({&drained}, [&] { ran = true; }, &counter);
+  jobs.wait(counter);
+  EXPECT_TRUE(ran);
+}
+
+TEST(JobSystem, ParallelForCoversRangeExactlyOnce) {
+  JobSystem jobs(WORKERS);
+  for (uint32_t count : {0u, 1u, 7u, 1000u, 65537u}) {
+    for (uint32_t grain : {1u, 64u, 100000u}) {
+      std::vector<std::atomic<uint32_t>> hits(count);
+      jobs.parallelFor(
+          count,
+          [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++)
+              hits[i]++;
+          },
+          grain);
+      for (uint32_t i = 0; i < count; i++)
+        ASSERT_EQ(hits[i].load(), 1u) << "count " << count << " index " << i;
+    }
+  }
+}
+
+TEST(JobSystem, NestedParallelForFromJobs) {
+  JobSystem jobs(WORKERS);
+  std::atomic<uint64_t> sum{0};
+  JobCounter counter;
+  for (int j = 0; j < 8; j++) {
+    jobs.run(
+        [&] {
+          jobs.parallelFor(4096, [&](uint32_t begin, uint32_t end) {
+            sum += end - begin;
+          });
+        },
+        &counter);
+  }
+  jobs.wait(counter);
+  EXPECT_EQ(sum.load(), 8u * 4096u);
+}
+
+TEST(JobSystem, MainThreadJobsRunOnMainThread) {
+  JobSystem jobs(WORKERS);
+  std::thread::id main = std::this_thread::get_id();
+  std::atomic<uint32_t> wrongThread{0};
+  JobCounter counter;
+  for (int i = 0; i < 100; i++) {
+    // Queued from workers, as startup tasks do
+    jobs.run(
+        [&] {
+          jobs.run(
+              [&] {
+                if (std::this_thread::get_id() != main)
+                  wrongThread++;
+              },
+              &counter, JobSystem::Affinity::MainThread);
+        },
+        &counter);
+  }
+  jobs.wait(counter);
+  EXPECT_EQ(wrongThread.load(), 0u);
+}
+
+TEST(JobSystem, BackgroundJobsStayOffTheMainThread) {
+  JobSystem jobs(WORKERS);
+  std::thread::id main = std::this_thread::get_id();
+  std::atomic<uint32_t> ran{0}, onMain{0};
+  JobCounter counter;
+  for (int i = 0; i < 200; i++) {
+    jobs.run(
+        [&] {
+          ran++;
+          if (std::this_thread::get_id() == main)
+            onMain++;
+        },
+        &counter, JobSystem::Affinity::Background);
+  }
+  // The main thread helps with ordinary jobs meanwhile, but never these
+  jobs.parallelFor(1 << 16, [](uint32_t, uint32_t) {});
+  jobs.wait(counter);
+  EXPECT_EQ(ran.load(), 200u);
+  EXPECT_EQ(onMain.load(), 0u);
+}
+
+TEST(JobSystem, WorkersStealFromMainDeque) {
+  JobSystem jobs(WORKERS);
+  std::mutex mutex;
+  std::set<uint32_t> threads;
+  JobCounter counter;
+  for (int i = 0; i < 256; i++) {
+    jobs.run(
+        [&] {
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+          std::lock_guard<std::mutex> lock(mutex);
+          threads.insert(jobs.threadIndex());
+        },
+        &counter);
+  }
+  jobs.wait(counter);
+  EXPECT_GT(threads.size(), 1u);
+}
+
+TEST(JobSystem, ThrowingJobStillDrainsCounter) {
+  JobSystem jobs(WORKERS);
+  JobCounter counter;
+  jobs.run([] { throw std::runtime_error("expected"); }, &counter);
+  jobs.wait(counter);
+  EXPECT_TRUE(counter.done());
+}
+
+TEST(TaskGraph, RunsInDependencyOrderAndSkipsAfterFailure) {
+  JobSystem jobs(WORKERS);
+  std::atomic<bool> aDone{false};
+  bool bSawA = false, skippedRan = false;
+  bool mainThreadOk = false;
+  std::thread::id main = std::this_thread::get_id();
+
+  TaskGraph graph;
+  auto a = graph.add("a", [&] {
+    aDone = true;
+    return true;
+  });
+  graph.add(
+      "b",
+      [&] {
+        bSawA = aDone.load();
+        mainThreadOk = std::this_thread::get_id() == main;
+        return true;
+      },
+      {a}, TaskGraph::Affinity::MainThread);
+  auto failing = graph.add("failing", [] { return false; });
+  graph.add("skipped", [&] { return skippedRan = true; }, {failing, a});
+
+  EXPECT_FALSE(graph.run(jobs));
+  EXPECT_TRUE(bSawA);
+  EXPECT_TRUE(mainThreadOk);
+  EXPECT_FALSE(skippedRan);
+  EXPECT_FALSE(graph.timings()[3].ran);
+}
+
+TEST(SceneStore, ParallelPropagationMatchesSerial) {
+  JobSystem jobs(WORKERS);
+  vulkan::SceneStore parallel, serial;
+  glm::mat4 step = glm::rotate(
+      glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.0f)), 0.1f,
+      glm::vec3(0, 1, 0));
+  for (auto *store : {&parallel, &serial}) {
+    for (int r = 0; r < 64; r++) {
+      vulkan::SceneNode root = store->create(glm::mat4(1.0f));
+      for (int c = 0; c < 64; c++) {
+        vulkan::SceneNode child = store->create(step, root);
+        for (int g = 0; g < 8; g++)
+          store->create(step, child);
+      }
+    }
+  }
+  parallel.propagate(&jobs);
+  serial.propagate();
+
+  for (vulkan::SceneNode node = 0; node < serial.size(); node++) {
+    const glm::mat4 &p = parallel.world(node);
+    const glm::mat4 &s = serial.world(node);
+    for (int c = 0; c < 4; c++)
+      for (int r = 0; r < 4; r++)
+        ASSERT_EQ(p[c][r], s[c][r]) << "node " << node;
+  }
+}
@@ -0,0 +1,164 @@
+// NBodySimulation's octree against the direct sum, its determinism across
+// thread counts, and NBodyCompute's step against the same direct sum. The
+// compute test needs a Vulkan device and the n-body shader, and skips
+// without them.
+
+#include "GalaxyGenerator.hpp"
+#include "JobSystem.hpp"
+#include "NBodyCompute.hpp"
+#include "NBodySimulation.hpp"
+#include "VulkanCore.hpp"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// A small galaxy with its bulge and halo, so the tree has dense and sparse
+// regions, on circular orbits
+static auto smallSystem(uint32_t count) -> NBodySnapshot {
+  GalaxyDesc desc;
+  desc.seed = 99;
+  desc.stars = count;
+  desc.radius = 2000.0f;
+  GalaxyGenerator galaxy(desc);
+  std::vector<Star> stars(count);
+  galaxy.generate(stars.data(), 0, count);
+  return makeRotatingSnapshot(std::move(stars), 1e10f, 20.0f);
+}
+
+// Root mean square of |a - reference| over root mean square of |reference|
+static auto relativeError(const std::vector<glm::vec3> &a,
+                          const std::vector<glm::vec3> &reference) -> double {
+  double error = 0.0, norm = 0.0;
+  for (size_t i = 0; i < a.size(); i++) {
+    glm::vec3 d = a[i] - reference[i];
+    error += glm::dot(d, d);
+    norm += glm::dot(reference[i], reference[i]);
+  }
+  return std::sqrt(error / norm);
+}
+
+TEST(NBodySimulation, OctreeMatchesDirectSum) {
+  NBodySettings settings;
+  settings.softening = 20.0f;
+  NBodySimulation sim(smallSystem(8000), settings);
+  JobSystem jobs(3);
+  std::vector<glm::vec3> reference, tree;
+  NBodySimulation::directAccelerations(sim.snapshot(), settings.softening,
+                                       reference, &jobs);
+  sim.accelerations(tree, &jobs);
+  EXPECT_LT(relativeError(tree, reference), 1e-2);
+  // Far fewer terms than the N^2 of the direct sum
+  uint64_t n = sim.snapshot().count();
+  EXPECT_LT(sim.interactions(), n * n / 10);
+
+  // Opening every cell sums every body: the direct sum up to float rounding
+  settings.theta = 0.0f;
+  sim.setSettings(settings);
+  sim.accelerations(tree, &jobs);
+  EXPECT_LT(relativeError(tree, reference), 1e-5);
+  EXPECT_EQ(sim.interactions(), n * n);
+}
+
+TEST(NBodySimulation, TreeCoversEveryBodyOnce) {
+  NBodySimulation sim(smallSystem(30001));
+  std::vector<glm::vec3> out;
+  sim.accelerations(out);
+  const auto &nodes = sim.nodes();
+  ASSERT_FALSE(nodes.empty());
+  EXPECT_EQ(nodes[0].next, nodes.size());
+  std::vector<uint32_t> seen(sim.snapshot().count(), 0);
+  double mass = 0.0;
+  for (const OctreeNode &node : nodes) {
+    for (uint32_t k = node.first; k < node.first + node.count; k++)
+      seen[k]++;
+    mass += node.count ? node.mass : 0.0;
+  }
+  for (uint32_t count : seen)
+    ASSERT_EQ(count, 1u);
+  EXPECT_NEAR(mass, nodes[0].mass, 1e-4 * nodes[0].mass);
+}
+
+TEST(NBodySimulation, SameStepsOnAnyThreadCount) {
+  NBodySnapshot start = smallSystem(20000);
+  NBodySimulation serial(start), threaded(start);
+  JobSystem jobs(5);
+  for (int i = 0; i < 3; i++) {
+    serial.step();
+    threaded.step(&jobs);
+  }
+  const NBodySnapshot &a = serial.snapshot(), &b = threaded.snapshot();
+  EXPECT_EQ(std::memcmp(a.stars.data(), b.stars.data(),
+                        a.stars.size() * sizeof(Star)),
+            0);
+  EXPECT_EQ(std::memcmp(a.motion.data(), b.motion.data(),
+                        a.motion.size() * sizeof(BodyMotion)),
+            0);
+  EXPECT_DOUBLE_EQ(a.time, 3.0 * serial.settings().dt);
+  EXPECT_EQ(serial.interactions(), threaded.interactions());
+}
+
+TEST(NBodySimulation, RotatingStartStaysBound) {
+  NBodySettings settings;
+  settings.softening = 20.0f;
+  settings.dt = 0.1f; // the inner orbits take a few megayears
+  NBodySimulation sim(smallSystem(10000), settings);
+  JobSystem jobs(3);
+  auto meanRadius = [&] {
+    double sum = 0.0;
+    for (const Star &star : sim.snapshot().stars)
+      sum += glm::length(star.position);
+    return sum / sim.snapshot().count();
+  };
+  double before = meanRadius();
+  for (int i = 0; i < 50; i++)
+    sim.step(&jobs);
+  // Neither collapsing nor flying apart over a fraction of an orbit
+  EXPECT_NEAR(meanRadius(), before, 0.1 * before);
+}
+
+TEST(NBodyCompute, StepMatchesDirectSum) {
+  std::ifstream file(VKAPP_SHADER_DIR "/nbody.comp.spv", std::ios::binary);
+  std::vector<char> code{std::istreambuf_iterator<char>(file),
+                         std::istreambuf_iterator<char>()};
+  vulkan::VulkanCore core;
+  if (code.empty() || !core.initializeHeadless({16, 16}))
+    GTEST_SKIP() << "Needs a Vulkan device and the n-body shader";
+
+  // Not a multiple of the group size, so the last tile is partial
+  NBodySnapshot start = smallSystem(3000);
+  NBodySettings settings;
+  settings.softening = 20.0f;
+  settings.dt = 0.1f;
+  NBodySnapshot stepped;
+  {
+    NBodyCompute compute(core.device(), core.physicalDevice(),
+                         core.bindless(), VK_NULL_HANDLE, &code);
+    compute.upload(core.graphicsQueue(), core.profile().graphicsFamily, start);
+    compute.simulate(core.graphicsQueue(), core.profile().graphicsFamily, 1,
+                     settings);
+    compute.download(core.graphicsQueue(), core.profile().graphicsFamily,
+                     stepped);
+  }
+  core.waitIdle();
+
+  // The kick recovers the accelerations the shader summed
+  ASSERT_EQ(stepped.count(), start.count());
+  EXPECT_DOUBLE_EQ(stepped.time, settings.dt);
+  std::vector<glm::vec3> reference, gpu(start.count());
+  NBodySimulation::directAccelerations(start, settings.softening, reference);
+  for (uint32_t i = 0; i < start.count(); i++) {
+    gpu[i] = (stepped.motion[i].velocity - start.motion[i].velocity) /
+             settings.dt;
+    EXPECT_EQ(stepped.motion[i].mass, start.motion[i].mass);
+    EXPECT_EQ(stepped.stars[i].color, start.stars[i].color);
+    glm::vec3 drift = start.stars[i].position +
+                      stepped.motion[i].velocity * settings.dt;
+    ASSERT_LT(glm::length(stepped.stars[i].position - drift), 1e-2f);
+  }
+  EXPECT_LT(relativeError(gpu, reference), 1e-3);
+}
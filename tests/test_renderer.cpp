@@ -1,25 +1,663 @@
+// Rendering regression tests: GridRenderer drawn headlessly at fixed camera
+// poses and compared with golden images (recorded with VKAPP_UPDATE_GOLDENS=1;
+// none are committed yet), a static grid pass against one
+// recorded every frame, StarRenderer's compute path checked against its
+// hardware points, plus CPU frame-time and allocation budgets per scenario.
+// All need a Vulkan device; without one (no GPU and no software ICD) they
+// skip. Run on lavapipe for reproducible images:
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json ctest
+
+#include "Camera.hpp"
+#include "CameraPath.hpp"
+#include "GridRenderer.hpp"
+#include "ImageWrite.hpp"
+#include "StarRenderer.hpp"
+#include "VulkanCore.hpp"
+
 #include <gtest/gtest.h>
-#include "../src/renderer.cpp" // Include the renderer implementation for testing
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ---- allocation counting -------------------------------------------------
+
+static std::atomic<uint64_t> g_allocCount{0};
+
+void *operator new(std::size_t size) {
+  g_allocCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+// ---- images ----------------------------------------------------------------
+
+static constexpr VkExtent2D EXTENT{160, 90};
+// Per-channel difference tolerated anywhere (rasterization and blending
+// rounding differ between drivers), and the share of pixels allowed past it
+// (edge coverage of thin grid lines)
+static constexpr int CHANNEL_TOLERANCE = 8;
+static constexpr double MAX_MISMATCH_FRACTION = 0.005;
+
+struct Image {
+  uint32_t width = 0, height = 0;
+  std::vector<uint8_t> rgba;
+};
+
+static auto readFile(const std::string &path) -> std::vector<uint8_t> {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+// Largest color channel difference at byte offset i (alpha is always opaque)
+static auto pixelDelta(const Image &a, const Image &b, size_t i) -> int {
+  int delta = 0;
+  for (int c = 0; c < 3; c++)
+    delta = std::max(delta, std::abs(a.rgba[i + c] - b.rgba[i + c]));
+  return delta;
+}
+
+// Share of pixels differing by more than CHANNEL_TOLERANCE; same-size images
+static auto mismatchFraction(const Image &a, const Image &b) -> double {
+  size_t mismatched = 0;
+  for (size_t i = 0; i < a.rgba.size(); i += 4)
+    mismatched += pixelDelta(a, b, i) > CHANNEL_TOLERANCE;
+  return static_cast<double>(mismatched) / (a.rgba.size() / 4);
+}
+
+static auto be32(const uint8_t *p) -> uint32_t {
+  return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 |
+         p[3];
+}
+
+// Reads the RGBA8 PNGs image::writePng produces (stored deflate blocks, no
+// filtering). Recompressed goldens have to be re-recorded.
+static auto readGolden(const std::string &path, Image &out) -> bool {
+  std::vector<uint8_t> file = readFile(path);
+  if (file.size() < 8 || file[1] != 'P')
+    return false;
+
+  std::vector<uint8_t> zlib;
+  for (size_t at = 8; at + 12 <= file.size();) {
+    uint32_t length = be32(&file[at]);
+    std::string type(file.begin() + at + 4, file.begin() + at + 8);
+    if (at + 12 + length > file.size())
+      return false;
+    const uint8_t *data = &file[at + 8];
+    if (type == "IHDR") {
+      out.width = be32(data);
+      out.height = be32(data + 4);
+      if (data[8] != 8 || data[9] != 6)
+        return false; // not RGBA8
+    } else if (type == "IDAT") {
+      zlib.insert(zlib.end(), data, data + length);
+    }
+    at += 12 + length;
+  }
+
+  std::vector<uint8_t> raw;
+  for (size_t p = 2; p + 5 <= zlib.size();) {
+    if (zlib[p] & 6)
+      return false; // compressed block
+    bool final = zlib[p] & 1;
+    size_t len = zlib[p + 1] | zlib[p + 2] << 8;
+    if (p + 5 + len > zlib.size())
+      return false;
+    raw.insert(raw.end(), zlib.begin() + p + 5, zlib.begin() + p + 5 + len);
+    p += 5 + len;
+    if (final)
+      break;
+  }
+
+  size_t row = size_t(out.width) * 4;
+  if (raw.size() != (row + 1) * out.height)
+    return false;
+  out.rgba.resize(row * out.height);
+  for (uint32_t y = 0; y < out.height; y++) {
+    if (raw[y * (row + 1)] != 0)
+      return false; // filtered scanline
+    std::copy_n(&raw[y * (row + 1) + 1], row, &out.rgba[y * row]);
+  }
+  return true;
+}
+
+// ---- devices and shaders ---------------------------------------------------
 
-class RendererTest : public ::testing::Test {
+// Initializes core to render headlessly at EXTENT with the resolution fixed;
+// views and static passes are set beforehand. False without a device.
+static auto initHeadless(vulkan::VulkanCore &core) -> bool {
+  vulkan::DynamicResolutionSettings fixed;
+  fixed.enabled = false;
+  core.setDynamicResolution(fixed);
+  return core.initializeHeadless(EXTENT);
+}
+
+// Compiled shaders from VKAPP_SHADER_DIR; false when one is missing
+static auto loadShaders(
+    std::initializer_list<std::pair<const char *, std::vector<char> *>> files)
+    -> bool {
+  for (auto [file, code] : files) {
+    auto bytes = readFile(std::string(VKAPP_SHADER_DIR "/") + file);
+    if (bytes.empty())
+      return false;
+    code->assign(bytes.begin(), bytes.end());
+  }
+  return true;
+}
+
+static auto loadGridShaders(GridShaders &shaders, bool multiview = false)
+    -> bool {
+  if (multiview)
+    return loadShaders(
+        {{"grid_multiview.vert.spv", &shaders.multiviewVertex},
+         {"grid_multiview.frag.spv", &shaders.multiviewFragment}});
+  return loadShaders({{"grid.vert.spv", &shaders.vertex},
+                      {"grid.frag.spv", &shaders.fragment}});
+}
+
+// ---- budgets ---------------------------------------------------------------
+
+// `key = value` lines as in vkapp.cfg; VKAPP_BUDGET_TOLERANCE overrides
+// the `tolerance` key
+static auto loadBudgets() -> std::map<std::string, double> {
+  std::map<std::string, double> budgets;
+  std::ifstream in(VKAPP_BUDGET_FILE);
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    auto eq = line.find('=');
+    if (eq == std::string::npos)
+      continue;
+    std::istringstream key(line.substr(0, eq)), value(line.substr(eq + 1));
+    std::string name;
+    double number;
+    if (key >> name && value >> number)
+      budgets[name] = number;
+  }
+  if (const char *tolerance = std::getenv("VKAPP_BUDGET_TOLERANCE"))
+    budgets["tolerance"] = std::strtod(tolerance, nullptr);
+  return budgets;
+}
+
+static auto percentile(std::vector<float> samples, double q) -> double {
+  if (samples.empty())
+    return 0.0;
+  std::sort(samples.begin(), samples.end());
+  size_t i = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+  return samples[std::min(i, samples.size() - 1)];
+}
+
+// ---- fixture ---------------------------------------------------------------
+
+// One headless device and grid pipeline for the whole suite
+class GridRenderTest : public ::testing::Test {
 protected:
-    Renderer* renderer;
+  static void SetUpTestSuite() {
+    auto core = std::make_unique<vulkan::VulkanCore>();
+    GridShaders shaders;
+    if (!initHeadless(*core) || !loadGridShaders(shaders))
+      return;
+    s_grid = std::make_unique<GridRenderer>(
+        core->device(), core->renderTargetLayout(), EXTENT, VK_NULL_HANDLE,
+        &shaders, core->bindless().pipelineLayout());
+    s_core = std::move(core);
+  }
+
+  static void TearDownTestSuite() {
+    if (s_core)
+      s_core->waitIdle();
+    s_grid.reset();
+    s_core.reset();
+  }
+
+  void SetUp() override {
+    if (!s_core)
+      GTEST_SKIP() << "No Vulkan device or grid shaders; point "
+                      "VK_ICD_FILENAMES at a software ICD such as lavapipe";
+  }
+
+  static auto camera() -> Camera {
+    return Camera(EXTENT.width / static_cast<float>(EXTENT.height));
+  }
+
+  static void drawFrame(const Camera &camera) {
+    GridPushConstants constants = GridRenderer::makeConstants(camera);
+    s_core->drawFrame([&](VkCommandBuffer cmd, uint32_t) {
+      s_grid->recordCommands(cmd, constants);
+    });
+  }
+
+  static std::unique_ptr<vulkan::VulkanCore> s_core;
+  static std::unique_ptr<GridRenderer> s_grid;
+};
+
+std::unique_ptr<vulkan::VulkanCore> GridRenderTest::s_core;
+std::unique_ptr<GridRenderer> GridRenderTest::s_grid;
+
+// ---- golden images ---------------------------------------------------------
+
+struct GoldenPose {
+  const char *name;
+  glm::vec3 position; // the camera looks at the origin
+  GridVariant variant;
+};
+
+static auto singleLevelVariant() -> GridVariant {
+  GridVariant variant;
+  variant.levels = 1;
+  variant.axes = false;
+  variant.color = glm::vec3(0.1f, 0.5f, 0.3f);
+  return variant;
+}
 
-    void SetUp() override {
-        renderer = new Renderer();
-        // Additional setup code if needed
+static const GoldenPose goldenPoses[] = {
+    {"default", {0.0f, 5.0f, 10.0f}, {}},
+    {"low_grazing", {-12.0f, 0.2f, 9.0f}, {}},
+    {"overhead", {0.5f, 60.0f, 0.5f}, {}},
+    {"far_lod", {300.0f, 250.0f, -400.0f}, {}},
+    {"single_level", {0.0f, 5.0f, 10.0f}, singleLevelVariant()},
+};
+
+static void PrintTo(const GoldenPose &pose, std::ostream *os) {
+  *os << pose.name;
+}
+
+class GridGoldenTest : public GridRenderTest,
+                       public ::testing::WithParamInterface<GoldenPose> {};
+
+TEST_P(GridGoldenTest, MatchesGolden) {
+  const GoldenPose &pose = GetParam();
+  s_grid->setVariant(pose.variant);
+  Camera cam = camera();
+  cam.setPosition(pose.position);
+  cam.update(0.0f);
+  drawFrame(cam);
+
+  Image actual{EXTENT.width, EXTENT.height, {}};
+  ASSERT_TRUE(s_core->readHeadlessTarget(actual.rgba));
+
+  std::string file = std::string("grid_") + pose.name + ".png";
+  std::string golden = std::string(VKAPP_GOLDEN_DIR) + "/" + file;
+  std::string output = std::string(VKAPP_TEST_OUTPUT_DIR) + "/" + file;
+  std::filesystem::create_directories(VKAPP_TEST_OUTPUT_DIR);
+
+  if (std::getenv("VKAPP_UPDATE_GOLDENS")) {
+    ASSERT_TRUE(image::writePng(golden, actual.width, actual.height,
+                                actual.rgba.data()));
+    GTEST_SKIP() << "Recorded " << golden;
+  }
+  Image expected;
+  if (!readGolden(golden, expected)) {
+    image::writePng(output, actual.width, actual.height, actual.rgba.data());
+    GTEST_SKIP() << "No golden at " << golden << "; wrote " << output
+                 << ". Re-run with VKAPP_UPDATE_GOLDENS=1 to record it.";
+  }
+  ASSERT_EQ(expected.width, actual.width);
+  ASSERT_EQ(expected.height, actual.height);
+
+  // Mismatching pixels are painted red in the diff image
+  std::vector<uint8_t> diff(actual.rgba.size());
+  int maxDelta = 0;
+  for (size_t i = 0; i < actual.rgba.size(); i += 4) {
+    int delta = pixelDelta(actual, expected, i);
+    maxDelta = std::max(maxDelta, delta);
+    bool bad = delta > CHANNEL_TOLERANCE;
+    uint8_t grey = actual.rgba[i + 1] / 4;
+    diff[i] = bad ? 255 : grey;
+    diff[i + 1] = bad ? 0 : grey;
+    diff[i + 2] = bad ? 0 : grey;
+    diff[i + 3] = 255;
+  }
+
+  double fraction = mismatchFraction(actual, expected);
+  RecordProperty("mismatch_fraction", std::to_string(fraction));
+  RecordProperty("max_channel_delta", maxDelta);
+  if (fraction > MAX_MISMATCH_FRACTION) {
+    image::writePng(output, actual.width, actual.height, actual.rgba.data());
+    std::string diffPath = std::string(VKAPP_TEST_OUTPUT_DIR) + "/grid_" +
+                           pose.name + "_diff.png";
+    image::writePng(diffPath, actual.width, actual.height, diff.data());
+    ADD_FAILURE() << fraction * 100.0 << "% of pixels differ by more than "
+                  << CHANNEL_TOLERANCE << " (max " << maxDelta
+                  << "); see " << output << " and " << diffPath;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Poses, GridGoldenTest, ::testing::ValuesIn(goldenPoses),
+    [](const ::testing::TestParamInfo<GoldenPose> &info) {
+      return std::string(info.param.name);
+    });
+
+TEST_F(GridRenderTest, VariantsCompileOncePerKey) {
+  GridVariant base;
+  GridVariant other = singleLevelVariant();
+  s_grid->setVariant(base);
+  size_t before = s_grid->variantCount();
+  s_grid->setVariant(other);
+  s_grid->setVariant(base);
+  s_grid->setVariant(other);
+  EXPECT_LE(s_grid->variantCount(), before + 1);
+  EXPECT_TRUE(s_grid->variant() == other);
+  s_grid->setVariant(base);
+}
+
+// ---- multiple views --------------------------------------------------------
+
+// A stereo pair of the default pose drawn with the given view mode on its own
+// headless device. False when there is no device, or multiview was asked for
+// and the device fell back to separate passes.
+static auto renderStereo(vulkan::VulkanCore::ViewMode mode, Image &out)
+    -> bool {
+  constexpr uint32_t VIEWS = 2;
+  constexpr float SEPARATION = 0.5f;
+  vulkan::VulkanCore core;
+  core.setViews(VIEWS, mode);
+  if (!initHeadless(core) || core.viewCount() != VIEWS)
+    return false;
+  bool multiview = mode == vulkan::VulkanCore::ViewMode::Multiview;
+  GridShaders shaders;
+  if (core.usesMultiview() != multiview ||
+      !loadGridShaders(shaders, multiview))
+    return false;
+  {
+    GridRenderer grid(core.device(), core.renderTargetLayout(),
+                      core.renderExtent(), VK_NULL_HANDLE, &shaders,
+                      core.bindless().pipelineLayout());
+    if (multiview)
+      grid.enableMultiview(core.physicalDevice(), core.bindless(),
+                           core.framesInFlight());
+
+    VkExtent2D view = core.renderExtent();
+    Camera cam(view.width / static_cast<float>(view.height));
+    cam.setPosition({0.0f, 5.0f, 10.0f});
+    GridPushConstants constants[VIEWS];
+    for (uint32_t v = 0; v < VIEWS; v++)
+      constants[v] = GridRenderer::makeConstants(
+          cam.getViewProjectionMatrix(v, VIEWS, SEPARATION),
+          cam.getViewPosition(v, VIEWS, SEPARATION));
+    core.drawFrame([&](VkCommandBuffer cmd, uint32_t) {
+      if (multiview)
+        grid.recordViews(cmd, core.frameIndex(), constants, VIEWS);
+      else
+        grid.recordCommands(cmd, constants[core.viewIndex()]);
+    });
+    out = {EXTENT.width, EXTENT.height, {}};
+    if (!core.readHeadlessTarget(out.rgba))
+      return false;
+  }
+  core.waitIdle();
+  return true;
+}
+
+TEST(MultiviewRenderTest, MatchesPerViewPasses) {
+  Image passes, multiview;
+  if (!renderStereo(vulkan::VulkanCore::ViewMode::PerViewPasses, passes) ||
+      !renderStereo(vulkan::VulkanCore::ViewMode::Multiview, multiview))
+    GTEST_SKIP() << "Needs a Vulkan device with multiview and the grid shaders";
+
+  ASSERT_EQ(passes.rgba.size(), multiview.rgba.size());
+  EXPECT_LE(mismatchFraction(passes, multiview), MAX_MISMATCH_FRACTION);
+
+  // The two halves come from different eyes
+  size_t half = EXTENT.width / 2 * 4, differing = 0;
+  for (uint32_t y = 0; y < EXTENT.height; y++) {
+    const uint8_t *row = &multiview.rgba[y * EXTENT.width * 4];
+    differing += !std::equal(row, row + half, row + half);
+  }
+  EXPECT_GT(differing, 0u);
+}
+
+// ---- static passes ---------------------------------------------------------
+
+// A grid replayed from its secondaries while the camera moves draws what one
+// recorded every frame draws, and is recorded once per frame slot until its
+// variant changes. A second grid drawn inline after the replay reads its view
+// through the bindless set, which the replay must not leave unbound.
+TEST(StaticPassTest, ReplayMatchesInlineRecording) {
+  vulkan::VulkanCore core;
+  core.setStaticPasses(true);
+  GridShaders shaders;
+  if (!loadGridShaders(shaders) || !initHeadless(core) ||
+      !core.canExecuteStatic())
+    GTEST_SKIP() << "Needs a Vulkan device with dynamic rendering, nested "
+                    "command buffers and the grid shaders";
+
+  Image replayed{EXTENT.width, EXTENT.height, {}};
+  Image recorded{EXTENT.width, EXTENT.height, {}};
+  {
+    GridRenderer grid(core.device(), core.renderTargetLayout(), EXTENT,
+                      VK_NULL_HANDLE, &shaders,
+                      core.bindless().pipelineLayout());
+    GridRenderer reference(core.device(), core.renderTargetLayout(), EXTENT,
+                           VK_NULL_HANDLE, &shaders,
+                           core.bindless().pipelineLayout());
+    GridRenderer after(core.device(), core.renderTargetLayout(), EXTENT,
+                       VK_NULL_HANDLE, &shaders,
+                       core.bindless().pipelineLayout());
+    grid.enableStatic(core.physicalDevice(), core.bindless(),
+                      core.framesInFlight(), core.profile().graphicsFamily);
+    after.enableStatic(core.physicalDevice(), core.bindless(),
+                       core.framesInFlight(), core.profile().graphicsFamily);
+
+    Camera cam(EXTENT.width / static_cast<float>(EXTENT.height));
+    const uint32_t frames = core.framesInFlight() + 3;
+    for (uint32_t i = 0; i < frames; i++) {
+      cam.setPosition({0.5f * i, 5.0f, 10.0f - i});
+      cam.update(0.0f);
+      GridPushConstants constants = GridRenderer::makeConstants(cam);
+      bool usedStatic = false;
+      ASSERT_TRUE(core.drawFrame(
+          [&](VkCommandBuffer cmd, uint32_t) {
+            after.recordViews(cmd, core.frameIndex(), &constants, 1);
+          },
+          nullptr,
+          [&] {
+            usedStatic = true;
+            return grid.staticCommands(core.frameIndex(), &constants, 1);
+          }));
+      EXPECT_TRUE(usedStatic);
     }
+    EXPECT_EQ(grid.staticRecordCount(), core.framesInFlight());
+    ASSERT_TRUE(core.readHeadlessTarget(replayed.rgba));
+
+    GridPushConstants constants = GridRenderer::makeConstants(cam);
+    ASSERT_TRUE(core.drawFrame([&](VkCommandBuffer cmd, uint32_t) {
+      reference.recordCommands(cmd, constants);
+      reference.recordCommands(cmd, constants);
+    }));
+    ASSERT_TRUE(core.readHeadlessTarget(recorded.rgba));
+
+    // A new pipeline is baked in, so the next frame records again
+    grid.setVariant(singleLevelVariant());
+    ASSERT_TRUE(core.drawFrame([](VkCommandBuffer, uint32_t) {}, nullptr, [&] {
+      return grid.staticCommands(core.frameIndex(), &constants, 1);
+    }));
+    EXPECT_EQ(grid.staticRecordCount(), core.framesInFlight() + 1);
+    core.waitIdle();
+  }
+
+  EXPECT_LE(mismatchFraction(recorded, replayed), MAX_MISMATCH_FRACTION);
+}
+
+// ---- stars -----------------------------------------------------------------
 
-    void TearDown() override {
-        delete renderer;
+// Isolated stars at pixel centers drawn with the given mode on its own
+// headless device; false when there is no device or no star shaders
+static auto renderStars(StarRenderer::Mode mode, Image &out) -> bool {
+  vulkan::VulkanCore core;
+  StarShaders shaders;
+  if (!loadShaders({{"star_splat.comp.spv", &shaders.splat},
+                    {"star_resolve.vert.spv", &shaders.resolveVertex},
+                    {"star_resolve.frag.spv", &shaders.resolveFragment},
+                    {"star_points.vert.spv", &shaders.pointVertex},
+                    {"star_points.frag.spv", &shaders.pointFragment}}) ||
+      !initHeadless(core))
+    return false;
+
+  Camera cam(EXTENT.width / static_cast<float>(EXTENT.height));
+  cam.setPosition({0.0f, 5.0f, 10.0f});
+  cam.update(0.0f);
+  glm::mat4 viewProj = cam.getViewProjectionMatrix();
+  glm::mat4 inverse = glm::inverse(viewProj);
+  glm::vec3 eye = cam.getViewPosition(0, 1, 0.0f);
+
+  // A sparse lattice of pixel centers, each star 10 pc out so a magnitude 0
+  // star has unit flux at exposure 1
+  constexpr uint32_t STEP = 7;
+  std::vector<Star> stars;
+  for (uint32_t y = 3; y < EXTENT.height; y += STEP) {
+    for (uint32_t x = 3; x < EXTENT.width; x += STEP) {
+      glm::vec4 ndc((x + 0.5f) / EXTENT.width * 2.0f - 1.0f,
+                    (y + 0.5f) / EXTENT.height * 2.0f - 1.0f, 0.0f, 1.0f);
+      glm::vec4 world = inverse * ndc;
+      glm::vec3 dir = glm::normalize(glm::vec3(world) / world.w - eye);
+      glm::vec3 rgb(x / float(EXTENT.width), y / float(EXTENT.height), 0.8f);
+      stars.push_back({eye + dir * 10.0f, packStarColor(rgb, 0.0f)});
     }
+  }
+  {
+    StarRenderer renderer(core.device(), core.physicalDevice(),
+                          core.bindless(), core.renderTargetLayout(), EXTENT,
+                          VK_NULL_HANDLE, &shaders);
+    renderer.setMode(mode);
+    renderer.upload(core.graphicsQueue(), core.profile().graphicsFamily,
+                    stars.data(), static_cast<uint32_t>(stars.size()));
+    StarPushConstants constants =
+        StarRenderer::makeConstants(viewProj, eye, 1.0f);
+    core.drawFrame(
+        [&](VkCommandBuffer cmd, uint32_t) {
+          renderer.recordCommands(cmd, constants);
+        },
+        [&](VkCommandBuffer cmd) {
+          if (mode == StarRenderer::Mode::Compute)
+            renderer.rasterize(cmd, constants);
+        });
+    out = {EXTENT.width, EXTENT.height, {}};
+    bool read = core.readHeadlessTarget(out.rgba);
+    core.waitIdle();
+    if (!read)
+      return false;
+  }
+  return true;
+}
+
+TEST(StarRenderTest, ComputeMatchesRaster) {
+  Image compute, raster;
+  if (!renderStars(StarRenderer::Mode::Compute, compute) ||
+      !renderStars(StarRenderer::Mode::Raster, raster))
+    GTEST_SKIP() << "Needs a Vulkan device and the star shaders";
+
+  ASSERT_EQ(compute.rgba.size(), raster.rgba.size());
+  EXPECT_LE(mismatchFraction(compute, raster), MAX_MISMATCH_FRACTION);
+  size_t lit = 0;
+  for (size_t i = 0; i < compute.rgba.size(); i += 4)
+    lit += *std::max_element(&compute.rgba[i], &compute.rgba[i + 3]) > 64;
+  EXPECT_GT(lit, 0u);
+}
+
+// ---- performance budgets ---------------------------------------------------
+
+struct BudgetScenario {
+  const char *name;
+  std::vector<glm::vec3> points;
 };
 
-TEST_F(RendererTest, InitializationTest) {
-    ASSERT_NO_THROW(renderer->initialize());
+static void PrintTo(const BudgetScenario &scenario, std::ostream *os) {
+  *os << scenario.name;
+}
+
+static const uint32_t BUDGET_WARMUP = 30;
+static const uint32_t BUDGET_FRAMES = 240;
+
+static auto budgetScenarios() -> std::vector<BudgetScenario> {
+  return {
+      {"grid_sweep", {{-40, 6, 40}, {-10, 4, 15}, {10, 5, -5}, {35, 8, -30}}},
+      {"grid_low", {{-30, 0.3f, 20}, {-10, 0.15f, 8}, {20, 0.2f, -6}}},
+      {"grid_climb", {{0, 20, 30}, {40, 120, 40}, {-20, 900, -50}}},
+  };
+}
+
+class GridBudgetTest : public GridRenderTest,
+                       public ::testing::WithParamInterface<BudgetScenario> {};
+
+TEST_P(GridBudgetTest, StaysWithinBudget) {
+  const BudgetScenario &scenario = GetParam();
+  s_grid->setVariant(GridVariant{});
+  CameraPath path(scenario.points);
+  Camera cam = camera();
+
+  std::vector<float> cpuMs;
+  cpuMs.reserve(BUDGET_FRAMES);
+  uint64_t allocStart = 0;
+  uint32_t total = BUDGET_WARMUP + BUDGET_FRAMES;
+  for (uint32_t i = 0; i < total; i++) {
+    if (i == BUDGET_WARMUP)
+      allocStart = g_allocCount.load();
+    path.apply(cam, static_cast<float>(i) / (total - 1));
+    cam.update(0.0f);
+    drawFrame(cam);
+    if (i >= BUDGET_WARMUP)
+      cpuMs.push_back(s_core->lastCpuRecordMs());
+  }
+  double allocsPerFrame =
+      static_cast<double>(g_allocCount.load() - allocStart) / BUDGET_FRAMES;
+  double p95 = percentile(cpuMs, 0.95);
+  s_core->waitIdle();
+
+  RecordProperty("cpu_ms_p95", std::to_string(p95));
+  RecordProperty("allocations_per_frame", std::to_string(allocsPerFrame));
+  std::cout << scenario.name << ": cpu p95 " << p95 << " ms, "
+            << allocsPerFrame << " allocations/frame\n";
+
+#ifdef NDEBUG
+  auto budgets = loadBudgets();
+  double slack = 1.0 + budgets["tolerance"];
+  std::string prefix = std::string(scenario.name) + ".";
+  std::ostringstream unrecorded;
+  for (auto [key, measured] : {std::make_pair("cpu_ms_p95", p95),
+                               std::make_pair("allocations_per_frame",
+                                              allocsPerFrame)}) {
+    auto budget = budgets.find(prefix + key);
+    if (budget == budgets.end()) {
+      unrecorded << " " << prefix << key << " = " << measured;
+      continue;
+    }
+    EXPECT_LE(measured, budget->second * slack)
+        << prefix << key << " regressed past its budget of " << budget->second
+        << " (+" << budgets["tolerance"] * 100.0 << "%)";
+  }
+  // Budgets that were never measured are reported, not made up; the ones
+  // that were recorded have been checked above either way
+  if (!unrecorded.str().empty())
+    std::cout << "No budget recorded in " << VKAPP_BUDGET_FILE
+              << " for:" << unrecorded.str() << "\n";
+#else
+  GTEST_SKIP() << "Budgets are enforced in release builds only: validation "
+                  "layers and sanitizers distort debug timings and "
+                  "allocation counts";
+#endif
 }
 
-TEST_F(RendererTest, RenderFrameTest) {
-    renderer->initialize();
-    ASSERT_NO_THROW(renderer->renderFrame());
-}
\ No newline at end of file
+INSTANTIATE_TEST_SUITE_P(
+    Scenarios, GridBudgetTest, ::testing::ValuesIn(budgetScenarios()),
+    [](const ::testing::TestParamInfo<BudgetScenario> &info) {
+      return std::string(info.param.name);
+    });
@@ -0,0 +1,127 @@
+// Offline star catalogs: procedural galaxy -> .vstars
+//
+//   vkapp_galaxygen output.vstars [--stars N] [--seed S] [--radius PC]
+//                   [--arms N] [--filaments SHARE] [--threads N]
+//                   [--evolve STEPS] [--dt MYR] [--mass MSUN]
+//
+// Generates a spiral galaxy with bulge, halo and globular clusters, and
+// optionally cosmic-web filaments around it (GalaxyGenerator.hpp), in
+// parallel and identically for a given seed. The catalog loads in the app
+// with star_catalog = output.vstars.
+//
+// --evolve sets the galaxy rotating with the given total mass and advances
+// it STEPS Barnes-Hut steps of dt megayears (NBodySimulation) before
+// writing; the whole galaxy is then held in memory.
+
+#include "GalaxyGenerator.hpp"
+#include "JobSystem.hpp"
+#include "NBodySimulation.hpp"
+#include "StarCatalog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+int main(int argc, char **argv) {
+  std::string output;
+  GalaxyDesc desc;
+  uint32_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+  uint32_t steps = 0;
+  NBodySettings settings;
+  float mass = 1e11f;
+  bool valid = true;
+  for (int i = 1; i < argc && valid; i++) {
+    std::string arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool takesValue = arg.rfind("--", 0) == 0;
+    if (takesValue && !value) {
+      valid = false;
+      break;
+    }
+    if (arg == "--stars")
+      desc.stars = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--seed")
+      desc.seed = std::strtoull(value, nullptr, 10);
+    else if (arg == "--radius")
+      desc.radius = std::strtof(value, nullptr);
+    else if (arg == "--arms")
+      desc.arms = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--filaments")
+      desc.filamentShare = std::strtof(value, nullptr);
+    else if (arg == "--evolve")
+      steps = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    else if (arg == "--dt")
+      settings.dt = std::strtof(value, nullptr);
+    else if (arg == "--mass")
+      mass = std::strtof(value, nullptr);
+    else if (arg == "--threads")
+      threads = std::max(
+          static_cast<uint32_t>(std::strtoul(value, nullptr, 10)), 1u);
+    else if (!takesValue && output.empty())
+      output = arg;
+    else
+      valid = false;
+    if (takesValue)
+      i++;
+  }
+  if (!valid || output.empty() || desc.radius <= 0.0f || mass <= 0.0f) {
+    std::cerr << "Usage: " << argv[0]
+              << " output.vstars [--stars N] [--seed S] [--radius PC]\n"
+                 "       [--arms N] [--filaments SHARE] [--threads N]\n"
+                 "       [--evolve STEPS] [--dt MYR] [--mass MSUN]\n";
+    return EXIT_FAILURE;
+  }
+
+  JobSystem jobs(threads - 1);
+  GalaxyGenerator galaxy(desc);
+  auto start = std::chrono::steady_clock::now();
+  StarFill fill = galaxy.fill(&jobs);
+  std::unique_ptr<NBodySimulation> sim;
+  if (steps > 0) {
+    std::vector<Star> stars(galaxy.count());
+    galaxy.generate(stars.data(), 0, galaxy.count(), &jobs);
+    // Softening scales with the mean spacing of the disk stars
+    settings.softening = 50.0f * desc.radius / 15000.0f *
+                         std::cbrt(1e6f / std::max(galaxy.count(), 1u));
+    sim = std::make_unique<NBodySimulation>(
+        makeRotatingSnapshot(std::move(stars), mass, settings.softening),
+        settings);
+    uint64_t interactions = 0;
+    for (uint32_t s = 0; s < steps; s++) {
+      sim->step(&jobs);
+      interactions += sim->interactions();
+    }
+    double evolved = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::printf("%u steps to %.1f Myr in %.2f s (%.1f M interactions/s)\n",
+                steps, sim->snapshot().time, evolved,
+                interactions / std::max(evolved, 1e-9) / 1e6);
+    const std::vector<Star> &evolvedStars = sim->snapshot().stars;
+    fill = [&evolvedStars](Star *out, uint32_t first, uint32_t count) {
+      std::copy_n(evolvedStars.begin() + first, count, out);
+      return true;
+    };
+  }
+  if (!StarCatalog::write(output, galaxy.count(), desc.seed, fill)) {
+    std::cerr << "Failed to write " << output << "\n";
+    return EXIT_FAILURE;
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  size_t bytes =
+      sizeof(vstars::FileHeader) + size_t(galaxy.count()) * sizeof(Star);
+  std::printf("%s: %u stars (seed %llu), %zu bytes in %.2f s on %u threads "
+              "(%.1f M stars/s)\n",
+              output.c_str(), galaxy.count(),
+              static_cast<unsigned long long>(desc.seed), bytes, seconds,
+              threads, galaxy.count() / std::max(seconds, 1e-9) / 1e6);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+#include "Json.hpp"
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+class Parser {
+public:
+  explicit Parser(const std::string &text) : _text(text) {}
+
+  auto parse(JsonValue &out, std::string &error) -> bool {
+    bool ok = value(out, 0);
+    skipSpace();
+    if (ok && _pos != _text.size())
+      ok = fail("trailing characters");
+    if (!ok)
+      error = _error + " at byte " + std::to_string(_pos);
+    return ok;
+  }
+
+private:
+  static constexpr int MAX_DEPTH = 256;
+
+  const std::string &_text;
+  size_t _pos = 0;
+  std::string _error;
+
+  auto fail(const char *message) -> bool {
+    if (_error.empty())
+      _error = message;
+    return false;
+  }
+
+  void skipSpace() {
+    while (_pos < _text.size() && (_text[_pos] == ' ' || _text[_pos] == '\t' ||
+                                   _text[_pos] == '\r' || _text[_pos] == '\n'))
+      _pos++;
+  }
+
+  auto literal(const char *word) -> bool {
+    size_t n = std::strlen(word);
+    if (_text.compare(_pos, n, word) != 0)
+      return fail("invalid literal");
+    _pos += n;
+    return true;
+  }
+
+  auto value(JsonValue &out, int depth) -> bool {
+    if (depth > MAX_DEPTH)
+      return fail("nesting too deep");
+    skipSpace();
+    if (_pos >= _text.size())
+      return fail("unexpected end of input");
+
+    char c = _text[_pos];
+    if (c == '{')
+      return object(out, depth);
+    if (c == '[')
+      return array(out, depth);
+    if (c == '"') {
+      out.type = JsonValue::Type::String;
+      return string(out.string);
+    }
+    if (c == 't' || c == 'f') {
+      out.type = JsonValue::Type::Bool;
+      out.boolean = c == 't';
+      return literal(out.boolean ? "true" : "false");
+    }
+    if (c == 'n') {
+      out.type = JsonValue::Type::Null;
+      return literal("null");
+    }
+
+    const char *begin = _text.c_str() + _pos;
+    char *end = nullptr;
+    out.number = std::strtod(begin, &end);
+    if (end == begin)
+      return fail("unexpected character");
+    out.type = JsonValue::Type::Number;
+    _pos += static_cast<size_t>(end - begin);
+    return true;
+  }
+
+  auto object(JsonValue &out, int depth) -> bool {
+    out.type = JsonValue::Type::Object;
+    _pos++; // '{'
+    skipSpace();
+    if (_pos < _text.size() && _text[_pos] == '}') {
+      _pos++;
+      return true;
+    }
+    while (true) {
+      skipSpace();
+      std::string key;
+      if (_pos >= _text.size() || _text[_pos] != '"' || !string(key))
+        return fail("expected member name");
+      skipSpace();
+      if (_pos >= _text.size() || _text[_pos++] != ':')
+        return fail("expected ':'");
+      out.object.emplace_back(std::move(key), JsonValue{});
+      if (!value(out.object.back().second, depth + 1))
+        return false;
+      skipSpace();
+      if (_pos < _text.size() && _text[_pos] == ',') {
+        _pos++;
+        continue;
+      }
+      if (_pos < _text.size() && _text[_pos] == '}') {
+        _pos++;
+        return true;
+      }
+      return fail("expected ',' or '}'");
+    }
+  }
+
+  auto array(JsonValue &out, int depth) -> bool {
+    out.type = JsonValue::Type::Array;
+    _pos++; // '['
+    skipSpace();
+    if (_pos < _text.size() && _text[_pos] == ']') {
+      _pos++;
+      return true;
+    }
+    while (true) {
+      out.array.emplace_back();
+      if (!value(out.array.back(), depth + 1))
+        return false;
+      skipSpace();
+      if (_pos < _text.size() && _text[_pos] == ',') {
+        _pos++;
+        continue;
+      }
+      if (_pos < _text.size() && _text[_pos] == ']') {
+        _pos++;
+        return true;
+      }
+      return fail("expected ',' or ']'");
+    }
+  }
+
+  auto hex4(uint32_t &out) -> bool {
+    if (_pos + 4 > _text.size())
+      return fail("truncated \\u escape");
+    out = 0;
+    for (int i = 0; i < 4; i++) {
+      char c = _text[_pos++];
+      out <<= 4;
+      if (c >= '0' && c <= '9')
+        out |= static_cast<uint32_t>(c - '0');
+      else if (c >= 'a' && c <= 'f')
+        out |= static_cast<uint32_t>(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F')
+        out |= static_cast<uint32_t>(c - 'A' + 10);
+      else
+        return fail("bad \\u escape");
+    }
+    return true;
+  }
+
+  static void appendUtf8(std::string &s, uint32_t cp) {
+    if (cp < 0x80) {
+      s += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      s += static_cast<char>(0xC0 | (cp >> 6));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      s += static_cast<char>(0xE0 | (cp >> 12));
+      s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      s += static_cast<char>(0xF0 | (cp >> 18));
+      s += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      s += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  auto string(std::string &out) -> bool {
+    _pos++; // opening quote
+    while (_pos < _text.size()) {
+      char c = _text[_pos++];
+      if (c == '"')
+        return true;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (_pos >= _text.size())
+        break;
+      char e = _text[_pos++];
+      switch (e) {
+      case '"':
+      case '\\':
+      case '/':
+        out += e;
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u': {
+        uint32_t cp;
+        if (!hex4(cp))
+          return false;
+        if (cp >= 0xD800 && cp < 0xDC00 && _text.compare(_pos, 2, "\\u") == 0) {
+          _pos += 2;
+          uint32_t low;
+          if (!hex4(low))
+            return false;
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        appendUtf8(out, cp);
+        break;
+      }
+      default:
+        return fail("bad escape");
+      }
+    }
+    return fail("unterminated string");
+  }
+};
+
+} // namespace
+
+auto JsonValue::find(const std::string &key) const -> const JsonValue * {
+  for (const auto &member : object) {
+    if (member.first == key)
+      return &member.second;
+  }
+  return nullptr;
+}
+
+auto JsonValue::num(const std::string &key, double fallback) const
+    -> double {
+  const JsonValue *v = find(key);
+  return v && v->isNumber() ? v->number : fallback;
+}
+
+auto JsonValue::str(const std::string &key) const -> std::string {
+  const JsonValue *v = find(key);
+  return v && v->type == Type::String ? v->string : std::string();
+}
+
+auto parseJson(const std::string &text, JsonValue &out, std::string &error)
+    -> bool {
+  out = JsonValue{};
+  return Parser(text).parse(out, error);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+@brief Minimal JSON DOM, enough for glTF.
+
+Numbers are doubles; objects keep their members in file order.
+*/
+struct JsonValue {
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  Type type = Type::Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+
+  // nullptr when this is not an object or has no such member
+  auto find(const std::string &key) const -> const JsonValue *;
+  auto isNumber() const -> bool { return type == Type::Number; }
+
+  // Member lookups with a fallback for absent or mistyped members
+  auto num(const std::string &key, double fallback) const -> double;
+  auto str(const std::string &key) const -> std::string;
+};
+
+// Returns false and sets error (with the byte offset) on malformed input
+auto parseJson(const std::string &text, JsonValue &out, std::string &error)
+    -> bool;
@@ -0,0 +1,157 @@
+// Offline mesh import: OBJ / glTF -> .vmesh
+//
+//   vkapp_meshimport input.{obj,gltf,glb} output.vmesh [--no-optimize]
+//
+// Welds vertices, generates missing normals, reorders triangles for the
+// post-transform vertex cache (Forsyth) and then for overdraw, renumbers
+// vertices for fetch locality, and quantizes attributes into 12-byte
+// vertices (MeshFormat.hpp).
+
+#include "MeshFormat.hpp"
+#include "MeshLoaders.hpp"
+#include "MeshOptimize.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static auto endsWith(const std::string &s, const char *suffix) -> bool {
+  size_t n = std::strlen(suffix);
+  if (s.size() < n)
+    return false;
+  for (size_t i = 0; i < n; i++) {
+    if (std::tolower(static_cast<unsigned char>(s[s.size() - n + i])) !=
+        suffix[i])
+      return false;
+  }
+  return true;
+}
+
+static auto writeVmesh(const std::string &path, const RawMesh &mesh) -> bool {
+  vmesh::FileHeader header;
+  header.vertexCount = mesh.vertexCount();
+  header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+  header.indexSize = header.vertexCount <= 65536 ? 2 : 4;
+
+  for (int k = 0; k < 3; k++) {
+    header.boundsMin[k] = INFINITY;
+    header.boundsMax[k] = -INFINITY;
+  }
+  for (uint32_t v = 0; v < header.vertexCount; v++) {
+    for (int k = 0; k < 3; k++) {
+      header.boundsMin[k] = std::min(header.boundsMin[k], mesh.positions[v * 3 + k]);
+      header.boundsMax[k] = std::max(header.boundsMax[k], mesh.positions[v * 3 + k]);
+    }
+  }
+
+  // Sphere around the box centre; loose but cheap and conservative
+  float radius2 = 0.0f;
+  for (int k = 0; k < 3; k++)
+    header.sphere[k] = 0.5f * (header.boundsMin[k] + header.boundsMax[k]);
+  for (uint32_t v = 0; v < header.vertexCount; v++) {
+    float d2 = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      float d = mesh.positions[v * 3 + k] - header.sphere[k];
+      d2 += d * d;
+    }
+    radius2 = std::max(radius2, d2);
+  }
+  header.sphere[3] = std::sqrt(radius2);
+
+  std::vector<vmesh::PackedVertex> vertices(header.vertexCount);
+  for (uint32_t v = 0; v < header.vertexCount; v++) {
+    vmesh::PackedVertex &out = vertices[v];
+    for (int k = 0; k < 3; k++) {
+      float extent = header.boundsMax[k] - header.boundsMin[k];
+      float t = extent > 0.0f
+                    ? (mesh.positions[v * 3 + k] - header.boundsMin[k]) / extent
+                    : 0.0f;
+      out.position[k] = vmesh::quantizeUnorm16(t);
+    }
+    vmesh::octEncode(&mesh.normals[v * 3], out.normal);
+    out.uv[0] = vmesh::floatToHalf(mesh.uvs.empty() ? 0.0f : mesh.uvs[v * 2]);
+    out.uv[1] =
+        vmesh::floatToHalf(mesh.uvs.empty() ? 0.0f : mesh.uvs[v * 2 + 1]);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(vertices.data()),
+             static_cast<std::streamsize>(vertices.size() *
+                                          sizeof(vmesh::PackedVertex)));
+  if (header.indexSize == 2) {
+    std::vector<uint16_t> indices(mesh.indices.begin(), mesh.indices.end());
+    file.write(reinterpret_cast<const char *>(indices.data()),
+               static_cast<std::streamsize>(indices.size() * 2));
+  } else {
+    file.write(reinterpret_cast<const char *>(mesh.indices.data()),
+               static_cast<std::streamsize>(mesh.indices.size() * 4));
+  }
+  return static_cast<bool>(file);
+}
+
+int main(int argc, char **argv) {
+  std::string input, output;
+  bool optimize = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--no-optimize")
+      optimize = false;
+    else if (input.empty())
+      input = arg;
+    else if (output.empty())
+      output = arg;
+    else
+      input.clear(); // too many arguments
+  }
+  if (input.empty() || output.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " input.{obj,gltf,glb} output.vmesh [--no-optimize]\n";
+    return EXIT_FAILURE;
+  }
+
+  RawMesh mesh;
+  std::string error;
+  bool loaded = endsWith(input, ".obj") ? loadObj(input, mesh, error)
+                                        : loadGltf(input, mesh, error);
+  if (!loaded) {
+    std::cerr << error << "\n";
+    return EXIT_FAILURE;
+  }
+
+  weldVertices(mesh);
+  if (mesh.normals.empty())
+    generateNormals(mesh);
+
+  uint32_t vertexCount = mesh.vertexCount();
+  size_t triangles = mesh.indices.size() / 3;
+  float acmrBefore = computeAcmr(mesh.indices, vertexCount);
+  if (optimize) {
+    optimizeVertexCache(mesh.indices, vertexCount);
+    optimizeOverdraw(mesh.indices, mesh.positions);
+    optimizeVertexFetch(mesh);
+  }
+  float acmrAfter = computeAcmr(mesh.indices, mesh.vertexCount());
+
+  if (!writeVmesh(output, mesh)) {
+    std::cerr << "Failed to write " << output << "\n";
+    return EXIT_FAILURE;
+  }
+
+  size_t bytes = sizeof(vmesh::FileHeader) +
+                 mesh.vertexCount() * sizeof(vmesh::PackedVertex) +
+                 mesh.indices.size() * (mesh.vertexCount() <= 65536 ? 2 : 4);
+  std::printf("%s: %u vertices, %zu triangles, ACMR %.3f -> %.3f "
+              "(ATVR %.3f), %zu bytes\n",
+              output.c_str(), mesh.vertexCount(), triangles, acmrBefore,
+              acmrAfter,
+              acmrAfter * triangles / std::max(mesh.vertexCount(), 1u), bytes);
+  return EXIT_SUCCESS;
+}
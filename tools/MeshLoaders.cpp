@@ -0,0 +1,612 @@
+#include "MeshLoaders.hpp"
+#include "Json.hpp"
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+namespace {
+
+auto readFile(const std::string &path, std::string &out) -> bool {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return false;
+  out.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(&out[0], static_cast<std::streamsize>(out.size()));
+  return static_cast<bool>(file);
+}
+
+auto directoryOf(const std::string &path) -> std::string {
+  auto slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// OBJ indices are 1-based; negative ones count back from the end
+auto objIndex(long index, size_t count) -> long {
+  return index < 0 ? static_cast<long>(count) + index : index - 1;
+}
+
+} // namespace
+
+auto loadObj(const std::string &path, RawMesh &mesh, std::string &error)
+    -> bool {
+  std::ifstream file(path);
+  if (!file) {
+    error = "cannot open " + path;
+    return false;
+  }
+
+  std::vector<std::array<float, 3>> positions, normals;
+  std::vector<std::array<float, 2>> uvs;
+  std::map<std::tuple<long, long, long>, uint32_t> unique;
+  mesh = RawMesh{};
+  bool missingNormals = false, anyUvs = false;
+
+  auto vertex = [&](const std::string &token, uint32_t &out) -> bool {
+    long v = 0, vt = 0, vn = 0;
+    const char *s = token.c_str();
+    char *end = nullptr;
+    v = std::strtol(s, &end, 10);
+    if (*end == '/') {
+      s = end + 1;
+      if (*s != '/')
+        vt = std::strtol(s, &end, 10);
+      else
+        end = const_cast<char *>(s);
+      if (*end == '/')
+        vn = std::strtol(end + 1, &end, 10);
+    }
+    v = objIndex(v, positions.size());
+    vt = vt ? objIndex(vt, uvs.size()) : -1;
+    vn = vn ? objIndex(vn, normals.size()) : -1;
+    if (v < 0 || v >= static_cast<long>(positions.size()) ||
+        vt >= static_cast<long>(uvs.size()) ||
+        vn >= static_cast<long>(normals.size()))
+      return false;
+
+    auto it = unique.emplace(std::make_tuple(v, vt, vn), mesh.vertexCount());
+    if (it.second) {
+      mesh.positions.insert(mesh.positions.end(), positions[v].begin(),
+                            positions[v].end());
+      std::array<float, 3> n = vn >= 0 ? normals[vn]
+                                       : std::array<float, 3>{0, 0, 0};
+      mesh.normals.insert(mesh.normals.end(), n.begin(), n.end());
+      std::array<float, 2> uv = vt >= 0 ? uvs[vt] : std::array<float, 2>{0, 0};
+      mesh.uvs.push_back(uv[0]);
+      mesh.uvs.push_back(1.0f - uv[1]);
+      missingNormals |= vn < 0;
+      anyUvs |= vt >= 0;
+    }
+    out = it.first->second;
+    return true;
+  };
+
+  std::string line;
+  int lineNumber = 0;
+  std::vector<uint32_t> face;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    std::istringstream in(line);
+    std::string tag;
+    in >> tag;
+    if (tag == "v") {
+      std::array<float, 3> p{};
+      in >> p[0] >> p[1] >> p[2];
+      positions.push_back(p);
+    } else if (tag == "vn") {
+      std::array<float, 3> n{};
+      in >> n[0] >> n[1] >> n[2];
+      normals.push_back(n);
+    } else if (tag == "vt") {
+      std::array<float, 2> t{};
+      in >> t[0] >> t[1];
+      uvs.push_back(t);
+    } else if (tag == "f") {
+      face.clear();
+      std::string token;
+      while (in >> token) {
+        uint32_t index;
+        if (!vertex(token, index)) {
+          error = path + ":" + std::to_string(lineNumber) +
+                  ": bad face vertex '" + token + "'";
+          return false;
+        }
+        face.push_back(index);
+      }
+      for (size_t i = 2; i < face.size(); i++)
+        mesh.indices.insert(mesh.indices.end(),
+                            {face[0], face[i - 1], face[i]});
+    }
+  }
+
+  if (mesh.indices.empty()) {
+    error = path + ": no faces";
+    return false;
+  }
+  // Normals are regenerated for the whole mesh if any vertex lacks one
+  if (missingNormals)
+    mesh.normals.clear();
+  if (!anyUvs)
+    mesh.uvs.clear();
+  return true;
+}
+
+// ---- glTF ------------------------------------------------------------------
+
+namespace {
+
+using Mat4 = std::array<float, 16>; // column-major, like glTF
+
+constexpr Mat4 IDENTITY = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+auto multiply(const Mat4 &a, const Mat4 &b) -> Mat4 {
+  Mat4 r{};
+  for (int c = 0; c < 4; c++)
+    for (int row = 0; row < 4; row++)
+      for (int k = 0; k < 4; k++)
+        r[c * 4 + row] += a[k * 4 + row] * b[c * 4 + k];
+  return r;
+}
+
+auto nodeMatrix(const JsonValue &node) -> Mat4 {
+  if (const JsonValue *m = node.find("matrix")) {
+    Mat4 r = IDENTITY;
+    for (size_t i = 0; i < 16 && i < m->array.size(); i++)
+      r[i] = static_cast<float>(m->array[i].number);
+    return r;
+  }
+  float t[3] = {0, 0, 0}, q[4] = {0, 0, 0, 1}, s[3] = {1, 1, 1};
+  auto read = [&](const char *key, float *out, size_t n) {
+    if (const JsonValue *v = node.find(key))
+      for (size_t i = 0; i < n && i < v->array.size(); i++)
+        out[i] = static_cast<float>(v->array[i].number);
+  };
+  read("translation", t, 3);
+  read("rotation", q, 4);
+  read("scale", s, 3);
+
+  float x = q[0], y = q[1], z = q[2], w = q[3];
+  Mat4 r = {1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0,
+            2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0,
+            2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0,
+            t[0], t[1], t[2], 1};
+  for (int c = 0; c < 3; c++)
+    for (int row = 0; row < 3; row++)
+      r[c * 4 + row] *= s[c];
+  return r;
+}
+
+// Inverse transpose of the upper 3x3 (cofactor matrix), for normals
+auto normalMatrix(const Mat4 &m) -> std::array<float, 9> {
+  auto e = [&](int row, int col) { return m[col * 4 + row]; };
+  std::array<float, 9> n; // column-major 3x3
+  for (int row = 0; row < 3; row++) {
+    for (int col = 0; col < 3; col++) {
+      int r0 = (row + 1) % 3, r1 = (row + 2) % 3;
+      int c0 = (col + 1) % 3, c1 = (col + 2) % 3;
+      n[col * 3 + row] = e(r0, c0) * e(r1, c1) - e(r0, c1) * e(r1, c0);
+    }
+  }
+  return n;
+}
+
+class GltfReader {
+public:
+  GltfReader(const JsonValue &doc, std::vector<std::string> &buffers)
+      : _doc(doc), _buffers(buffers) {}
+
+  // Reads accessor as floats (normalized integers are converted)
+  auto readFloats(size_t accessorIndex, int components, std::vector<float> &out,
+                  std::string &error) const -> bool {
+    const JsonValue *acc = element("accessors", accessorIndex);
+    if (!acc)
+      return fail(error, "bad accessor index");
+    if (acc->find("sparse"))
+      return fail(error, "sparse accessors are not supported");
+
+    int type = static_cast<int>(acc->num("componentType", 0));
+    bool normalized = false;
+    if (const JsonValue *n = acc->find("normalized"))
+      normalized = n->boolean;
+    size_t count = static_cast<size_t>(acc->num("count", 0));
+    const char *data;
+    size_t stride;
+    if (!view(*acc, componentSize(type) * components, count, data, stride,
+              error))
+      return false;
+
+    out.resize(count * components);
+    for (size_t i = 0; i < count; i++) {
+      for (int c = 0; c < components; c++)
+        out[i * components + c] =
+            component(data + i * stride + c * componentSize(type), type,
+                      normalized);
+    }
+    return true;
+  }
+
+  auto readIndices(size_t accessorIndex, std::vector<uint32_t> &out,
+                   std::string &error) const -> bool {
+    const JsonValue *acc = element("accessors", accessorIndex);
+    if (!acc)
+      return fail(error, "bad index accessor");
+    int type = static_cast<int>(acc->num("componentType", 0));
+    size_t count = static_cast<size_t>(acc->num("count", 0));
+    const char *data;
+    size_t stride;
+    if (!view(*acc, componentSize(type), count, data, stride, error))
+      return false;
+
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      const char *p = data + i * stride;
+      switch (type) {
+      case 5121:
+        out[i] = static_cast<uint8_t>(*p);
+        break;
+      case 5123: {
+        uint16_t v;
+        std::memcpy(&v, p, 2);
+        out[i] = v;
+        break;
+      }
+      case 5125:
+        std::memcpy(&out[i], p, 4);
+        break;
+      default:
+        return fail(error, "bad index component type");
+      }
+    }
+    return true;
+  }
+
+  auto element(const char *array, size_t index) const -> const JsonValue * {
+    const JsonValue *a = _doc.find(array);
+    return a && index < a->array.size() ? &a->array[index] : nullptr;
+  }
+
+private:
+  const JsonValue &_doc;
+  std::vector<std::string> &_buffers;
+
+  static auto fail(std::string &error, const char *message) -> bool {
+    error = message;
+    return false;
+  }
+
+  static auto componentSize(int type) -> size_t {
+    switch (type) {
+    case 5120: // BYTE
+    case 5121: // UNSIGNED_BYTE
+      return 1;
+    case 5122: // SHORT
+    case 5123: // UNSIGNED_SHORT
+      return 2;
+    case 5125: // UNSIGNED_INT
+    case 5126: // FLOAT
+      return 4;
+    default:
+      return 0;
+    }
+  }
+
+  static auto component(const char *p, int type, bool normalized) -> float {
+    switch (type) {
+    case 5126: {
+      float f;
+      std::memcpy(&f, p, 4);
+      return f;
+    }
+    case 5120: {
+      int8_t v = static_cast<int8_t>(*p);
+      return normalized ? std::max(v / 127.0f, -1.0f) : v;
+    }
+    case 5121: {
+      uint8_t v = static_cast<uint8_t>(*p);
+      return normalized ? v / 255.0f : v;
+    }
+    case 5122: {
+      int16_t v;
+      std::memcpy(&v, p, 2);
+      return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+    }
+    case 5123: {
+      uint16_t v;
+      std::memcpy(&v, p, 2);
+      return normalized ? v / 65535.0f : v;
+    }
+    default: {
+      uint32_t v;
+      std::memcpy(&v, p, 4);
+      return static_cast<float>(v);
+    }
+    }
+  }
+
+  // Resolves accessor -> bufferView -> buffer bytes with bounds checks
+  auto view(const JsonValue &acc, size_t elementSize, size_t count,
+            const char *&data, size_t &stride, std::string &error) const
+      -> bool {
+    if (elementSize == 0)
+      return fail(error, "unsupported component type");
+    const JsonValue *bv = element(
+        "bufferViews", static_cast<size_t>(acc.num("bufferView", -1)));
+    if (!bv)
+      return fail(error, "accessor without buffer view");
+    size_t bufferIndex = static_cast<size_t>(bv->num("buffer", -1));
+    if (bufferIndex >= _buffers.size())
+      return fail(error, "bad buffer index");
+    const std::string &buffer = _buffers[bufferIndex];
+
+    size_t offset = static_cast<size_t>(bv->num("byteOffset", 0)) +
+                    static_cast<size_t>(acc.num("byteOffset", 0));
+    size_t length = static_cast<size_t>(bv->num("byteLength", 0));
+    stride = static_cast<size_t>(bv->num("byteStride", 0));
+    if (stride == 0)
+      stride = elementSize;
+    size_t needed = count ? (count - 1) * stride + elementSize : 0;
+    size_t viewStart = static_cast<size_t>(bv->num("byteOffset", 0));
+    if (offset + needed > buffer.size() || offset + needed > viewStart + length)
+      return fail(error, "accessor out of bounds");
+    data = buffer.data() + offset;
+    return true;
+  }
+};
+
+auto decodeBase64(const std::string &in, std::string &out) -> bool {
+  auto value = [](char c) -> int {
+    if (c >= 'A' && c <= 'Z')
+      return c - 'A';
+    if (c >= 'a' && c <= 'z')
+      return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+      return c - '0' + 52;
+    if (c == '+')
+      return 62;
+    if (c == '/')
+      return 63;
+    return -1;
+  };
+  out.clear();
+  uint32_t bits = 0;
+  int count = 0;
+  for (char c : in) {
+    if (c == '=')
+      break;
+    int v = value(c);
+    if (v < 0)
+      return false;
+    bits = (bits << 6) | static_cast<uint32_t>(v);
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out += static_cast<char>((bits >> count) & 0xFF);
+    }
+  }
+  return true;
+}
+
+auto loadBuffers(const JsonValue &doc, const std::string &dir,
+                 const std::string *glbChunk, std::vector<std::string> &out,
+                 std::string &error) -> bool {
+  const JsonValue *buffers = doc.find("buffers");
+  if (!buffers)
+    return true;
+  for (const auto &b : buffers->array) {
+    std::string uri = b.str("uri");
+    out.emplace_back();
+    if (uri.empty()) {
+      if (!glbChunk) {
+        error = "buffer without uri";
+        return false;
+      }
+      out.back() = *glbChunk;
+    } else if (uri.compare(0, 5, "data:") == 0) {
+      auto comma = uri.find(";base64,");
+      if (comma == std::string::npos ||
+          !decodeBase64(uri.substr(comma + 8), out.back())) {
+        error = "bad data URI";
+        return false;
+      }
+    } else if (!readFile(dir + uri, out.back())) {
+      error = "cannot read buffer " + dir + uri;
+      return false;
+    }
+  }
+  return true;
+}
+
+auto appendPrimitive(const GltfReader &reader, const JsonValue &prim,
+                     const Mat4 &world, RawMesh &mesh, bool &anyUvs,
+                     std::string &error) -> bool {
+  const JsonValue *attrs = prim.find("attributes");
+  if (!attrs || !attrs->find("POSITION"))
+    return true; // nothing to draw
+
+  std::vector<float> positions, normals, uvs;
+  if (!reader.readFloats(static_cast<size_t>(attrs->num("POSITION", -1)), 3,
+                         positions, error))
+    return false;
+  if (attrs->find("NORMAL") &&
+      !reader.readFloats(static_cast<size_t>(attrs->num("NORMAL", -1)), 3,
+                         normals, error))
+    return false;
+  if (attrs->find("TEXCOORD_0") &&
+      !reader.readFloats(static_cast<size_t>(attrs->num("TEXCOORD_0", -1)), 2,
+                         uvs, error))
+    return false;
+
+  size_t count = positions.size() / 3;
+  if ((!normals.empty() && normals.size() != count * 3) ||
+      (!uvs.empty() && uvs.size() != count * 2)) {
+    error = "attribute counts differ";
+    return false;
+  }
+  std::vector<uint32_t> indices;
+  if (prim.find("indices")) {
+    if (!reader.readIndices(static_cast<size_t>(prim.num("indices", -1)),
+                            indices, error))
+      return false;
+  } else {
+    indices.resize(count);
+    for (size_t i = 0; i < count; i++)
+      indices[i] = static_cast<uint32_t>(i);
+  }
+
+  // Transform into a primitive-local mesh first so missing normals can be
+  // generated from the final winding
+  RawMesh local;
+  auto nm = normalMatrix(world);
+  for (size_t v = 0; v < count; v++) {
+    const float *p = &positions[v * 3];
+    for (int row = 0; row < 3; row++)
+      local.positions.push_back(world[row] * p[0] + world[4 + row] * p[1] +
+                                world[8 + row] * p[2] + world[12 + row]);
+    if (!normals.empty()) {
+      const float *n = &normals[v * 3];
+      float out[3];
+      for (int row = 0; row < 3; row++)
+        out[row] = nm[row] * n[0] + nm[3 + row] * n[1] + nm[6 + row] * n[2];
+      float len = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+      for (float c : out)
+        local.normals.push_back(len > 0.0f ? c / len : 0.0f);
+    }
+  }
+
+  // A negative determinant flips the winding
+  float det = world[0] * (world[5] * world[10] - world[9] * world[6]) -
+              world[4] * (world[1] * world[10] - world[9] * world[2]) +
+              world[8] * (world[1] * world[6] - world[5] * world[2]);
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+    if (a >= count || b >= count || c >= count) {
+      error = "index out of range";
+      return false;
+    }
+    if (det < 0.0f)
+      std::swap(b, c);
+    local.indices.insert(local.indices.end(), {a, b, c});
+  }
+  if (normals.empty())
+    generateNormals(local);
+
+  uint32_t base = mesh.vertexCount();
+  mesh.positions.insert(mesh.positions.end(), local.positions.begin(),
+                        local.positions.end());
+  mesh.normals.insert(mesh.normals.end(), local.normals.begin(),
+                      local.normals.end());
+  if (uvs.empty())
+    mesh.uvs.resize(mesh.uvs.size() + count * 2, 0.0f);
+  else
+    mesh.uvs.insert(mesh.uvs.end(), uvs.begin(), uvs.begin() + count * 2);
+  anyUvs |= !uvs.empty();
+  for (uint32_t i : local.indices)
+    mesh.indices.push_back(base + i);
+  return true;
+}
+
+} // namespace
+
+auto loadGltf(const std::string &path, RawMesh &mesh, std::string &error)
+    -> bool {
+  std::string file;
+  if (!readFile(path, file)) {
+    error = "cannot open " + path;
+    return false;
+  }
+
+  std::string json, binChunk;
+  bool glb = file.size() >= 12 && file.compare(0, 4, "glTF") == 0;
+  if (glb) {
+    // 12-byte header, then (length, type, data) chunks: JSON then BIN
+    size_t pos = 12;
+    while (pos + 8 <= file.size()) {
+      uint32_t length, type;
+      std::memcpy(&length, &file[pos], 4);
+      std::memcpy(&type, &file[pos + 4], 4);
+      if (pos + 8 + length > file.size())
+        break;
+      if (type == 0x4E4F534A) // "JSON"
+        json = file.substr(pos + 8, length);
+      else if (type == 0x004E4942) // "BIN\0"
+        binChunk = file.substr(pos + 8, length);
+      pos += 8 + length;
+    }
+  } else {
+    json = std::move(file);
+  }
+
+  JsonValue doc;
+  if (!parseJson(json, doc, error)) {
+    error = path + ": " + error;
+    return false;
+  }
+  std::vector<std::string> buffers;
+  if (!loadBuffers(doc, directoryOf(path), glb ? &binChunk : nullptr, buffers,
+                   error))
+    return false;
+
+  GltfReader reader(doc, buffers);
+  mesh = RawMesh{};
+  bool anyUvs = false;
+
+  auto appendMesh = [&](size_t meshIndex, const Mat4 &world) -> bool {
+    const JsonValue *m = reader.element("meshes", meshIndex);
+    const JsonValue *prims = m ? m->find("primitives") : nullptr;
+    if (!prims)
+      return true;
+    for (const auto &prim : prims->array) {
+      if (prim.num("mode", 4) != 4) // TRIANGLES only
+        continue;
+      if (!appendPrimitive(reader, prim, world, mesh, anyUvs, error))
+        return false;
+    }
+    return true;
+  };
+
+  // Walk the default scene; files without scenes get every mesh untransformed
+  const JsonValue *scene =
+      reader.element("scenes", static_cast<size_t>(doc.num("scene", 0)));
+  if (scene && scene->find("nodes")) {
+    struct Item {
+      size_t node;
+      Mat4 parent;
+      int depth;
+    };
+    std::vector<Item> stack;
+    for (const auto &n : scene->find("nodes")->array)
+      stack.push_back({static_cast<size_t>(n.number), IDENTITY, 0});
+    while (!stack.empty()) {
+      Item item = stack.back();
+      stack.pop_back();
+      const JsonValue *node = reader.element("nodes", item.node);
+      if (!node || item.depth > 256)
+        continue;
+      Mat4 world = multiply(item.parent, nodeMatrix(*node));
+      if (node->find("mesh") &&
+          !appendMesh(static_cast<size_t>(node->num("mesh", -1)), world))
+        return false;
+      if (const JsonValue *children = node->find("children"))
+        for (const auto &c : children->array)
+          stack.push_back({static_cast<size_t>(c.number), world,
+                           item.depth + 1});
+    }
+  } else if (const JsonValue *meshes = doc.find("meshes")) {
+    for (size_t i = 0; i < meshes->array.size(); i++)
+      if (!appendMesh(i, IDENTITY))
+        return false;
+  }
+
+  if (mesh.indices.empty()) {
+    error = path + ": no triangle primitives";
+    return false;
+  }
+  if (!anyUvs)
+    mesh.uvs.clear();
+  return true;
+}
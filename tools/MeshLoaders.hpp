@@ -0,0 +1,15 @@
+#pragma once
+#include "MeshOptimize.hpp"
+#include <string>
+
+// Wavefront OBJ: v/vt/vn and polygonal faces (fan-triangulated). Vertices are
+// unique per position/uv/normal combination; V is flipped to Vulkan's
+// top-left origin.
+auto loadObj(const std::string &path, RawMesh &mesh, std::string &error)
+    -> bool;
+
+// glTF 2.0 (.gltf with external or data: URI buffers, or .glb). Triangle
+// primitives of every mesh in the default scene are merged with their node
+// transforms applied; POSITION, NORMAL and TEXCOORD_0 are read.
+auto loadGltf(const std::string &path, RawMesh &mesh, std::string &error)
+    -> bool;
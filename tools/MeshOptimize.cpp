@@ -0,0 +1,383 @@
+#include "MeshOptimize.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+
+auto computeAcmr(const std::vector<uint32_t> &indices, uint32_t vertexCount,
+                 uint32_t cacheSize) -> float {
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // FIFO: a vertex is cached if it entered within the last cacheSize misses
+  std::vector<uint64_t> enteredAt(vertexCount, 0);
+  uint64_t misses = 0;
+  for (uint32_t v : indices) {
+    if (enteredAt[v] == 0 || misses - (enteredAt[v] - 1) >= cacheSize) {
+      misses++;
+      enteredAt[v] = misses; // stored +1 so 0 means "never"
+    }
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+void generateNormals(RawMesh &mesh) {
+  uint32_t count = mesh.vertexCount();
+  mesh.normals.assign(count * 3, 0.0f);
+  const float *p = mesh.positions.data();
+  for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+    uint32_t a = mesh.indices[t], b = mesh.indices[t + 1],
+             c = mesh.indices[t + 2];
+    float e1[3], e2[3];
+    for (int k = 0; k < 3; k++) {
+      e1[k] = p[b * 3 + k] - p[a * 3 + k];
+      e2[k] = p[c * 3 + k] - p[a * 3 + k];
+    }
+    // Unnormalised cross product: length is twice the area
+    float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                  e1[0] * e2[1] - e1[1] * e2[0]};
+    for (uint32_t v : {a, b, c}) {
+      for (int k = 0; k < 3; k++)
+        mesh.normals[v * 3 + k] += n[k];
+    }
+  }
+  for (uint32_t v = 0; v < count; v++) {
+    float *n = &mesh.normals[v * 3];
+    float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len > 0.0f) {
+      n[0] /= len;
+      n[1] /= len;
+      n[2] /= len;
+    } else {
+      n[0] = 0.0f;
+      n[1] = 1.0f;
+      n[2] = 0.0f;
+    }
+  }
+}
+
+void weldVertices(RawMesh &mesh) {
+  uint32_t count = mesh.vertexCount();
+  bool hasNormals = !mesh.normals.empty();
+  bool hasUvs = !mesh.uvs.empty();
+
+  auto key = [&](uint32_t v) {
+    std::string k(reinterpret_cast<const char *>(&mesh.positions[v * 3]),
+                  3 * sizeof(float));
+    if (hasNormals)
+      k.append(reinterpret_cast<const char *>(&mesh.normals[v * 3]),
+               3 * sizeof(float));
+    if (hasUvs)
+      k.append(reinterpret_cast<const char *>(&mesh.uvs[v * 2]),
+               2 * sizeof(float));
+    return k;
+  };
+
+  std::unordered_map<std::string, uint32_t> unique;
+  std::vector<uint32_t> remap(count);
+  RawMesh out;
+  for (uint32_t v = 0; v < count; v++) {
+    auto it = unique.emplace(key(v), out.vertexCount());
+    if (it.second) {
+      out.positions.insert(out.positions.end(), &mesh.positions[v * 3],
+                           &mesh.positions[v * 3] + 3);
+      if (hasNormals)
+        out.normals.insert(out.normals.end(), &mesh.normals[v * 3],
+                           &mesh.normals[v * 3] + 3);
+      if (hasUvs)
+        out.uvs.insert(out.uvs.end(), &mesh.uvs[v * 2], &mesh.uvs[v * 2] + 2);
+    }
+    remap[v] = it.first->second;
+  }
+
+  for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+    uint32_t a = remap[mesh.indices[t]], b = remap[mesh.indices[t + 1]],
+             c = remap[mesh.indices[t + 2]];
+    if (a == b || b == c || a == c)
+      continue;
+    out.indices.insert(out.indices.end(), {a, b, c});
+  }
+  mesh = std::move(out);
+}
+
+// ---- Forsyth vertex cache optimisation ------------------------------------
+
+namespace {
+
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float FORSYTH_LAST_TRI_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY = 1.5f;
+constexpr float FORSYTH_VALENCE_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_POWER = 0.5f;
+constexpr int FORSYTH_MAX_VALENCE = 64;
+
+struct ForsythTables {
+  float cache[FORSYTH_CACHE_SIZE];
+  float valence[FORSYTH_MAX_VALENCE + 1];
+
+  ForsythTables() {
+    for (int i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+      // The three vertices of the last triangle score the same so the next
+      // triangle doesn't favour one of its edges
+      cache[i] = i < 3 ? FORSYTH_LAST_TRI_SCORE
+                       : std::pow(1.0f - float(i - 3) /
+                                             float(FORSYTH_CACHE_SIZE - 3),
+                                  FORSYTH_CACHE_DECAY);
+    }
+    valence[0] = 0.0f;
+    for (int i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+      valence[i] =
+          FORSYTH_VALENCE_SCALE * std::pow(float(i), -FORSYTH_VALENCE_POWER);
+  }
+
+  auto score(int cachePos, uint32_t remaining) const -> float {
+    if (remaining == 0)
+      return -1.0f; // no triangles left to help
+    float s = cachePos >= 0 ? cache[cachePos] : 0.0f;
+    return s + valence[std::min<uint32_t>(remaining, FORSYTH_MAX_VALENCE)];
+  }
+};
+
+} // namespace
+
+void optimizeVertexCache(std::vector<uint32_t> &indices,
+                         uint32_t vertexCount) {
+  static const ForsythTables tables;
+  size_t triCount = indices.size() / 3;
+  if (triCount == 0)
+    return;
+
+  // Vertex -> triangle adjacency (CSR)
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (uint32_t v : indices)
+    offsets[v + 1]++;
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> remaining(vertexCount, 0); // live triangles per vertex
+  for (size_t t = 0; t < triCount; t++) {
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = indices[t * 3 + k];
+      adjacency[offsets[v] + remaining[v]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<int> cachePos(vertexCount, -1);
+  std::vector<float> vertexScore(vertexCount);
+  for (uint32_t v = 0; v < vertexCount; v++)
+    vertexScore[v] = tables.score(-1, remaining[v]);
+
+  std::vector<float> triScore(triCount);
+  for (size_t t = 0; t < triCount; t++)
+    triScore[t] = vertexScore[indices[t * 3]] +
+                  vertexScore[indices[t * 3 + 1]] +
+                  vertexScore[indices[t * 3 + 2]];
+
+  std::vector<bool> emitted(triCount, false);
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+
+  std::vector<uint32_t> cache, nextCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  size_t scanCursor = 0; // for restarts once the cache holds no candidates
+  int64_t best = -1;
+  for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+    if (best < 0) {
+      // Restart: highest-scoring remaining triangle in a forward scan window
+      while (emitted[scanCursor])
+        scanCursor++;
+      best = static_cast<int64_t>(scanCursor);
+      for (size_t t = scanCursor, n = 0; t < triCount && n < 64; t++) {
+        if (emitted[t])
+          continue;
+        n++;
+        if (triScore[t] > triScore[best])
+          best = static_cast<int64_t>(t);
+      }
+    }
+
+    size_t tri = static_cast<size_t>(best);
+    emitted[tri] = true;
+    const uint32_t *v = &indices[tri * 3];
+    output.insert(output.end(), v, v + 3);
+
+    // Drop the triangle from its vertices' live lists
+    for (int k = 0; k < 3; k++) {
+      uint32_t *list = &adjacency[offsets[v[k]]];
+      uint32_t n = remaining[v[k]];
+      for (uint32_t i = 0; i < n; i++) {
+        if (list[i] == tri) {
+          list[i] = list[n - 1];
+          break;
+        }
+      }
+      remaining[v[k]]--;
+    }
+
+    // LRU update: the triangle's vertices move to the front
+    nextCache.assign(v, v + 3);
+    for (uint32_t c : cache) {
+      if (c != v[0] && c != v[1] && c != v[2])
+        nextCache.push_back(c);
+    }
+    for (size_t i = 0; i < nextCache.size(); i++) {
+      uint32_t c = nextCache[i];
+      cachePos[c] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+      vertexScore[c] = tables.score(cachePos[c], remaining[c]);
+    }
+    if (nextCache.size() > FORSYTH_CACHE_SIZE)
+      nextCache.resize(FORSYTH_CACHE_SIZE);
+    std::swap(cache, nextCache);
+
+    // Rescore triangles touching cached vertices and pick the next one there
+    best = -1;
+    float bestScore = -1.0f;
+    for (uint32_t c : cache) {
+      const uint32_t *list = &adjacency[offsets[c]];
+      for (uint32_t i = 0; i < remaining[c]; i++) {
+        uint32_t t = list[i];
+        float s = vertexScore[indices[t * 3]] +
+                  vertexScore[indices[t * 3 + 1]] +
+                  vertexScore[indices[t * 3 + 2]];
+        triScore[t] = s;
+        if (s > bestScore) {
+          bestScore = s;
+          best = t;
+        }
+      }
+    }
+  }
+  indices = std::move(output);
+}
+
+// ---- overdraw --------------------------------------------------------------
+
+void optimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<float> &positions,
+                      uint32_t cacheSize) {
+  size_t triCount = indices.size() / 3;
+  if (triCount < 2)
+    return;
+  uint32_t vertexCount = static_cast<uint32_t>(positions.size() / 3);
+
+  // Cluster starts: triangles whose three vertices all miss the FIFO cache,
+  // i.e. where the cache optimiser restarted anyway
+  std::vector<size_t> starts = {0};
+  std::vector<uint64_t> enteredAt(vertexCount, 0);
+  uint64_t misses = 0;
+  for (size_t t = 0; t < triCount; t++) {
+    int triMisses = 0;
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = indices[t * 3 + k];
+      if (enteredAt[v] == 0 || misses - (enteredAt[v] - 1) >= cacheSize) {
+        misses++;
+        enteredAt[v] = misses;
+        triMisses++;
+      }
+    }
+    if (triMisses == 3 && t != 0)
+      starts.push_back(t);
+  }
+  starts.push_back(triCount);
+  size_t clusterCount = starts.size() - 1;
+  if (clusterCount < 2)
+    return;
+
+  // Area-weighted centroid and normal per cluster and for the whole mesh
+  struct Cluster {
+    double centroid[3] = {};
+    double normal[3] = {};
+    double area = 0.0;
+    float sortKey = 0.0f;
+  };
+  std::vector<Cluster> clusters(clusterCount);
+  double meshCentroid[3] = {};
+  double meshArea = 0.0;
+  const float *p = positions.data();
+  for (size_t c = 0; c < clusterCount; c++) {
+    Cluster &cl = clusters[c];
+    for (size_t t = starts[c]; t < starts[c + 1]; t++) {
+      const float *a = &p[indices[t * 3] * 3];
+      const float *b = &p[indices[t * 3 + 1] * 3];
+      const float *d = &p[indices[t * 3 + 2] * 3];
+      double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      double e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      double n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                     e1[2] * e2[0] - e1[0] * e2[2],
+                     e1[0] * e2[1] - e1[1] * e2[0]};
+      double area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; k++) {
+        cl.centroid[k] += area * (a[k] + b[k] + d[k]) / 3.0;
+        cl.normal[k] += n[k];
+      }
+      cl.area += area;
+    }
+    for (int k = 0; k < 3; k++)
+      meshCentroid[k] += cl.centroid[k];
+    meshArea += cl.area;
+  }
+  if (meshArea <= 0.0)
+    return;
+  for (double &m : meshCentroid)
+    m /= meshArea;
+
+  // Clusters facing away from the centre are likely in front of the others
+  for (Cluster &cl : clusters) {
+    if (cl.area <= 0.0)
+      continue;
+    double len = std::sqrt(cl.normal[0] * cl.normal[0] +
+                           cl.normal[1] * cl.normal[1] +
+                           cl.normal[2] * cl.normal[2]);
+    if (len <= 0.0)
+      continue;
+    double key = 0.0;
+    for (int k = 0; k < 3; k++)
+      key += (cl.centroid[k] / cl.area - meshCentroid[k]) * cl.normal[k] / len;
+    cl.sortKey = static_cast<float>(key);
+  }
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return clusters[a].sortKey > clusters[b].sortKey;
+  });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  for (size_t c : order)
+    output.insert(output.end(), indices.begin() + starts[c] * 3,
+                  indices.begin() + starts[c + 1] * 3);
+  indices = std::move(output);
+}
+
+// ---- vertex fetch ----------------------------------------------------------
+
+void optimizeVertexFetch(RawMesh &mesh) {
+  uint32_t count = mesh.vertexCount();
+  std::vector<uint32_t> remap(count, UINT32_MAX);
+  uint32_t next = 0;
+  for (uint32_t &v : mesh.indices) {
+    if (remap[v] == UINT32_MAX)
+      remap[v] = next++;
+    v = remap[v];
+  }
+
+  // Unreferenced vertices are dropped
+  auto reorder = [&](std::vector<float> &attr, int width) {
+    if (attr.empty())
+      return;
+    std::vector<float> out(static_cast<size_t>(next) * width);
+    for (uint32_t v = 0; v < count; v++) {
+      if (remap[v] != UINT32_MAX)
+        std::memcpy(&out[remap[v] * width], &attr[v * width],
+                    width * sizeof(float));
+    }
+    attr = std::move(out);
+  };
+  reorder(mesh.positions, 3);
+  reorder(mesh.normals, 3);
+  reorder(mesh.uvs, 2);
+}
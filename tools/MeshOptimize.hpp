@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Unpacked triangle mesh as read from OBJ/glTF
+struct RawMesh {
+  std::vector<float> positions; // xyz per vertex
+  std::vector<float> normals;   // xyz per vertex, may be empty
+  std::vector<float> uvs;       // uv per vertex, may be empty
+  std::vector<uint32_t> indices;
+
+  auto vertexCount() const -> uint32_t {
+    return static_cast<uint32_t>(positions.size() / 3);
+  }
+};
+
+// Average cache miss ratio (misses per triangle) of a FIFO cache
+auto computeAcmr(const std::vector<uint32_t> &indices, uint32_t vertexCount,
+                 uint32_t cacheSize = 16) -> float;
+
+// Area-weighted vertex normals, used when the source has none
+void generateNormals(RawMesh &mesh);
+
+// Merge bit-identical vertices and drop degenerate triangles
+void weldVertices(RawMesh &mesh);
+
+// Forsyth's linear-speed vertex cache optimisation: greedily emits the
+// triangle whose vertices score highest given an LRU cache model
+void optimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount);
+
+// Splits the cache-optimised order into clusters at hard cache restarts and
+// sorts the clusters so outward-facing ones draw first. Cluster contents stay
+// intact, so the cache efficiency is preserved.
+void optimizeOverdraw(std::vector<uint32_t> &indices,
+                      const std::vector<float> &positions,
+                      uint32_t cacheSize = 16);
+
+// Renumbers vertices in order of first use so fetches walk memory forwards
+void optimizeVertexFetch(RawMesh &mesh);